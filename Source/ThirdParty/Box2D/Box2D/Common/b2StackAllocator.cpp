@@ -19,6 +19,8 @@
 #include "Box2D/Common/b2StackAllocator.h"
 #include "Box2D/Common/b2Math.h"
 
+#include <string.h>
+
 b2StackAllocator::b2StackAllocator()
 {
 	m_index = 0;
@@ -81,3 +83,66 @@ int32 b2StackAllocator::GetMaxAllocation() const
 {
 	return m_maxAllocation;
 }
+
+b2StepArena::b2StepArena()
+{
+	m_blocks = nullptr;
+	m_blockCount = 0;
+	m_blockCapacity = 0;
+	m_blockIndex = 0;
+	m_index = 0;
+}
+
+b2StepArena::~b2StepArena()
+{
+	for (int32 i = 0; i < m_blockCount; ++i)
+	{
+		b2Free(m_blocks[i].data);
+	}
+	b2Free(m_blocks);
+}
+
+void* b2StepArena::Allocate(int32 size)
+{
+	// Keep the alignment of b2Alloc
+	size = (size + 15) & ~15;
+
+	// Use the current block, or the next retained one that has room
+	while (m_blockIndex < m_blockCount)
+	{
+		b2StepArenaBlock* block = m_blocks + m_blockIndex;
+		if (m_index + size <= block->size)
+		{
+			void* p = block->data + m_index;
+			m_index += size;
+			return p;
+		}
+		++m_blockIndex;
+		m_index = 0;
+	}
+
+	if (m_blockCount == m_blockCapacity)
+	{
+		b2StepArenaBlock* oldBlocks = m_blocks;
+		m_blockCapacity = b2Max(2 * m_blockCapacity, 4);
+		m_blocks = (b2StepArenaBlock*)b2Alloc(m_blockCapacity * sizeof(b2StepArenaBlock));
+		if (oldBlocks)
+		{
+			memcpy(m_blocks, oldBlocks, m_blockCount * sizeof(b2StepArenaBlock));
+			b2Free(oldBlocks);
+		}
+	}
+
+	b2StepArenaBlock* block = m_blocks + m_blockCount;
+	block->size = b2Max(size, b2_stepArenaBlockSize);
+	block->data = (char*)b2Alloc(block->size);
+	m_blockIndex = m_blockCount++;
+	m_index = size;
+	return block->data;
+}
+
+void b2StepArena::Reset()
+{
+	m_blockIndex = 0;
+	m_index = 0;
+}
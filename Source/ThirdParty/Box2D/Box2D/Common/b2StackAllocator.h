@@ -58,4 +58,34 @@ private:
 	int32 m_entryCount;
 };
 
+// Urho3D: Default size of the blocks of b2StepArena.
+const int32 b2_stepArenaBlockSize = 64 * 1024;
+
+struct BOX2D_API b2StepArenaBlock
+{
+	char* data;
+	int32 size;
+};
+
+// Urho3D: Arena for per step allocations that are not freed in stack order, such as the islands
+// solved in parallel. Everything is released at once by Reset, and the blocks are kept for the next
+// step. Not thread-safe, allocate only from the thread that steps the world.
+class BOX2D_API b2StepArena
+{
+public:
+	b2StepArena();
+	~b2StepArena();
+
+	void* Allocate(int32 size);
+	void Reset();
+
+private:
+
+	b2StepArenaBlock* m_blocks;
+	int32 m_blockCount;
+	int32 m_blockCapacity;
+	int32 m_blockIndex;
+	int32 m_index;
+};
+
 #endif
@@ -48,9 +48,20 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 {
 	m_step = def->step;
 	m_allocator = def->allocator;
+	m_arena = def->arena;
 	m_count = def->count;
-	m_positionConstraints = (b2ContactPositionConstraint*)m_allocator->Allocate(m_count * sizeof(b2ContactPositionConstraint));
-	m_velocityConstraints = (b2ContactVelocityConstraint*)m_allocator->Allocate(m_count * sizeof(b2ContactVelocityConstraint));
+	// Urho3D: Null allocator means arena allocation, used when islands are solved in parallel
+	if (m_allocator)
+	{
+		m_positionConstraints = (b2ContactPositionConstraint*)m_allocator->Allocate(m_count * sizeof(b2ContactPositionConstraint));
+		m_velocityConstraints = (b2ContactVelocityConstraint*)m_allocator->Allocate(m_count * sizeof(b2ContactVelocityConstraint));
+	}
+	else
+	{
+		b2Assert(m_arena);
+		m_positionConstraints = (b2ContactPositionConstraint*)m_arena->Allocate(m_count * sizeof(b2ContactPositionConstraint));
+		m_velocityConstraints = (b2ContactVelocityConstraint*)m_arena->Allocate(m_count * sizeof(b2ContactVelocityConstraint));
+	}
 	m_positions = def->positions;
 	m_velocities = def->velocities;
 	m_contacts = def->contacts;
@@ -133,8 +144,12 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 
 b2ContactSolver::~b2ContactSolver()
 {
-	m_allocator->Free(m_velocityConstraints);
-	m_allocator->Free(m_positionConstraints);
+	// Urho3D: Arena allocations are released all at once at the end of the step
+	if (m_allocator)
+	{
+		m_allocator->Free(m_velocityConstraints);
+		m_allocator->Free(m_positionConstraints);
+	}
 }
 
 // Initialize position dependent portions of the velocity constraints.
@@ -27,6 +27,7 @@
 class b2Contact;
 class b2Body;
 class b2StackAllocator;
+class b2StepArena;
 struct b2ContactPositionConstraint;
 
 struct BOX2D_API b2VelocityConstraintPoint
@@ -65,6 +66,8 @@ struct BOX2D_API b2ContactSolverDef
 	b2Position* positions;
 	b2Velocity* velocities;
 	b2StackAllocator* allocator;
+	// Urho3D: Used when there is no stack allocator
+	b2StepArena* arena;
 };
 
 class BOX2D_API b2ContactSolver
@@ -86,6 +89,8 @@ public:
 	b2Position* m_positions;
 	b2Velocity* m_velocities;
 	b2StackAllocator* m_allocator;
+	// Urho3D
+	b2StepArena* m_arena;
 	b2ContactPositionConstraint* m_positionConstraints;
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
@@ -27,6 +27,8 @@
 #include "Box2D/Common/b2StackAllocator.h"
 #include "Box2D/Common/b2Timer.h"
 
+#include <new>
+
 /*
 Position Correction Notes
 =========================
@@ -150,7 +152,8 @@ b2Island::b2Island(
 	int32 contactCapacity,
 	int32 jointCapacity,
 	b2StackAllocator* allocator,
-	b2ContactListener* listener)
+	b2ContactListener* listener,
+	b2StepArena* arena)
 {
 	m_bodyCapacity = bodyCapacity;
 	m_contactCapacity = contactCapacity;
@@ -161,26 +164,56 @@ b2Island::b2Island(
 
 	m_allocator = allocator;
 	m_listener = listener;
+	m_arena = arena;
+	b2Assert(m_allocator || m_arena);
+
+	m_contactSolver = nullptr;
 
-	m_bodies = (b2Body**)m_allocator->Allocate(bodyCapacity * sizeof(b2Body*));
-	m_contacts = (b2Contact**)m_allocator->Allocate(contactCapacity	 * sizeof(b2Contact*));
-	m_joints = (b2Joint**)m_allocator->Allocate(jointCapacity * sizeof(b2Joint*));
+	m_bodies = (b2Body**)Allocate(bodyCapacity * sizeof(b2Body*));
+	m_contacts = (b2Contact**)Allocate(contactCapacity	 * sizeof(b2Contact*));
+	m_joints = (b2Joint**)Allocate(jointCapacity * sizeof(b2Joint*));
 
-	m_velocities = (b2Velocity*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Velocity));
-	m_positions = (b2Position*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Position));
+	m_velocities = (b2Velocity*)Allocate(m_bodyCapacity * sizeof(b2Velocity));
+	m_positions = (b2Position*)Allocate(m_bodyCapacity * sizeof(b2Position));
 }
 
 b2Island::~b2Island()
 {
+	b2Assert(m_contactSolver == nullptr);
+
 	// Warning: the order should reverse the constructor order.
-	m_allocator->Free(m_positions);
-	m_allocator->Free(m_velocities);
-	m_allocator->Free(m_joints);
-	m_allocator->Free(m_contacts);
-	m_allocator->Free(m_bodies);
+	Free(m_positions);
+	Free(m_velocities);
+	Free(m_joints);
+	Free(m_contacts);
+	Free(m_bodies);
+}
+
+void* b2Island::Allocate(int32 size)
+{
+	// Urho3D
+	return m_allocator ? m_allocator->Allocate(size) : m_arena->Allocate(size);
+}
+
+void b2Island::Free(void* p)
+{
+	// Urho3D: Arena allocations are released all at once at the end of the step
+	if (m_allocator)
+		m_allocator->Free(p);
 }
 
 void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
+{
+	// Urho3D: Solve is split in two phases
+	InitializeSolve(step, gravity);
+	FinishSolve(step, allowSleep);
+
+	profile->solveInit = m_profile.solveInit;
+	profile->solveVelocity = m_profile.solveVelocity;
+	profile->solvePosition = m_profile.solvePosition;
+}
+
+void b2Island::InitializeSolve(const b2TimeStep& step, const b2Vec2& gravity)
 {
 	b2Timer timer;
 
@@ -226,10 +259,9 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	timer.Reset();
 
 	// Solver data
-	b2SolverData solverData;
-	solverData.step = step;
-	solverData.positions = m_positions;
-	solverData.velocities = m_velocities;
+	m_solverData.step = step;
+	m_solverData.positions = m_positions;
+	m_solverData.velocities = m_velocities;
 
 	// Initialize velocity constraints.
 	b2ContactSolverDef contactSolverDef;
@@ -239,21 +271,32 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	contactSolverDef.positions = m_positions;
 	contactSolverDef.velocities = m_velocities;
 	contactSolverDef.allocator = m_allocator;
+	contactSolverDef.arena = m_arena;
 
-	b2ContactSolver contactSolver(&contactSolverDef);
-	contactSolver.InitializeVelocityConstraints();
+	// Urho3D: The contact solver lives until FinishSolve, allocate it after the island buffers to keep stack order
+	m_contactSolver = new (Allocate(sizeof(b2ContactSolver))) b2ContactSolver(&contactSolverDef);
+	m_contactSolver->InitializeVelocityConstraints();
 
 	if (step.warmStarting)
 	{
-		contactSolver.WarmStart();
+		m_contactSolver->WarmStart();
 	}
 	
 	for (int32 i = 0; i < m_jointCount; ++i)
 	{
-		m_joints[i]->InitVelocityConstraints(solverData);
+		m_joints[i]->InitVelocityConstraints(m_solverData);
 	}
 
-	profile->solveInit = timer.GetMilliseconds();
+	m_profile.solveInit = timer.GetMilliseconds();
+}
+
+void b2Island::FinishSolve(const b2TimeStep& step, bool allowSleep)
+{
+	b2Timer timer;
+
+	float32 h = step.dt;
+	b2ContactSolver& contactSolver = *m_contactSolver;
+	b2SolverData& solverData = m_solverData;
 
 	// Solve velocity constraints
 	timer.Reset();
@@ -269,7 +312,7 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 
 	// Store impulses for warm starting
 	contactSolver.StoreImpulses();
-	profile->solveVelocity = timer.GetMilliseconds();
+	m_profile.solveVelocity = timer.GetMilliseconds();
 
 	// Integrate positions
 	for (int32 i = 0; i < m_bodyCount; ++i)
@@ -330,6 +373,11 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
 		b2Body* body = m_bodies[i];
+		// Urho3D: Static bodies may be shared with islands solved in parallel and do not move, skip them
+		if (body->GetType() == b2_staticBody)
+		{
+			continue;
+		}
 		body->m_sweep.c = m_positions[i].c;
 		body->m_sweep.a = m_positions[i].a;
 		body->m_linearVelocity = m_velocities[i].v;
@@ -337,10 +385,15 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		body->SynchronizeTransform();
 	}
 
-	profile->solvePosition = timer.GetMilliseconds();
+	m_profile.solvePosition = timer.GetMilliseconds();
 
 	Report(contactSolver.m_velocityConstraints);
 
+	// Urho3D: Free the contact solver, it is the last allocation of this island
+	contactSolver.~b2ContactSolver();
+	Free(m_contactSolver);
+	m_contactSolver = nullptr;
+
 	if (allowSleep)
 	{
 		float32 minSleepTime = b2_maxFloat;
@@ -375,6 +428,11 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 			for (int32 i = 0; i < m_bodyCount; ++i)
 			{
 				b2Body* b = m_bodies[i];
+				// Urho3D: Static bodies may be shared with islands solved in parallel
+				if (b->GetType() == b2_staticBody)
+				{
+					continue;
+				}
 				b->SetAwake(false);
 			}
 		}
@@ -400,6 +458,7 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 	contactSolverDef.contacts = m_contacts;
 	contactSolverDef.count = m_contactCount;
 	contactSolverDef.allocator = m_allocator;
+	contactSolverDef.arena = m_arena;
 	contactSolverDef.step = subStep;
 	contactSolverDef.positions = m_positions;
 	contactSolverDef.velocities = m_velocities;
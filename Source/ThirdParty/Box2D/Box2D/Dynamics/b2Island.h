@@ -27,7 +27,9 @@
 class b2Contact;
 class b2Joint;
 class b2StackAllocator;
+class b2StepArena;
 class b2ContactListener;
+class b2ContactSolver;
 struct b2ContactVelocityConstraint;
 struct b2Profile;
 
@@ -35,8 +37,9 @@ struct b2Profile;
 class BOX2D_API b2Island
 {
 public:
+	// Urho3D: Islands solved in parallel allocate from the per step arena instead of the stack allocator
 	b2Island(int32 bodyCapacity, int32 contactCapacity, int32 jointCapacity,
-			b2StackAllocator* allocator, b2ContactListener* listener);
+			b2StackAllocator* allocator, b2ContactListener* listener, b2StepArena* arena = nullptr);
 	~b2Island();
 
 	void Clear()
@@ -48,6 +51,12 @@ public:
 
 	void Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep);
 
+	// Urho3D: Solve in two phases. The initialization reads the island indices of the bodies, which are shared
+	// between islands for static bodies, so it must run right after the island is built. The rest of the solve
+	// only touches the island's own data and may run in parallel with other islands.
+	void InitializeSolve(const b2TimeStep& step, const b2Vec2& gravity);
+	void FinishSolve(const b2TimeStep& step, bool allowSleep);
+
 	void SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiIndexB);
 
 	void Add(b2Body* body)
@@ -72,8 +81,14 @@ public:
 
 	void Report(const b2ContactVelocityConstraint* constraints);
 
+	// Urho3D: Allocate from the stack allocator, or from the arena if there is no allocator
+	void* Allocate(int32 size);
+	void Free(void* p);
+
 	b2StackAllocator* m_allocator;
 	b2ContactListener* m_listener;
+	// Urho3D
+	b2StepArena* m_arena;
 
 	b2Body** m_bodies;
 	b2Contact** m_contacts;
@@ -89,6 +104,11 @@ public:
 	int32 m_bodyCapacity;
 	int32 m_contactCapacity;
 	int32 m_jointCapacity;
+
+	// Urho3D: State between the solve phases
+	b2ContactSolver* m_contactSolver;
+	b2SolverData m_solverData;
+	b2Profile m_profile;
 };
 
 #endif
@@ -38,6 +38,7 @@ b2World::b2World(const b2Vec2& gravity)
 {
 	m_destructionListener = nullptr;
 	m_debugDraw = nullptr;
+	m_taskScheduler = nullptr;
 
 	m_bodyList = nullptr;
 	m_jointList = nullptr;
@@ -104,6 +105,31 @@ void b2World::SetDebugDraw(b2Draw* debugDraw)
 	m_debugDraw = debugDraw;
 }
 
+void b2World::SetTaskScheduler(b2TaskScheduler* taskScheduler)
+{
+	m_taskScheduler = taskScheduler;
+}
+
+// Urho3D: Islands with fewer bodies and contacts are solved right away on the calling thread
+const int32 b2_minParallelIslandSize = 16;
+
+// Urho3D: Solve the initialized islands in parallel
+struct b2ParallelIslands
+{
+	b2Island** islands;
+	b2TimeStep step;
+	bool allowSleep;
+};
+
+static void b2FinishIslands(void* context, int32 begin, int32 end)
+{
+	b2ParallelIslands* data = (b2ParallelIslands*)context;
+	for (int32 i = begin; i < end; ++i)
+	{
+		data->islands[i]->FinishSolve(data->step, data->allowSleep);
+	}
+}
+
 b2Body* b2World::CreateBody(const b2BodyDef* def)
 {
 	b2Assert(IsLocked() == false);
@@ -410,6 +436,13 @@ void b2World::Solve(const b2TimeStep& step)
 		j->m_islandFlag = false;
 	}
 
+	// Urho3D: With a task scheduler the islands are built and initialized serially, because static bodies are
+	// shared between islands, then the iterations of the large islands are solved in parallel. Their memory comes
+	// from the per step arena, which keeps its blocks between steps
+	const bool parallel = m_taskScheduler != nullptr && m_taskScheduler->GetNumThreads() > 1;
+	b2Island** parallelIslands = parallel ? (b2Island**)m_stepArena.Allocate(b2Max(m_bodyCount, 1) * sizeof(b2Island*)) : nullptr;
+	int32 parallelIslandCount = 0;
+
 	// Build and simulate all awake islands.
 	int32 stackSize = m_bodyCount;
 	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
@@ -527,11 +560,36 @@ void b2World::Solve(const b2TimeStep& step)
 			}
 		}
 
-		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
-		m_profile.solveInit += profile.solveInit;
-		m_profile.solveVelocity += profile.solveVelocity;
-		m_profile.solvePosition += profile.solvePosition;
+		if (parallel && island.m_bodyCount + island.m_contactCount >= b2_minParallelIslandSize)
+		{
+			// Urho3D: Copy the island into an exactly sized arena island that outlives this loop.
+			// Bodies are added in the same order, so the island indices stay the same
+			void* mem = m_stepArena.Allocate(sizeof(b2Island));
+			b2Island* parallelIsland = new (mem) b2Island(island.m_bodyCount, island.m_contactCount, island.m_jointCount,
+				nullptr, m_contactManager.m_contactListener, &m_stepArena);
+			for (int32 i = 0; i < island.m_bodyCount; ++i)
+			{
+				parallelIsland->Add(island.m_bodies[i]);
+			}
+			for (int32 i = 0; i < island.m_contactCount; ++i)
+			{
+				parallelIsland->Add(island.m_contacts[i]);
+			}
+			for (int32 i = 0; i < island.m_jointCount; ++i)
+			{
+				parallelIsland->Add(island.m_joints[i]);
+			}
+			parallelIsland->InitializeSolve(step, m_gravity);
+			parallelIslands[parallelIslandCount++] = parallelIsland;
+		}
+		else
+		{
+			b2Profile profile;
+			island.Solve(&profile, step, m_gravity, m_allowSleep);
+			m_profile.solveInit += profile.solveInit;
+			m_profile.solveVelocity += profile.solveVelocity;
+			m_profile.solvePosition += profile.solvePosition;
+		}
 
 		// Post solve cleanup.
 		for (int32 i = 0; i < island.m_bodyCount; ++i)
@@ -547,6 +605,33 @@ void b2World::Solve(const b2TimeStep& step)
 
 	m_stackAllocator.Free(stack);
 
+	if (parallel)
+	{
+		// Urho3D: Finish the islands in parallel and release them
+		if (parallelIslandCount > 1)
+		{
+			b2ParallelIslands data;
+			data.islands = parallelIslands;
+			data.step = step;
+			data.allowSleep = m_allowSleep;
+			m_taskScheduler->ParallelFor(parallelIslandCount, b2FinishIslands, &data);
+		}
+		else if (parallelIslandCount == 1)
+		{
+			parallelIslands[0]->FinishSolve(step, m_allowSleep);
+		}
+
+		for (int32 i = 0; i < parallelIslandCount; ++i)
+		{
+			b2Island* parallelIsland = parallelIslands[i];
+			m_profile.solveInit += parallelIsland->m_profile.solveInit;
+			m_profile.solveVelocity += parallelIsland->m_profile.solveVelocity;
+			m_profile.solvePosition += parallelIsland->m_profile.solvePosition;
+			parallelIsland->~b2Island();
+		}
+		m_stepArena.Reset();
+	}
+
 	{
 		b2Timer timer;
 		// Synchronize fixtures, check for out of range bodies.
@@ -67,6 +67,10 @@ public:
 	/// by you and must remain in scope.
 	void SetDebugDraw(b2Draw* debugDraw);
 
+	/// Urho3D: Register a task scheduler used to solve islands in parallel. The scheduler is
+	/// owned by you and must remain in scope. Pass nullptr to solve islands serially.
+	void SetTaskScheduler(b2TaskScheduler* taskScheduler);
+
 	/// Create a rigid body given a definition. No reference to the definition
 	/// is retained.
 	/// @warning This function is locked during callbacks.
@@ -233,6 +237,8 @@ private:
 
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
+	// Urho3D: Per step memory of the islands solved in parallel
+	b2StepArena m_stepArena;
 
 	int32 m_flags;
 
@@ -249,6 +255,8 @@ private:
 
 	b2DestructionListener* m_destructionListener;
 	b2Draw* m_debugDraw;
+	// Urho3D
+	b2TaskScheduler* m_taskScheduler;
 
 	// This is used to compute the time step ratio to
 	// support a variable time step.
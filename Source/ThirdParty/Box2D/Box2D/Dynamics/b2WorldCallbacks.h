@@ -119,6 +119,25 @@ public:
 	}
 };
 
+// Urho3D: Task executed by b2TaskScheduler over the range [begin, end).
+typedef void (*b2Task)(void* context, int32 begin, int32 end);
+
+/// Urho3D: Implement this class to solve islands in parallel.
+/// The world calls ParallelFor from within b2World::Step and expects it to return
+/// only after all the tasks are complete.
+/// @warning Contact listener PostSolve callbacks may be called from the worker threads.
+class BOX2D_API b2TaskScheduler
+{
+public:
+	virtual ~b2TaskScheduler() {}
+
+	/// Return the number of threads that may execute tasks.
+	virtual int32 GetNumThreads() const = 0;
+
+	/// Execute the task over the range [0, count), possibly split into several subranges.
+	virtual void ParallelFor(int32 count, b2Task task, void* context) = 0;
+};
+
 /// Callback class for AABB queries.
 /// See b2World::Query
 class BOX2D_API b2QueryCallback
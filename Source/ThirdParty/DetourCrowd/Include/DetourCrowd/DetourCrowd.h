@@ -204,11 +204,32 @@ struct dtCrowdAgentDebugInfo
 /// Type for the update callback.
 typedef void (*dtUpdateCallback)(bool positionUpdate, dtCrowdAgent* agent, float* pos, float dt);
 
+// Urho3D: Add parallel update support
+/// Type of the task executed by the task scheduler for the range of items [begin, end).
+typedef void (*dtCrowdTask)(void* context, int begin, int end, int threadIndex);
+
+// Urho3D: Add parallel update support
+/// Interface used by the crowd to run independent per-agent work in parallel.
+struct dtCrowdTaskScheduler
+{
+	virtual ~dtCrowdTaskScheduler() {}
+
+	/// Return the number of threads that may run the tasks. Thread indices passed to the tasks are less than this value.
+	virtual int getNumThreads() const = 0;
+
+	/// Run the task for all items in range [0, count) and wait until it is complete.
+	virtual void parallelFor(const int count, dtCrowdTask task, void* context) = 0;
+};
+
 /// Provides local steering behaviors for a group of agents. 
 /// @ingroup crowd
 class dtCrowd
 {
     dtUpdateCallback m_updateCallback; // Urho3D
+	dtCrowdTaskScheduler* m_taskScheduler; // Urho3D
+	dtNavMeshQuery** m_threadNavQueries; // Urho3D
+	dtObstacleAvoidanceQuery** m_threadObstacleQueries; // Urho3D
+	int m_numThreadQueries; // Urho3D
 	int m_maxAgents;
 	dtCrowdAgent* m_agents;
 	dtCrowdAgent** m_activeAgents;
@@ -242,6 +263,11 @@ class dtCrowd
 
 	bool requestMoveTargetReplan(const int idx, dtPolyRef ref, const float* pos);
 
+	// Urho3D: Add parallel update support
+	dtNavMeshQuery* getThreadNavQuery(const int threadIndex) const { return threadIndex > 0 ? m_threadNavQueries[threadIndex-1] : m_navquery; }
+	dtObstacleAvoidanceQuery* getThreadObstacleQuery(const int threadIndex) const { return threadIndex > 0 ? m_threadObstacleQueries[threadIndex-1] : m_obstacleQuery; }
+	void purgeThreadQueries();
+
 	void purge();
 	
 public:
@@ -257,6 +283,13 @@ public:
 	/// @return True if the initialization succeeded.
 	bool init(const int maxAgents, const float maxAgentRadius, dtNavMesh* nav, dtUpdateCallback cb = 0);
 	
+	// Urho3D: Add parallel update support
+	/// Sets the task scheduler used to update the agents in parallel. Must be called after init().
+	/// Position and velocity update callbacks are still invoked from the calling thread.
+	///  @param[in]		scheduler	The task scheduler, or null to update the agents serially.
+	/// @return True if the per-thread queries were allocated successfully.
+	bool setTaskScheduler(dtCrowdTaskScheduler* scheduler);
+
 	/// Sets the shared avoidance configuration for the specified index.
 	///  @param[in]		idx		The index. [Limits: 0 <= value < #DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS]
 	///  @param[in]		params	The new configuration.
@@ -23,6 +23,7 @@
 #include <float.h>
 #include <stdlib.h>
 #include <new>
+#include <atomic>
 #include "DetourCrowd.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshQuery.h"
@@ -53,6 +54,23 @@ static const int MAX_ITERS_PER_UPDATE = 100;
 static const int MAX_PATHQUEUE_NODES = 4096;
 static const int MAX_COMMON_NODES = 512;
 
+// Urho3D: Add parallel update support
+template <class T>
+static void runCrowdTask(void* context, int begin, int end, int threadIndex)
+{
+	(*static_cast<const T*>(context))(begin, end, threadIndex);
+}
+
+// Urho3D: Add parallel update support
+template <class T>
+static void parallelFor(dtCrowdTaskScheduler* scheduler, const int count, const T& task)
+{
+	if (scheduler && count > 1)
+		scheduler->parallelFor(count, &runCrowdTask<T>, (void*)&task);
+	else if (count > 0)
+		task(0, count, 0);
+}
+
 inline float tween(const float t, const float t0, const float t1)
 {
 	return dtClamp((t-t0) / (t1-t0), 0.0f, 1.0f);
@@ -333,6 +351,10 @@ Notes:
 
 dtCrowd::dtCrowd() :
 	m_updateCallback(0), // Urho3D: Add update callback support
+	m_taskScheduler(0), // Urho3D: Add parallel update support
+	m_threadNavQueries(0),
+	m_threadObstacleQueries(0),
+	m_numThreadQueries(0),
 	m_maxAgents(0),
 	m_agents(0),
 	m_activeAgents(0),
@@ -355,8 +377,72 @@ dtCrowd::~dtCrowd()
 	purge();
 }
 
+// Urho3D: Add parallel update support
+void dtCrowd::purgeThreadQueries()
+{
+	for (int i = 0; i < m_numThreadQueries; ++i)
+	{
+		dtFreeNavMeshQuery(m_threadNavQueries[i]);
+		dtFreeObstacleAvoidanceQuery(m_threadObstacleQueries[i]);
+	}
+	dtFree(m_threadNavQueries);
+	m_threadNavQueries = 0;
+	dtFree(m_threadObstacleQueries);
+	m_threadObstacleQueries = 0;
+	m_numThreadQueries = 0;
+	m_taskScheduler = 0;
+}
+
+// Urho3D: Add parallel update support
+bool dtCrowd::setTaskScheduler(dtCrowdTaskScheduler* scheduler)
+{
+	purgeThreadQueries();
+	if (!scheduler || !m_navquery)
+		return !scheduler;
+
+	// Main thread uses the crowd's own queries, other threads need their own ones.
+	const int numQueries = scheduler->getNumThreads() - 1;
+	if (numQueries > 0)
+	{
+		m_threadNavQueries = (dtNavMeshQuery**)dtAlloc(sizeof(dtNavMeshQuery*)*numQueries, DT_ALLOC_PERM);
+		m_threadObstacleQueries = (dtObstacleAvoidanceQuery**)dtAlloc(sizeof(dtObstacleAvoidanceQuery*)*numQueries, DT_ALLOC_PERM);
+		if (!m_threadNavQueries || !m_threadObstacleQueries)
+		{
+			dtFree(m_threadNavQueries);
+			m_threadNavQueries = 0;
+			dtFree(m_threadObstacleQueries);
+			m_threadObstacleQueries = 0;
+			return false;
+		}
+		memset(m_threadNavQueries, 0, sizeof(dtNavMeshQuery*)*numQueries);
+		memset(m_threadObstacleQueries, 0, sizeof(dtObstacleAvoidanceQuery*)*numQueries);
+		m_numThreadQueries = numQueries;
+
+		for (int i = 0; i < numQueries; ++i)
+		{
+			m_threadNavQueries[i] = dtAllocNavMeshQuery();
+			if (!m_threadNavQueries[i] || dtStatusFailed(m_threadNavQueries[i]->init(m_navquery->getAttachedNavMesh(), MAX_COMMON_NODES)))
+			{
+				purgeThreadQueries();
+				return false;
+			}
+			m_threadObstacleQueries[i] = dtAllocObstacleAvoidanceQuery();
+			if (!m_threadObstacleQueries[i] || !m_threadObstacleQueries[i]->init(6, 8))
+			{
+				purgeThreadQueries();
+				return false;
+			}
+		}
+	}
+
+	m_taskScheduler = scheduler;
+	return true;
+}
+
 void dtCrowd::purge()
 {
+	purgeThreadQueries(); // Urho3D
+
 	for (int i = 0; i < m_maxAgents; ++i)
 		m_agents[i].~dtCrowdAgent();
 	dtFree(m_agents);
@@ -1083,68 +1169,79 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 		m_grid->addItem((unsigned short)i, p[0]-r, p[2]-r, p[0]+r, p[2]+r);
 	}
 	
+	// Urho3D: Per-agent stages below only modify the agent itself and read the state of the neighbours
+	// that was written by the previous stage, so they may be run in parallel with per-thread queries.
+
 	// Get nearby navmesh segments and agents to collide with.
-	for (int i = 0; i < nagents; ++i)
+	parallelFor(m_taskScheduler, nagents, [&](int begin, int end, int threadIndex)
 	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-
-		// Update the collision boundary after certain distance has been passed or
-		// if it has become invalid.
-		const float updateThr = ag->params.collisionQueryRange*0.25f;
-		if (dtVdist2DSqr(ag->npos, ag->boundary.getCenter()) > dtSqr(updateThr) ||
-			!ag->boundary.isValid(m_navquery, &m_filters[ag->params.queryFilterType]))
+		dtNavMeshQuery* navquery = getThreadNavQuery(threadIndex);
+		for (int i = begin; i < end; ++i)
 		{
-			ag->boundary.update(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
-								m_navquery, &m_filters[ag->params.queryFilterType]);
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+
+			// Update the collision boundary after certain distance has been passed or
+			// if it has become invalid.
+			const float updateThr = ag->params.collisionQueryRange*0.25f;
+			if (dtVdist2DSqr(ag->npos, ag->boundary.getCenter()) > dtSqr(updateThr) ||
+				!ag->boundary.isValid(navquery, &m_filters[ag->params.queryFilterType]))
+			{
+				ag->boundary.update(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
+									navquery, &m_filters[ag->params.queryFilterType]);
+			}
+			// Query neighbour agents
+			ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
+									  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
+									  agents, nagents, m_grid);
+			for (int j = 0; j < ag->nneis; j++)
+				ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
 		}
-		// Query neighbour agents
-		ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
-								  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
-								  agents, nagents, m_grid);
-		for (int j = 0; j < ag->nneis; j++)
-			ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
-	}
+	});
 	
 	// Find next corner to steer to.
-	for (int i = 0; i < nagents; ++i)
+	parallelFor(m_taskScheduler, nagents, [&](int begin, int end, int threadIndex)
 	{
-		dtCrowdAgent* ag = agents[i];
+		dtNavMeshQuery* navquery = getThreadNavQuery(threadIndex);
+		for (int i = begin; i < end; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
 		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-			continue;
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+				continue;
 		
-		// Find corners for steering
-		ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
-												DT_CROWDAGENT_MAX_CORNERS, m_navquery, &m_filters[ag->params.queryFilterType]);
+			// Find corners for steering
+			ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
+													DT_CROWDAGENT_MAX_CORNERS, navquery, &m_filters[ag->params.queryFilterType]);
 		
-		// Check to see if the corner after the next corner is directly visible,
-		// and short cut to there.
-		if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
-		{
-			const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
-			ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, m_navquery, &m_filters[ag->params.queryFilterType]);
-			
-			// Copy data for debug purposes.
-			if (debugIdx == i)
+			// Check to see if the corner after the next corner is directly visible,
+			// and short cut to there.
+			if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
 			{
-				dtVcopy(debug->optStart, ag->corridor.getPos());
-				dtVcopy(debug->optEnd, target);
+				const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
+				ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, navquery, &m_filters[ag->params.queryFilterType]);
+			
+				// Copy data for debug purposes.
+				if (debugIdx == i)
+				{
+					dtVcopy(debug->optStart, ag->corridor.getPos());
+					dtVcopy(debug->optEnd, target);
+				}
 			}
-		}
-		else
-		{
-			// Copy data for debug purposes.
-			if (debugIdx == i)
+			else
 			{
-				dtVset(debug->optStart, 0,0,0);
-				dtVset(debug->optEnd, 0,0,0);
+				// Copy data for debug purposes.
+				if (debugIdx == i)
+				{
+					dtVset(debug->optStart, 0,0,0);
+					dtVset(debug->optEnd, 0,0,0);
+				}
 			}
 		}
-	}
+	});
 	
 	// Trigger off-mesh connections (depends on corners).
 	for (int i = 0; i < nagents; ++i)
@@ -1188,214 +1285,258 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 	}
 		
 	// Calculate steering.
-	for (int i = 0; i < nagents; ++i)
+	parallelFor(m_taskScheduler, nagents, [&](int begin, int end, int /*threadIndex*/)
 	{
-		dtCrowdAgent* ag = agents[i];
+		for (int i = begin; i < end; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
 
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
-			continue;
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
+				continue;
 		
-		float dvel[3] = {0,0,0};
+			float dvel[3] = {0,0,0};
 
-		if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-		{
-			dtVcopy(dvel, ag->targetPos);
-			ag->desiredSpeed = dtVlen(ag->targetPos);
-		}
-		else
-		{
-			// Calculate steering direction.
-			if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
-				calcSmoothSteerDirection(ag, dvel);
+			if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+			{
+				dtVcopy(dvel, ag->targetPos);
+				ag->desiredSpeed = dtVlen(ag->targetPos);
+			}
 			else
-				calcStraightSteerDirection(ag, dvel);
+			{
+				// Calculate steering direction.
+				if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
+					calcSmoothSteerDirection(ag, dvel);
+				else
+					calcStraightSteerDirection(ag, dvel);
 			
-			// Calculate speed scale, which tells the agent to slowdown at the end of the path.
-			const float slowDownRadius = ag->params.radius*2;	// TODO: make less hacky.
-			const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
+				// Calculate speed scale, which tells the agent to slowdown at the end of the path.
+				const float slowDownRadius = ag->params.radius*2;	// TODO: make less hacky.
+				const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
 				
-			ag->desiredSpeed = ag->params.maxSpeed;
-			dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
+				ag->desiredSpeed = ag->params.maxSpeed;
+				dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
+			}
+
+			// Urho3D: Store steering direction until velocity callbacks are done
+			dtVcopy(ag->dvel, dvel);
 		}
+	});
 
-		// Urho3D: Update velocity callback
-		if (m_updateCallback)
-			m_updateCallback(false, ag, dvel, dt);
+	// Urho3D: Update velocity callback, always called from the calling thread
+	if (m_updateCallback)
+	{
+		for (int i = 0; i < nagents; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
+				continue;
+			m_updateCallback(false, ag, ag->dvel, dt);
+		}
+	}
 
-		// Separation
-		if (ag->params.updateFlags & DT_CROWD_SEPARATION)
+	parallelFor(m_taskScheduler, nagents, [&](int begin, int end, int /*threadIndex*/)
+	{
+		for (int i = begin; i < end; ++i)
 		{
-			const float separationDist = ag->params.collisionQueryRange; 
-			const float invSeparationDist = 1.0f / separationDist; 
-			const float separationWeight = ag->params.separationWeight;
+			dtCrowdAgent* ag = agents[i];
+
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
+				continue;
+
+			float dvel[3];
+			dtVcopy(dvel, ag->dvel);
+
+			// Separation
+			if (ag->params.updateFlags & DT_CROWD_SEPARATION)
+			{
+				const float separationDist = ag->params.collisionQueryRange; 
+				const float invSeparationDist = 1.0f / separationDist; 
+				const float separationWeight = ag->params.separationWeight;
 			
-			float w = 0;
-			float disp[3] = {0,0,0};
+				float w = 0;
+				float disp[3] = {0,0,0};
 			
-			for (int j = 0; j < ag->nneis; ++j)
-			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+				for (int j = 0; j < ag->nneis; ++j)
+				{
+					const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
 				
-				float diff[3];
-				dtVsub(diff, ag->npos, nei->npos);
-				diff[1] = 0;
+					float diff[3];
+					dtVsub(diff, ag->npos, nei->npos);
+					diff[1] = 0;
 				
-				const float distSqr = dtVlenSqr(diff);
-				if (distSqr < 0.00001f)
-					continue;
-				if (distSqr > dtSqr(separationDist))
-					continue;
-				const float dist = dtMathSqrtf(distSqr);
-				const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
+					const float distSqr = dtVlenSqr(diff);
+					if (distSqr < 0.00001f)
+						continue;
+					if (distSqr > dtSqr(separationDist))
+						continue;
+					const float dist = dtMathSqrtf(distSqr);
+					const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
 				
-				dtVmad(disp, disp, diff, weight/dist);
-				w += 1.0f;
-			}
+					dtVmad(disp, disp, diff, weight/dist);
+					w += 1.0f;
+				}
 			
-			if (w > 0.0001f)
-			{
-				// Adjust desired velocity.
-				dtVmad(dvel, dvel, disp, 1.0f/w);
-				// Clamp desired velocity to desired speed.
-				const float speedSqr = dtVlenSqr(dvel);
-				const float desiredSqr = dtSqr(ag->desiredSpeed);
-				if (speedSqr > desiredSqr)
-					dtVscale(dvel, dvel, desiredSqr/speedSqr);
+				if (w > 0.0001f)
+				{
+					// Adjust desired velocity.
+					dtVmad(dvel, dvel, disp, 1.0f/w);
+					// Clamp desired velocity to desired speed.
+					const float speedSqr = dtVlenSqr(dvel);
+					const float desiredSqr = dtSqr(ag->desiredSpeed);
+					if (speedSqr > desiredSqr)
+						dtVscale(dvel, dvel, desiredSqr/speedSqr);
+				}
 			}
-		}
 		
-		// Set the desired velocity.
-		dtVcopy(ag->dvel, dvel);
-	}
+			// Set the desired velocity.
+			dtVcopy(ag->dvel, dvel);
+		}
+	});
 
 	// Velocity planning.
-	for (int i = 0; i < nagents; ++i)
+	std::atomic<int> velocitySampleCount(0); // Urho3D
+	parallelFor(m_taskScheduler, nagents, [&](int begin, int end, int threadIndex)
 	{
-		dtCrowdAgent* ag = agents[i];
+		dtObstacleAvoidanceQuery* obstacleQuery = getThreadObstacleQuery(threadIndex);
+		for (int i = begin; i < end; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
 		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
 		
-		if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
-		{
-			m_obstacleQuery->reset();
-			
-			// Add neighbours as obstacles.
-			for (int j = 0; j < ag->nneis; ++j)
+			if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
 			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				m_obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
-			}
+				obstacleQuery->reset();
+			
+				// Add neighbours as obstacles.
+				for (int j = 0; j < ag->nneis; ++j)
+				{
+					const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+					obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
+				}
 
-			// Append neighbour segments as obstacles.
-			for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
-			{
-				const float* s = ag->boundary.getSegment(j);
-				if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
-					continue;
-				m_obstacleQuery->addSegment(s, s+3);
-			}
+				// Append neighbour segments as obstacles.
+				for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
+				{
+					const float* s = ag->boundary.getSegment(j);
+					if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
+						continue;
+					obstacleQuery->addSegment(s, s+3);
+				}
 
-			dtObstacleAvoidanceDebugData* vod = 0;
-			if (debugIdx == i) 
-				vod = debug->vod;
+				dtObstacleAvoidanceDebugData* vod = 0;
+				if (debugIdx == i) 
+					vod = debug->vod;
 			
-			// Sample new safe velocity.
-			bool adaptive = true;
-			int ns = 0;
+				// Sample new safe velocity.
+				bool adaptive = true;
+				int ns = 0;
 
-			const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
+				const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
 				
-			if (adaptive)
-			{
-				ns = m_obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
+				if (adaptive)
+				{
+					ns = obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
+																 ag->vel, ag->dvel, ag->nvel, params, vod);
+				}
+				else
+				{
+					ns = obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
 															 ag->vel, ag->dvel, ag->nvel, params, vod);
+				}
+				velocitySampleCount += ns;
 			}
 			else
 			{
-				ns = m_obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
-														 ag->vel, ag->dvel, ag->nvel, params, vod);
+				// If not using velocity planning, new velocity is directly the desired velocity.
+				dtVcopy(ag->nvel, ag->dvel);
 			}
-			m_velocitySampleCount += ns;
-		}
-		else
-		{
-			// If not using velocity planning, new velocity is directly the desired velocity.
-			dtVcopy(ag->nvel, ag->dvel);
 		}
-	}
+	});
+	m_velocitySampleCount = velocitySampleCount;
 
 	// Integrate.
-	for (int i = 0; i < nagents; ++i)
+	parallelFor(m_taskScheduler, nagents, [&](int begin, int end, int /*threadIndex*/)
 	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		integrate(ag, dt);
-	}
+		for (int i = begin; i < end; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			integrate(ag, dt);
+		}
+	});
 	
 	// Handle collisions.
 	static const float COLLISION_RESOLVE_FACTOR = 0.7f;
 	
 	for (int iter = 0; iter < 4; ++iter)
 	{
-		for (int i = 0; i < nagents; ++i)
+		parallelFor(m_taskScheduler, nagents, [&](int begin, int end, int /*threadIndex*/)
 		{
-			dtCrowdAgent* ag = agents[i];
-			const int idx0 = getAgentIndex(ag);
+			for (int i = begin; i < end; ++i)
+			{
+				dtCrowdAgent* ag = agents[i];
+				const int idx0 = getAgentIndex(ag);
 			
-			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-				continue;
+				if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+					continue;
 
-			dtVset(ag->disp, 0,0,0);
+				dtVset(ag->disp, 0,0,0);
 			
-			float w = 0;
+				float w = 0;
 
-			for (int j = 0; j < ag->nneis; ++j)
-			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				const int idx1 = getAgentIndex(nei);
+				for (int j = 0; j < ag->nneis; ++j)
+				{
+					const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+					const int idx1 = getAgentIndex(nei);
 
-				float diff[3];
-				dtVsub(diff, ag->npos, nei->npos);
-				diff[1] = 0;
+					float diff[3];
+					dtVsub(diff, ag->npos, nei->npos);
+					diff[1] = 0;
 				
-				float dist = dtVlenSqr(diff);
-				if (dist > dtSqr(ag->params.radius + nei->params.radius))
-					continue;
-				dist = dtMathSqrtf(dist);
-				float pen = (ag->params.radius + nei->params.radius) - dist;
-				if (dist < 0.0001f)
-				{
-					// Agents on top of each other, try to choose diverging separation directions.
-					if (idx0 > idx1)
-						dtVset(diff, -ag->dvel[2],0,ag->dvel[0]);
+					float dist = dtVlenSqr(diff);
+					if (dist > dtSqr(ag->params.radius + nei->params.radius))
+						continue;
+					dist = dtMathSqrtf(dist);
+					float pen = (ag->params.radius + nei->params.radius) - dist;
+					if (dist < 0.0001f)
+					{
+						// Agents on top of each other, try to choose diverging separation directions.
+						if (idx0 > idx1)
+							dtVset(diff, -ag->dvel[2],0,ag->dvel[0]);
+						else
+							dtVset(diff, ag->dvel[2],0,-ag->dvel[0]);
+						pen = 0.01f;
+					}
 					else
-						dtVset(diff, ag->dvel[2],0,-ag->dvel[0]);
-					pen = 0.01f;
-				}
-				else
-				{
-					pen = (1.0f/dist) * (pen*0.5f) * COLLISION_RESOLVE_FACTOR;
-				}
+					{
+						pen = (1.0f/dist) * (pen*0.5f) * COLLISION_RESOLVE_FACTOR;
+					}
 				
-				// Urho3D: Avoid tremble when another agent can not move away
-				if (ag->params.separationWeight < 0.0001f) 
-					continue;
+					// Urho3D: Avoid tremble when another agent can not move away
+					if (ag->params.separationWeight < 0.0001f) 
+						continue;
 				
-				dtVmad(ag->disp, ag->disp, diff, pen);			
+					dtVmad(ag->disp, ag->disp, diff, pen);			
 				
-				w += 1.0f;
-			}
+					w += 1.0f;
+				}
 			
-			if (w > 0.0001f)
-			{
-				const float iw = 1.0f / w;
-				dtVscale(ag->disp, ag->disp, iw);
+				if (w > 0.0001f)
+				{
+					const float iw = 1.0f / w;
+					dtVscale(ag->disp, ag->disp, iw);
+				}
 			}
-		}
+		});
 		
 		for (int i = 0; i < nagents; ++i)
 		{
@@ -1407,27 +1548,39 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 		}
 	}
 	
-	for (int i = 0; i < nagents; ++i)
+	parallelFor(m_taskScheduler, nagents, [&](int begin, int end, int threadIndex)
 	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
+		dtNavMeshQuery* navquery = getThreadNavQuery(threadIndex);
+		for (int i = begin; i < end; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
 		
-		// Move along navmesh.
-		ag->corridor.movePosition(ag->npos, m_navquery, &m_filters[ag->params.queryFilterType]);
-		// Get valid constrained position back.
-		dtVcopy(ag->npos, ag->corridor.getPos());
+			// Move along navmesh.
+			ag->corridor.movePosition(ag->npos, navquery, &m_filters[ag->params.queryFilterType]);
+			// Get valid constrained position back.
+			dtVcopy(ag->npos, ag->corridor.getPos());
 
-		// If not using path, truncate the corridor to just one poly.
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-		{
-			ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
-			ag->partial = false;
+			// If not using path, truncate the corridor to just one poly.
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+			{
+				ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
+				ag->partial = false;
+			}
 		}
+	});
 
-		// Urho3D: Update position callback support
-		if (m_updateCallback)
+	// Urho3D: Update position callback support, always called from the calling thread after all agents are moved
+	if (m_updateCallback)
+	{
+		for (int i = 0; i < nagents; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
 			m_updateCallback(true, ag, ag->npos, dt);
+		}
 	}
 
 	// Update agents using off-mesh connection.
@@ -0,0 +1,590 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <EASTL/sort.h>
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkEvents.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Node.h>
+#include <Urho3D/Scene/Scene.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+/// Remote event sent periodically by the simulated clients.
+URHO3D_EVENT(E_LOADTESTACTION, LoadTestAction)
+{
+    URHO3D_PARAM(P_STAMP, Stamp);                  // long long
+}
+
+static const unsigned CTRL_FORWARD = 1;
+static const float MOVE_SPEED = 5.0f;
+static const float TURN_SPEED = 45.0f;
+static const float OBJECT_RADIUS = 50.0f;
+static const unsigned CONNECT_TIMEOUT_MSEC = 30000;
+static const StringHash VAR_STAMP("Stamp");
+static const StringHash VAR_INDEX("Index");
+
+/// Load test parameters.
+struct LoadTestParameters
+{
+    /// Number of simulated clients.
+    unsigned numClients_{100};
+    /// Measured duration in seconds.
+    float duration_{30.0f};
+    /// Number of additional moving objects in the scene.
+    unsigned numObjects_{0};
+    /// Server port.
+    unsigned short port_{2345};
+    /// Frames per second.
+    unsigned fps_{60};
+    /// Number of server worker threads.
+    unsigned numThreads_{0};
+    /// Interval of client remote events in seconds.
+    float actionInterval_{1.0f};
+    /// Simulated latency in milliseconds.
+    int latency_{0};
+    /// Simulated packet loss probability.
+    float packetLoss_{0.0f};
+    /// Maximum allowed 95th percentile server tick time in milliseconds, 0 = no limit.
+    float maxTickTime_{0.0f};
+    /// Maximum allowed 95th percentile replication latency in milliseconds, 0 = no limit.
+    float maxLatency_{0.0f};
+};
+
+/// Collected measurements.
+struct LoadTestStats
+{
+    /// Server tick times in milliseconds.
+    ea::vector<float> tickTimes_;
+    /// Latencies from a server side change to the client seeing it, in milliseconds.
+    ea::vector<float> replicationLatencies_;
+    /// Latencies of client remote events, in milliseconds.
+    ea::vector<float> remoteEventLatencies_;
+    /// Server bytes out per client per second, sampled once per second.
+    ea::vector<float> bytesOut_;
+    /// Server bytes in per client per second, sampled once per second.
+    ea::vector<float> bytesIn_;
+};
+
+/// Clock shared by the server and the clients for latency measurements.
+static HiresTimer* clock_ = nullptr;
+
+/// Return microseconds since the start of the test.
+static long long GetStamp()
+{
+    return clock_->GetUSec(false);
+}
+
+/// Load test server. Moves the node of each client according to its controls.
+class LoadTestServer : public Object
+{
+    URHO3D_OBJECT(LoadTestServer, Object);
+
+public:
+    /// Construct.
+    LoadTestServer(Context* context, LoadTestStats& stats) :
+        Object(context),
+        scene_(MakeShared<Scene>(context)),
+        stats_(stats)
+    {
+        SubscribeToEvent(E_CLIENTIDENTITY, URHO3D_HANDLER(LoadTestServer, HandleClientIdentity));
+        SubscribeToEvent(E_CLIENTDISCONNECTED, URHO3D_HANDLER(LoadTestServer, HandleClientDisconnected));
+        SubscribeToEvent(E_LOADTESTACTION, URHO3D_HANDLER(LoadTestServer, HandleLoadTestAction));
+        GetSubsystem<Network>()->RegisterRemoteEvent(E_LOADTESTACTION);
+    }
+
+    /// Create the additional moving objects.
+    void CreateObjects(unsigned numObjects)
+    {
+        for (unsigned i = 0; i < numObjects; ++i)
+            objects_.push_back(SharedPtr<Node>(scene_->CreateChild("Object" + ea::to_string(i))));
+    }
+
+    /// Apply client controls and move the objects.
+    void Update(float timeStep)
+    {
+        const long long stamp = GetStamp();
+
+        for (auto& pair : clientNodes_)
+        {
+            const Controls& controls = pair.first->GetControls();
+            Node* node = pair.second;
+            node->SetRotation(Quaternion(controls.yaw_, Vector3::UP));
+            if (controls.buttons_ & CTRL_FORWARD)
+                node->Translate(Vector3::FORWARD * MOVE_SPEED * timeStep);
+            node->SetVar(VAR_STAMP, stamp);
+        }
+
+        time_ += timeStep;
+        for (unsigned i = 0; i < objects_.size(); ++i)
+        {
+            const float angle = time_ * TURN_SPEED + i * 360.0f / objects_.size();
+            objects_[i]->SetPosition(Vector3(Cos(angle), 0.0f, Sin(angle)) * OBJECT_RADIUS);
+            objects_[i]->SetRotation(Quaternion(angle, Vector3::UP));
+        }
+    }
+
+    /// Return number of clients that have been assigned a node.
+    unsigned GetNumClients() const { return clientNodes_.size(); }
+    /// Return number of remote events received.
+    unsigned GetNumRemoteEvents() const { return numRemoteEvents_; }
+
+    /// Whether remote event latencies are recorded.
+    bool measuring_{};
+
+private:
+    /// Handle client identity. Assign the client to the scene and create its node.
+    void HandleClientIdentity(StringHash /*eventType*/, VariantMap& eventData)
+    {
+        using namespace ClientIdentity;
+
+        auto* connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+        const unsigned index = connection->GetIdentity()[VAR_INDEX].GetUInt();
+        connection->SetScene(scene_);
+        clientNodes_[connection] = scene_->CreateChild("Client" + ea::to_string(index));
+    }
+
+    /// Handle client disconnection.
+    void HandleClientDisconnected(StringHash /*eventType*/, VariantMap& eventData)
+    {
+        using namespace ClientDisconnected;
+
+        auto* connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+        auto i = clientNodes_.find(connection);
+        if (i != clientNodes_.end())
+        {
+            i->second->Remove();
+            clientNodes_.erase(i);
+        }
+    }
+
+    /// Handle a client remote event.
+    void HandleLoadTestAction(StringHash /*eventType*/, VariantMap& eventData)
+    {
+        using namespace LoadTestAction;
+
+        ++numRemoteEvents_;
+        if (measuring_)
+            stats_.remoteEventLatencies_.push_back((GetStamp() - eventData[P_STAMP].GetInt64()) / 1000.0f);
+    }
+
+    /// Scene.
+    SharedPtr<Scene> scene_;
+    /// Measurements.
+    LoadTestStats& stats_;
+    /// Client nodes by connection.
+    ea::unordered_map<Connection*, SharedPtr<Node> > clientNodes_;
+    /// Additional moving objects.
+    ea::vector<SharedPtr<Node> > objects_;
+    /// Elapsed time.
+    float time_{};
+    /// Number of remote events received.
+    unsigned numRemoteEvents_{};
+};
+
+/// Simulated client with its own context. Replays a scripted movement pattern and sends remote events periodically.
+class LoadTestClient
+{
+public:
+    /// Construct. Create the client context and connect to the server.
+    LoadTestClient(unsigned index, const LoadTestParameters& parameters, LoadTestStats& stats) :
+        context_(MakeShared<Context>()),
+        index_(index),
+        stats_(stats)
+    {
+        context_->RegisterSubsystem(new WorkQueue(context_));
+        context_->RegisterSubsystem(new FileSystem(context_));
+        context_->RegisterSubsystem(new ResourceCache(context_));
+        network_ = new Network(context_);
+        context_->RegisterSubsystem(network_);
+        RegisterSceneLibrary(context_);
+
+        scene_ = MakeShared<Scene>(context_);
+
+        // Spread the clients evenly on the movement script and the remote event interval
+        phase_ = index * 137.5f;
+        actionTimer_ = parameters.actionInterval_ * index / Max(parameters.numClients_, 1u);
+        actionInterval_ = parameters.actionInterval_;
+
+        VariantMap identity;
+        identity[VAR_INDEX] = index;
+        network_->Connect("127.0.0.1", parameters.port_, scene_, identity);
+    }
+
+    /// Destruct. Disconnect and destroy the scene before the context.
+    ~LoadTestClient()
+    {
+        network_->Disconnect();
+        node_.Reset();
+        scene_.Reset();
+    }
+
+    /// Update the simulated client.
+    void Update(float timeStep)
+    {
+        network_->Update(timeStep);
+
+        Connection* connection = network_->GetServerConnection();
+        if (connection && connection->IsSceneLoaded())
+        {
+            if (!node_)
+                node_ = scene_->GetChild("Client" + ea::to_string(index_));
+
+            if (node_)
+            {
+                const long long stamp = node_->GetVar(VAR_STAMP).GetInt64();
+                if (stamp && stamp != lastStamp_)
+                {
+                    if (measuring_)
+                        stats_.replicationLatencies_.push_back((GetStamp() - stamp) / 1000.0f);
+                    lastStamp_ = stamp;
+                }
+            }
+
+            // Turn continuously and pause the movement for a while every ten seconds
+            time_ += timeStep;
+            Controls controls;
+            controls.yaw_ = phase_ + time_ * TURN_SPEED;
+            if (fmodf(time_ + phase_, 10.0f) < 8.0f)
+                controls.buttons_ = CTRL_FORWARD;
+            connection->SetControls(controls);
+
+            if (actionInterval_ > 0.0f)
+            {
+                actionTimer_ += timeStep;
+                if (actionTimer_ >= actionInterval_)
+                {
+                    using namespace LoadTestAction;
+
+                    actionTimer_ = fmodf(actionTimer_, actionInterval_);
+                    VariantMap eventData;
+                    eventData[P_STAMP] = GetStamp();
+                    connection->SendRemoteEvent(E_LOADTESTACTION, true, eventData);
+                }
+            }
+        }
+
+        network_->PostUpdate(timeStep);
+    }
+
+    /// Return whether the client has received its node.
+    bool IsReady() const { return node_ != nullptr; }
+
+    /// Whether replication latencies are recorded.
+    bool measuring_{};
+
+private:
+    /// Client context.
+    SharedPtr<Context> context_;
+    /// Network subsystem.
+    Network* network_{};
+    /// Client scene.
+    SharedPtr<Scene> scene_;
+    /// Replicated node of this client.
+    WeakPtr<Node> node_;
+    /// Client index.
+    unsigned index_;
+    /// Measurements.
+    LoadTestStats& stats_;
+    /// Movement script phase.
+    float phase_{};
+    /// Elapsed time since the scene was loaded.
+    float time_{};
+    /// Remote event timer.
+    float actionTimer_{};
+    /// Remote event interval.
+    float actionInterval_{};
+    /// Last received server stamp.
+    long long lastStamp_{};
+};
+
+int main(int argc, char** argv);
+void Run(const ea::vector<ea::string>& arguments);
+LoadTestParameters ParseParameters(const ea::vector<ea::string>& arguments);
+void PrintDistribution(const ea::string& name, ea::vector<float>& values);
+float GetPercentile(const ea::vector<float>& sortedValues, float percentile);
+float GetAverage(const ea::vector<float>& values);
+
+int main(int argc, char** argv)
+{
+    ea::vector<ea::string> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
+
+void Run(const ea::vector<ea::string>& arguments)
+{
+    const LoadTestParameters parameters = ParseParameters(arguments);
+
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new Time(context));
+    auto* workQueue = new WorkQueue(context);
+    context->RegisterSubsystem(workQueue);
+    context->RegisterSubsystem(new FileSystem(context));
+#ifdef URHO3D_LOGGING
+    auto* log = new Log(context);
+    context->RegisterSubsystem(log);
+    log->SetLevel(LOG_WARNING);
+#endif
+    context->RegisterSubsystem(new ResourceCache(context));
+    auto* network = new Network(context);
+    context->RegisterSubsystem(network);
+    RegisterSceneLibrary(context);
+
+    if (parameters.numThreads_)
+        workQueue->CreateThreads(parameters.numThreads_);
+
+    HiresTimer clock;
+    clock_ = &clock;
+
+    LoadTestStats stats;
+    SharedPtr<LoadTestServer> server(new LoadTestServer(context, stats));
+    server->CreateObjects(parameters.numObjects_);
+
+    network->SetSimulatedLatency(parameters.latency_);
+    network->SetSimulatedPacketLoss(parameters.packetLoss_);
+    if (!network->StartServer(parameters.port_, parameters.numClients_))
+        ErrorExit("Failed to start server on port " + ea::to_string(parameters.port_));
+
+    PrintLine("Connecting " + ea::to_string(parameters.numClients_) + " clients");
+
+    ea::vector<ea::unique_ptr<LoadTestClient> > clients;
+    for (unsigned i = 0; i < parameters.numClients_; ++i)
+        clients.push_back(ea::make_unique<LoadTestClient>(i, parameters, stats));
+
+    const float timeStep = 1.0f / parameters.fps_;
+    const long long frameUSec = 1000000 / parameters.fps_;
+    HiresTimer frameTimer;
+    Timer connectTimer;
+    Timer sampleTimer;
+    bool measuring = false;
+    float measuredTime = 0.0f;
+
+    while (!measuring || measuredTime < parameters.duration_)
+    {
+        frameTimer.Reset();
+
+        // Server tick
+        {
+            HiresTimer tickTimer;
+            network->Update(timeStep);
+            server->Update(timeStep);
+            network->PostUpdate(timeStep);
+            if (measuring)
+                stats.tickTimes_.push_back(tickTimer.GetUSec(false) / 1000.0f);
+        }
+
+        for (auto& client : clients)
+            client->Update(timeStep);
+
+        if (!measuring)
+        {
+            unsigned numReady = 0;
+            for (auto& client : clients)
+                numReady += client->IsReady() ? 1 : 0;
+
+            if (numReady == clients.size() || connectTimer.GetMSec(false) > CONNECT_TIMEOUT_MSEC)
+            {
+                PrintLine(ea::to_string(numReady) + " of " + ea::to_string(clients.size()) + " clients connected, measuring for " +
+                    ea::to_string(parameters.duration_) + " seconds");
+
+                measuring = true;
+                server->measuring_ = true;
+                for (auto& client : clients)
+                    client->measuring_ = true;
+                sampleTimer.Reset();
+            }
+        }
+        else
+        {
+            measuredTime += timeStep;
+
+            if (sampleTimer.GetMSec(false) >= 1000)
+            {
+                sampleTimer.Reset();
+                ea::vector<SharedPtr<Connection> > connections = network->GetClientConnections();
+                if (!connections.empty())
+                {
+                    float bytesOut = 0.0f;
+                    float bytesIn = 0.0f;
+                    for (Connection* connection : connections)
+                    {
+                        bytesOut += connection->GetBytesOutPerSec();
+                        bytesIn += connection->GetBytesInPerSec();
+                    }
+                    stats.bytesOut_.push_back(bytesOut / connections.size());
+                    stats.bytesIn_.push_back(bytesIn / connections.size());
+                }
+            }
+        }
+
+        const long long elapsed = frameTimer.GetUSec(false);
+        if (elapsed < frameUSec)
+            Time::Sleep((unsigned)((frameUSec - elapsed) / 1000));
+    }
+
+    PrintLine("");
+    PrintLine("Clients: " + ea::to_string(server->GetNumClients()));
+    PrintLine("Remote events received: " + ea::to_string(server->GetNumRemoteEvents()));
+    PrintLine(Format("Server bytes out per client per second: {:.0f}", GetAverage(stats.bytesOut_)));
+    PrintLine(Format("Server bytes in per client per second: {:.0f}", GetAverage(stats.bytesIn_)));
+    PrintDistribution("Server tick time", stats.tickTimes_);
+    PrintDistribution("Replication latency", stats.replicationLatencies_);
+    PrintDistribution("Remote event latency", stats.remoteEventLatencies_);
+
+    clients.clear();
+    network->StopServer();
+
+    // Fail when a limit was given and exceeded, so that the tool can be used to catch regressions
+    if (parameters.maxTickTime_ > 0.0f && GetPercentile(stats.tickTimes_, 95.0f) > parameters.maxTickTime_)
+        ErrorExit("Server tick time exceeds the limit");
+    if (parameters.maxLatency_ > 0.0f && GetPercentile(stats.replicationLatencies_, 95.0f) > parameters.maxLatency_)
+        ErrorExit("Replication latency exceeds the limit");
+}
+
+LoadTestParameters ParseParameters(const ea::vector<ea::string>& arguments)
+{
+    LoadTestParameters parameters;
+
+    for (unsigned i = 0; i < arguments.size(); ++i)
+    {
+        const ea::string& argument = arguments[i];
+        if (argument.length() != 2 || argument[0] != '-' || i + 1 >= arguments.size())
+        {
+            ErrorExit(
+                "Usage: NetworkLoadTest [options]\n"
+                "\n"
+                "Options:\n"
+                "-c      Number of simulated clients, default 100\n"
+                "-d      Measured duration in seconds, default 30\n"
+                "-o      Number of additional moving objects, default 0\n"
+                "-p      Server port, default 2345\n"
+                "-f      Frames per second, default 60\n"
+                "-t      Number of server worker threads, default 0\n"
+                "-e      Interval of client remote events in seconds, 0 to disable, default 1\n"
+                "-l      Simulated latency in milliseconds, default 0\n"
+                "-x      Simulated packet loss probability, default 0\n"
+                "-m      Fail if the 95th percentile server tick time in milliseconds exceeds this\n"
+                "-r      Fail if the 95th percentile replication latency in milliseconds exceeds this\n"
+            );
+        }
+
+        const ea::string& value = arguments[++i];
+        switch (argument[1])
+        {
+        case 'c':
+            parameters.numClients_ = Max(ToUInt(value), 1u);
+            break;
+        case 'd':
+            parameters.duration_ = ToFloat(value);
+            break;
+        case 'o':
+            parameters.numObjects_ = ToUInt(value);
+            break;
+        case 'p':
+            parameters.port_ = (unsigned short)ToUInt(value);
+            break;
+        case 'f':
+            parameters.fps_ = Max(ToUInt(value), 1u);
+            break;
+        case 't':
+            parameters.numThreads_ = ToUInt(value);
+            break;
+        case 'e':
+            parameters.actionInterval_ = ToFloat(value);
+            break;
+        case 'l':
+            parameters.latency_ = ToInt(value);
+            break;
+        case 'x':
+            parameters.packetLoss_ = ToFloat(value);
+            break;
+        case 'm':
+            parameters.maxTickTime_ = ToFloat(value);
+            break;
+        case 'r':
+            parameters.maxLatency_ = ToFloat(value);
+            break;
+        default:
+            ErrorExit("Unrecognized option " + argument);
+        }
+    }
+
+    return parameters;
+}
+
+void PrintDistribution(const ea::string& name, ea::vector<float>& values)
+{
+    if (values.empty())
+    {
+        PrintLine(name + " (ms): no samples");
+        return;
+    }
+
+    ea::sort(values.begin(), values.end());
+    PrintLine(Format("{} (ms): avg {:.2f}, p50 {:.2f}, p95 {:.2f}, p99 {:.2f}, max {:.2f} ({} samples)", name,
+        GetAverage(values), GetPercentile(values, 50.0f), GetPercentile(values, 95.0f), GetPercentile(values, 99.0f),
+        values.back(), values.size()));
+}
+
+float GetPercentile(const ea::vector<float>& sortedValues, float percentile)
+{
+    if (sortedValues.empty())
+        return 0.0f;
+
+    const auto index = (unsigned)(percentile / 100.0f * (sortedValues.size() - 1) + 0.5f);
+    return sortedValues[Min(index, sortedValues.size() - 1)];
+}
+
+float GetAverage(const ea::vector<float>& values)
+{
+    if (values.empty())
+        return 0.0f;
+
+    float sum = 0.0f;
+    for (float value : values)
+        sum += value;
+    return sum / values.size();
+}
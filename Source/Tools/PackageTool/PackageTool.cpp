@@ -49,6 +49,7 @@ struct FileEntry
     unsigned offset_{};
     unsigned size_{};
     unsigned checksum_{};
+    ea::vector<unsigned> blockSizes_;
 };
 
 Context* context_ = nullptr;
@@ -57,8 +58,10 @@ ea::string basePath_;
 ea::vector<FileEntry> entries_;
 unsigned checksum_ = 0;
 bool compress_ = false;
+bool sequential_ = false;
 bool quiet_ = false;
 unsigned blockSize_ = COMPRESSED_BLOCK_SIZE;
+unsigned fileListOffset_ = 0;
 
 ea::string ignoreExtensions_[] = {
     ".bak",
@@ -97,6 +100,7 @@ void Run(const ea::vector<ea::string>& arguments)
             "\n"
             "Options:\n"
             "-c      Enable package file LZ4 compression\n"
+            "-s      Write compressed blocks sequentially in the old format without random access\n"
             "-q      Enable quiet mode\n"
             "\n"
             "Basepath is an optional prefix that will be added to the file entries.\n\n"
@@ -125,6 +129,9 @@ void Run(const ea::vector<ea::string>& arguments)
                     case 'c':
                         compress_ = true;
                         break;
+                    case 's':
+                        sequential_ = true;
+                        break;
                     case 'q':
                         quiet_ = true;
                         break;
@@ -206,6 +213,8 @@ void Run(const ea::vector<ea::string>& arguments)
             PrintLine("Package size: " + ea::to_string(packageFile->GetTotalSize()));
             PrintLine("Checksum: " + ea::to_string(packageFile->GetChecksum()));
             PrintLine("Compressed: " + ea::string(packageFile->IsCompressed() ? "yes" : "no"));
+            if (packageFile->GetBlockSize())
+                PrintLine("Block size: " + ea::to_string(packageFile->GetBlockSize()));
             break;
         case 'L':
             if (!packageFile->IsCompressed())
@@ -221,7 +230,8 @@ void Run(const ea::vector<ea::string>& arguments)
                     ea::string fileEntry(current->first);
                     if (outputCompressionRatio)
                     {
-                        unsigned compressedSize =
+                        const ea::vector<unsigned>& blocks = current->second.blocks_;
+                        unsigned compressedSize = !blocks.empty() ? blocks.back() - blocks.front() :
                             (i == entries.end() ? packageFile->GetTotalSize() - sizeof(unsigned) : i->second.offset_) -
                             current->second.offset_;
                         fileEntry.append_sprintf("\tin: %u\tout: %u\tratio: %f", current->second.size_, compressedSize,
@@ -261,10 +271,13 @@ void WritePackageFile(const ea::string& fileName, const ea::string& rootDir)
     if (!dest.Open(fileName, FILE_WRITE))
         ErrorExit("Could not open output file " + fileName);
 
+    // Block-compressed packages have the file list with the block tables at the end
+    const bool blockCompress = compress_ && !sequential_;
+
     // Write ID, number of files & placeholder for checksum
     WriteHeader(dest);
 
-    for (unsigned i = 0; i < entries_.size(); ++i)
+    for (unsigned i = 0; i < entries_.size() && !blockCompress; ++i)
     {
         // Write entry (correct offset is still unknown, will be filled in later)
         dest.WriteString(basePath_ + entries_[i].name_);
@@ -322,9 +335,26 @@ void WritePackageFile(const ea::string& fileName, const ea::string& rootDir)
                 if (!packedSize)
                     ErrorExit("LZ4 compression failed for file " + entries_[i].name_ + " at offset " + ea::to_string(pos));
 
-                dest.WriteUShort((unsigned short)unpackedSize);
-                dest.WriteUShort((unsigned short)packedSize);
-                dest.Write(compressBuffer.get(), packedSize);
+                if (blockCompress)
+                {
+                    // Store blocks that do not compress as is, marked by the packed size being equal to the unpacked size
+                    if (packedSize >= unpackedSize)
+                    {
+                        dest.Write(&buffer[pos], unpackedSize);
+                        entries_[i].blockSizes_.push_back(unpackedSize);
+                    }
+                    else
+                    {
+                        dest.Write(compressBuffer.get(), packedSize);
+                        entries_[i].blockSizes_.push_back(packedSize);
+                    }
+                }
+                else
+                {
+                    dest.WriteUShort((unsigned short)unpackedSize);
+                    dest.WriteUShort((unsigned short)packedSize);
+                    dest.Write(compressBuffer.get(), packedSize);
+                }
 
                 pos += unpackedSize;
             }
@@ -340,6 +370,20 @@ void WritePackageFile(const ea::string& fileName, const ea::string& rootDir)
         }
     }
 
+    if (blockCompress)
+    {
+        fileListOffset_ = dest.GetSize();
+        for (unsigned i = 0; i < entries_.size(); ++i)
+        {
+            dest.WriteString(basePath_ + entries_[i].name_);
+            dest.WriteUInt(entries_[i].offset_);
+            dest.WriteUInt(entries_[i].size_);
+            dest.WriteUInt(entries_[i].checksum_);
+            for (unsigned blockSize : entries_[i].blockSizes_)
+                dest.WriteUInt(blockSize);
+        }
+    }
+
     // Write package size to the end of file to allow finding it linked to an executable file
     unsigned currentSize = dest.GetSize();
     dest.WriteUInt(currentSize + sizeof(unsigned));
@@ -348,7 +392,7 @@ void WritePackageFile(const ea::string& fileName, const ea::string& rootDir)
     dest.Seek(0);
     WriteHeader(dest);
 
-    for (unsigned i = 0; i < entries_.size(); ++i)
+    for (unsigned i = 0; i < entries_.size() && !blockCompress; ++i)
     {
         dest.WriteString(basePath_ + entries_[i].name_);
         dest.WriteUInt(entries_[i].offset_);
@@ -368,6 +412,17 @@ void WritePackageFile(const ea::string& fileName, const ea::string& rootDir)
 
 void WriteHeader(File& dest)
 {
+    if (compress_ && !sequential_)
+    {
+        dest.WriteFileID("RLZ4");
+        dest.WriteUInt(entries_.size());
+        dest.WriteUInt(checksum_);
+        dest.WriteUInt(PACKAGE_VERSION_BLOCKS);
+        dest.WriteInt64(fileListOffset_);
+        dest.WriteUInt(blockSize_);
+        return;
+    }
+
     if (!compress_)
         dest.WriteFileID("UPAK");
     else
@@ -346,6 +346,8 @@ namespace SDL
 // --------------------------------------- IO ---------------------------------------
 %include "_properties_io.i"
 %ignore Urho3D::GetWideNativePath;
+%ignore Urho3D::Deserializer::GetInMemoryData;
+%ignore Urho3D::PackageFile::GetMappedData;
 %ignore Urho3D::logLevelNames;
 %ignore Urho3D::LOG_LEVEL_COLORS;
 
@@ -642,6 +644,8 @@ public:
 %ignore Urho3D::Network::MakeHttpRequest;
 %ignore Urho3D::PackageDownload;
 %ignore Urho3D::PackageUpload;
+%ignore Urho3D::PackageUploadSource;
+%ignore Urho3D::Network::GetPackageUploadSource;
 
 %template(ConnectionVector) eastl::vector<Urho3D::SharedPtr<Urho3D::Connection>>;
 
@@ -660,6 +664,7 @@ public:
 %include "Urho3D/Network/Connection.h"
 %include "Urho3D/Network/Network.h"
 %include "Urho3D/Network/NetworkPriority.h"
+%include "Urho3D/Network/NetworkInterestGrid.h"
 %include "Urho3D/Network/Protocol.h"
 #endif
 
@@ -172,7 +172,7 @@
     get { return GetNetPositionAttr(); }
     set { SetNetPositionAttr(value); }
   }
-  public $typemap(cstype, const eastl::vector<unsigned char> &) NetRotationAttr {
+  public $typemap(cstype, const Urho3D::Quaternion &) NetRotationAttr {
     get { return GetNetRotationAttr(); }
     set { SetNetRotationAttr(value); }
   }
@@ -86,6 +86,7 @@ URHO3D_REFCOUNTED(Urho3D::Connection);
 URHO3D_REFCOUNTED(Urho3D::HttpRequest);
 URHO3D_REFCOUNTED(Urho3D::Network);
 URHO3D_REFCOUNTED(Urho3D::NetworkPriority);
+URHO3D_REFCOUNTED(Urho3D::NetworkInterestGrid);
 URHO3D_REFCOUNTED(Urho3D::CollisionGeometryData);
 URHO3D_REFCOUNTED(Urho3D::TriangleMeshData);
 URHO3D_REFCOUNTED(Urho3D::GImpactMeshData);
@@ -359,6 +359,8 @@ bool Engine::InitializeResourceCache(const VariantMap& parameters, bool removeOl
             cache->RemovePackageFile(packageFiles[i].Get());
     }
 
+    cache->SetMemoryMapPackages(GetParameter(parameters, EP_MEMORY_MAP_PACKAGES, false).GetBool());
+
     // Add resource paths
     ea::vector<ea::string> resourcePrefixPaths = GetParameter(parameters, EP_RESOURCE_PREFIX_PATHS,
         EMPTY_STRING).GetString().split(';', true);
@@ -948,6 +950,7 @@ void Engine::DefineParameters(CLI::App& commandLine, VariantMap& engineParameter
     addOptionString("--pp,--prefix-paths", EP_RESOURCE_PREFIX_PATHS, "Resource prefix paths")->envname("URHO3D_PREFIX_PATH")->set_custom_option("path1;path2;...");
     addOptionString("--pr,--resource-paths", EP_RESOURCE_PATHS, "Resource paths")->set_custom_option("path1;path2;...");
     addOptionString("--pf,--resource-packages", EP_RESOURCE_PACKAGES, "Resource packages")->set_custom_option("path1;path2;...");
+    addFlag("--mmap", EP_MEMORY_MAP_PACKAGES, true, "Memory-map resource packages");
     addOptionString("--ap,--autoload-paths", EP_AUTOLOAD_PATHS, "Resource autoload paths")->set_custom_option("path1;path2;...");
     addOptionString("--ds,--dump-shaders", EP_DUMP_SHADERS, "Dump shaders")->set_custom_option("filename");
     addFlagInternal("--mq,--material-quality", "Material quality", [&](CLI::results_t res) {
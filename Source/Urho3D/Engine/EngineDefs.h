@@ -45,6 +45,7 @@ static const ea::string EP_LOG_NAME = "LogName";
 static const ea::string EP_LOG_QUIET = "LogQuiet";
 static const ea::string EP_LOW_QUALITY_SHADOWS = "LowQualityShadows";
 static const ea::string EP_MATERIAL_QUALITY = "MaterialQuality";
+static const ea::string EP_MEMORY_MAP_PACKAGES = "MemoryMapPackages";
 static const ea::string EP_MONITOR = "Monitor";
 static const ea::string EP_MULTI_SAMPLE = "MultiSample";
 static const ea::string EP_ORGANIZATION_NAME = "OrganizationName";
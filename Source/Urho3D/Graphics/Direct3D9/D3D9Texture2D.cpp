@@ -205,6 +205,12 @@ bool Texture2D::SetData(unsigned level, int x, int y, int width, int height, con
     return true;
 }
 
+bool Texture2D::AllocateLevel(unsigned level)
+{
+    // The storage of all levels is allocated on creation
+    return object_.ptr_ && level < levels_;
+}
+
 bool Texture2D::SetData(Image* image, bool useAlpha)
 {
     if (!image)
@@ -213,104 +219,40 @@ bool Texture2D::SetData(Image* image, bool useAlpha)
         return false;
     }
 
-    // Use a shared ptr for managing the temporary mip images created during this function
-    SharedPtr<Image> mipImage;
+    ImageUpload upload;
+    if (!PrepareImageUpload(image, useAlpha, upload))
+        return false;
+
+    if (width_ != upload.width_ || height_ != upload.height_ || upload.format_ != format_ || !object_.ptr_)
+        SetSize(upload.width_, upload.height_, upload.format_, usage_);
+
     unsigned memoryUse = sizeof(Texture2D);
-    MaterialQuality quality = QUALITY_HIGH;
-    Renderer* renderer = GetSubsystem<Renderer>();
-    if (renderer)
-        quality = renderer->GetTextureQuality();
 
     if (!image->IsCompressed())
     {
-        unsigned char* levelData = image->GetData();
-        int levelWidth = image->GetWidth();
-        int levelHeight = image->GetHeight();
-        unsigned components = image->GetComponents();
-        unsigned format = 0;
-
-        // Discard unnecessary mip levels
-        for (unsigned i = 0; i < mipsToSkip_[quality]; ++i)
-        {
-            mipImage = image->GetNextLevel(); image = mipImage;
-            levelData = image->GetData();
-            levelWidth = image->GetWidth();
-            levelHeight = image->GetHeight();
-        }
-
-        switch (components)
-        {
-        case 1:
-            format = useAlpha ? Graphics::GetAlphaFormat() : Graphics::GetLuminanceFormat();
-            break;
-
-        case 2:
-            format = Graphics::GetLuminanceAlphaFormat();
-            break;
-
-        case 3:
-            format = Graphics::GetRGBFormat();
-            break;
-
-        case 4:
-            format = Graphics::GetRGBAFormat();
-            break;
-
-        default:
-            assert(false);  // Should never reach here
-            break;
-        }
-
-        // If image was previously compressed, reset number of requested levels to avoid error if level count is too high for new size
-        if (IsCompressed() && requestedLevels_ > 1)
-            requestedLevels_ = 0;
-        if (width_ != levelWidth || height_ != levelHeight || format != format_ || !object_.ptr_)
-            SetSize(levelWidth, levelHeight, format, usage_);
-
+        // Use a shared ptr for managing the temporary mip images created during this function
+        SharedPtr<Image> mipImage = upload.image_;
         for (unsigned i = 0; i < levels_; ++i)
         {
-            SetData(i, 0, 0, levelWidth, levelHeight, levelData);
-            memoryUse += levelWidth * levelHeight * components;
+            const int levelWidth = mipImage->GetWidth();
+            const int levelHeight = mipImage->GetHeight();
+            SetData(i, 0, 0, levelWidth, levelHeight, mipImage->GetData());
+            memoryUse += levelWidth * levelHeight * mipImage->GetComponents();
 
             if (i < levels_ - 1)
             {
-                mipImage = image->GetNextLevel(); image = mipImage;
-                levelData = image->GetData();
-                levelWidth = image->GetWidth();
-                levelHeight = image->GetHeight();
+                mipImage = mipImage->GetNextLevel();
+                if (!mipImage)
+                    return false;
             }
         }
     }
     else
     {
-        int width = image->GetWidth();
-        int height = image->GetHeight();
-        unsigned levels = image->GetNumCompressedLevels();
-        unsigned format = graphics_->GetFormat(image->GetCompressedFormat());
-        bool needDecompress = false;
-
-        if (!format)
-        {
-            format = Graphics::GetRGBAFormat();
-            needDecompress = true;
-        }
-
-        unsigned mipsToSkip = mipsToSkip_[quality];
-        if (mipsToSkip >= levels)
-            mipsToSkip = levels - 1;
-        while (mipsToSkip && (width / (1 << mipsToSkip) < 4 || height / (1 << mipsToSkip) < 4))
-            --mipsToSkip;
-        width /= (1 << mipsToSkip);
-        height /= (1 << mipsToSkip);
-
-        SetNumLevels(Max((levels - mipsToSkip), 1U));
-        if (width_ != width || height_ != height || format != format_ || !object_.ptr_)
-            SetSize(width, height, format, usage_);
-
-        for (unsigned i = 0; i < levels_ && i < levels - mipsToSkip; ++i)
+        for (unsigned i = 0; i < levels_ && i < upload.levels_; ++i)
         {
-            CompressedLevel level = image->GetCompressedLevel(i + mipsToSkip);
-            if (!needDecompress)
+            CompressedLevel level = image->GetCompressedLevel(i + upload.skip_);
+            if (!upload.decompress_)
             {
                 SetData(i, 0, 0, level.width_, level.height_, level.data_);
                 memoryUse += level.rows_ * level.rowSize_;
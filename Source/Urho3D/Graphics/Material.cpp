@@ -1143,6 +1143,26 @@ void Material::MarkForAuxView(unsigned frameNumber)
     auxViewFrameNumber_ = frameNumber;
 }
 
+void Material::MarkTexturesUsed(unsigned frameNumber, float screenSize)
+{
+    if (frameNumber != texturesUsedFrameNumber_)
+    {
+        texturesUsedFrameNumber_ = frameNumber;
+        texturesScreenSize_ = screenSize;
+    }
+    else
+        texturesScreenSize_ = Max(texturesScreenSize_, screenSize);
+
+    for (auto i = textures_.begin(); i != textures_.end(); ++i)
+    {
+        if (i->second)
+        {
+            i->second->MarkUsed();
+            i->second->RequestStreamingSize(frameNumber, texturesScreenSize_);
+        }
+    }
+}
+
 const TechniqueEntry& Material::GetTechniqueEntry(unsigned index) const
 {
     return index < techniques_.size() ? techniques_[index] : noEntry;
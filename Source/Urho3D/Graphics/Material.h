@@ -247,6 +247,8 @@ public:
     void SortTechniques();
     /// Mark material for auxiliary view rendering.
     void MarkForAuxView(unsigned frameNumber);
+    /// Mark the textures of the material used on a frame, so that the resource cache keeps them resident. Optionally request a streaming resolution with the size in pixels the material is drawn at.
+    void MarkTexturesUsed(unsigned frameNumber, float screenSize = 0.0f);
 
     /// Return number of techniques.
     /// @property
@@ -320,6 +322,12 @@ public:
     /// Return last auxiliary view rendered frame number.
     unsigned GetAuxViewFrameNumber() const { return auxViewFrameNumber_; }
 
+    /// Return frame number on which the textures were last marked used.
+    unsigned GetTexturesUsedFrameNumber() const { return texturesUsedFrameNumber_; }
+
+    /// Return largest size in pixels the material was drawn at on the frame the textures were last marked used.
+    float GetTexturesScreenSize() const { return texturesScreenSize_; }
+
     /// Return whether should render occlusion.
     /// @property
     bool GetOcclusion() const { return occlusion_; }
@@ -384,6 +392,10 @@ private:
     unsigned char renderOrder_{};
     /// Last auxiliary view rendered frame number.
     unsigned auxViewFrameNumber_{};
+    /// Frame number on which the textures were last marked used.
+    unsigned texturesUsedFrameNumber_{};
+    /// Largest size in pixels drawn at on the frame the textures were last marked used.
+    float texturesScreenSize_{};
     /// Shader parameter hash value.
     unsigned shaderParameterHash_{};
     /// Alpha-to-coverage flag.
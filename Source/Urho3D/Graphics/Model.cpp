@@ -365,6 +365,106 @@ bool Model::EndLoad()
     return true;
 }
 
+bool Model::EndLoadPartial(unsigned& budget, bool& finished)
+{
+    unsigned totalSize = 0;
+    for (const VertexBufferDesc& desc : loadVBData_)
+        totalSize += desc.data_ ? desc.dataSize_ : 0;
+    for (const IndexBufferDesc& desc : loadIBData_)
+        totalSize += desc.data_ ? desc.dataSize_ : 0;
+
+    // Small models finish at once
+    if (!uploadBuffer_ && !uploadOffset_ && totalSize <= budget)
+    {
+        budget -= totalSize;
+        finished = true;
+        return EndLoad();
+    }
+
+    const unsigned numBuffers = loadVBData_.size() + loadIBData_.size();
+    while (uploadBuffer_ < numBuffers)
+    {
+        bool success = true;
+        if (uploadBuffer_ < loadVBData_.size())
+        {
+            VertexBuffer* buffer = vertexBuffers_[uploadBuffer_];
+            VertexBufferDesc& desc = loadVBData_[uploadBuffer_];
+            if (desc.data_)
+            {
+                if (!uploadOffset_)
+                {
+                    buffer->SetShadowed(true);
+                    success = buffer->SetSize(desc.vertexCount_, desc.vertexElements_);
+                }
+
+                // Upload at least one vertex per call
+                const unsigned vertexSize = buffer->GetVertexSize();
+                const unsigned count = Min(desc.vertexCount_ - uploadOffset_, Max(budget / Max(vertexSize, 1U), 1U));
+                success = success && buffer->SetDataRange(desc.data_.get() + uploadOffset_ * vertexSize, uploadOffset_, count);
+                budget -= Min(count * vertexSize, budget);
+                uploadOffset_ += count;
+                if (uploadOffset_ >= desc.vertexCount_)
+                    desc.data_.reset();
+            }
+            if (!desc.data_)
+            {
+                ++uploadBuffer_;
+                uploadOffset_ = 0;
+            }
+        }
+        else
+        {
+            IndexBuffer* buffer = indexBuffers_[uploadBuffer_ - loadVBData_.size()];
+            IndexBufferDesc& desc = loadIBData_[uploadBuffer_ - loadVBData_.size()];
+            if (desc.data_)
+            {
+                if (!uploadOffset_)
+                {
+                    buffer->SetShadowed(true);
+                    success = buffer->SetSize(desc.indexCount_, desc.indexSize_ > sizeof(unsigned short));
+                }
+
+                // Upload at least one index per call
+                const unsigned indexSize = buffer->GetIndexSize();
+                const unsigned count = Min(desc.indexCount_ - uploadOffset_, Max(budget / Max(indexSize, 1U), 1U));
+                success = success && buffer->SetDataRange(desc.data_.get() + uploadOffset_ * indexSize, uploadOffset_, count);
+                budget -= Min(count * indexSize, budget);
+                uploadOffset_ += count;
+                if (uploadOffset_ >= desc.indexCount_)
+                    desc.data_.reset();
+            }
+            if (!desc.data_)
+            {
+                ++uploadBuffer_;
+                uploadOffset_ = 0;
+            }
+        }
+
+        if (!success)
+        {
+            uploadBuffer_ = 0;
+            uploadOffset_ = 0;
+            loadVBData_.clear();
+            loadIBData_.clear();
+            loadGeometries_.clear();
+            finished = true;
+            return false;
+        }
+
+        if (!budget)
+            break;
+    }
+
+    finished = uploadBuffer_ >= numBuffers;
+    if (!finished)
+        return true;
+
+    // Uploaded buffers have their data released, so EndLoad() only sets up the geometries
+    uploadBuffer_ = 0;
+    uploadOffset_ = 0;
+    return EndLoad();
+}
+
 bool Model::Save(Serializer& dest) const
 {
     // Write ID
@@ -134,6 +134,8 @@ public:
     bool BeginLoad(Deserializer& source) override;
     /// Finish resource loading. Always called from the main thread. Return true if successful.
     bool EndLoad() override;
+    /// Finish background loaded model loading by uploading vertex and index data in ranges within the upload byte budget. Return true if successful.
+    bool EndLoadPartial(unsigned& budget, bool& finished) override;
     /// Save resource. Return true if successful.
     bool Save(Serializer& dest) const override;
 
@@ -257,6 +259,10 @@ private:
     ea::vector<IndexBufferDesc> loadIBData_;
     /// Geometry definitions for asynchronous loading.
     ea::vector<ea::vector<GeometryDesc> > loadGeometries_;
+    /// Next buffer of a partial upload. Vertex buffers come first, then index buffers.
+    unsigned uploadBuffer_{};
+    /// Next vertex or index of the current buffer of a partial upload.
+    unsigned uploadOffset_{};
 };
 
 }
@@ -170,125 +170,85 @@ bool Texture2D::SetData(unsigned level, int x, int y, int width, int height, con
     return true;
 }
 
-bool Texture2D::SetData(Image* image, bool useAlpha)
+bool Texture2D::AllocateLevel(unsigned level)
 {
-    if (!image)
-    {
-        URHO3D_LOGERROR("Null image, can not set data");
+    if (!object_.name_ || !graphics_ || level >= levels_)
         return false;
-    }
 
-    // Use a shared ptr for managing the temporary mip images created during this function
-    SharedPtr<Image> mipImage;
-    unsigned memoryUse = sizeof(Texture2D);
-    MaterialQuality quality = QUALITY_HIGH;
-    auto* renderer = GetSubsystem<Renderer>();
-    if (renderer)
-        quality = renderer->GetTextureQuality();
+    if (graphics_->IsDeviceLost())
+        return false;
 
-    if (!image->IsCompressed())
-    {
-        // Convert unsuitable formats to RGBA
-        unsigned components = image->GetComponents();
-        if (Graphics::GetGL3Support() && ((components == 1 && !useAlpha) || components == 2))
-        {
-            mipImage = image->ConvertToRGBA(); image = mipImage;
-            if (!image)
-                return false;
-            components = image->GetComponents();
-        }
+    // Level 0 of an uncompressed texture is allocated on creation
+    if (!IsCompressed() && level == 0)
+        return true;
 
-        unsigned char* levelData = image->GetData();
-        int levelWidth = image->GetWidth();
-        int levelHeight = image->GetHeight();
-        unsigned format = 0;
+#ifdef GL_ES_VERSION_2_0
+    // Compressed storage can not be allocated without data, and not all formats support partial updates
+    if (IsCompressed())
+        return false;
+#endif
 
-        // Discard unnecessary mip levels
-        for (unsigned i = 0; i < mipsToSkip_[quality]; ++i)
-        {
-            mipImage = image->GetNextLevel(); image = mipImage;
-            levelData = image->GetData();
-            levelWidth = image->GetWidth();
-            levelHeight = image->GetHeight();
-        }
+    graphics_->SetTextureForUpdate(this);
 
-        switch (components)
-        {
-        case 1:
-            format = useAlpha ? Graphics::GetAlphaFormat() : Graphics::GetLuminanceFormat();
-            break;
+    const int levelWidth = GetLevelWidth(level);
+    const int levelHeight = GetLevelHeight(level);
+    unsigned format = GetSRGB() ? GetSRGBFormat(format_) : format_;
 
-        case 2:
-            format = Graphics::GetLuminanceAlphaFormat();
-            break;
+    glGetError();
+    if (!IsCompressed())
+        glTexImage2D(target_, level, format, levelWidth, levelHeight, 0, GetExternalFormat(format_), GetDataType(format_), nullptr);
+    else
+        glCompressedTexImage2D(target_, level, format, levelWidth, levelHeight, 0, GetDataSize(levelWidth, levelHeight), nullptr);
+    const bool success = glGetError() == GL_NO_ERROR;
 
-        case 3:
-            format = Graphics::GetRGBFormat();
-            break;
+    graphics_->SetTexture(0, nullptr);
+    return success;
+}
 
-        case 4:
-            format = Graphics::GetRGBAFormat();
-            break;
+bool Texture2D::SetData(Image* image, bool useAlpha)
+{
+    if (!image)
+    {
+        URHO3D_LOGERROR("Null image, can not set data");
+        return false;
+    }
 
-        default:
-            assert(false);  // Should not reach here
-            break;
-        }
+    ImageUpload upload;
+    if (!PrepareImageUpload(image, useAlpha, upload))
+        return false;
 
-        // If image was previously compressed, reset number of requested levels to avoid error if level count is too high for new size
-        if (IsCompressed() && requestedLevels_ > 1)
-            requestedLevels_ = 0;
-        if (width_ != levelWidth || height_ != levelHeight || format != format_ || !object_.name_)
-            SetSize(levelWidth, levelHeight, format, usage_);
-        if (!object_.name_)
-            return false;
+    if (width_ != upload.width_ || height_ != upload.height_ || upload.format_ != format_ || !object_.name_)
+        SetSize(upload.width_, upload.height_, upload.format_, usage_);
+    if (!object_.name_)
+        return false;
 
+    unsigned memoryUse = sizeof(Texture2D);
+
+    if (!image->IsCompressed())
+    {
+        // Use a shared ptr for managing the temporary mip images created during this function
+        SharedPtr<Image> mipImage = upload.image_;
         for (unsigned i = 0; i < levels_; ++i)
         {
-            SetData(i, 0, 0, levelWidth, levelHeight, levelData);
-            memoryUse += levelWidth * levelHeight * components;
+            const int levelWidth = mipImage->GetWidth();
+            const int levelHeight = mipImage->GetHeight();
+            SetData(i, 0, 0, levelWidth, levelHeight, mipImage->GetData());
+            memoryUse += levelWidth * levelHeight * mipImage->GetComponents();
 
             if (i < levels_ - 1)
             {
-                mipImage = image->GetNextLevel(); image = mipImage;
-                levelData = image->GetData();
-                levelWidth = image->GetWidth();
-                levelHeight = image->GetHeight();
+                mipImage = mipImage->GetNextLevel();
+                if (!mipImage)
+                    return false;
             }
         }
     }
     else
     {
-        int width = image->GetWidth();
-        int height = image->GetHeight();
-        unsigned levels = image->GetNumCompressedLevels();
-        unsigned format = graphics_->GetFormat(image->GetCompressedFormat());
-        bool needDecompress = false;
-
-        if (!format)
-        {
-            format = Graphics::GetRGBAFormat();
-            needDecompress = true;
-        }
-
-        unsigned mipsToSkip = 0;
-        if (quality < URHO3D_ARRAYSIZE(mipsToSkip_))
-            mipsToSkip = mipsToSkip_[quality];
-        if (mipsToSkip >= levels)
-            mipsToSkip = levels - 1;
-        while (mipsToSkip && (width / (1u << mipsToSkip) < 4 || height / (1u << mipsToSkip) < 4))
-            --mipsToSkip;
-        width /= (1u << mipsToSkip);
-        height /= (1u << mipsToSkip);
-
-        SetNumLevels(Max((levels - mipsToSkip), 1U));
-        if (width_ != width || height_ != height || format != format_ || !object_.name_)
-            SetSize(width, height, format, usage_);
-
-        for (unsigned i = 0; i < levels_ && i < levels - mipsToSkip; ++i)
+        for (unsigned i = 0; i < levels_ && i < upload.levels_; ++i)
         {
-            CompressedLevel level = image->GetCompressedLevel(i + mipsToSkip);
-            if (!needDecompress)
+            CompressedLevel level = image->GetCompressedLevel(i + upload.skip_);
+            if (!upload.decompress_)
             {
                 SetData(i, 0, 0, level.width_, level.height_, level.data_);
                 memoryUse += level.rows_ * level.rowSize_;
@@ -50,6 +50,7 @@
 #include "../Scene/Scene.h"
 
 #include <EASTL/functional.h>
+#include <EASTL/sort.h>
 
 #include "../DebugNew.h"
 
@@ -255,6 +256,20 @@ static const char* heightFogVariations[] =
 
 static const unsigned MAX_BUFFER_AGE = 1000;
 
+/// Maximum number of texture streaming loads in progress at once.
+static const unsigned MAX_STREAMING_LOADS = 4;
+
+/// Texture streaming resolution change request.
+struct TextureStreamingRequest
+{
+    /// Size in pixels the texture was drawn at, negative for dropping mip levels of an unused texture.
+    float size_;
+    /// Texture.
+    Texture2D* texture_;
+    /// Wanted number of dropped mip levels.
+    unsigned mips_;
+};
+
 static const int MAX_EXTRA_INSTANCING_BUFFER_ELEMENTS = 4;
 
 inline ea::vector<VertexElement> CreateInstancingBufferElements(unsigned numExtraElements)
@@ -705,6 +720,12 @@ unsigned Renderer::GetNumOccluders(bool allViews) const
     return numOccluders;
 }
 
+void Renderer::AddStreamedTexture(Texture2D* texture)
+{
+    if (texture)
+        streamedTextures_.push_back(WeakPtr<Texture2D>(texture));
+}
+
 void Renderer::Update(float timeStep)
 {
     URHO3D_PROFILE("UpdateViews");
@@ -748,6 +769,8 @@ void Renderer::Update(float timeStep)
 
     queuedViewports_.clear();
     resetViews_ = false;
+
+    UpdateTextureStreaming();
 }
 
 void Renderer::Render()
@@ -2066,4 +2089,81 @@ void Renderer::BlurShadowMap(View* view, Texture2D* shadowMap, float blurScale)
     graphics_->SetTexture(TU_DIFFUSE, tmpBuffer);
     view->DrawFullscreenQuad(true);
 }
+
+void Renderer::UpdateTextureStreaming()
+{
+    if (streamedTextures_.empty())
+        return;
+
+    URHO3D_PROFILE("UpdateTextureStreaming");
+
+    // Remove destroyed textures
+    for (unsigned i = streamedTextures_.size() - 1; i < streamedTextures_.size(); --i)
+    {
+        if (streamedTextures_[i].Expired())
+            streamedTextures_.erase_unsorted(streamedTextures_.begin() + i);
+    }
+
+    // Upload the completed loads within the byte budget. Large textures are uploaded over several frames
+    unsigned budget = Max(textureStreamingBudget_, 1U);
+    unsigned numLoading = 0;
+    for (auto i = streamedTextures_.begin(); i != streamedTextures_.end(); ++i)
+    {
+        Texture2D* texture = *i;
+        if (texture->IsStreamingLoadComplete() && budget)
+            texture->FinishStreamingLoad(budget);
+        if (texture->IsStreamingLoading())
+            ++numLoading;
+    }
+
+    if (numLoading >= MAX_STREAMING_LOADS)
+        return;
+
+    // Serve the textures drawn largest first, then drop the unused ones
+    ea::vector<TextureStreamingRequest> requests;
+    for (auto i = streamedTextures_.begin(); i != streamedTextures_.end(); ++i)
+    {
+        Texture2D* texture = *i;
+        if (texture->IsStreamingLoading())
+            continue;
+
+        const unsigned mips = texture->GetWantedStreamingMips(frame_.frameNumber_);
+        if (mips < texture->GetReducedMips())
+            requests.push_back({texture->GetStreamingSize(), texture, mips});
+        else if (mips > texture->GetReducedMips())
+            requests.push_back({-1.0f, texture, mips});
+    }
+
+    ea::sort(requests.begin(), requests.end(), [](const TextureStreamingRequest& lhs, const TextureStreamingRequest& rhs)
+        { return lhs.size_ > rhs.size_; });
+
+    auto* cache = GetSubsystem<ResourceCache>();
+    unsigned long long extraMemoryUse = 0;
+    for (auto i = requests.begin(); i != requests.end() && numLoading < MAX_STREAMING_LOADS; ++i)
+    {
+        Texture2D* texture = i->texture_;
+        unsigned mips = i->mips_;
+
+        // Raise the resolution only as far as the memory budgets allow. Each mip level roughly quadruples the memory use
+        if (mips < texture->GetReducedMips())
+        {
+            const unsigned long long memoryUse = texture->GetMemoryUse();
+            unsigned long long newMemoryUse = memoryUse;
+            mips = texture->GetReducedMips();
+            while (mips > i->mips_ && cache->IsWithinMemoryBudget(Texture2D::GetTypeStatic(),
+                extraMemoryUse + newMemoryUse * 4 - memoryUse))
+            {
+                newMemoryUse *= 4;
+                --mips;
+            }
+
+            if (mips == texture->GetReducedMips())
+                continue;
+            extraMemoryUse += newMemoryUse - memoryUse;
+        }
+
+        texture->StartStreamingLoad(mips);
+        ++numLoading;
+    }
+}
 }
@@ -228,6 +228,12 @@ public:
     /// Set material quality level. See the QUALITY constants in GraphicsDefs.h.
     /// @property
     void SetMaterialQuality(MaterialQuality quality);
+    /// Set whether 2D textures loaded from now on stream in their higher mip levels as they are drawn larger on screen. Default false.
+    /// @property
+    void SetTextureStreaming(bool enable) { textureStreaming_ = enable; }
+    /// Set maximum bytes of streamed texture data uploaded per frame. At least one texture is uploaded each frame.
+    /// @property
+    void SetTextureStreamingBudget(unsigned bytes) { textureStreamingBudget_ = bytes; }
     /// Set shadows on/off.
     /// @property
     void SetDrawShadows(bool enable);
@@ -298,6 +304,8 @@ public:
 
     /// Apply post processing filter to the shadow map. Called by View.
     void ApplyShadowMapFilter(View* view, Texture2D* shadowMap, float blurScale);
+    /// Register a texture that streams its mip levels. Called by Texture2D.
+    void AddStreamedTexture(Texture2D* texture);
 
     /// Return number of backbuffer viewports.
     /// @property
@@ -343,6 +351,17 @@ public:
     /// @property
     MaterialQuality GetMaterialQuality() const { return materialQuality_; }
 
+    /// Return whether 2D textures stream in their higher mip levels.
+    /// @property
+    bool GetTextureStreaming() const { return textureStreaming_; }
+
+    /// Return maximum bytes of streamed texture data uploaded per frame.
+    /// @property
+    unsigned GetTextureStreamingBudget() const { return textureStreamingBudget_; }
+
+    /// Return number of textures that stream their mip levels.
+    unsigned GetNumStreamedTextures() const { return streamedTextures_.size(); }
+
     /// Return shadow map resolution.
     /// @property
     int GetShadowMapSize() const { return shadowMapSize_; }
@@ -565,6 +584,8 @@ private:
     void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
     /// Blur the shadow map.
     void BlurShadowMap(View* view, Texture2D* shadowMap, float blurScale);
+    /// Upload completed texture streaming loads and start new ones from the sizes the textures were drawn at.
+    void UpdateTextureStreaming();
 
     /// Graphics subsystem.
     WeakPtr<Graphics> graphics_;
@@ -642,6 +663,12 @@ private:
     MaterialQuality textureQuality_{QUALITY_HIGH};
     /// Material quality level.
     MaterialQuality materialQuality_{QUALITY_HIGH};
+    /// Textures that stream their mip levels.
+    ea::vector<WeakPtr<Texture2D> > streamedTextures_;
+    /// Maximum bytes of streamed texture data uploaded per frame.
+    unsigned textureStreamingBudget_{4 * 1024 * 1024};
+    /// Texture streaming flag.
+    bool textureStreaming_{};
     /// Shadow map resolution.
     int shadowMapSize_{1024};
     /// Shadow quality.
@@ -121,6 +121,17 @@ void Texture::SetMipsToSkip(MaterialQuality quality, int toSkip)
     }
 }
 
+void Texture::RequestStreamingSize(unsigned frameNumber, float size)
+{
+    if (frameNumber != streamingFrameNumber_)
+    {
+        streamingFrameNumber_ = frameNumber;
+        streamingSize_ = size;
+    }
+    else
+        streamingSize_ = Max(streamingSize_, size);
+}
+
 int Texture::GetMipsToSkip(MaterialQuality quality) const
 {
     return (quality >= QUALITY_LOW && quality < MAX_TEXTURE_QUALITY_LEVELS) ? mipsToSkip_[quality] : 0;
@@ -223,6 +234,9 @@ void Texture::SetParameters(const XMLElement& element)
 
         if (name == "srgb")
             SetSRGB(paramElem.GetBool("enable"));
+
+        if (name == "streaming")
+            SetStreaming(paramElem.GetBool("enable"));
     }
 }
 
@@ -75,6 +75,11 @@ public:
     /// Set mip levels to skip on a quality setting when loading. Ensures higher quality levels do not skip more.
     /// @property
     void SetMipsToSkip(MaterialQuality quality, int toSkip);
+    /// Set whether only the low mip levels are loaded at first, and the higher ones streamed in as the texture is drawn larger on screen. Only supported by Texture2D, and must be set before loading.
+    /// @property
+    void SetStreaming(bool enable) { streaming_ = enable; }
+    /// Request a resolution for texture streaming with the size in pixels the texture is drawn at on a frame. The largest request of a frame counts. Called by the renderer.
+    void RequestStreamingSize(unsigned frameNumber, float size);
 
     /// Return API-specific texture format.
     /// @property
@@ -148,6 +153,13 @@ public:
     /// Return mip levels to skip on a quality setting when loading.
     /// @property
     int GetMipsToSkip(MaterialQuality quality) const;
+    /// Return whether the higher mip levels are streamed in.
+    /// @property
+    bool GetStreaming() const { return streaming_; }
+    /// Return frame number of the last texture streaming request.
+    unsigned GetStreamingFrameNumber() const { return streamingFrameNumber_; }
+    /// Return largest size in pixels the texture was drawn at on the frame of the last streaming request.
+    float GetStreamingSize() const { return streamingSize_; }
     /// Return mip level width, or 0 if level does not exist.
     /// @property
     int GetLevelWidth(unsigned level) const;
@@ -279,6 +291,12 @@ protected:
     bool resolveDirty_{};
     /// Mipmap levels regeneration needed -flag.
     bool levelsDirty_{};
+    /// Mip level streaming flag.
+    bool streaming_{};
+    /// Frame number of the last texture streaming request.
+    unsigned streamingFrameNumber_{};
+    /// Largest size in pixels requested for texture streaming on the last request frame.
+    float streamingSize_{};
     /// Backup texture.
     SharedPtr<Texture> backupTexture_;
 };
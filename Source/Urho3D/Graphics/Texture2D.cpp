@@ -31,6 +31,7 @@
 #include "../Graphics/Texture2D.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
+#include "../Resource/Image.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/XMLFile.h"
 
@@ -39,12 +40,45 @@
 namespace Urho3D
 {
 
+/// Smallest width or height a texture is reduced to when dropping mip levels to reduce memory use.
+static const int MIN_REDUCED_TEXTURE_SIZE = 64;
+/// Largest width or height a streamed texture is loaded at before the higher mip levels are requested.
+static const int STREAMING_START_SIZE = 128;
+/// Time after the last use when a streamed texture drops back to the streaming start size.
+static const unsigned STREAMING_UNUSED_MS = 5000;
+
+/// Return the pixel rows per data row of a compressed mip level that can be uploaded in row bands, or 0 if it must be uploaded whole.
+static int GetBandBlockHeight(CompressedFormat format)
+{
+    if (format == CF_RGBA)
+        return 1;
+    else if (format < CF_PVRTC_RGB_2BPP)
+        return 4;
+    else
+        return 0;
+}
+
+/// Texture streaming load state shared between the main thread and a worker thread.
+struct TextureStreamingLoad
+{
+    /// Number of dropped mip levels to load the texture with.
+    unsigned reducedMips_{};
+    /// Image loaded on the worker thread, null on failure.
+    SharedPtr<Image> image_;
+    /// Whether the worker thread has finished.
+    std::atomic<bool> completed_{};
+};
+
 Texture2D::Texture2D(Context* context) :
     Texture(context)
 {
 #ifdef URHO3D_OPENGL
     target_ = GL_TEXTURE_2D;
 #endif
+
+    auto* renderer = GetSubsystem<Renderer>();
+    if (renderer)
+        streaming_ = renderer->GetTextureStreaming();
 }
 
 Texture2D::~Texture2D()
@@ -79,15 +113,19 @@ bool Texture2D::BeginLoad(Deserializer& source)
         return false;
     }
 
-    // Precalculate mip levels if async loading
-    if (GetAsyncLoadState() == ASYNC_LOADING)
-        loadImage_->PrecalculateLevels();
-
     // Load the optional parameters file
     auto* cache = GetSubsystem<ResourceCache>();
     ea::string xmlName = ReplaceExtension(GetName(), ".xml");
     loadParameters_ = cache->GetTempResource<XMLFile>(xmlName, false);
 
+    // Average the mip levels of sRGB textures in linear space
+    if (sRGB_ || (loadParameters_ && loadParameters_->GetRoot().GetChild("srgb").GetBool("enable")))
+        loadImage_->SetSRGB(true);
+
+    // Precalculate mip levels if async loading
+    if (GetAsyncLoadState() == ASYNC_LOADING)
+        loadImage_->PrecalculateLevels();
+
     return true;
 }
 
@@ -97,10 +135,16 @@ bool Texture2D::EndLoad()
     if (!graphics_ || graphics_->IsDeviceLost())
         return true;
 
+    // A streaming load in progress would overwrite the new data
+    CancelStreamingLoad();
+
     // If over the texture budget, see if materials can be freed to allow textures to be freed
     CheckTextureBudget(GetTypeStatic());
 
     SetParameters(loadParameters_);
+    if (sRGB_ && loadImage_)
+        loadImage_->SetSRGB(true);
+    BeginStreaming();
     bool success = SetData(loadImage_);
 
     loadImage_.Reset();
@@ -109,6 +153,506 @@ bool Texture2D::EndLoad()
     return success;
 }
 
+bool Texture2D::EndLoadPartial(unsigned& budget, bool& finished)
+{
+    // Small images, headless mode and lost device finish at once
+    if (!uploadStarted_ && (!graphics_ || graphics_->IsDeviceLost() || !loadImage_ || loadImage_->GetMemoryUse() <= budget))
+    {
+        if (loadImage_)
+            budget -= Min(loadImage_->GetMemoryUse(), budget);
+        finished = true;
+        return EndLoad();
+    }
+
+    if (!uploadStarted_)
+    {
+        // A streaming load in progress would overwrite the new data
+        CancelStreamingLoad();
+
+        // If over the texture budget, see if materials can be freed to allow textures to be freed
+        CheckTextureBudget(GetTypeStatic());
+        SetParameters(loadParameters_);
+        if (sRGB_)
+            loadImage_->SetSRGB(true);
+        BeginStreaming();
+
+        const bool success = BeginPartialUpload(loadImage_);
+        loadImage_.Reset();
+        loadParameters_.Reset();
+        if (!success)
+        {
+            ResetPartialUpload();
+            finished = true;
+            return false;
+        }
+    }
+
+    if (!UploadPartial(budget, finished))
+    {
+        finished = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool Texture2D::UploadPartial(unsigned& budget, bool& finished)
+{
+    // Upload at least one row per call. Large mip levels are split into row bands sized to the budget
+    do
+    {
+        unsigned uploaded = UploadNextBand(budget);
+        if (!uploaded)
+        {
+            ResetPartialUpload();
+            return false;
+        }
+        budget -= Min(uploaded, budget);
+    } while (budget && uploadLevel_ < uploadLevels_);
+
+    finished = uploadLevel_ >= uploadLevels_;
+    if (finished)
+    {
+        SetMemoryUse(uploadMemoryUse_);
+        ResetPartialUpload();
+    }
+
+    return true;
+}
+
+bool Texture2D::PrepareImageUpload(Image* image, bool useAlpha, ImageUpload& upload)
+{
+    MaterialQuality quality = QUALITY_HIGH;
+    auto* renderer = GetSubsystem<Renderer>();
+    if (renderer)
+        quality = renderer->GetTextureQuality();
+    const unsigned mipsToSkip = (unsigned)GetMipsToSkip(quality) + reducedMips_;
+
+    upload = ImageUpload();
+    upload.image_ = image;
+
+    if (!image->IsCompressed())
+    {
+        // Convert unsuitable formats to RGBA
+        unsigned components = image->GetComponents();
+#if defined(URHO3D_D3D11)
+        const bool convert = (components == 1 && !useAlpha) || components == 2 || components == 3;
+#elif defined(URHO3D_OPENGL)
+        const bool convert = Graphics::GetGL3Support() && ((components == 1 && !useAlpha) || components == 2);
+#else
+        const bool convert = false;
+#endif
+        if (convert)
+        {
+            upload.image_ = image->ConvertToRGBA();
+            if (!upload.image_)
+                return false;
+            components = upload.image_->GetComponents();
+        }
+
+        // Discard unnecessary mip levels, stopping at the last level
+        for (unsigned i = 0; i < mipsToSkip && (upload.image_->GetWidth() > 1 || upload.image_->GetHeight() > 1); ++i)
+        {
+            SharedPtr<Image> nextLevel = upload.image_->GetNextLevel();
+            if (!nextLevel)
+                return false;
+            upload.image_ = nextLevel;
+        }
+
+        switch (components)
+        {
+        case 1:
+            upload.format_ = useAlpha ? Graphics::GetAlphaFormat() : Graphics::GetLuminanceFormat();
+            break;
+
+        case 2:
+            upload.format_ = Graphics::GetLuminanceAlphaFormat();
+            break;
+
+        case 3:
+            upload.format_ = Graphics::GetRGBFormat();
+            break;
+
+        default:
+            upload.format_ = Graphics::GetRGBAFormat();
+            break;
+        }
+
+        upload.width_ = upload.image_->GetWidth();
+        upload.height_ = upload.image_->GetHeight();
+
+        // If image was previously compressed, reset number of requested levels to avoid error if level count is too high for new size
+        if (IsCompressed() && requestedLevels_ > 1)
+            requestedLevels_ = 0;
+    }
+    else
+    {
+        const unsigned levels = image->GetNumCompressedLevels();
+        upload.format_ = graphics_->GetFormat(image->GetCompressedFormat());
+        if (!upload.format_)
+        {
+            upload.format_ = Graphics::GetRGBAFormat();
+            upload.decompress_ = true;
+        }
+
+        unsigned skip = Min(mipsToSkip, levels ? levels - 1 : 0);
+        while (skip && ((image->GetWidth() >> skip) < 4 || (image->GetHeight() >> skip) < 4))
+            --skip;
+
+        upload.width_ = image->GetWidth() >> skip;
+        upload.height_ = image->GetHeight() >> skip;
+        upload.skip_ = skip;
+        upload.levels_ = levels - skip;
+
+        SetNumLevels(Max(upload.levels_, 1U));
+    }
+
+    return true;
+}
+
+bool Texture2D::BeginPartialUpload(Image* image)
+{
+    URHO3D_PROFILE("BeginPartialTextureUpload");
+
+    uploadStarted_ = true;
+    uploadLevel_ = 0;
+    uploadMemoryUse_ = sizeof(Texture2D);
+
+    uploadSource_ = image;
+
+    ImageUpload upload;
+    if (!PrepareImageUpload(image, false, upload) || !SetSize(upload.width_, upload.height_, upload.format_, usage_))
+        return false;
+
+    if (!image->IsCompressed())
+    {
+        // Generate the mip chain now, so that each later call only uploads
+        SharedPtr<Image> image = upload.image_;
+        uploadLevels_ = levels_;
+        uploadImages_.push_back(image);
+        for (unsigned i = 1; i < uploadLevels_; ++i)
+        {
+            image = image->GetNextLevel();
+            if (!image)
+                return false;
+            uploadImages_.push_back(image);
+        }
+    }
+    else
+    {
+        uploadSkip_ = upload.skip_;
+        uploadDecompress_ = upload.decompress_;
+        uploadLevels_ = Min(levels_, upload.levels_);
+    }
+
+    return true;
+}
+
+unsigned Texture2D::UploadNextBand(unsigned budget)
+{
+    URHO3D_PROFILE("UploadTextureBand");
+
+    const unsigned i = uploadLevel_;
+    const unsigned char* data = nullptr;
+    int width = 0;
+    int height = 0;
+    // Pixel rows per data row, and bytes per data row
+    int blockHeight = 1;
+    unsigned rowSize = 0;
+
+    if (!uploadImages_.empty())
+    {
+        Image* image = uploadImages_[i];
+        data = image->GetData();
+        width = image->GetWidth();
+        height = image->GetHeight();
+        rowSize = (unsigned)(width * image->GetComponents());
+    }
+    else
+    {
+        CompressedLevel level = uploadSource_->GetCompressedLevel(i + uploadSkip_);
+        width = level.width_;
+        height = level.height_;
+        if (!uploadDecompress_)
+        {
+            data = level.data_;
+            blockHeight = GetBandBlockHeight(level.format_);
+            rowSize = level.rowSize_;
+            if (!blockHeight)
+            {
+                // Upload the level as a single row
+                blockHeight = height;
+                rowSize = level.rows_ * level.rowSize_;
+            }
+        }
+        else
+        {
+            // Decompress the whole level when its first band is uploaded
+            if (!uploadRow_)
+            {
+                uploadLevelData_.resize((unsigned)(width * height * 4));
+                level.Decompress(uploadLevelData_.data());
+            }
+            data = uploadLevelData_.data();
+            rowSize = (unsigned)(width * 4);
+        }
+    }
+
+    const unsigned numRows = (unsigned)((height + blockHeight - 1) / blockHeight);
+    unsigned rows = Clamp(budget / Max(rowSize, 1U), 1U, numRows - uploadRow_);
+    // Without separately allocated storage the level is uploaded whole
+    if (!uploadRow_ && rows < numRows && !AllocateLevel(i))
+        rows = numRows;
+
+    const int y = (int)uploadRow_ * blockHeight;
+    const int bandHeight = Min((int)rows * blockHeight, height - y);
+    if (!SetData(i, 0, y, width, bandHeight, data + uploadRow_ * rowSize))
+        return 0;
+
+    const unsigned size = rows * rowSize;
+    uploadRow_ += rows;
+    if (uploadRow_ >= numRows)
+    {
+        // Release the level data as soon as it is on the GPU
+        if (!uploadImages_.empty())
+            uploadImages_[i].Reset();
+        uploadLevelData_.clear();
+        uploadRow_ = 0;
+        ++uploadLevel_;
+    }
+
+    uploadMemoryUse_ += size;
+    return Max(size, 1U);
+}
+
+void Texture2D::ResetPartialUpload()
+{
+    uploadImages_.clear();
+    uploadLevels_ = 0;
+    uploadLevel_ = 0;
+    uploadRow_ = 0;
+    uploadLevelData_.clear();
+    uploadSkip_ = 0;
+    uploadDecompress_ = false;
+    uploadStarted_ = false;
+    uploadMemoryUse_ = 0;
+    uploadSource_.Reset();
+}
+
+bool Texture2D::ReduceMemoryUse()
+{
+    // Only static textures loaded from a file, and not in the middle of loading, can be reloaded at a lower resolution
+    if (!graphics_ || usage_ != TEXTURE_STATIC || uploadStarted_ || streamingLoad_ || GetAsyncLoadState() != ASYNC_DONE ||
+        levels_ < 2 || Min(width_, height_) / 2 < MIN_REDUCED_TEXTURE_SIZE)
+        return false;
+
+    auto* cache = GetSubsystem<ResourceCache>();
+    if (!cache->Exists(GetName()))
+        return false;
+
+    StartReload(reducedMips_ + 1);
+    return true;
+}
+
+bool Texture2D::RestoreMemoryUse()
+{
+    if (!reducedMips_ || uploadStarted_ || streamingStarted_ || streamingLoad_ || GetAsyncLoadState() != ASYNC_DONE)
+        return false;
+
+    StartReload(reducedMips_ - 1);
+    return true;
+}
+
+bool Texture2D::UpdateMemoryUseChange(unsigned& budget)
+{
+    FinishStreamingLoad(budget);
+    return !streamingLoad_;
+}
+
+void Texture2D::BeginStreaming()
+{
+    auto* renderer = GetSubsystem<Renderer>();
+    if (!streaming_ || streamingStarted_ || !renderer || !loadImage_ || usage_ != TEXTURE_STATIC)
+        return;
+
+    // The higher mip levels are reloaded from the file when requested
+    auto* cache = GetSubsystem<ResourceCache>();
+    if (!cache->Exists(GetName()))
+        return;
+
+    const unsigned mipsToSkip = (unsigned)GetMipsToSkip(renderer->GetTextureQuality());
+    const int width = Max(loadImage_->GetWidth() >> mipsToSkip, 1);
+    const int height = Max(loadImage_->GetHeight() >> mipsToSkip, 1);
+    unsigned startMips = 0;
+    while ((Max(width, height) >> startMips) > STREAMING_START_SIZE)
+        ++startMips;
+
+    // Compressed images can only drop the levels they have, following the rules of SetData(Image*)
+    if (loadImage_->IsCompressed())
+    {
+        const unsigned levels = loadImage_->GetNumCompressedLevels();
+        while (startMips && (mipsToSkip + startMips >= levels || (loadImage_->GetWidth() >> (mipsToSkip + startMips)) < 4 ||
+            (loadImage_->GetHeight() >> (mipsToSkip + startMips)) < 4))
+            --startMips;
+    }
+
+    // Small textures are loaded whole
+    if (!startMips)
+        return;
+
+    streamingStartMips_ = startMips;
+    streamingStarted_ = true;
+    reducedMips_ = Max(reducedMips_, startMips);
+    renderer->AddStreamedTexture(this);
+}
+
+unsigned Texture2D::GetWantedStreamingMips(unsigned frameNumber)
+{
+    // Keep the resolution of textures not drawn on this frame until they have been unused for a while
+    if (streamingFrameNumber_ != frameNumber)
+        return GetLastUseTimer() >= STREAMING_UNUSED_MS ? Max(reducedMips_, streamingStartMips_) : reducedMips_;
+
+    // Find the smallest resolution that is at least the size drawn on screen. Drawn textures are not dropped to a lower resolution,
+    // that is left to the resource cache memory budgets
+    const float fullSize = (float)(Max(width_, height_) << reducedMips_);
+    unsigned mips = 0;
+    while (mips < streamingStartMips_ && fullSize / (float)(1u << (mips + 1)) >= streamingSize_)
+        ++mips;
+
+    return Min(mips, reducedMips_);
+}
+
+void Texture2D::StartStreamingLoad(unsigned reducedMips)
+{
+    if (streamingStarted_)
+        StartReload(reducedMips);
+}
+
+void Texture2D::StartReload(unsigned reducedMips)
+{
+    auto* cache = GetSubsystem<ResourceCache>();
+    if (streamingLoad_ || !cache)
+        return;
+
+    auto load = ea::make_shared<TextureStreamingLoad>();
+    load->reducedMips_ = reducedMips;
+    streamingLoad_ = load;
+
+    // Load on the background loader threads, which are meant for file I/O. Capture only thread-safe state,
+    // as the texture may be destroyed before the load completes
+    Context* context = context_;
+    const ea::string name = GetName();
+    const bool sRGB = sRGB_;
+    cache->QueueBackgroundTask([context, name, sRGB, load]()
+    {
+        URHO3D_PROFILE("LoadStreamedTexture");
+
+        auto* cache = context->GetSubsystem<ResourceCache>();
+        SharedPtr<File> file = cache->GetFile(name, false);
+        if (file)
+        {
+            auto image = MakeShared<Image>(context);
+            if (image->Load(*file))
+            {
+                if (sRGB)
+                    image->SetSRGB(true);
+                if (!image->IsCompressed())
+                    image->PrecalculateLevels();
+                load->image_ = image;
+            }
+        }
+        load->completed_ = true;
+    });
+}
+
+bool Texture2D::IsStreamingLoadComplete() const
+{
+    return streamingLoad_ && streamingLoad_->completed_;
+}
+
+void Texture2D::FinishStreamingLoad(unsigned& budget)
+{
+    if (!IsStreamingLoadComplete())
+        return;
+
+    // The texture stays drawable while the new data is uploaded over several frames, so upload it to a staging texture
+    if (!streamingTexture_)
+    {
+        // Skip the upload if the texture has been reloaded meanwhile
+        SharedPtr<Image> image = streamingLoad_->image_;
+        if (!image || !graphics_ || graphics_->IsDeviceLost() || uploadStarted_ || GetAsyncLoadState() != ASYNC_DONE)
+        {
+            streamingLoad_.reset();
+            return;
+        }
+
+        URHO3D_PROFILE("BeginStreamedTextureUpload");
+
+        streamingLoad_->image_.Reset();
+        streamingTexture_ = MakeShared<Texture2D>(context_);
+        streamingTexture_->requestedLevels_ = requestedLevels_;
+        streamingTexture_->sRGB_ = sRGB_;
+        for (unsigned i = 0; i < MAX_TEXTURE_QUALITY_LEVELS; ++i)
+            streamingTexture_->mipsToSkip_[i] = mipsToSkip_[i];
+        streamingTexture_->reducedMips_ = streamingLoad_->reducedMips_;
+        if (!streamingTexture_->BeginPartialUpload(image))
+        {
+            URHO3D_LOGERROR("Failed to upload streamed texture " + GetName());
+            streamingTexture_.Reset();
+            streamingLoad_.reset();
+            return;
+        }
+    }
+
+    bool finished = false;
+    if (!streamingTexture_->UploadPartial(budget, finished))
+    {
+        URHO3D_LOGERROR("Failed to upload streamed texture " + GetName());
+        streamingTexture_.Reset();
+        streamingLoad_.reset();
+        return;
+    }
+
+    if (finished)
+    {
+        // An image without more mip levels to drop is left as it is
+        if (streamingLoad_->reducedMips_ <= reducedMips_ || streamingTexture_->width_ != width_)
+        {
+            SwapStreamingTexture();
+            reducedMips_ = streamingLoad_->reducedMips_;
+        }
+        streamingTexture_.Reset();
+        streamingLoad_.reset();
+    }
+}
+
+void Texture2D::CancelStreamingLoad()
+{
+    streamingTexture_.Reset();
+    streamingLoad_.reset();
+}
+
+void Texture2D::SwapStreamingTexture()
+{
+    // Graphics recognizes bound textures by pointer, so unbind before the GPU object changes
+    for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+    {
+        if (graphics_->GetTexture(i) == this)
+            graphics_->SetTexture(i, nullptr);
+    }
+
+    // The old GPU object is released with the staging texture
+    ea::swap(object_, streamingTexture_->object_);
+    ea::swap(shaderResourceView_, streamingTexture_->shaderResourceView_);
+    format_ = streamingTexture_->format_;
+    levels_ = streamingTexture_->levels_;
+    requestedLevels_ = streamingTexture_->requestedLevels_;
+    width_ = streamingTexture_->width_;
+    height_ = streamingTexture_->height_;
+    parametersDirty_ = true;
+    SetMemoryUse(streamingTexture_->GetMemoryUse());
+}
+
 bool Texture2D::SetSize(int width, int height, unsigned format, TextureUsage usage, int multiSample, bool autoResolve)
 {
     if (width <= 0 || height <= 0)
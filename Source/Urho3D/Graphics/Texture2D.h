@@ -26,11 +26,14 @@
 #include "../Graphics/RenderSurface.h"
 #include "../Graphics/Texture.h"
 
+#include <EASTL/shared_ptr.h>
+
 namespace Urho3D
 {
 
 class Image;
 class XMLFile;
+struct TextureStreamingLoad;
 
 /// 2D texture resource.
 class URHO3D_API Texture2D : public Texture
@@ -49,12 +52,20 @@ public:
     bool BeginLoad(Deserializer& source) override;
     /// Finish resource loading. Always called from the main thread. Return true if successful.
     bool EndLoad() override;
+    /// Finish background loaded texture loading one mip level at a time within the upload byte budget. Return true if successful.
+    bool EndLoadPartial(unsigned& budget, bool& finished) override;
     /// Mark the GPU resource destroyed on context destruction.
     void OnDeviceLost() override;
     /// Recreate the GPU resource and restore data if applicable.
     void OnDeviceReset() override;
     /// Release the texture.
     void Release() override;
+    /// Start dropping the highest mip level by reloading the texture from its file at half the resolution in the background. Return true if started.
+    bool ReduceMemoryUse() override;
+    /// Bring back one mip level dropped by ReduceMemoryUse() by reloading the texture from its file. Return true if started.
+    bool RestoreMemoryUse() override;
+    /// Upload the reloaded texture of ReduceMemoryUse() or RestoreMemoryUse() within the byte budget once loaded. Return true when finished.
+    bool UpdateMemoryUseChange(unsigned& budget) override;
 
     /// Set size, format, usage and multisampling parameters for rendertargets. Zero size will follow application window size. Return true if successful.
     /** Autoresolve true means the multisampled texture will be automatically resolved to 1-sample after being rendered to and before being sampled as a texture.
@@ -76,14 +87,70 @@ public:
     /// Return render surface.
     /// @property
     RenderSurface* GetRenderSurface() const { return renderSurface_; }
+    /// Return whether mip levels have been dropped to reduce memory use. Streamed textures restore their mip levels through streaming instead.
+    bool IsMemoryUseReduced() const override { return reducedMips_ != 0 && !streamingStarted_; }
+    /// Return number of mip levels dropped to reduce memory use or not yet streamed in, on top of the ones skipped by the texture quality setting.
+    unsigned GetReducedMips() const { return reducedMips_; }
+
+    /// Return number of dropped mip levels texture streaming wants on a frame, from the size the texture was drawn at. Called by the renderer.
+    unsigned GetWantedStreamingMips(unsigned frameNumber);
+    /// Start loading the texture from its file with the given number of dropped mip levels on a worker thread. Called by the renderer.
+    void StartStreamingLoad(unsigned reducedMips);
+    /// Upload the texture loaded by StartStreamingLoad() once complete, in row bands within the byte budget. Subtract the uploaded bytes from the budget. Called by the renderer.
+    void FinishStreamingLoad(unsigned& budget);
+    /// Return whether a streaming load is in progress.
+    bool IsStreamingLoading() const { return streamingLoad_ != nullptr; }
+    /// Return whether a streaming load has completed on the worker thread and is waiting for upload.
+    bool IsStreamingLoadComplete() const;
+    /// Return whether texture streaming has been started for the texture.
+    bool IsStreamingStarted() const { return streamingStarted_; }
 
 protected:
     /// Create the GPU texture.
     bool Create() override;
 
 private:
+    /// Texture size, format and source mip levels decided for uploading an image.
+    struct ImageUpload
+    {
+        /// Uncompressed image after format conversion and discarding mip levels, or the compressed image.
+        SharedPtr<Image> image_;
+        /// Texture format.
+        unsigned format_{};
+        /// Texture width.
+        int width_{};
+        /// Texture height.
+        int height_{};
+        /// Number of discarded compressed mip levels.
+        unsigned skip_{};
+        /// Number of compressed mip levels left after discarding.
+        unsigned levels_{};
+        /// Whether compressed mip levels need decompression to RGBA.
+        bool decompress_{};
+    };
+
     /// Handle render surface update event.
     void HandleRenderSurfaceUpdate(StringHash eventType, VariantMap& eventData);
+    /// Decide the size, format and source mip levels for uploading an image following the rules of the rendering backend, and set the requested mip level count. Return true if successful.
+    bool PrepareImageUpload(Image* image, bool useAlpha, ImageUpload& upload);
+    /// Size the texture and prepare the mip levels of an image for a partial upload. Return true if successful.
+    bool BeginPartialUpload(Image* image);
+    /// Continue a partial upload within the byte budget, subtracting the uploaded bytes. Return false on failure.
+    bool UploadPartial(unsigned& budget, bool& finished);
+    /// Upload the next rows of the current mip level of a partial upload, sized to the byte budget but at least one row. Return the number of bytes uploaded, or 0 on failure.
+    unsigned UploadNextBand(unsigned budget);
+    /// Allocate the storage of a mip level without setting its data, so that it can be uploaded in row bands. Return false if not supported.
+    bool AllocateLevel(unsigned level);
+    /// Release the load image and the partial upload state.
+    void ResetPartialUpload();
+    /// Start reloading the texture from its file with the given number of dropped mip levels on a background loader thread.
+    void StartReload(unsigned reducedMips);
+    /// Drop a streaming load or upload in progress.
+    void CancelStreamingLoad();
+    /// Take the GPU object of the staging texture of a finished streaming upload.
+    void SwapStreamingTexture();
+    /// Drop the mip levels above the streaming start size from the load image and register with the renderer, if streaming is enabled.
+    void BeginStreaming();
 
     /// Render surface.
     SharedPtr<RenderSurface> renderSurface_;
@@ -91,6 +158,36 @@ private:
     SharedPtr<Image> loadImage_;
     /// Parameter file acquired during BeginLoad.
     SharedPtr<XMLFile> loadParameters_;
+    /// Source image of a partial upload.
+    SharedPtr<Image> uploadSource_;
+    /// Uncompressed mip level images of a partial upload, after skipping mips and converting the format.
+    ea::vector<SharedPtr<Image> > uploadImages_;
+    /// Number of mip levels of a partial upload.
+    unsigned uploadLevels_{};
+    /// Next mip level of a partial upload.
+    unsigned uploadLevel_{};
+    /// Next row of the current mip level of a partial upload. Counts compressed block rows for compressed levels.
+    unsigned uploadRow_{};
+    /// Decompressed data of the current mip level of a partial upload.
+    ea::vector<unsigned char> uploadLevelData_;
+    /// Number of skipped compressed mip levels of a partial upload.
+    unsigned uploadSkip_{};
+    /// Whether compressed mip levels of a partial upload need decompression to RGBA.
+    bool uploadDecompress_{};
+    /// Whether a partial upload has been started.
+    bool uploadStarted_{};
+    /// Memory use accumulated during a partial upload.
+    unsigned uploadMemoryUse_{};
+    /// Mip levels dropped to reduce memory use.
+    unsigned reducedMips_{};
+    /// Mip levels dropped when texture streaming started.
+    unsigned streamingStartMips_{};
+    /// Whether texture streaming has been started.
+    bool streamingStarted_{};
+    /// State shared with the worker thread of a streaming load.
+    ea::shared_ptr<TextureStreamingLoad> streamingLoad_;
+    /// Staging texture the streamed data is uploaded to before it replaces the texture data.
+    SharedPtr<Texture2D> streamingTexture_;
 };
 
 }
@@ -1222,6 +1222,12 @@ void View::GetBaseBatches()
 {
     URHO3D_PROFILE("GetBaseBatches");
 
+    // Scale from world size at unit distance to pixels, for requesting texture streaming resolutions
+    const bool textureStreaming = renderer_->GetNumStreamedTextures() != 0;
+    const float pixelScale = textureStreaming ? camera_->GetProjection().m11_ * viewSize_.y_ * 0.5f : 0.0f;
+    const bool orthographic = camera_->IsOrthographic();
+    const float nearClip = camera_->GetNearClip();
+
     for (auto i = geometries_.begin(); i != geometries_.end(); ++i)
     {
         Drawable* drawable = *i;
@@ -1234,6 +1240,15 @@ void View::GetBaseBatches()
         const ea::vector<SourceBatch>& batches = drawable->GetBatches();
         bool vertexLightsProcessed = false;
 
+        // Projected size of the drawable on screen in pixels
+        float screenSize = 0.0f;
+        if (textureStreaming)
+        {
+            screenSize = drawable->GetWorldBoundingBox().Size().Length() * pixelScale;
+            if (!orthographic)
+                screenSize /= Max(drawable->GetDistance(), nearClip);
+        }
+
         for (unsigned j = 0; j < batches.size(); ++j)
         {
             const SourceBatch& srcBatch = batches[j];
@@ -1242,6 +1257,10 @@ void View::GetBaseBatches()
             // Only check this for backbuffer views (null rendertarget)
             if (srcBatch.material_ && srcBatch.material_->GetAuxViewFrameNumber() != frame_.frameNumber_ && !renderTarget_)
                 CheckMaterialForAuxView(srcBatch.material_);
+            // Keep the textures drawn with resident when the resource cache enforces memory budgets, and request their streaming resolution
+            if (srcBatch.material_ && (srcBatch.material_->GetTexturesUsedFrameNumber() != frame_.frameNumber_ ||
+                screenSize > srcBatch.material_->GetTexturesScreenSize()))
+                srcBatch.material_->MarkTexturesUsed(frame_.frameNumber_, screenSize);
 
             Technique* tech = GetTechnique(drawable, srcBatch.material_);
             if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
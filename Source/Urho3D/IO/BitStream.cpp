@@ -0,0 +1,217 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../IO/BitStream.h"
+
+namespace Urho3D
+{
+
+/// Maximum length of the Exp-Golomb zero prefix for 32-bit values.
+static const unsigned MAX_VAR_BITS_PREFIX = 32;
+
+BitWriter::BitWriter(Serializer& dest) :
+    dest_(dest)
+{
+}
+
+BitWriter::~BitWriter()
+{
+    Flush();
+}
+
+unsigned BitWriter::Write(const void* data, unsigned size)
+{
+    if (!size)
+        return 0;
+
+    // Fast path when on a byte boundary
+    if (!scratchBits_)
+        return dest_.Write(data, size);
+
+    const auto* src = static_cast<const unsigned char*>(data);
+    unsigned char buffer[256];
+    unsigned numBytes = 0;
+
+    // The number of pending bits stays the same, every input byte completes one output byte
+    for (unsigned i = 0; i < size; ++i)
+    {
+        scratch_ |= (unsigned long long)src[i] << scratchBits_;
+        buffer[numBytes++] = (unsigned char)scratch_;
+        scratch_ >>= 8u;
+
+        if (numBytes == sizeof buffer)
+        {
+            dest_.Write(buffer, numBytes);
+            numBytes = 0;
+        }
+    }
+
+    if (numBytes)
+        dest_.Write(buffer, numBytes);
+
+    return size;
+}
+
+void BitWriter::WriteBits(unsigned value, unsigned numBits)
+{
+    if (!numBits)
+        return;
+    if (numBits > 32)
+        numBits = 32;
+
+    const unsigned long long mask = (1ull << numBits) - 1;
+    scratch_ |= ((unsigned long long)value & mask) << scratchBits_;
+    scratchBits_ += numBits;
+    WriteCompletedBytes();
+}
+
+void BitWriter::WriteVarBits(unsigned value)
+{
+    // Exp-Golomb: N zero bits, a one bit, then the lowest N bits of value + 1
+    const unsigned long long biased = (unsigned long long)value + 1;
+    unsigned prefix = 0;
+    while (biased >> (prefix + 1))
+        ++prefix;
+
+    WriteBits(0, prefix);
+    WriteBits(1, 1);
+    WriteBits((unsigned)(biased & ((1ull << prefix) - 1)), prefix);
+}
+
+void BitWriter::Flush()
+{
+    if (scratchBits_)
+    {
+        auto byte = (unsigned char)scratch_;
+        dest_.Write(&byte, 1);
+        scratch_ = 0;
+        scratchBits_ = 0;
+    }
+}
+
+unsigned BitWriter::GetVarBitsLength(unsigned value)
+{
+    const unsigned long long biased = (unsigned long long)value + 1;
+    unsigned prefix = 0;
+    while (biased >> (prefix + 1))
+        ++prefix;
+    return prefix * 2 + 1;
+}
+
+void BitWriter::WriteCompletedBytes()
+{
+    unsigned char buffer[8];
+    unsigned numBytes = 0;
+
+    while (scratchBits_ >= 8)
+    {
+        buffer[numBytes++] = (unsigned char)scratch_;
+        scratch_ >>= 8u;
+        scratchBits_ -= 8;
+    }
+
+    if (numBytes)
+        dest_.Write(buffer, numBytes);
+}
+
+BitReader::BitReader(Deserializer& source) :
+    Deserializer(source.GetSize() - Min(source.GetPosition(), source.GetSize())),
+    source_(source),
+    sourceStart_(source.GetPosition())
+{
+}
+
+unsigned BitReader::Read(void* dest, unsigned size)
+{
+    if (!size)
+        return 0;
+
+    // Fast path when on a byte boundary
+    if (!scratchBits_)
+    {
+        unsigned numRead = source_.Read(dest, size);
+        position_ += numRead;
+        return numRead;
+    }
+
+    auto* destBytes = static_cast<unsigned char*>(dest);
+    unsigned numRead = 0;
+    while (numRead < size && !source_.IsEof())
+    {
+        scratch_ |= (unsigned long long)source_.ReadUByte() << scratchBits_;
+        ++position_;
+        destBytes[numRead++] = (unsigned char)scratch_;
+        scratch_ >>= 8u;
+    }
+
+    return numRead;
+}
+
+unsigned BitReader::Seek(unsigned position)
+{
+    // The bits of a partially consumed byte are not kept, reading continues from the byte boundary
+    const unsigned sourcePosition = source_.Seek(sourceStart_ + Min(position, size_));
+    position_ = sourcePosition > sourceStart_ ? sourcePosition - sourceStart_ : 0;
+    scratch_ = 0;
+    scratchBits_ = 0;
+    return position_;
+}
+
+unsigned BitReader::ReadBits(unsigned numBits)
+{
+    if (!numBits)
+        return 0;
+    if (numBits > 32)
+        numBits = 32;
+
+    // Read only as many bytes as needed, so that the source stays at the end of the packed data when done.
+    // Missing bits of a truncated stream read as zero
+    while (scratchBits_ < numBits && !source_.IsEof())
+    {
+        scratch_ |= (unsigned long long)source_.ReadUByte() << scratchBits_;
+        ++position_;
+        scratchBits_ += 8;
+    }
+
+    const unsigned long long mask = (1ull << numBits) - 1;
+    auto value = (unsigned)(scratch_ & mask);
+    scratch_ >>= numBits;
+    scratchBits_ = scratchBits_ > numBits ? scratchBits_ - numBits : 0;
+    return value;
+}
+
+unsigned BitReader::ReadVarBits()
+{
+    unsigned prefix = 0;
+    while (!ReadBit())
+    {
+        if (++prefix > MAX_VAR_BITS_PREFIX || IsEof())
+            return 0;
+    }
+
+    const unsigned long long biased = (1ull << prefix) | ReadBits(prefix);
+    return (unsigned)(biased - 1);
+}
+
+}
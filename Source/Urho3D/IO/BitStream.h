@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../IO/Deserializer.h"
+#include "../IO/Serializer.h"
+
+namespace Urho3D
+{
+
+/// Serializer that packs values with an arbitrary number of bits to another serializer. Whole bytes are forwarded as they fill up.
+/// @nobind
+class URHO3D_API BitWriter : public Serializer
+{
+public:
+    /// Construct with destination serializer.
+    explicit BitWriter(Serializer& dest);
+    /// Destruct. Flush the remaining bits.
+    ~BitWriter() override;
+
+    /// Write bytes starting from the current bit position. Return number of bytes actually written.
+    unsigned Write(const void* data, unsigned size) override;
+
+    /// Write the lowest bits of a value, at most 32.
+    void WriteBits(unsigned value, unsigned numBits);
+    /// Write a single bit.
+    void WriteBit(bool value) { WriteBits(value ? 1u : 0u, 1); }
+    /// Write an unsigned value with variable length Exp-Golomb coding. Small values take less bits.
+    void WriteVarBits(unsigned value);
+    /// Write a signed value with zigzag and variable length Exp-Golomb coding.
+    void WriteSignedVarBits(int value) { WriteVarBits(ZigZagEncode(value)); }
+    /// Pad the last partial byte with zero bits and write it to the destination.
+    void Flush();
+
+    /// Return number of bits a value takes when written with WriteVarBits().
+    static unsigned GetVarBitsLength(unsigned value);
+    /// Map a signed value to unsigned so that values near zero stay small.
+    static unsigned ZigZagEncode(int value) { return ((unsigned)value << 1u) ^ (unsigned)(value >> 31); }
+
+private:
+    /// Write the completed bytes from the scratch to the destination.
+    void WriteCompletedBytes();
+
+    /// Destination serializer.
+    Serializer& dest_;
+    /// Bits not yet written to the destination.
+    unsigned long long scratch_{};
+    /// Number of bits in the scratch.
+    unsigned scratchBits_{};
+};
+
+/// Deserializer that reads values packed by BitWriter from another deserializer. Bytes are read from the source only when needed.
+/// @nobind
+class URHO3D_API BitReader : public Deserializer
+{
+public:
+    /// Construct with source deserializer.
+    explicit BitReader(Deserializer& source);
+
+    /// Read bytes starting from the current bit position. Return number of bytes actually read.
+    unsigned Read(void* dest, unsigned size) override;
+    /// Set position in bytes from where the source was when the reader was constructed. Bits not yet consumed are discarded and reading continues from the byte boundary. Return the actual new position.
+    unsigned Seek(unsigned position) override;
+    /// Return whether the end of the source has been reached and no bits remain.
+    bool IsEof() const override { return !scratchBits_ && source_.IsEof(); }
+
+    /// Read a value with the specified number of bits, at most 32.
+    unsigned ReadBits(unsigned numBits);
+    /// Read a single bit.
+    bool ReadBit() { return ReadBits(1) != 0; }
+    /// Read an unsigned value written with WriteVarBits().
+    unsigned ReadVarBits();
+    /// Read a signed value written with WriteSignedVarBits().
+    int ReadSignedVarBits() { return ZigZagDecode(ReadVarBits()); }
+
+    /// Map a zigzag encoded value back to signed.
+    static int ZigZagDecode(unsigned value) { return (int)(value >> 1u) ^ -(int)(value & 1u); }
+
+private:
+    /// Source deserializer.
+    Deserializer& source_;
+    /// Position of the source when the reader was constructed.
+    unsigned sourceStart_{};
+    /// Bits read from the source but not yet consumed.
+    unsigned long long scratch_{};
+    /// Number of bits in the scratch.
+    unsigned scratchBits_{};
+};
+
+}
@@ -56,6 +56,8 @@ public:
     /// Return whether the end of stream has been reached.
     /// @property
     virtual bool IsEof() const { return position_ >= size_; }
+    /// Return the whole stream contents if they are in memory and can be parsed in place without reading, or null.
+    virtual const unsigned char* GetInMemoryData() const { return nullptr; }
 
     /// Set position relative to current position. Return actual new position.
     unsigned SeekRelative(int delta);
@@ -23,6 +23,8 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
@@ -34,6 +36,7 @@
 #endif
 
 #include <cstdio>
+#include <thread>
 #include <LZ4/lz4.h>
 
 #include "../DebugNew.h"
@@ -63,6 +66,8 @@ static const char* openMode[] =
 static const unsigned READ_BUFFER_SIZE = 32768;
 #endif
 static const unsigned SKIP_BUFFER_SIZE = 1024;
+/// Minimum number of blocks in one read to decompress them on the work queue threads.
+static const unsigned PARALLEL_DECOMPRESS_BLOCKS = 8;
 
 File::File(Context* context) :
     Object(context),
@@ -136,6 +141,26 @@ bool File::Open(PackageFile* package, const ea::string& fileName)
     if (!entry)
         return false;
 
+    // Read entries of a memory-mapped package in place, without opening the package file
+    const bool blockCompressed = !entry->blocks_.empty();
+    if (package->IsMemoryMapped() && (!package->IsCompressed() || blockCompressed))
+    {
+        Close();
+
+        name_ = fileName;
+        mode_ = FILE_READ;
+        offset_ = entry->offset_;
+        checksum_ = entry->checksum_;
+        size_ = entry->size_;
+        position_ = 0;
+        compressed_ = blockCompressed;
+        mappedData_ = blockCompressed ? nullptr : package->GetMappedData() + entry->offset_;
+        package_ = package;
+        blockEntry_ = blockCompressed ? entry : nullptr;
+        readBlock_ = M_MAX_UNSIGNED;
+        return true;
+    }
+
     bool success = OpenInternal(package->GetName(), FILE_READ, true);
     if (!success)
     {
@@ -148,6 +173,12 @@ bool File::Open(PackageFile* package, const ea::string& fileName)
     checksum_ = entry->checksum_;
     size_ = entry->size_;
     compressed_ = package->IsCompressed();
+    if (blockCompressed)
+    {
+        package_ = package;
+        blockEntry_ = entry;
+        readBlock_ = M_MAX_UNSIGNED;
+    }
 
     // Seek to beginning of package entry's file data
     SeekInternal(offset_);
@@ -173,6 +204,16 @@ unsigned File::Read(void* dest, unsigned size)
     if (!size)
         return 0;
 
+    if (mappedData_)
+    {
+        memcpy(dest, mappedData_ + position_, size);
+        position_ += size;
+        return size;
+    }
+
+    if (blockEntry_)
+        return ReadBlocks(static_cast<unsigned char*>(dest), size);
+
 #ifdef __ANDROID__
     if (assetHandle_ && !compressed_)
     {
@@ -281,6 +322,13 @@ unsigned File::Seek(unsigned position)
     if (mode_ == FILE_READ && position > size_)
         position = size_;
 
+    // Memory-mapped and block-compressed entries are read at random
+    if (mappedData_ || blockEntry_)
+    {
+        position_ = position;
+        return position_;
+    }
+
     if (compressed_)
     {
         // Start over from the beginning
@@ -393,6 +441,18 @@ void File::Close()
     readBuffer_.reset();
     inputBuffer_.reset();
 
+    if (package_)
+    {
+        mappedData_ = nullptr;
+        blockEntry_ = nullptr;
+        package_.Reset();
+        packedBuffer_.clear();
+        position_ = 0;
+        size_ = 0;
+        offset_ = 0;
+        checksum_ = 0;
+    }
+
     if (handle_)
     {
         fclose((FILE*)handle_);
@@ -413,12 +473,153 @@ void File::Flush()
 bool File::IsOpen() const
 {
 #ifdef __ANDROID__
-    return handle_ != 0 || assetHandle_ != 0;
+    return handle_ != 0 || assetHandle_ != 0 || mappedData_ != nullptr || blockEntry_ != nullptr;
 #else
-    return handle_ != nullptr;
+    return handle_ != nullptr || mappedData_ != nullptr || blockEntry_ != nullptr;
 #endif
 }
 
+unsigned File::ReadBlocks(unsigned char* dest, unsigned size)
+{
+    const unsigned blockSize = package_->GetBlockSize();
+    const auto numBlocks = (unsigned)blockEntry_->blocks_.size() - 1;
+    unsigned sizeLeft = size;
+
+    while (sizeLeft)
+    {
+        const unsigned block = position_ / blockSize;
+        const unsigned blockStart = block * blockSize;
+        const unsigned endPosition = position_ + sizeLeft;
+
+        // Decompress whole blocks straight to the destination
+        if (position_ == blockStart)
+        {
+            const unsigned endBlock = endPosition == size_ ? numBlocks : endPosition / blockSize;
+            if (endBlock > block)
+            {
+                if (!DecompressBlocks(block, endBlock - block, dest))
+                    break;
+
+                const unsigned copySize = Min(endBlock * blockSize, size_) - position_;
+                dest += copySize;
+                sizeLeft -= copySize;
+                position_ += copySize;
+                continue;
+            }
+        }
+
+        // Partial blocks go through the read buffer
+        if (readBlock_ != block)
+        {
+            if (!readBuffer_)
+                readBuffer_ = new unsigned char[blockSize];
+            if (!DecompressBlocks(block, 1, readBuffer_.get()))
+            {
+                readBlock_ = M_MAX_UNSIGNED;
+                break;
+            }
+            readBlock_ = block;
+        }
+
+        const unsigned blockOffset = position_ - blockStart;
+        const unsigned copySize = Min(Min(blockSize, size_ - blockStart) - blockOffset, sizeLeft);
+        memcpy(dest, readBuffer_.get() + blockOffset, copySize);
+        dest += copySize;
+        sizeLeft -= copySize;
+        position_ += copySize;
+    }
+
+    if (sizeLeft)
+        URHO3D_LOGERROR("Error while decompressing file " + GetName());
+
+    return size - sizeLeft;
+}
+
+bool File::DecompressBlocks(unsigned first, unsigned count, unsigned char* dest)
+{
+    const ea::vector<unsigned>& blocks = blockEntry_->blocks_;
+    const unsigned blockSize = package_->GetBlockSize();
+    const unsigned packedStart = blocks[first];
+    const unsigned packedSize = blocks[first + count] - packedStart;
+
+    // Read the packed data of all the blocks at once, unless it can be decompressed straight from the memory mapping
+    const unsigned char* packedData = package_->GetMappedData();
+    if (packedData)
+        packedData += packedStart;
+    else
+    {
+        packedBuffer_.resize(packedSize);
+        SeekInternal(packedStart);
+        if (!ReadInternal(packedBuffer_.data(), packedSize))
+            return false;
+        packedData = packedBuffer_.data();
+    }
+
+    const unsigned entrySize = size_;
+    auto decompressBlock = [&blocks, blockSize, packedStart, packedData, entrySize, first, dest](unsigned index)
+    {
+        const unsigned block = first + index;
+        const unsigned unpackedSize = Min(blockSize, entrySize - block * blockSize);
+        const unsigned blockPackedSize = blocks[block + 1] - blocks[block];
+        const unsigned char* src = packedData + (blocks[block] - packedStart);
+        unsigned char* blockDest = dest + index * blockSize;
+
+        // Blocks that did not compress are stored as is
+        if (blockPackedSize == unpackedSize)
+        {
+            memcpy(blockDest, src, unpackedSize);
+            return true;
+        }
+        return LZ4_decompress_safe((const char*)src, (char*)blockDest, blockPackedSize, unpackedSize) == (int)unpackedSize;
+    };
+
+    // The work queue may only be fed from the main thread. Elsewhere, such as in the background loader threads, decompress serially
+    auto* workQueue = GetSubsystem<WorkQueue>();
+    if (count < PARALLEL_DECOMPRESS_BLOCKS || !workQueue || !workQueue->GetNumThreads() || !Thread::IsMainThread() ||
+        workQueue->IsCompleting())
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (!decompressBlock(i))
+                return false;
+        }
+        return true;
+    }
+
+    URHO3D_PROFILE("DecompressBlocks");
+
+    // The main thread takes part, so that the work also gets done if the worker threads are busy
+    std::atomic<unsigned> nextBlock{0};
+    std::atomic<bool> failed{false};
+    auto work = [&]()
+    {
+        for (unsigned i = nextBlock++; i < count; i = nextBlock++)
+        {
+            if (!decompressBlock(i))
+                failed = true;
+        }
+    };
+
+    ea::vector<SharedPtr<WorkItem> > items;
+    const unsigned numItems = Min(workQueue->GetNumThreads(), count - 1);
+    for (unsigned i = 0; i < numItems; ++i)
+        items.push_back(workQueue->AddWorkItem(work, M_MAX_UNSIGNED));
+
+    work();
+
+    // Items not started yet have nothing left to do, wait only for the ones in progress
+    for (SharedPtr<WorkItem>& item : items)
+    {
+        if (!workQueue->RemoveWorkItem(item))
+        {
+            while (!item->completed_)
+                std::this_thread::yield();
+        }
+    }
+
+    return !failed;
+}
+
 bool File::OpenInternal(const ea::string& fileName, FileMode mode, bool fromPackage)
 {
     Close();
@@ -59,6 +59,7 @@ enum FileMode
 };
 
 class PackageFile;
+struct PackageEntry;
 
 /// %File opened either through the filesystem or from within a package file.
 class URHO3D_API File : public Object, public AbstractFile
@@ -87,6 +88,8 @@ public:
 
     /// Return a checksum of the file contents using the SDBM hash algorithm.
     unsigned GetChecksum() override;
+    /// Return the file contents if opened from a memory-mapped package, or null.
+    const unsigned char* GetInMemoryData() const override { return mappedData_; }
 
     /// Open a filesystem file. Return true if successful.
     bool Open(const ea::string& fileName, FileMode mode = FILE_READ);
@@ -112,6 +115,9 @@ public:
     /// @property
     bool IsPackaged() const { return offset_ != 0; }
 
+    /// Return whether the file is read directly from a memory-mapped package.
+    bool IsMemoryMapped() const { return mappedData_ != nullptr; }
+
     /// Reads a binary file to buffer.
     void ReadBinary(ea::vector<unsigned char>& buffer);
 
@@ -135,6 +141,10 @@ private:
     bool ReadInternal(void* dest, unsigned size);
     /// Seek in file internally using either C standard IO functions or SDL RWops for Android asset files.
     void SeekInternal(unsigned newPosition);
+    /// Read from a block-compressed package entry at the current position. Return number of bytes actually read.
+    unsigned ReadBlocks(unsigned char* dest, unsigned size);
+    /// Decompress a range of whole blocks of a block-compressed package entry. Large ranges are decompressed on the work queue threads when called from the main thread. Return true if successful.
+    bool DecompressBlocks(unsigned first, unsigned count, unsigned char* dest);
 
     /// Absolute file name.
     ea::string absoluteFileName_;
@@ -156,6 +166,16 @@ private:
     unsigned readBufferSize_;
     /// Start position within a package file, 0 for regular files.
     unsigned offset_;
+    /// Entry data within a memory-mapped package file. Null for compressed entries.
+    const unsigned char* mappedData_{};
+    /// Package file when reading from a memory mapping or a block-compressed package, held to keep the mapping and block table alive.
+    SharedPtr<PackageFile> package_;
+    /// Package entry with the block table when reading from a block-compressed package.
+    const PackageEntry* blockEntry_{};
+    /// Index of the block in the read buffer when reading from a block-compressed package.
+    unsigned readBlock_{};
+    /// Packed data of the blocks being decompressed when reading from a block-compressed package without a memory mapping.
+    ea::vector<unsigned char> packedBuffer_;
     /// Content checksum.
     unsigned checksum_;
     /// Compression flag.
@@ -48,6 +48,8 @@ public:
     unsigned Seek(unsigned position) override;
     /// Write bytes to the memory area.
     unsigned Write(const void* data, unsigned size) override;
+    /// Return the memory area for parsing in place.
+    const unsigned char* GetInMemoryData() const override { return buffer_; }
 
     /// Return memory area.
     unsigned char* GetData() { return buffer_; }
@@ -27,6 +27,14 @@
 #include "../IO/PackageFile.h"
 #include "../IO/FileSystem.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace Urho3D
 {
 
@@ -39,20 +47,25 @@ PackageFile::PackageFile(Context* context) :
 {
 }
 
-PackageFile::PackageFile(Context* context, const ea::string& fileName, unsigned startOffset) :
+PackageFile::PackageFile(Context* context, const ea::string& fileName, unsigned startOffset, bool memoryMapped) :
     Object(context),
     totalSize_(0),
     totalDataSize_(0),
     checksum_(0),
     compressed_(false)
 {
-    Open(fileName, startOffset);
+    Open(fileName, startOffset, memoryMapped);
 }
 
-PackageFile::~PackageFile() = default;
+PackageFile::~PackageFile()
+{
+    UnmapMemory();
+}
 
-bool PackageFile::Open(const ea::string& fileName, unsigned startOffset)
+bool PackageFile::Open(const ea::string& fileName, unsigned startOffset, bool memoryMapped)
 {
+    UnmapMemory();
+
     SharedPtr<File> file(new File(context_, fileName));
     if (!file->IsOpen())
         return false;
@@ -91,15 +104,30 @@ bool PackageFile::Open(const ea::string& fileName, unsigned startOffset)
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
 
+    blockSize_ = 0;
     if (id == "RPAK" || id == "RLZ4")
     {
         // New PAK file format includes two extra PAK header fields:
-        // * Version. At this time this field is unused and is always 0. It will be used in the future if PAK format needs to be extended.
+        // * Version. 0 for the original format. PACKAGE_VERSION_BLOCKS adds the block size after the file list offset, and a table
+        //   of compressed block sizes after each entry of a compressed package, so that compressed entries can be read at random.
         // * File list offset. New format writes file list in the end of the file. This allows PAK creation without knowing entire file list
         //   beforehand.
-        unsigned version = file->ReadUInt();                        // Reserved for future use.
-        assert(version == 0);
+        unsigned version = file->ReadUInt();
+        if (version > PACKAGE_VERSION_BLOCKS)
+        {
+            URHO3D_LOGERROR(fileName + " has unsupported package version " + ea::to_string(version));
+            return false;
+        }
         int64_t fileListOffset = file->ReadInt64();                 // New format has file list at the end of the file.
+        if (version >= PACKAGE_VERSION_BLOCKS && compressed_)
+        {
+            blockSize_ = file->ReadUInt();
+            if (!blockSize_)
+            {
+                URHO3D_LOGERROR(fileName + " has zero compressed block size");
+                return false;
+            }
+        }
         file->Seek(fileListOffset);                                 // TODO: Serializer/Deserializer do not support files bigger than 4 GB
     }
 
@@ -110,7 +138,20 @@ bool PackageFile::Open(const ea::string& fileName, unsigned startOffset)
         newEntry.offset_ = file->ReadUInt() + startOffset;
         totalDataSize_ += (newEntry.size_ = file->ReadUInt());
         newEntry.checksum_ = file->ReadUInt();
-        if (!compressed_ && newEntry.offset_ + newEntry.size_ > totalSize_)
+
+        unsigned endOffset = newEntry.offset_ + newEntry.size_;
+        if (blockSize_)
+        {
+            // Convert the compressed block sizes to offsets
+            const unsigned numBlocks = (newEntry.size_ + blockSize_ - 1) / blockSize_;
+            newEntry.blocks_.resize(numBlocks + 1);
+            newEntry.blocks_[0] = newEntry.offset_;
+            for (unsigned j = 0; j < numBlocks; ++j)
+                newEntry.blocks_[j + 1] = newEntry.blocks_[j] + file->ReadUInt();
+            endOffset = newEntry.blocks_.back();
+        }
+
+        if ((!compressed_ || blockSize_) && endOffset > totalSize_)
         {
             URHO3D_LOGERROR("File entry " + entryName + " outside package file");
             return false;
@@ -119,6 +160,10 @@ bool PackageFile::Open(const ea::string& fileName, unsigned startOffset)
             entries_[entryName] = newEntry;
     }
 
+    // Sequentially compressed entries need to be decompressed through the file anyway, so mapping would not save the copy
+    if (memoryMapped && (!compressed_ || blockSize_) && !MapMemory())
+        URHO3D_LOGWARNING("Could not memory-map package file " + fileName + ", reading through file IO");
+
     return true;
 }
 
@@ -201,4 +246,74 @@ void PackageFile::Scan(ea::vector<ea::string>& result, const ea::string& pathNam
     }
 }
 
+bool PackageFile::MapMemory()
+{
+#ifdef __ANDROID__
+    // Packages inside the APK can not be mapped
+    if (URHO3D_IS_ASSET(fileName_))
+        return false;
+#endif
+
+    if (!totalSize_)
+        return false;
+
+#if defined(_WIN32)
+    HANDLE fileHandle = CreateFileW(GetWideNativePath(fileName_).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    // The mapping keeps the file open, so the file handle can be closed right away
+    HANDLE mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(fileHandle);
+    if (!mappingHandle)
+        return false;
+
+    void* data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, totalSize_);
+    if (!data)
+    {
+        CloseHandle(mappingHandle);
+        return false;
+    }
+
+    mappingHandle_ = mappingHandle;
+    mappedData_ = static_cast<unsigned char*>(data);
+    mappedSize_ = totalSize_;
+    return true;
+#elif !defined(__EMSCRIPTEN__)
+    int fd = open(GetNativePath(fileName_).c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    // The mapping stays valid after closing the descriptor
+    void* data = mmap(nullptr, totalSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    mappedData_ = static_cast<unsigned char*>(data);
+    mappedSize_ = totalSize_;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PackageFile::UnmapMemory()
+{
+    if (!mappedData_)
+        return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(mappedData_);
+    CloseHandle((HANDLE)mappingHandle_);
+    mappingHandle_ = nullptr;
+#elif !defined(__EMSCRIPTEN__)
+    munmap(mappedData_, mappedSize_);
+#endif
+
+    mappedData_ = nullptr;
+    mappedSize_ = 0;
+}
+
 }
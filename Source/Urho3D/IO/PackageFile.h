@@ -27,6 +27,9 @@
 namespace Urho3D
 {
 
+/// Package format version with per-entry block tables for random access to compressed entries.
+static const unsigned PACKAGE_VERSION_BLOCKS = 1;
+
 /// %File entry within the package file.
 struct PackageEntry
 {
@@ -36,6 +39,8 @@ struct PackageEntry
     unsigned size_;
     /// File checksum.
     unsigned checksum_;
+    /// Offsets of the compressed blocks within the package followed by the end offset. Empty unless the package is block-compressed.
+    ea::vector<unsigned> blocks_;
 };
 
 /// Stores files of a directory tree sequentially for convenient access.
@@ -46,13 +51,13 @@ class URHO3D_API PackageFile : public Object
 public:
     /// Construct.
     explicit PackageFile(Context* context);
-    /// Construct and open.
-    PackageFile(Context* context, const ea::string& fileName, unsigned startOffset = 0);
+    /// Construct and open. Optionally memory-map the package.
+    PackageFile(Context* context, const ea::string& fileName, unsigned startOffset = 0, bool memoryMapped = false);
     /// Destruct.
     ~PackageFile() override;
 
-    /// Open the package file. Return true if successful.
-    bool Open(const ea::string& fileName, unsigned startOffset = 0);
+    /// Open the package file. Optionally memory-map the whole package so that uncompressed entries are read without file IO. Return true if successful.
+    bool Open(const ea::string& fileName, unsigned startOffset = 0, bool memoryMapped = false);
     /// Check if a file exists within the package file. This will be case-insensitive on Windows and case-sensitive on other platforms.
     bool Exists(const ea::string& fileName) const;
     /// Return the file entry corresponding to the name, or null if not found. This will be case-insensitive on Windows and case-sensitive on other platforms.
@@ -88,6 +93,17 @@ public:
     /// @property
     bool IsCompressed() const { return compressed_; }
 
+    /// Return uncompressed block size if the package is block-compressed for random access, or 0 if the compressed entries can only be read sequentially.
+    /// @property
+    unsigned GetBlockSize() const { return blockSize_; }
+
+    /// Return whether the package is memory-mapped.
+    /// @property
+    bool IsMemoryMapped() const { return mappedData_ != nullptr; }
+
+    /// Return the memory-mapped contents of the whole package file, or null if not mapped. Entry offsets index into it.
+    const unsigned char* GetMappedData() const { return mappedData_; }
+
     /// Return list of file names in the package.
     const ea::vector<ea::string> GetEntryNames() const { return entries_.keys(); }
 
@@ -107,6 +123,11 @@ public:
     void Scan(ea::vector<ea::string>& result, const ea::string& pathName, const ea::string& filter, bool recursive) const;
 
 private:
+    /// Memory-map the package file. Return true if successful.
+    bool MapMemory();
+    /// Release the memory mapping.
+    void UnmapMemory();
+
     /// File entries.
     ea::unordered_map<ea::string, PackageEntry> entries_;
     /// File name.
@@ -121,6 +142,14 @@ private:
     unsigned checksum_;
     /// Compressed flag.
     bool compressed_;
+    /// Uncompressed block size of a block-compressed package.
+    unsigned blockSize_{};
+    /// Memory-mapped package file contents.
+    unsigned char* mappedData_{};
+    /// Memory-mapped size in bytes.
+    unsigned mappedSize_{};
+    /// File mapping object handle on Windows.
+    void* mappingHandle_{};
 };
 
 }
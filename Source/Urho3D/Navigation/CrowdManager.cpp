@@ -24,6 +24,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../IO/Log.h"
 #include "../Navigation/CrowdAgent.h"
@@ -78,6 +79,68 @@ void CrowdAgentUpdateCallback(bool positionUpdate, dtCrowdAgent* ag, float* pos,
         crowdAgent->OnCrowdVelocityUpdate(ag, pos, dt);
 }
 
+/// Detour crowd task scheduler which splits the crowd update stages between WorkQueue threads.
+class CrowdTaskScheduler : public dtCrowdTaskScheduler
+{
+public:
+    /// Construct.
+    explicit CrowdTaskScheduler(WorkQueue* workQueue) :
+        workQueue_(workQueue)
+    {
+    }
+
+    /// Return number of threads including the calling one.
+    int getNumThreads() const override { return static_cast<int>(workQueue_->GetNumThreads()) + 1; }
+
+    /// Execute task over the range [0, count) and wait for completion.
+    void parallelFor(const int count, dtCrowdTask task, void* context) override
+    {
+        const int numItems = Min(count, getNumThreads());
+        const int countPerItem = (count + numItems - 1) / numItems;
+
+        ranges_.resize(numItems);
+        int begin = 0;
+        for (int i = 0; i < numItems; ++i)
+        {
+            TaskRange& range = ranges_[i];
+            range.task_ = task;
+            range.context_ = context;
+            range.begin_ = begin;
+            range.end_ = Min(begin + countPerItem, count);
+            begin = range.end_;
+
+            SharedPtr<WorkItem> item = workQueue_->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = RunTaskRange;
+            item->start_ = &range;
+            workQueue_->AddWorkItem(item);
+        }
+        workQueue_->Complete(M_MAX_UNSIGNED);
+    }
+
+private:
+    /// Subrange of a task.
+    struct TaskRange
+    {
+        dtCrowdTask task_{};
+        void* context_{};
+        int begin_{};
+        int end_{};
+    };
+
+    /// Work item function.
+    static void RunTaskRange(const WorkItem* item, unsigned threadIndex)
+    {
+        const auto* range = reinterpret_cast<const TaskRange*>(item->start_);
+        range->task_(range->context_, range->begin_, range->end_, static_cast<int>(threadIndex));
+    }
+
+    /// Work queue.
+    WorkQueue* workQueue_{};
+    /// Subranges of the current task.
+    ea::vector<TaskRange> ranges_;
+};
+
 CrowdManager::CrowdManager(Context* context) :
     Component(context),
     maxAgents_(DEFAULT_MAX_AGENTS),
@@ -102,6 +165,7 @@ void CrowdManager::RegisterObject(Context* context)
     URHO3D_ATTRIBUTE("Max Agents", unsigned, maxAgents_, DEFAULT_MAX_AGENTS, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Max Agent Radius", float, maxAgentRadius_, DEFAULT_MAX_AGENT_RADIUS, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Navigation Mesh", unsigned, navigationMeshId_, 0, AM_DEFAULT | AM_COMPONENTID);
+    URHO3D_ACCESSOR_ATTRIBUTE("Threaded Update", GetThreadedUpdate, SetThreadedUpdate, bool, false, AM_DEFAULT);
     URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Filter Types", GetQueryFilterTypesAttr, SetQueryFilterTypesAttr,
         VariantVector, Variant::emptyVariantVector, AM_DEFAULT)
         .SetMetadata(AttributeMetadata::P_VECTOR_STRUCT_ELEMENTS, filterTypesStructureElementNames);
@@ -391,6 +455,25 @@ void CrowdManager::SetObstacleAvoidanceParams(unsigned obstacleAvoidanceType, co
     }
 }
 
+void CrowdManager::SetThreadedUpdate(bool enable)
+{
+    threadedUpdate_ = enable;
+    if (!crowd_)
+        return;
+
+    // There is no point in splitting the update if there are no worker threads
+    auto* workQueue = GetSubsystem<WorkQueue>();
+    if (enable && workQueue && workQueue->GetNumThreads() > 0)
+    {
+        if (!taskScheduler_)
+            taskScheduler_ = ea::make_unique<CrowdTaskScheduler>(workQueue);
+        if (!crowd_->setTaskScheduler(taskScheduler_.get()))
+            URHO3D_LOGWARNING("CrowdManager: could not allocate per-thread queries, crowd will be updated on the main thread");
+    }
+    else
+        crowd_->setTaskScheduler(nullptr);
+}
+
 Vector3 CrowdManager::FindNearestPoint(const Vector3& point, int queryFilterType, dtPolyRef* nearestRef)
 {
     if (nearestRef)
@@ -594,6 +677,10 @@ bool CrowdManager::CreateCrowd()
         return false;
     }
 
+    // Split the update between worker threads if requested. Must be done after init() as it purges the crowd
+    if (threadedUpdate_)
+        SetThreadedUpdate(true);
+
     // Reconfigure the newly initialized crowd
     SetQueryFilterTypesAttr(queryFilterTypeConfiguration);
     SetObstacleAvoidanceTypesAttr(obstacleAvoidanceTypeConfiguration);
@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <EASTL/unique_ptr.h>
+
 #include "../Scene/Component.h"
 
 #ifdef DT_POLYREF64
@@ -38,6 +40,7 @@ namespace Urho3D
 {
 
 class CrowdAgent;
+class CrowdTaskScheduler;
 class NavigationMesh;
 
 /// Parameter structure for obstacle avoidance params (copied from DetourObstacleAvoidance.h in order to hide Detour header from Urho3D library users).
@@ -113,6 +116,9 @@ public:
     void SetObstacleAvoidanceTypesAttr(const VariantVector& value);
     /// Set the params for the specified obstacle avoidance type.
     void SetObstacleAvoidanceParams(unsigned obstacleAvoidanceType, const CrowdObstacleAvoidanceParams& params);
+    /// Set whether the crowd simulation is split between WorkQueue threads. Agent callbacks are always executed on the main thread.
+    /// @property
+    void SetThreadedUpdate(bool enable);
 
     /// Get all the crowd agent components in the specified node hierarchy. If the node is not specified then use scene node. When inCrowdFilter is set to true then only get agents that are in the crowd.
     ea::vector<CrowdAgent*> GetAgents(Node* node = nullptr, bool inCrowdFilter = true) const;
@@ -168,6 +174,10 @@ public:
     /// Get the params for the specified obstacle avoidance type.
     const CrowdObstacleAvoidanceParams& GetObstacleAvoidanceParams(unsigned obstacleAvoidanceType) const;
 
+    /// Return whether the crowd simulation is split between WorkQueue threads.
+    /// @property
+    bool GetThreadedUpdate() const { return threadedUpdate_; }
+
 protected:
     /// Create and initialized internal Detour crowd object. When it is a recreate, it preserves the configuration and attempts to re-add existing agents in the previous crowd back to the newly created crowd.
     bool CreateCrowd();
@@ -199,6 +209,10 @@ private:
 
     /// Internal Detour crowd object.
     dtCrowd* crowd_{};
+    /// Task scheduler used to split the crowd update between WorkQueue threads.
+    ea::unique_ptr<CrowdTaskScheduler> taskScheduler_;
+    /// Whether the crowd simulation is split between WorkQueue threads.
+    bool threadedUpdate_{false};
     /// Velocity shader.
     CrowdAgentVelocityShader velocityShader_;
     /// NavigationMesh for which the crowd was created.
@@ -27,6 +27,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
@@ -41,6 +42,7 @@
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 
+#include <atomic>
 #include <LZ4/lz4.h>
 #include <Detour/DetourNavMesh.h>
 #include <Detour/DetourNavMeshBuilder.h>
@@ -209,6 +211,57 @@ struct LinearAllocator : public dtTileCacheAlloc
     }
 };
 
+/// Snapshot of the data required to build the compressed tile cache layers of one tile outside of the main thread.
+struct DynamicNavigationMesh::TileCacheBuildTask : public RefCounted
+{
+    /// Construct.
+    TileCacheBuildTask() :
+        build_(&alloc_)
+    {
+    }
+
+    /// Destruct. Free the layer data that was never added to the tile cache.
+    ~TileCacheBuildTask() override
+    {
+        for (const TileCacheData& layer : layers_)
+            dtFree(layer.data);
+    }
+
+    /// Tile index.
+    IntVector2 tile_;
+    /// Tile bounding box in the navigation mesh space.
+    BoundingBox tileBoundingBox_;
+    /// Recast configuration.
+    rcConfig config_;
+    /// Type of the heightfield partitioning.
+    NavmeshPartitionType partitionType_{};
+    /// Allocator of the build data. The linear allocator of the tile cache is not thread-safe.
+    dtTileCacheAlloc alloc_;
+    /// Compressor of the layers. Owned by the task so that it outlives the navigation mesh if needed.
+    TileCompressor compressor_;
+    /// Geometry and intermediate build results.
+    DynamicNavBuildData build_;
+    /// Resulting compressed layers.
+    ea::vector<TileCacheData> layers_;
+    /// Whether the layers were built successfully.
+    bool success_{};
+    /// Whether the task is overridden by a later build of the same tile.
+    bool superseded_{};
+    /// Whether the task is finished. Written by the worker thread.
+    std::atomic<bool> completed_{};
+};
+
+/// Asynchronous build of a range of tiles. Tiles are swapped in together when all of them are built.
+struct DynamicNavigationMesh::TileCacheAsyncBuild : public RefCounted
+{
+    /// First tile of the range.
+    IntVector2 from_;
+    /// Last tile of the range.
+    IntVector2 to_;
+    /// Tile build tasks.
+    ea::vector<SharedPtr<TileCacheBuildTask> > tasks_;
+};
+
 
 DynamicNavigationMesh::DynamicNavigationMesh(Context* context) :
     NavigationMesh(context),
@@ -540,6 +593,95 @@ bool DynamicNavigationMesh::Build(const IntVector2& from, const IntVector2& to)
     return true;
 }
 
+bool DynamicNavigationMesh::BuildAsync(const BoundingBox& boundingBox)
+{
+    if (!node_)
+        return false;
+
+    if (!navMesh_)
+    {
+        URHO3D_LOGERROR("Navigation mesh must first be built fully before it can be partially rebuilt");
+        return false;
+    }
+
+    IntVector2 from;
+    IntVector2 to;
+    GetTileRange(boundingBox, from, to);
+    return BuildAsync(from, to);
+}
+
+bool DynamicNavigationMesh::BuildAsync(const IntVector2& from, const IntVector2& to)
+{
+    URHO3D_PROFILE("BuildPartialNavigationMeshAsync");
+
+    if (!node_)
+        return false;
+
+    if (!navMesh_)
+    {
+        URHO3D_LOGERROR("Navigation mesh must first be built fully before it can be partially rebuilt");
+        return false;
+    }
+
+    if (!node_->GetWorldScale().Equals(Vector3::ONE))
+        URHO3D_LOGWARNING("Navigation mesh root node has scaling. Agent parameters may not work as intended");
+
+    // Geometry is gathered here in the main thread, only Recast processing and compression is done in the worker threads
+    ea::vector<NavigationGeometryInfo> geometryList;
+    CollectGeometries(geometryList);
+
+    auto* queue = GetSubsystem<WorkQueue>();
+
+    SharedPtr<TileCacheAsyncBuild> asyncBuild(new TileCacheAsyncBuild());
+    asyncBuild->from_ = from;
+    asyncBuild->to_ = to;
+
+    for (int z = from.y_; z <= to.y_; ++z)
+    {
+        for (int x = from.x_; x <= to.x_; ++x)
+        {
+            // Newer geometry wins if the tile is already being rebuilt
+            const IntVector2 tile(x, z);
+            for (TileCacheAsyncBuild* pendingBuild : tileCacheAsyncBuilds_)
+            {
+                for (TileCacheBuildTask* pendingTask : pendingBuild->tasks_)
+                {
+                    if (pendingTask->tile_ == tile)
+                        pendingTask->superseded_ = true;
+                }
+            }
+
+            SharedPtr<TileCacheBuildTask> task = PrepareTileCacheBuild(geometryList, x, z);
+            asyncBuild->tasks_.push_back(task);
+
+            // Use low priority so that the frame never waits for the tiles
+            queue->AddWorkItem([task]()
+            {
+                BuildTileCacheLayers(*task);
+                task->completed_ = true;
+            }, 0);
+        }
+    }
+
+    tileCacheAsyncBuilds_.push_back(asyncBuild);
+    UpdateBeginFrameSubscription();
+
+    URHO3D_LOGDEBUG("Queued " + ea::to_string(asyncBuild->tasks_.size()) + " tiles of the navigation mesh for rebuild");
+    return true;
+}
+
+void DynamicNavigationMesh::CancelAsyncBuilds()
+{
+    // Worker threads keep their tasks alive until finished, the results are simply discarded
+    tileCacheAsyncBuilds_.clear();
+    NavigationMesh::CancelAsyncBuilds();
+}
+
+bool DynamicNavigationMesh::IsBuildingAsync() const
+{
+    return !tileCacheAsyncBuilds_.empty() || NavigationMesh::IsBuildingAsync();
+}
+
 ea::vector<unsigned char> DynamicNavigationMesh::GetTileData(const IntVector2& tile) const
 {
     VectorBuffer ret;
@@ -739,9 +881,13 @@ ea::vector<unsigned char> DynamicNavigationMesh::GetNavigationDataAttr() const
         const dtTileCacheParams* tcParams = tileCache_->getParams();
         ret.Write(tcParams, sizeof(dtTileCacheParams));
 
-        for (int z = 0; z < numTilesZ_; ++z)
-            for (int x = 0; x < numTilesX_; ++x)
-                WriteTiles(ret, x, z);
+        // Streamed tiles are stored as separate resources
+        if (GetTileStreamingPath().empty())
+        {
+            for (int z = 0; z < numTilesZ_; ++z)
+                for (int x = 0; x < numTilesX_; ++x)
+                    WriteTiles(ret, x, z);
+        }
     }
     return ret.GetBuffer();
 }
@@ -799,7 +945,10 @@ bool DynamicNavigationMesh::ReadTiles(Deserializer& source, bool silent)
     }
 
     for (unsigned i = 0; i < tileQueue_.size(); ++i)
+    {
         tileCache_->buildNavMeshTilesAt(tileQueue_[i].x_, tileQueue_[i].y_, navMesh_);
+        MarkTileGraphDirty(tileQueue_[i], tileQueue_[i]);
+    }
 
     tileCache_->update(0, navMesh_);
 
@@ -823,13 +972,49 @@ int DynamicNavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometr
 {
     URHO3D_PROFILE("BuildNavigationMeshTile");
 
-    tileCache_->removeTile(navMesh_->getTileRefAt(x, z, 0), nullptr, nullptr);
+    SharedPtr<TileCacheBuildTask> task = PrepareTileCacheBuild(geometryList, x, z);
+    BuildTileCacheLayers(*task);
+    if (!task->success_ || task->layers_.empty())
+        return 0;
 
-    const BoundingBox tileBoundingBox = GetTileBoundingBox(IntVector2(x, z));
+    // The caller owns the layer data now
+    const int numLayers = (int)task->layers_.size();
+    for (int i = 0; i < numLayers; ++i)
+        tiles[i] = task->layers_[i];
+    task->layers_.clear();
 
-    DynamicNavBuildData build(allocator_.get());
+    SendAreaRebuiltEvent(task->tileBoundingBox_);
+    return numLayers;
+}
 
-    rcConfig cfg;   // NOLINT(hicpp-member-init)
+unsigned DynamicNavigationMesh::BuildTiles(ea::vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to)
+{
+    unsigned numTiles = 0;
+
+    for (int z = from.y_; z <= to.y_; ++z)
+    {
+        for (int x = from.x_; x <= to.x_; ++x)
+        {
+            URHO3D_PROFILE("BuildNavigationMeshTile");
+
+            SharedPtr<TileCacheBuildTask> task = PrepareTileCacheBuild(geometryList, x, z);
+            BuildTileCacheLayers(*task);
+            numTiles += CommitTileCacheBuild(task);
+        }
+    }
+
+    return numTiles;
+}
+
+SharedPtr<DynamicNavigationMesh::TileCacheBuildTask> DynamicNavigationMesh::PrepareTileCacheBuild(
+    ea::vector<NavigationGeometryInfo>& geometryList, int x, int z)
+{
+    SharedPtr<TileCacheBuildTask> task(new TileCacheBuildTask());
+    task->tile_ = IntVector2(x, z);
+    task->tileBoundingBox_ = GetTileBoundingBox(task->tile_);
+    task->partitionType_ = partitionType_;
+
+    rcConfig& cfg = task->config_;
     memset(&cfg, 0, sizeof cfg);
     cfg.cs = cellSize_;
     cfg.ch = cellHeight_;
@@ -849,31 +1034,46 @@ int DynamicNavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometr
     cfg.detailSampleDist = detailSampleDistance_ < 0.9f ? 0.0f : cellSize_ * detailSampleDistance_;
     cfg.detailSampleMaxError = cellHeight_ * detailSampleMaxError_;
 
-    rcVcopy(cfg.bmin, &tileBoundingBox.min_.x_);
-    rcVcopy(cfg.bmax, &tileBoundingBox.max_.x_);
+    rcVcopy(cfg.bmin, &task->tileBoundingBox_.min_.x_);
+    rcVcopy(cfg.bmax, &task->tileBoundingBox_.max_.x_);
     cfg.bmin[0] -= cfg.borderSize * cfg.cs;
     cfg.bmin[2] -= cfg.borderSize * cfg.cs;
     cfg.bmax[0] += cfg.borderSize * cfg.cs;
     cfg.bmax[2] += cfg.borderSize * cfg.cs;
 
+    // Geometry is copied into the build data, so the layers may be built later without touching the scene
     BoundingBox expandedBox(*reinterpret_cast<Vector3*>(cfg.bmin), *reinterpret_cast<Vector3*>(cfg.bmax));
-    GetTileGeometry(&build, geometryList, expandedBox);
+    GetTileGeometry(&task->build_, geometryList, expandedBox);
+
+    return task;
+}
+
+void DynamicNavigationMesh::BuildTileCacheLayers(TileCacheBuildTask& task)
+{
+    URHO3D_PROFILE("BuildNavigationMeshTileLayers");
+
+    DynamicNavBuildData& build = task.build_;
+    const rcConfig& cfg = task.config_;
 
     if (build.vertices_.empty() || build.indices_.empty())
-        return 0; // Nothing to do
+    {
+        // Nothing to do
+        task.success_ = true;
+        return;
+    }
 
     build.heightField_ = rcAllocHeightfield();
     if (!build.heightField_)
     {
         URHO3D_LOGERROR("Could not allocate heightfield");
-        return 0;
+        return;
     }
 
     if (!rcCreateHeightfield(build.ctx_, *build.heightField_, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs,
         cfg.ch))
     {
         URHO3D_LOGERROR("Could not create heightfield");
-        return 0;
+        return;
     }
 
     unsigned numTriangles = build.indices_.size() / 3;
@@ -893,18 +1093,18 @@ int DynamicNavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometr
     if (!build.compactHeightField_)
     {
         URHO3D_LOGERROR("Could not allocate create compact heightfield");
-        return 0;
+        return;
     }
     if (!rcBuildCompactHeightfield(build.ctx_, cfg.walkableHeight, cfg.walkableClimb, *build.heightField_,
         *build.compactHeightField_))
     {
         URHO3D_LOGERROR("Could not build compact heightfield");
-        return 0;
+        return;
     }
     if (!rcErodeWalkableArea(build.ctx_, cfg.walkableRadius, *build.compactHeightField_))
     {
         URHO3D_LOGERROR("Could not erode compact heightfield");
-        return 0;
+        return;
     }
 
     // area volumes
@@ -912,18 +1112,18 @@ int DynamicNavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometr
         rcMarkBoxArea(build.ctx_, &build.navAreas_[i].bounds_.min_.x_, &build.navAreas_[i].bounds_.max_.x_,
             build.navAreas_[i].areaID_, *build.compactHeightField_);
 
-    if (this->partitionType_ == NAVMESH_PARTITION_WATERSHED)
+    if (task.partitionType_ == NAVMESH_PARTITION_WATERSHED)
     {
         if (!rcBuildDistanceField(build.ctx_, *build.compactHeightField_))
         {
             URHO3D_LOGERROR("Could not build distance field");
-            return 0;
+            return;
         }
         if (!rcBuildRegions(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea,
             cfg.mergeRegionArea))
         {
             URHO3D_LOGERROR("Could not build regions");
-            return 0;
+            return;
         }
     }
     else
@@ -931,7 +1131,7 @@ int DynamicNavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometr
         if (!rcBuildRegionsMonotone(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
         {
             URHO3D_LOGERROR("Could not build monotone regions");
-            return 0;
+            return;
         }
     }
 
@@ -939,24 +1139,23 @@ int DynamicNavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometr
     if (!build.heightFieldLayers_)
     {
         URHO3D_LOGERROR("Could not allocate height field layer set");
-        return 0;
+        return;
     }
 
     if (!rcBuildHeightfieldLayers(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.walkableHeight,
         *build.heightFieldLayers_))
     {
         URHO3D_LOGERROR("Could not build height field layers");
-        return 0;
+        return;
     }
 
-    int retCt = 0;
     for (int i = 0; i < build.heightFieldLayers_->nlayers; ++i)
     {
         dtTileCacheLayerHeader header;      // NOLINT(hicpp-member-init)
         header.magic = DT_TILECACHE_MAGIC;
         header.version = DT_TILECACHE_VERSION;
-        header.tx = x;
-        header.ty = z;
+        header.tx = task.tile_.x_;
+        header.ty = task.tile_.y_;
         header.tlayer = i;
 
         rcHeightfieldLayer* layer = &build.heightFieldLayers_->layers[i];
@@ -973,69 +1172,97 @@ int DynamicNavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometr
         header.hmin = (unsigned short)layer->hmin;
         header.hmax = (unsigned short)layer->hmax;
 
+        TileCacheData data{};
         if (dtStatusFailed(
-            dtBuildTileCacheLayer(compressor_.get()/*compressor*/, &header, layer->heights, layer->areas/*areas*/, layer->cons,
-                &(tiles[retCt].data), &tiles[retCt].dataSize)))
+            dtBuildTileCacheLayer(&task.compressor_, &header, layer->heights, layer->areas/*areas*/, layer->cons,
+                &data.data, &data.dataSize)))
         {
             URHO3D_LOGERROR("Failed to build tile cache layers");
-            return 0;
+            return;
         }
-        else
-            ++retCt;
+        task.layers_.push_back(data);
     }
 
-    // Send a notification of the rebuild of this tile to anyone interested
+    task.success_ = true;
+}
+
+unsigned DynamicNavigationMesh::CommitTileCacheBuild(TileCacheBuildTask* task)
+{
+    const int x = task->tile_.x_;
+    const int z = task->tile_.y_;
+
+    // Remove previous layers (if any)
+    dtCompressedTileRef existing[TILECACHE_MAXLAYERS];
+    const int existingCt = tileCache_->getTilesAt(x, z, existing, maxLayers_);
+    for (int i = 0; i < existingCt; ++i)
+    {
+        unsigned char* data = nullptr;
+        if (!dtStatusFailed(tileCache_->removeTile(existing[i], &data, nullptr)) && data != nullptr)
+            dtFree(data);
+    }
+    MarkTileGraphDirty(task->tile_, task->tile_);
+
+    if (!task->success_ || task->layers_.empty())
+        return 0;
+
+    unsigned numLayers = 0;
+    for (TileCacheData& layer : task->layers_)
     {
-        using namespace NavigationAreaRebuilt;
-        VariantMap& eventData = GetContext()->GetEventDataMap();
-        eventData[P_NODE] = GetNode();
-        eventData[P_MESH] = this;
-        eventData[P_BOUNDSMIN] = Variant(tileBoundingBox.min_);
-        eventData[P_BOUNDSMAX] = Variant(tileBoundingBox.max_);
-        SendEvent(E_NAVIGATION_AREA_REBUILT, eventData);
+        dtCompressedTileRef tileRef;
+        int status = tileCache_->addTile(layer.data, layer.dataSize, DT_COMPRESSEDTILE_FREE_DATA, &tileRef);
+        if (dtStatusFailed((dtStatus)status))
+            continue;
+
+        // Tile cache owns the data now
+        layer.data = nullptr;
+        tileCache_->buildNavMeshTile(tileRef, navMesh_);
+        ++numLayers;
     }
 
-    return retCt;
+    SendAreaRebuiltEvent(task->tileBoundingBox_);
+    return numLayers;
 }
 
-unsigned DynamicNavigationMesh::BuildTiles(ea::vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to)
+void DynamicNavigationMesh::SendAreaRebuiltEvent(const BoundingBox& tileBoundingBox)
 {
-    unsigned numTiles = 0;
+    // Send a notification of the rebuild of this tile to anyone interested
+    using namespace NavigationAreaRebuilt;
+    VariantMap& eventData = GetContext()->GetEventDataMap();
+    eventData[P_NODE] = GetNode();
+    eventData[P_MESH] = this;
+    eventData[P_BOUNDSMIN] = Variant(tileBoundingBox.min_);
+    eventData[P_BOUNDSMAX] = Variant(tileBoundingBox.max_);
+    SendEvent(E_NAVIGATION_AREA_REBUILT, eventData);
+}
 
-    for (int z = from.y_; z <= to.y_; ++z)
+void DynamicNavigationMesh::UpdateAsyncBuilds()
+{
+    NavigationMesh::UpdateAsyncBuilds();
+
+    // Builds are swapped in the order of submission, each one as a whole
+    while (!tileCacheAsyncBuilds_.empty())
     {
-        for (int x = from.x_; x <= to.x_; ++x)
+        SharedPtr<TileCacheAsyncBuild> asyncBuild = tileCacheAsyncBuilds_.front();
+        for (TileCacheBuildTask* task : asyncBuild->tasks_)
         {
-            dtCompressedTileRef existing[TILECACHE_MAXLAYERS];
-            const int existingCt = tileCache_->getTilesAt(x, z, existing, maxLayers_);
-            for (int i = 0; i < existingCt; ++i)
-            {
-                unsigned char* data = nullptr;
-                if (!dtStatusFailed(tileCache_->removeTile(existing[i], &data, nullptr)) && data != nullptr)
-                    dtFree(data);
-            }
+            if (!task->completed_)
+                return;
+        }
 
-            TileCacheData tiles[TILECACHE_MAXLAYERS];
-            int layerCt = BuildTile(geometryList, x, z, tiles);
-            for (int i = 0; i < layerCt; ++i)
-            {
-                dtCompressedTileRef tileRef;
-                int status = tileCache_->addTile(tiles[i].data, tiles[i].dataSize, DT_COMPRESSEDTILE_FREE_DATA, &tileRef);
-                if (dtStatusFailed((dtStatus)status))
-                {
-                    dtFree(tiles[i].data);
-                    tiles[i].data = nullptr;
-                }
-                else
-                {
-                    tileCache_->buildNavMeshTile(tileRef, navMesh_);
-                    ++numTiles;
-                }
-            }
+        URHO3D_PROFILE("CommitNavigationMeshTiles");
+
+        tileCacheAsyncBuilds_.erase(tileCacheAsyncBuilds_.begin());
+
+        unsigned numTiles = 0;
+        for (TileCacheBuildTask* task : asyncBuild->tasks_)
+        {
+            if (!task->superseded_)
+                numTiles += CommitTileCacheBuild(task);
         }
-    }
 
-    return numTiles;
+        URHO3D_LOGDEBUG("Rebuilt " + ea::to_string(numTiles) + " tiles of the navigation mesh asynchronously");
+        SendAsyncBuildFinishedEvent(asyncBuild->from_, asyncBuild->to_, numTiles);
+    }
 }
 
 ea::vector<OffMeshConnection*> DynamicNavigationMesh::CollectOffMeshConnections(const BoundingBox& bounds)
@@ -1059,6 +1286,7 @@ ea::vector<OffMeshConnection*> DynamicNavigationMesh::CollectOffMeshConnections(
 void DynamicNavigationMesh::ReleaseNavigationMesh()
 {
     NavigationMesh::ReleaseNavigationMesh();
+    obstacleDirtyTiles_.clear();
     ReleaseTileCache();
 }
 
@@ -1098,6 +1326,7 @@ void DynamicNavigationMesh::AddObstacle(Obstacle* obstacle, bool silent)
         }
         obstacle->obstacleId_ = refHolder;
         assert(refHolder > 0);
+        MarkObstacleTilesDirty(obstacle);
 
         if (!silent)
         {
@@ -1137,6 +1366,8 @@ void DynamicNavigationMesh::RemoveObstacle(Obstacle* obstacle, bool silent)
             return;
         }
         obstacle->obstacleId_ = 0;
+        if (obstacle->GetNode())
+            MarkObstacleTilesDirty(obstacle);
         // Require a node in order to send an event
         if (!silent && obstacle->GetNode())
         {
@@ -1157,7 +1388,31 @@ void DynamicNavigationMesh::HandleSceneSubsystemUpdate(StringHash eventType, Var
     using namespace SceneSubsystemUpdate;
 
     if (tileCache_ && navMesh_ && IsEnabledEffective())
-        tileCache_->update(eventData[P_TIMESTEP].GetFloat(), navMesh_);
+    {
+        bool upToDate = false;
+        tileCache_->update(eventData[P_TIMESTEP].GetFloat(), navMesh_, &upToDate);
+
+        // Obstacle changes are applied to the tiles over several updates
+        if (upToDate && !obstacleDirtyTiles_.empty())
+        {
+            for (const auto& range : obstacleDirtyTiles_)
+                MarkTileGraphDirty(range.first, range.second);
+            obstacleDirtyTiles_.clear();
+        }
+    }
+}
+
+void DynamicNavigationMesh::MarkObstacleTilesDirty(Obstacle* obstacle)
+{
+    if (!GetHierarchicalPathfinding())
+        return;
+
+    const Vector3 position = obstacle->GetNode()->GetWorldPosition();
+    const Vector3 halfSize(obstacle->GetRadius(), obstacle->GetHeight(), obstacle->GetRadius());
+    IntVector2 from;
+    IntVector2 to;
+    GetTileRange(BoundingBox(position - halfSize, position + halfSize), from, to);
+    obstacleDirtyTiles_.emplace_back(from, to);
 }
 
 }
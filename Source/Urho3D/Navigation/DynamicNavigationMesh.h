@@ -64,6 +64,14 @@ public:
     bool Build(const BoundingBox& boundingBox) override;
     /// Rebuild part of the navigation mesh in the rectangular area. Return true if successful.
     bool Build(const IntVector2& from, const IntVector2& to) override;
+    /// Rebuild part of the navigation mesh contained by the world-space bounding box. Compressed tile cache layers are built on worker threads and swapped in at the beginning of a frame. Return true if the build was queued.
+    bool BuildAsync(const BoundingBox& boundingBox) override;
+    /// Rebuild part of the navigation mesh in the rectangular area. Compressed tile cache layers are built on worker threads and swapped in at the beginning of a frame. Return true if the build was queued.
+    bool BuildAsync(const IntVector2& from, const IntVector2& to) override;
+    /// Cancel all pending asynchronous builds. Tiles that are already swapped in are kept.
+    void CancelAsyncBuilds() override;
+    /// Return whether any asynchronous build is pending.
+    bool IsBuildingAsync() const override;
     /// Return tile data.
     ea::vector<unsigned char> GetTileData(const IntVector2& tile) const override;
     /// Return whether the Obstacle is touching the given tile.
@@ -108,6 +116,8 @@ public:
 
 protected:
     struct TileCacheData;
+    struct TileCacheBuildTask;
+    struct TileCacheAsyncBuild;
 
     /// Subscribe to events when assigned to a scene.
     void OnSceneSet(Scene* scene) override;
@@ -125,6 +135,16 @@ protected:
     int BuildTile(ea::vector<NavigationGeometryInfo>& geometryList, int x, int z, TileCacheData* tiles);
     /// Build tiles in the rectangular area. Return number of built tiles.
     unsigned BuildTiles(ea::vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to);
+    /// Snapshot tile geometry and build settings so that the tile cache layers can be built outside of the main thread.
+    SharedPtr<TileCacheBuildTask> PrepareTileCacheBuild(ea::vector<NavigationGeometryInfo>& geometryList, int x, int z);
+    /// Build compressed tile cache layers from the snapshot. Does not access the scene, so it is safe to call from worker threads.
+    static void BuildTileCacheLayers(TileCacheBuildTask& task);
+    /// Replace the tile cache layers of the tile with the result of the build task. Return number of added layers.
+    unsigned CommitTileCacheBuild(TileCacheBuildTask* task);
+    /// Send the event about the rebuilt tile.
+    void SendAreaRebuiltEvent(const BoundingBox& tileBoundingBox);
+    /// Swap in the tile cache layers of the finished asynchronous builds.
+    void UpdateAsyncBuilds() override;
     /// Off-mesh connections to be rebuilt in the mesh processor.
     ea::vector<OffMeshConnection*> CollectOffMeshConnections(const BoundingBox& bounds);
     /// Release the navigation mesh, query, and tile cache.
@@ -137,6 +157,8 @@ private:
     bool ReadTiles(Deserializer& source, bool silent);
     /// Free the tile cache.
     void ReleaseTileCache();
+    /// Remember tiles affected by the obstacle to update the tile graph once the tile cache is up to date.
+    void MarkObstacleTilesDirty(Obstacle* obstacle);
 
     /// Detour tile cache instance that works with the nav mesh.
     dtTileCache* tileCache_{};
@@ -154,6 +176,10 @@ private:
     bool drawObstacles_{};
     /// Queue of tiles to be built.
     ea::vector<IntVector2> tileQueue_;
+    /// Tile ranges affected by obstacle changes not yet processed by the tile cache.
+    ea::vector<ea::pair<IntVector2, IntVector2> > obstacleDirtyTiles_;
+    /// Pending asynchronous builds of the tile cache layers.
+    ea::vector<SharedPtr<TileCacheAsyncBuild> > tileCacheAsyncBuilds_;
 };
 
 }
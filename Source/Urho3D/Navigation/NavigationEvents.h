@@ -43,6 +43,16 @@ URHO3D_EVENT(E_NAVIGATION_AREA_REBUILT, NavigationAreaRebuilt)
     URHO3D_PARAM(P_BOUNDSMAX, BoundsMax); // Vector3
 }
 
+/// Asynchronous rebuild of navigation mesh tiles has finished and the new tiles are swapped in.
+URHO3D_EVENT(E_NAVIGATION_ASYNC_BUILD_FINISHED, NavigationAsyncBuildFinished)
+{
+    URHO3D_PARAM(P_NODE, Node); // Node pointer
+    URHO3D_PARAM(P_MESH, Mesh); // NavigationMesh pointer
+    URHO3D_PARAM(P_FROM, From); // IntVector2
+    URHO3D_PARAM(P_TO, To); // IntVector2
+    URHO3D_PARAM(P_NUMTILES, NumTiles); // unsigned
+}
+
 /// Mesh tile is added to navigation mesh.
 URHO3D_EVENT(E_NAVIGATION_TILE_ADDED, NavigationTileAdded)
 {
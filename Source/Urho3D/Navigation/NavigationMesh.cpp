@@ -23,7 +23,9 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/Drawable.h"
 #include "../Graphics/Geometry.h"
@@ -31,6 +33,8 @@
 #include "../Graphics/StaticModel.h"
 #include "../Graphics/TerrainPatch.h"
 #include "../Graphics/VertexBuffer.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
 #include "../Navigation/CrowdAgent.h"
@@ -45,8 +49,11 @@
 #ifdef URHO3D_PHYSICS
 #include "../Physics/CollisionShape.h"
 #endif
+#include "../Resource/ResourceCache.h"
 #include "../Scene/Scene.h"
 
+#include <EASTL/heap.h>
+
 #include <cfloat>
 #include <Detour/DetourNavMesh.h>
 #include <Detour/DetourNavMeshBuilder.h>
@@ -82,6 +89,8 @@ static const float DEFAULT_DETAIL_SAMPLE_DISTANCE = 6.0f;
 static const float DEFAULT_DETAIL_SAMPLE_MAX_ERROR = 1.0f;
 
 static const int MAX_POLYS = 2048;
+static const int MAX_TILE_LAYERS = 255;
+static const int DEFAULT_HIERARCHICAL_PATH_MIN_TILES = 3;
 
 
 /// Temporary data for finding a path.
@@ -95,231 +104,891 @@ struct FindPathData
     Vector3 pathPoints_[MAX_POLYS];
     // Flags on the path.
     unsigned char pathFlags_[MAX_POLYS]{};
+    // Polygon corridor assembled from several searches.
+    ea::vector<dtPolyRef> corridor_;
 };
 
-NavigationMesh::NavigationMesh(Context* context) :
-    Component(context),
-    navMesh_(nullptr),
-    navMeshQuery_(nullptr),
-    queryFilter_(new dtQueryFilter()),
-    pathData_(new FindPathData()),
-    tileSize_(DEFAULT_TILE_SIZE),
-    cellSize_(DEFAULT_CELL_SIZE),
-    cellHeight_(DEFAULT_CELL_HEIGHT),
-    agentHeight_(DEFAULT_AGENT_HEIGHT),
-    agentRadius_(DEFAULT_AGENT_RADIUS),
-    agentMaxClimb_(DEFAULT_AGENT_MAX_CLIMB),
-    agentMaxSlope_(DEFAULT_AGENT_MAX_SLOPE),
-    regionMinSize_(DEFAULT_REGION_MIN_SIZE),
-    regionMergeSize_(DEFAULT_REGION_MERGE_SIZE),
-    edgeMaxLength_(DEFAULT_EDGE_MAX_LENGTH),
-    edgeMaxError_(DEFAULT_EDGE_MAX_ERROR),
-    detailSampleDistance_(DEFAULT_DETAIL_SAMPLE_DISTANCE),
-    detailSampleMaxError_(DEFAULT_DETAIL_SAMPLE_MAX_ERROR),
-    padding_(Vector3::ONE),
-    numTilesX_(0),
-    numTilesZ_(0),
-    partitionType_(NAVMESH_PARTITION_WATERSHED),
-    keepInterResults_(false),
-    drawOffMeshConnections_(false),
-    drawNavAreas_(false)
+/// Snapshot of the data required to build one navigation mesh tile outside of the main thread.
+struct NavigationTileBuildTask : public RefCounted
 {
-}
+    /// Destruct. Free the tile data if it was never added to the navigation mesh.
+    ~NavigationTileBuildTask() override { dtFree(navData_); }
+
+    /// Tile index.
+    IntVector2 tile_;
+    /// Tile bounding box in the navigation mesh space.
+    BoundingBox tileBoundingBox_;
+    /// Recast configuration.
+    rcConfig config_;
+    /// Navigation agent height.
+    float agentHeight_{};
+    /// Navigation agent radius.
+    float agentRadius_{};
+    /// Navigation agent max vertical climb.
+    float agentMaxClimb_{};
+    /// Type of the heightfield partitioning.
+    NavmeshPartitionType partitionType_{};
+    /// Geometry and intermediate build results.
+    SimpleNavBuildData build_;
+    /// Resulting Detour tile data. Null if the tile is empty.
+    unsigned char* navData_{};
+    /// Size of the resulting Detour tile data.
+    int navDataSize_{};
+    /// Whether the tile was built successfully.
+    bool success_{};
+    /// Whether the task is overridden by a later build of the same tile.
+    bool superseded_{};
+    /// Whether the task is finished. Written by the worker thread.
+    std::atomic<bool> completed_{};
+};
 
-NavigationMesh::~NavigationMesh()
+/// Asynchronous build of a range of navigation mesh tiles. Tiles are swapped in together when all of them are built.
+struct NavigationAsyncBuild : public RefCounted
 {
-    ReleaseNavigationMesh();
-}
+    /// First tile of the range.
+    IntVector2 from_;
+    /// Last tile of the range.
+    IntVector2 to_;
+    /// Tile build tasks.
+    ea::vector<SharedPtr<NavigationTileBuildTask> > tasks_;
+};
 
-void NavigationMesh::RegisterObject(Context* context)
+/// Navigation mesh tile data read from a separate resource on a worker thread.
+struct NavigationStreamedTile : public RefCounted
 {
-    context->RegisterFactory<NavigationMesh>(NAVIGATION_CATEGORY);
+    /// Tile index.
+    IntVector2 tile_;
+    /// Name of the tile resource.
+    ea::string resourceName_;
+    /// Tile data. Empty if the resource does not exist.
+    ea::vector<unsigned char> data_;
+    /// Whether the load is cancelled.
+    std::atomic<bool> cancelled_{};
+    /// Whether the load is finished.
+    std::atomic<bool> completed_{};
+};
 
-    URHO3D_ACCESSOR_ATTRIBUTE("Tile Size", GetTileSize, SetTileSize, int, DEFAULT_TILE_SIZE, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Cell Size", GetCellSize, SetCellSize, float, DEFAULT_CELL_SIZE, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Cell Height", GetCellHeight, SetCellHeight, float, DEFAULT_CELL_HEIGHT, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Agent Height", GetAgentHeight, SetAgentHeight, float, DEFAULT_AGENT_HEIGHT, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Agent Radius", GetAgentRadius, SetAgentRadius, float, DEFAULT_AGENT_RADIUS, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Agent Max Climb", GetAgentMaxClimb, SetAgentMaxClimb, float, DEFAULT_AGENT_MAX_CLIMB, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Agent Max Slope", GetAgentMaxSlope, SetAgentMaxSlope, float, DEFAULT_AGENT_MAX_SLOPE, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Region Min Size", GetRegionMinSize, SetRegionMinSize, float, DEFAULT_REGION_MIN_SIZE, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Region Merge Size", GetRegionMergeSize, SetRegionMergeSize, float, DEFAULT_REGION_MERGE_SIZE, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Edge Max Length", GetEdgeMaxLength, SetEdgeMaxLength, float, DEFAULT_EDGE_MAX_LENGTH, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Edge Max Error", GetEdgeMaxError, SetEdgeMaxError, float, DEFAULT_EDGE_MAX_ERROR, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Detail Sample Distance", GetDetailSampleDistance, SetDetailSampleDistance, float,
-        DEFAULT_DETAIL_SAMPLE_DISTANCE, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Detail Sample Max Error", GetDetailSampleMaxError, SetDetailSampleMaxError, float,
-        DEFAULT_DETAIL_SAMPLE_MAX_ERROR, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Bounding Box Padding", GetPadding, SetPadding, Vector3, Vector3::ONE, AM_DEFAULT);
-    URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Navigation Data", GetNavigationDataAttr, SetNavigationDataAttr, ea::vector<unsigned char>,
-        Variant::emptyBuffer, AM_FILE | AM_NOEDIT);
-    URHO3D_ENUM_ACCESSOR_ATTRIBUTE("Partition Type", GetPartitionType, SetPartitionType, NavmeshPartitionType, navmeshPartitionTypeNames,
-        NAVMESH_PARTITION_WATERSHED, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Draw OffMeshConnections", GetDrawOffMeshConnections, SetDrawOffMeshConnections, bool, false, AM_DEFAULT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Draw NavAreas", GetDrawNavAreas, SetDrawNavAreas, bool, false, AM_DEFAULT);
-}
+static const unsigned DEFAULT_MAX_PATH_QUERY_ITERATIONS = 4096;
+static const unsigned DEFAULT_PATH_CACHE_SIZE = 256;
 
-void NavigationMesh::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
+/// Asynchronous path query.
+struct NavigationPathQuery : public RefCounted
 {
-    if (!debug || !navMesh_ || !node_)
-        return;
+    /// Query ID.
+    unsigned id_{};
+    /// Start point in the navigation mesh space.
+    Vector3 localStart_;
+    /// End point in the navigation mesh space.
+    Vector3 localEnd_;
+    /// Search extents.
+    Vector3 extents_;
+    /// Query filter.
+    const dtQueryFilter* filter_{};
+    /// Callback.
+    NavigationPathCallback callback_;
+    /// Start polygon.
+    dtPolyRef startRef_{};
+    /// End polygon.
+    dtPolyRef endRef_{};
+    /// Whether the search was restarted after the navigation mesh was changed.
+    bool restarted_{};
+    /// Whether the query is cancelled.
+    bool cancelled_{};
+    /// Resulting path points in the navigation mesh space.
+    ea::vector<Vector3> pathPoints_;
+    /// Resulting path flags.
+    ea::vector<unsigned char> pathFlags_;
+};
 
-    const Matrix3x4& worldTransform = node_->GetWorldTransform();
+/// Key of the path corridor cache.
+struct NavigationPathCacheKey
+{
+    /// Start polygon.
+    dtPolyRef startRef_;
+    /// End polygon.
+    dtPolyRef endRef_;
+    /// Query filter.
+    const dtQueryFilter* filter_;
+
+    /// Test for equality with another key.
+    bool operator ==(const NavigationPathCacheKey& rhs) const
+    {
+        return startRef_ == rhs.startRef_ && endRef_ == rhs.endRef_ && filter_ == rhs.filter_;
+    }
 
-    const dtNavMesh* navMesh = navMesh_;
+    /// Return hash value.
+    unsigned ToHash() const
+    {
+        unsigned hash = MakeHash(startRef_);
+        CombineHash(hash, MakeHash(endRef_));
+        CombineHash(hash, MakeHash(filter_));
+        return hash;
+    }
+};
 
-    for (int j = 0; j < navMesh->getMaxTiles(); ++j)
+/// Path query processing state owned by one worker at a time.
+struct NavigationPathQueryLane
+{
+    /// Destruct.
+    ~NavigationPathQueryLane() { dtFreeNavMeshQuery(query_); }
+
+    /// Detour query used only by this lane.
+    dtNavMeshQuery* query_{};
+    /// Navigation mesh the query is initialized with.
+    const dtNavMesh* navMesh_{};
+    /// Temporary data for finding a path.
+    FindPathData data_;
+    /// Query with sliced search in progress.
+    SharedPtr<NavigationPathQuery> active_;
+    /// Queries finished during the last update.
+    ea::vector<SharedPtr<NavigationPathQuery> > finished_;
+};
+
+/// Queue of asynchronous path queries.
+struct NavigationPathQueue
+{
+    /// Queries waiting for processing.
+    ea::vector<SharedPtr<NavigationPathQuery> > queued_;
+    /// Index of the next query in the queue to be taken by a lane.
+    std::atomic<unsigned> nextQueued_{};
+    /// Processing lanes, one per work item.
+    ea::vector<ea::unique_ptr<NavigationPathQueryLane> > lanes_;
+    /// Polygon corridors of the recently found paths.
+    ea::unordered_map<NavigationPathCacheKey, ea::vector<dtPolyRef> > cache_;
+    /// Path corridor cache mutex.
+    Mutex cacheMutex_;
+    /// Maximum number of cached path corridors.
+    unsigned cacheSize_{DEFAULT_PATH_CACHE_SIZE};
+    /// Maximum number of search iterations per lane per frame.
+    unsigned maxIterations_{DEFAULT_MAX_PATH_QUERY_ITERATIONS};
+    /// Next query ID.
+    unsigned nextId_{1};
+};
+
+/// Portal between two adjacent tiles of the hierarchical tile graph.
+struct NavigationTilePortal
+{
+    /// Position in the navigation mesh space.
+    Vector3 position_;
+    /// Polygon containing the position. Zero if the portal is unused.
+    dtPolyRef polyRef_{};
+    /// Connected tiles.
+    IntVector2 tiles_[2];
+};
+
+/// Tile of the hierarchical tile graph.
+struct NavigationTileCluster
+{
+    /// Portals leading out of the tile.
+    ea::vector<unsigned> portals_;
+    /// Traversal costs between each pair of the portals inside the tile. Negative if the portals are not connected.
+    ea::vector<float> costs_;
+};
+
+/// Hierarchical graph of navigation mesh tiles used to plan long paths.
+struct NavigationTileGraph
+{
+    /// Reset the graph so it is rebuilt from scratch on next use.
+    void Reset()
     {
-        const dtMeshTile* tile = navMesh->getTile(j);
-        assert(tile);
-        if (!tile->header)
-            continue;
+        portals_.clear();
+        freePortals_.clear();
+        clusters_.clear();
+        dirtyTiles_.clear();
+        built_ = false;
+    }
 
-        for (int i = 0; i < tile->header->polyCount; ++i)
+    /// Portals.
+    ea::vector<NavigationTilePortal> portals_;
+    /// Indices of unused portals.
+    ea::vector<unsigned> freePortals_;
+    /// Tiles that have portals.
+    ea::unordered_map<IntVector2, NavigationTileCluster> clusters_;
+    /// Tiles that need to be updated.
+    ea::hash_set<IntVector2> dirtyTiles_;
+    /// Whether the graph is built.
+    bool built_{};
+    /// Search state: cost from the start.
+    ea::vector<float> searchCosts_;
+    /// Search state: previous node on the best route.
+    ea::vector<unsigned> searchPrevious_;
+    /// Search state: whether the node is closed.
+    ea::vector<bool> searchClosed_;
+};
+
+/// Segment of the border between two tiles.
+struct NavigationPortalSegment
+{
+    /// Segment start.
+    Vector3 start_;
+    /// Segment end.
+    Vector3 end_;
+    /// Polygon the segment belongs to.
+    dtPolyRef polyRef_{};
+    /// Index of the segment group.
+    unsigned group_{};
+};
+
+/// Find portals between the tile and its neighbour. Connected border segments are merged into one portal.
+static void CollectTilePortals(const dtNavMesh* navMesh, const IntVector2& tile, const IntVector2& neighbour, float mergeDistance,
+    ea::vector<NavigationTilePortal>& portals)
+{
+    ea::vector<NavigationPortalSegment> segments;
+
+    const dtMeshTile* meshTiles[MAX_TILE_LAYERS];
+    const int numMeshTiles = navMesh->getTilesAt(tile.x_, tile.y_, meshTiles, MAX_TILE_LAYERS);
+    for (int i = 0; i < numMeshTiles; ++i)
+    {
+        const dtMeshTile* meshTile = meshTiles[i];
+        const dtPolyRef polyRefBase = navMesh->getPolyRefBase(meshTile);
+        for (int j = 0; j < meshTile->header->polyCount; ++j)
         {
-            dtPoly* poly = tile->polys + i;
-            for (unsigned j = 0; j < poly->vertCount; ++j)
+            const dtPoly& poly = meshTile->polys[j];
+            if (poly.getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+                continue;
+
+            for (unsigned k = poly.firstLink; k != DT_NULL_LINK; k = meshTile->links[k].next)
             {
-                debug->AddLine(
-                    worldTransform * *reinterpret_cast<const Vector3*>(&tile->verts[poly->verts[j] * 3]),
-                    worldTransform * *reinterpret_cast<const Vector3*>(&tile->verts[poly->verts[(j + 1) % poly->vertCount] * 3]),
-                    Color::YELLOW,
-                    depthTest
-                );
+                const dtLink& link = meshTile->links[k];
+                // Internal links have no side
+                if (link.side == 0xff)
+                    continue;
+
+                const dtMeshTile* linkedTile = nullptr;
+                const dtPoly* linkedPoly = nullptr;
+                navMesh->getTileAndPolyByRefUnsafe(link.ref, &linkedTile, &linkedPoly);
+                if (linkedPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+                    continue;
+                if (linkedTile->header->x != neighbour.x_ || linkedTile->header->y != neighbour.y_)
+                    continue;
+
+                // Link may cover only a part of the edge
+                const Vector3 v0(&meshTile->verts[poly.verts[link.edge] * 3]);
+                const Vector3 v1(&meshTile->verts[poly.verts[(link.edge + 1) % poly.vertCount] * 3]);
+                NavigationPortalSegment segment;
+                segment.start_ = v0.Lerp(v1, link.bmin / 255.0f);
+                segment.end_ = v0.Lerp(v1, link.bmax / 255.0f);
+                segment.polyRef_ = polyRefBase | (dtPolyRef)j;
+                segment.group_ = segments.size();
+                segments.push_back(segment);
             }
         }
     }
 
-    Scene* scene = GetScene();
-    if (scene)
+    // Merge touching segments
+    for (unsigned i = 0; i < segments.size(); ++i)
     {
-        // Draw OffMeshConnection components
-        if (drawOffMeshConnections_)
+        for (unsigned j = i + 1; j < segments.size(); ++j)
         {
-            ea::vector<Node*> connections;
-            scene->GetChildrenWithComponent<OffMeshConnection>(connections, true);
-            for (unsigned i = 0; i < connections.size(); ++i)
+            const NavigationPortalSegment& a = segments[i];
+            const NavigationPortalSegment& b = segments[j];
+            if (a.group_ == b.group_)
+                continue;
+
+            const float distance = Min(Min((a.start_ - b.start_).Length(), (a.start_ - b.end_).Length()),
+                Min((a.end_ - b.start_).Length(), (a.end_ - b.end_).Length()));
+            if (distance > mergeDistance)
+                continue;
+
+            const unsigned oldGroup = b.group_;
+            const unsigned newGroup = a.group_;
+            for (NavigationPortalSegment& segment : segments)
             {
-                auto* connection = connections[i]->GetComponent<OffMeshConnection>();
-                if (connection && connection->IsEnabledEffective())
-                    connection->DrawDebugGeometry(debug, depthTest);
+                if (segment.group_ == oldGroup)
+                    segment.group_ = newGroup;
             }
         }
+    }
 
-        // Draw NavArea components
-        if (drawNavAreas_)
+    // Make one portal per group at the segment closest to the group center
+    for (unsigned i = 0; i < segments.size(); ++i)
+    {
+        const unsigned group = segments[i].group_;
+        bool processed = false;
+        Vector3 center;
+        unsigned count = 0;
+        for (unsigned j = 0; j < segments.size(); ++j)
         {
-            for (unsigned i = 0; i < areas_.size(); ++i)
+            if (segments[j].group_ != group)
+                continue;
+            if (j < i)
             {
-                NavArea* area = areas_[i];
-                if (area && area->IsEnabledEffective())
-                    area->DrawDebugGeometry(debug, depthTest);
+                processed = true;
+                break;
+            }
+            center += (segments[j].start_ + segments[j].end_) * 0.5f;
+            ++count;
+        }
+        if (processed)
+            continue;
+        center /= (float)count;
+
+        NavigationTilePortal portal;
+        float bestDistance = M_INFINITY;
+        for (unsigned j = i; j < segments.size(); ++j)
+        {
+            if (segments[j].group_ != group)
+                continue;
+            const Vector3 midpoint = (segments[j].start_ + segments[j].end_) * 0.5f;
+            const float distance = (midpoint - center).LengthSquared();
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                portal.position_ = midpoint;
+                portal.polyRef_ = segments[j].polyRef_;
             }
         }
+        portal.tiles_[0] = tile;
+        portal.tiles_[1] = neighbour;
+        portals.push_back(portal);
     }
 }
 
-void NavigationMesh::SetMeshName(const ea::string& newName)
+/// Straighten the path corridor and finish the query. Called from worker threads.
+static void FinishPathQuery(NavigationPathQueryLane& lane, NavigationPathQuery& query, int numPolys)
 {
-    meshName_ = newName;
-}
+    FindPathData& data = lane.data_;
+    if (numPolys > 0)
+    {
+        Vector3 actualLocalEnd = query.localEnd_;
 
-void NavigationMesh::SetTileSize(int size)
-{
-    tileSize_ = Max(size, 16);
+        // If full path was not found, clamp end point to the end polygon
+        if (data.polys_[numPolys - 1] != query.endRef_)
+            lane.query_->closestPointOnPoly(data.polys_[numPolys - 1], &query.localEnd_.x_, &actualLocalEnd.x_, nullptr);
 
-    MarkNetworkUpdate();
-}
+        int numPathPoints = 0;
+        lane.query_->findStraightPath(&query.localStart_.x_, &actualLocalEnd.x_, data.polys_, numPolys,
+            &data.pathPoints_[0].x_, data.pathFlags_, data.pathPolys_, &numPathPoints, MAX_POLYS);
 
-void NavigationMesh::SetCellSize(float size)
-{
-    cellSize_ = Max(size, M_EPSILON);
+        query.pathPoints_.assign(data.pathPoints_, data.pathPoints_ + numPathPoints);
+        query.pathFlags_.assign(data.pathFlags_, data.pathFlags_ + numPathPoints);
+    }
 
-    MarkNetworkUpdate();
+    lane.finished_.push_back(SharedPtr<NavigationPathQuery>(&query));
 }
 
-void NavigationMesh::SetCellHeight(float height)
+/// Start the search of the path query. Return true if the sliced search is in progress. Called from worker threads.
+static bool StartPathQuery(NavigationPathQueue& pathQueue, NavigationPathQueryLane& lane, NavigationPathQuery& query)
 {
-    cellHeight_ = Max(height, M_EPSILON);
-
-    MarkNetworkUpdate();
-}
+    dtNavMeshQuery* navMeshQuery = lane.query_;
+    navMeshQuery->findNearestPoly(&query.localStart_.x_, &query.extents_.x_, query.filter_, &query.startRef_, nullptr);
+    navMeshQuery->findNearestPoly(&query.localEnd_.x_, &query.extents_.x_, query.filter_, &query.endRef_, nullptr);
 
-void NavigationMesh::SetAgentHeight(float height)
-{
-    agentHeight_ = Max(height, M_EPSILON);
+    if (!query.startRef_ || !query.endRef_)
+    {
+        FinishPathQuery(lane, query, 0);
+        return false;
+    }
 
-    MarkNetworkUpdate();
-}
+    // Reuse the corridor if it is still valid
+    if (pathQueue.cacheSize_)
+    {
+        MutexLock lock(pathQueue.cacheMutex_);
+        const auto iter = pathQueue.cache_.find(NavigationPathCacheKey{ query.startRef_, query.endRef_, query.filter_ });
+        if (iter != pathQueue.cache_.end())
+        {
+            const ea::vector<dtPolyRef>& corridor = iter->second;
+            const dtNavMesh* navMesh = navMeshQuery->getAttachedNavMesh();
+            const bool isValid = ea::all_of(corridor.begin(), corridor.end(),
+                [navMesh](dtPolyRef polyRef) { return navMesh->isValidPolyRef(polyRef); });
 
-void NavigationMesh::SetAgentRadius(float radius)
-{
-    agentRadius_ = Max(radius, M_EPSILON);
+            if (isValid)
+            {
+                ea::copy(corridor.begin(), corridor.end(), lane.data_.polys_);
+                FinishPathQuery(lane, query, (int)corridor.size());
+                return false;
+            }
+            pathQueue.cache_.erase(iter);
+        }
+    }
 
-    MarkNetworkUpdate();
+    const dtStatus status = navMeshQuery->initSlicedFindPath(query.startRef_, query.endRef_, &query.localStart_.x_,
+        &query.localEnd_.x_, query.filter_);
+    if (dtStatusFailed(status))
+    {
+        FinishPathQuery(lane, query, 0);
+        return false;
+    }
+    return true;
 }
 
-void NavigationMesh::SetAgentMaxClimb(float maxClimb)
+/// Process path queries until the iteration budget is spent or the queue is empty. Called from worker threads.
+static void ProcessPathQueryLane(NavigationPathQueue& pathQueue, NavigationPathQueryLane& lane)
 {
-    agentMaxClimb_ = Max(maxClimb, M_EPSILON);
+    URHO3D_PROFILE("ProcessPathQueries");
 
-    MarkNetworkUpdate();
-}
+    dtNavMeshQuery* navMeshQuery = lane.query_;
+    int iterationsLeft = (int)pathQueue.maxIterations_;
 
-void NavigationMesh::SetAgentMaxSlope(float maxSlope)
-{
-    agentMaxSlope_ = Max(maxSlope, 0.0f);
+    while (iterationsLeft > 0)
+    {
+        if (!lane.active_)
+        {
+            const unsigned index = pathQueue.nextQueued_.fetch_add(1);
+            if (index >= pathQueue.queued_.size())
+                break;
 
-    MarkNetworkUpdate();
-}
+            NavigationPathQuery* query = pathQueue.queued_[index];
+            if (!StartPathQuery(pathQueue, lane, *query))
+                continue;
+            lane.active_ = query;
+        }
 
-void NavigationMesh::SetRegionMinSize(float size)
-{
-    regionMinSize_ = Max(size, M_EPSILON);
+        NavigationPathQuery& query = *lane.active_;
 
-    MarkNetworkUpdate();
-}
+        int numIterations = 0;
+        dtStatus status = navMeshQuery->updateSlicedFindPath(iterationsLeft, &numIterations);
+        iterationsLeft -= numIterations;
 
-void NavigationMesh::SetRegionMergeSize(float size)
-{
-    regionMergeSize_ = Max(size, M_EPSILON);
+        if (dtStatusInProgress(status))
+            continue;
 
-    MarkNetworkUpdate();
-}
+        if (dtStatusSucceed(status))
+        {
+            int numPolys = 0;
+            status = navMeshQuery->finalizeSlicedFindPath(lane.data_.polys_, &numPolys, MAX_POLYS);
+            if (dtStatusSucceed(status) && numPolys > 0)
+            {
+                // Cache only complete corridors
+                if (pathQueue.cacheSize_ && lane.data_.polys_[numPolys - 1] == query.endRef_)
+                {
+                    MutexLock lock(pathQueue.cacheMutex_);
+                    if (pathQueue.cache_.size() >= pathQueue.cacheSize_)
+                        pathQueue.cache_.clear();
+                    pathQueue.cache_[NavigationPathCacheKey{ query.startRef_, query.endRef_, query.filter_ }].assign(
+                        lane.data_.polys_, lane.data_.polys_ + numPolys);
+                }
 
-void NavigationMesh::SetEdgeMaxLength(float length)
-{
-    edgeMaxLength_ = Max(length, M_EPSILON);
+                FinishPathQuery(lane, query, numPolys);
+                lane.active_ = nullptr;
+                continue;
+            }
+        }
 
-    MarkNetworkUpdate();
+        // The search fails if the tiles were changed since the previous frame, try once again from scratch
+        SharedPtr<NavigationPathQuery> failedQuery = lane.active_;
+        lane.active_ = nullptr;
+        if (!failedQuery->restarted_)
+        {
+            failedQuery->restarted_ = true;
+            if (StartPathQuery(pathQueue, lane, *failedQuery))
+                lane.active_ = failedQuery;
+        }
+        else
+            FinishPathQuery(lane, *failedQuery, 0);
+    }
 }
 
-void NavigationMesh::SetEdgeMaxError(float error)
+/// Build Detour tile data from the snapshot. Does not access the scene, so it is safe to call from worker threads.
+static void BuildTileNavData(NavigationTileBuildTask& task)
 {
-    edgeMaxError_ = Max(error, M_EPSILON);
+    URHO3D_PROFILE("BuildNavigationMeshTileData");
 
-    MarkNetworkUpdate();
-}
-
-void NavigationMesh::SetDetailSampleDistance(float distance)
-{
-    detailSampleDistance_ = Max(distance, M_EPSILON);
+    SimpleNavBuildData& build = task.build_;
+    const rcConfig& cfg = task.config_;
 
-    MarkNetworkUpdate();
-}
+    if (build.vertices_.empty() || build.indices_.empty())
+    {
+        // Nothing to do
+        task.success_ = true;
+        return;
+    }
 
-void NavigationMesh::SetDetailSampleMaxError(float error)
-{
-    detailSampleMaxError_ = Max(error, M_EPSILON);
+    build.heightField_ = rcAllocHeightfield();
+    if (!build.heightField_)
+    {
+        URHO3D_LOGERROR("Could not allocate heightfield");
+        return;
+    }
 
-    MarkNetworkUpdate();
-}
+    if (!rcCreateHeightfield(build.ctx_, *build.heightField_, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs,
+        cfg.ch))
+    {
+        URHO3D_LOGERROR("Could not create heightfield");
+        return;
+    }
 
-void NavigationMesh::SetPadding(const Vector3& padding)
-{
-    padding_ = padding;
+    unsigned numTriangles = build.indices_.size() / 3;
+    ea::shared_array<unsigned char> triAreas(new unsigned char[numTriangles]);
+    memset(triAreas.get(), 0, numTriangles);
 
-    MarkNetworkUpdate();
+    rcMarkWalkableTriangles(build.ctx_, cfg.walkableSlopeAngle, &build.vertices_[0].x_, build.vertices_.size(),
+        &build.indices_[0], numTriangles, triAreas.get());
+    rcRasterizeTriangles(build.ctx_, &build.vertices_[0].x_, build.vertices_.size(), &build.indices_[0],
+        triAreas.get(), numTriangles, *build.heightField_, cfg.walkableClimb);
+    rcFilterLowHangingWalkableObstacles(build.ctx_, cfg.walkableClimb, *build.heightField_);
+
+    rcFilterWalkableLowHeightSpans(build.ctx_, cfg.walkableHeight, *build.heightField_);
+    rcFilterLedgeSpans(build.ctx_, cfg.walkableHeight, cfg.walkableClimb, *build.heightField_);
+
+    build.compactHeightField_ = rcAllocCompactHeightfield();
+    if (!build.compactHeightField_)
+    {
+        URHO3D_LOGERROR("Could not allocate create compact heightfield");
+        return;
+    }
+    if (!rcBuildCompactHeightfield(build.ctx_, cfg.walkableHeight, cfg.walkableClimb, *build.heightField_,
+        *build.compactHeightField_))
+    {
+        URHO3D_LOGERROR("Could not build compact heightfield");
+        return;
+    }
+    if (!rcErodeWalkableArea(build.ctx_, cfg.walkableRadius, *build.compactHeightField_))
+    {
+        URHO3D_LOGERROR("Could not erode compact heightfield");
+        return;
+    }
+
+    // Mark area volumes
+    for (unsigned i = 0; i < build.navAreas_.size(); ++i)
+        rcMarkBoxArea(build.ctx_, &build.navAreas_[i].bounds_.min_.x_, &build.navAreas_[i].bounds_.max_.x_,
+            build.navAreas_[i].areaID_, *build.compactHeightField_);
+
+    if (task.partitionType_ == NAVMESH_PARTITION_WATERSHED)
+    {
+        if (!rcBuildDistanceField(build.ctx_, *build.compactHeightField_))
+        {
+            URHO3D_LOGERROR("Could not build distance field");
+            return;
+        }
+        if (!rcBuildRegions(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea,
+            cfg.mergeRegionArea))
+        {
+            URHO3D_LOGERROR("Could not build regions");
+            return;
+        }
+    }
+    else
+    {
+        if (!rcBuildRegionsMonotone(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+        {
+            URHO3D_LOGERROR("Could not build monotone regions");
+            return;
+        }
+    }
+
+    build.contourSet_ = rcAllocContourSet();
+    if (!build.contourSet_)
+    {
+        URHO3D_LOGERROR("Could not allocate contour set");
+        return;
+    }
+    if (!rcBuildContours(build.ctx_, *build.compactHeightField_, cfg.maxSimplificationError, cfg.maxEdgeLen,
+        *build.contourSet_))
+    {
+        URHO3D_LOGERROR("Could not create contours");
+        return;
+    }
+
+    build.polyMesh_ = rcAllocPolyMesh();
+    if (!build.polyMesh_)
+    {
+        URHO3D_LOGERROR("Could not allocate poly mesh");
+        return;
+    }
+    if (!rcBuildPolyMesh(build.ctx_, *build.contourSet_, cfg.maxVertsPerPoly, *build.polyMesh_))
+    {
+        URHO3D_LOGERROR("Could not triangulate contours");
+        return;
+    }
+
+    build.polyMeshDetail_ = rcAllocPolyMeshDetail();
+    if (!build.polyMeshDetail_)
+    {
+        URHO3D_LOGERROR("Could not allocate detail mesh");
+        return;
+    }
+    if (!rcBuildPolyMeshDetail(build.ctx_, *build.polyMesh_, *build.compactHeightField_, cfg.detailSampleDist,
+        cfg.detailSampleMaxError, *build.polyMeshDetail_))
+    {
+        URHO3D_LOGERROR("Could not build detail mesh");
+        return;
+    }
+
+    // Set polygon flags
+    /// \todo Assignment of flags from navigation areas?
+    for (int i = 0; i < build.polyMesh_->npolys; ++i)
+    {
+        if (build.polyMesh_->areas[i] != RC_NULL_AREA)
+            build.polyMesh_->flags[i] = 0x1;
+    }
+
+    dtNavMeshCreateParams params;       // NOLINT(hicpp-member-init)
+    memset(&params, 0, sizeof params);
+    params.verts = build.polyMesh_->verts;
+    params.vertCount = build.polyMesh_->nverts;
+    params.polys = build.polyMesh_->polys;
+    params.polyAreas = build.polyMesh_->areas;
+    params.polyFlags = build.polyMesh_->flags;
+    params.polyCount = build.polyMesh_->npolys;
+    params.nvp = build.polyMesh_->nvp;
+    params.detailMeshes = build.polyMeshDetail_->meshes;
+    params.detailVerts = build.polyMeshDetail_->verts;
+    params.detailVertsCount = build.polyMeshDetail_->nverts;
+    params.detailTris = build.polyMeshDetail_->tris;
+    params.detailTriCount = build.polyMeshDetail_->ntris;
+    params.walkableHeight = task.agentHeight_;
+    params.walkableRadius = task.agentRadius_;
+    params.walkableClimb = task.agentMaxClimb_;
+    params.tileX = task.tile_.x_;
+    params.tileY = task.tile_.y_;
+    rcVcopy(params.bmin, build.polyMesh_->bmin);
+    rcVcopy(params.bmax, build.polyMesh_->bmax);
+    params.cs = cfg.cs;
+    params.ch = cfg.ch;
+    params.buildBvTree = true;
+
+    // Add off-mesh connections if have them
+    if (build.offMeshRadii_.size())
+    {
+        params.offMeshConCount = build.offMeshRadii_.size();
+        params.offMeshConVerts = &build.offMeshVertices_[0].x_;
+        params.offMeshConRad = &build.offMeshRadii_[0];
+        params.offMeshConFlags = &build.offMeshFlags_[0];
+        params.offMeshConAreas = &build.offMeshAreas_[0];
+        params.offMeshConDir = &build.offMeshDir_[0];
+    }
+
+    if (!dtCreateNavMeshData(&params, &task.navData_, &task.navDataSize_))
+    {
+        URHO3D_LOGERROR("Could not build navigation mesh tile data");
+        return;
+    }
+
+    task.success_ = true;
+}
+
+NavigationMesh::NavigationMesh(Context* context) :
+    Component(context),
+    navMesh_(nullptr),
+    navMeshQuery_(nullptr),
+    queryFilter_(new dtQueryFilter()),
+    pathData_(new FindPathData()),
+    pathQueue_(new NavigationPathQueue()),
+    tileGraph_(new NavigationTileGraph()),
+    tileSize_(DEFAULT_TILE_SIZE),
+    cellSize_(DEFAULT_CELL_SIZE),
+    cellHeight_(DEFAULT_CELL_HEIGHT),
+    agentHeight_(DEFAULT_AGENT_HEIGHT),
+    agentRadius_(DEFAULT_AGENT_RADIUS),
+    agentMaxClimb_(DEFAULT_AGENT_MAX_CLIMB),
+    agentMaxSlope_(DEFAULT_AGENT_MAX_SLOPE),
+    regionMinSize_(DEFAULT_REGION_MIN_SIZE),
+    regionMergeSize_(DEFAULT_REGION_MERGE_SIZE),
+    edgeMaxLength_(DEFAULT_EDGE_MAX_LENGTH),
+    edgeMaxError_(DEFAULT_EDGE_MAX_ERROR),
+    detailSampleDistance_(DEFAULT_DETAIL_SAMPLE_DISTANCE),
+    detailSampleMaxError_(DEFAULT_DETAIL_SAMPLE_MAX_ERROR),
+    padding_(Vector3::ONE),
+    numTilesX_(0),
+    numTilesZ_(0),
+    partitionType_(NAVMESH_PARTITION_WATERSHED),
+    keepInterResults_(false),
+    drawOffMeshConnections_(false),
+    drawNavAreas_(false),
+    hierarchicalPathfinding_(false),
+    hierarchicalPathMinTiles_(DEFAULT_HIERARCHICAL_PATH_MIN_TILES)
+{
+}
+
+NavigationMesh::~NavigationMesh()
+{
+    ReleaseNavigationMesh();
+}
+
+void NavigationMesh::RegisterObject(Context* context)
+{
+    context->RegisterFactory<NavigationMesh>(NAVIGATION_CATEGORY);
+
+    URHO3D_ACCESSOR_ATTRIBUTE("Tile Size", GetTileSize, SetTileSize, int, DEFAULT_TILE_SIZE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Cell Size", GetCellSize, SetCellSize, float, DEFAULT_CELL_SIZE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Cell Height", GetCellHeight, SetCellHeight, float, DEFAULT_CELL_HEIGHT, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Agent Height", GetAgentHeight, SetAgentHeight, float, DEFAULT_AGENT_HEIGHT, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Agent Radius", GetAgentRadius, SetAgentRadius, float, DEFAULT_AGENT_RADIUS, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Agent Max Climb", GetAgentMaxClimb, SetAgentMaxClimb, float, DEFAULT_AGENT_MAX_CLIMB, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Agent Max Slope", GetAgentMaxSlope, SetAgentMaxSlope, float, DEFAULT_AGENT_MAX_SLOPE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Region Min Size", GetRegionMinSize, SetRegionMinSize, float, DEFAULT_REGION_MIN_SIZE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Region Merge Size", GetRegionMergeSize, SetRegionMergeSize, float, DEFAULT_REGION_MERGE_SIZE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Edge Max Length", GetEdgeMaxLength, SetEdgeMaxLength, float, DEFAULT_EDGE_MAX_LENGTH, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Edge Max Error", GetEdgeMaxError, SetEdgeMaxError, float, DEFAULT_EDGE_MAX_ERROR, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Detail Sample Distance", GetDetailSampleDistance, SetDetailSampleDistance, float,
+        DEFAULT_DETAIL_SAMPLE_DISTANCE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Detail Sample Max Error", GetDetailSampleMaxError, SetDetailSampleMaxError, float,
+        DEFAULT_DETAIL_SAMPLE_MAX_ERROR, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Bounding Box Padding", GetPadding, SetPadding, Vector3, Vector3::ONE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Tile Streaming Path", GetTileStreamingPath, SetTileStreamingPath, ea::string, EMPTY_STRING, AM_DEFAULT);
+    URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Navigation Data", GetNavigationDataAttr, SetNavigationDataAttr, ea::vector<unsigned char>,
+        Variant::emptyBuffer, AM_FILE | AM_NOEDIT);
+    URHO3D_ENUM_ACCESSOR_ATTRIBUTE("Partition Type", GetPartitionType, SetPartitionType, NavmeshPartitionType, navmeshPartitionTypeNames,
+        NAVMESH_PARTITION_WATERSHED, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Draw OffMeshConnections", GetDrawOffMeshConnections, SetDrawOffMeshConnections, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Draw NavAreas", GetDrawNavAreas, SetDrawNavAreas, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Hierarchical Pathfinding", GetHierarchicalPathfinding, SetHierarchicalPathfinding, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Hierarchical Path Min Tiles", GetHierarchicalPathMinTiles, SetHierarchicalPathMinTiles, int,
+        DEFAULT_HIERARCHICAL_PATH_MIN_TILES, AM_DEFAULT);
+}
+
+void NavigationMesh::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
+{
+    if (!debug || !navMesh_ || !node_)
+        return;
+
+    const Matrix3x4& worldTransform = node_->GetWorldTransform();
+
+    const dtNavMesh* navMesh = navMesh_;
+
+    for (int j = 0; j < navMesh->getMaxTiles(); ++j)
+    {
+        const dtMeshTile* tile = navMesh->getTile(j);
+        assert(tile);
+        if (!tile->header)
+            continue;
+
+        for (int i = 0; i < tile->header->polyCount; ++i)
+        {
+            dtPoly* poly = tile->polys + i;
+            for (unsigned j = 0; j < poly->vertCount; ++j)
+            {
+                debug->AddLine(
+                    worldTransform * *reinterpret_cast<const Vector3*>(&tile->verts[poly->verts[j] * 3]),
+                    worldTransform * *reinterpret_cast<const Vector3*>(&tile->verts[poly->verts[(j + 1) % poly->vertCount] * 3]),
+                    Color::YELLOW,
+                    depthTest
+                );
+            }
+        }
+    }
+
+    Scene* scene = GetScene();
+    if (scene)
+    {
+        // Draw OffMeshConnection components
+        if (drawOffMeshConnections_)
+        {
+            ea::vector<Node*> connections;
+            scene->GetChildrenWithComponent<OffMeshConnection>(connections, true);
+            for (unsigned i = 0; i < connections.size(); ++i)
+            {
+                auto* connection = connections[i]->GetComponent<OffMeshConnection>();
+                if (connection && connection->IsEnabledEffective())
+                    connection->DrawDebugGeometry(debug, depthTest);
+            }
+        }
+
+        // Draw NavArea components
+        if (drawNavAreas_)
+        {
+            for (unsigned i = 0; i < areas_.size(); ++i)
+            {
+                NavArea* area = areas_[i];
+                if (area && area->IsEnabledEffective())
+                    area->DrawDebugGeometry(debug, depthTest);
+            }
+        }
+    }
+}
+
+void NavigationMesh::SetMeshName(const ea::string& newName)
+{
+    meshName_ = newName;
+}
+
+void NavigationMesh::SetTileSize(int size)
+{
+    tileSize_ = Max(size, 16);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetCellSize(float size)
+{
+    cellSize_ = Max(size, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetCellHeight(float height)
+{
+    cellHeight_ = Max(height, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetAgentHeight(float height)
+{
+    agentHeight_ = Max(height, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetAgentRadius(float radius)
+{
+    agentRadius_ = Max(radius, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetAgentMaxClimb(float maxClimb)
+{
+    agentMaxClimb_ = Max(maxClimb, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetAgentMaxSlope(float maxSlope)
+{
+    agentMaxSlope_ = Max(maxSlope, 0.0f);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetRegionMinSize(float size)
+{
+    regionMinSize_ = Max(size, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetRegionMergeSize(float size)
+{
+    regionMergeSize_ = Max(size, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetEdgeMaxLength(float length)
+{
+    edgeMaxLength_ = Max(length, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetEdgeMaxError(float error)
+{
+    edgeMaxError_ = Max(error, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetDetailSampleDistance(float distance)
+{
+    detailSampleDistance_ = Max(distance, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetDetailSampleMaxError(float error)
+{
+    detailSampleMaxError_ = Max(error, M_EPSILON);
+
+    MarkNetworkUpdate();
+}
+
+void NavigationMesh::SetPadding(const Vector3& padding)
+{
+    padding_ = padding;
+
+    MarkNetworkUpdate();
 }
 
 bool NavigationMesh::Allocate(const BoundingBox& boundingBox, unsigned maxTiles)
@@ -478,27 +1147,64 @@ bool NavigationMesh::Build(const BoundingBox& boundingBox)
     if (!node_->GetWorldScale().Equals(Vector3::ONE))
         URHO3D_LOGWARNING("Navigation mesh root node has scaling. Agent parameters may not work as intended");
 
-    BoundingBox localSpaceBox = boundingBox.Transformed(node_->GetWorldTransform().Inverse());
-
-    float tileEdgeLength = (float)tileSize_ * cellSize_;
-
     ea::vector<NavigationGeometryInfo> geometryList;
     CollectGeometries(geometryList);
 
-    int sx = Clamp((int)((localSpaceBox.min_.x_ - boundingBox_.min_.x_) / tileEdgeLength), 0, numTilesX_ - 1);
-    int sz = Clamp((int)((localSpaceBox.min_.z_ - boundingBox_.min_.z_) / tileEdgeLength), 0, numTilesZ_ - 1);
-    int ex = Clamp((int)((localSpaceBox.max_.x_ - boundingBox_.min_.x_) / tileEdgeLength), 0, numTilesX_ - 1);
-    int ez = Clamp((int)((localSpaceBox.max_.z_ - boundingBox_.min_.z_) / tileEdgeLength), 0, numTilesZ_ - 1);
-
-    unsigned numTiles = BuildTiles(geometryList, IntVector2(sx, sz), IntVector2(ex, ez));
+    IntVector2 from;
+    IntVector2 to;
+    GetTileRange(boundingBox, from, to);
+
+    unsigned numTiles = BuildTiles(geometryList, from, to);
+
+    URHO3D_LOGDEBUG("Rebuilt " + ea::to_string(numTiles) + " tiles of the navigation mesh");
+    return true;
+}
+
+bool NavigationMesh::Build(const IntVector2& from, const IntVector2& to)
+{
+    URHO3D_PROFILE("BuildPartialNavigationMesh");
+
+    if (!node_)
+        return false;
+
+    if (!navMesh_)
+    {
+        URHO3D_LOGERROR("Navigation mesh must first be built fully before it can be partially rebuilt");
+        return false;
+    }
+
+    if (!node_->GetWorldScale().Equals(Vector3::ONE))
+        URHO3D_LOGWARNING("Navigation mesh root node has scaling. Agent parameters may not work as intended");
+
+    ea::vector<NavigationGeometryInfo> geometryList;
+    CollectGeometries(geometryList);
+
+    unsigned numTiles = BuildTiles(geometryList, from, to);
 
     URHO3D_LOGDEBUG("Rebuilt " + ea::to_string(numTiles) + " tiles of the navigation mesh");
     return true;
 }
 
-bool NavigationMesh::Build(const IntVector2& from, const IntVector2& to)
+bool NavigationMesh::BuildAsync(const BoundingBox& boundingBox)
 {
-    URHO3D_PROFILE("BuildPartialNavigationMesh");
+    if (!node_)
+        return false;
+
+    if (!navMesh_)
+    {
+        URHO3D_LOGERROR("Navigation mesh must first be built fully before it can be partially rebuilt");
+        return false;
+    }
+
+    IntVector2 from;
+    IntVector2 to;
+    GetTileRange(boundingBox, from, to);
+    return BuildAsync(from, to);
+}
+
+bool NavigationMesh::BuildAsync(const IntVector2& from, const IntVector2& to)
+{
+    URHO3D_PROFILE("BuildPartialNavigationMeshAsync");
 
     if (!node_)
         return false;
@@ -512,15 +1218,58 @@ bool NavigationMesh::Build(const IntVector2& from, const IntVector2& to)
     if (!node_->GetWorldScale().Equals(Vector3::ONE))
         URHO3D_LOGWARNING("Navigation mesh root node has scaling. Agent parameters may not work as intended");
 
+    // Geometry is gathered here in the main thread, only Recast processing is done in the worker threads
     ea::vector<NavigationGeometryInfo> geometryList;
     CollectGeometries(geometryList);
 
-    unsigned numTiles = BuildTiles(geometryList, from, to);
+    auto* queue = GetSubsystem<WorkQueue>();
 
-    URHO3D_LOGDEBUG("Rebuilt " + ea::to_string(numTiles) + " tiles of the navigation mesh");
+    SharedPtr<NavigationAsyncBuild> asyncBuild(new NavigationAsyncBuild());
+    asyncBuild->from_ = from;
+    asyncBuild->to_ = to;
+
+    for (int z = from.y_; z <= to.y_; ++z)
+    {
+        for (int x = from.x_; x <= to.x_; ++x)
+        {
+            // Newer geometry wins if the tile is already being rebuilt
+            const IntVector2 tile(x, z);
+            for (NavigationAsyncBuild* pendingBuild : asyncBuilds_)
+            {
+                for (NavigationTileBuildTask* pendingTask : pendingBuild->tasks_)
+                {
+                    if (pendingTask->tile_ == tile)
+                        pendingTask->superseded_ = true;
+                }
+            }
+
+            SharedPtr<NavigationTileBuildTask> task = PrepareTileBuild(geometryList, x, z);
+            asyncBuild->tasks_.push_back(task);
+
+            // Use low priority so that the frame never waits for the tiles. Without worker threads the work queue
+            // processes the tiles in the main thread within its non-threaded time budget
+            queue->AddWorkItem([task]()
+            {
+                BuildTileNavData(*task);
+                task->completed_ = true;
+            }, 0);
+        }
+    }
+
+    asyncBuilds_.push_back(asyncBuild);
+    UpdateBeginFrameSubscription();
+
+    URHO3D_LOGDEBUG("Queued " + ea::to_string(asyncBuild->tasks_.size()) + " tiles of the navigation mesh for rebuild");
     return true;
 }
 
+void NavigationMesh::CancelAsyncBuilds()
+{
+    // Worker threads keep their tasks alive until finished, the results are simply discarded
+    asyncBuilds_.clear();
+    UpdateBeginFrameSubscription();
+}
+
 ea::vector<unsigned char> NavigationMesh::GetTileData(const IntVector2& tile) const
 {
     VectorBuffer ret;
@@ -575,6 +1324,7 @@ void NavigationMesh::RemoveTile(const IntVector2& tile)
         return;
 
     navMesh_->removeTile(tileRef, nullptr, nullptr);
+    MarkTileGraphDirty(tile, tile);
 
     // Send event
     using namespace NavigationTileRemoved;
@@ -595,6 +1345,7 @@ void NavigationMesh::RemoveAllTiles()
         if (tile->header)
             navMesh_->removeTile(navMesh_->getTileRef(tile), nullptr, nullptr);
     }
+    tileGraph_->Reset();
 
     // Send event
     using namespace NavigationAllTilesRemoved;
@@ -686,55 +1437,329 @@ void NavigationMesh::FindPath(ea::vector<NavigationPathPoint>& dest, const Vecto
     if (!startRef || !endRef)
         return;
 
+    const dtPolyRef* polys = pathData_->polys_;
     int numPolys = 0;
     int numPathPoints = 0;
 
-    navMeshQuery_->findPath(startRef, endRef, &localStart.x_, &localEnd.x_, queryFilter, pathData_->polys_, &numPolys,
-        MAX_POLYS);
+    // Plan long paths over the tile graph first, fall back to the full search if it fails
+    if (hierarchicalPathfinding_ && FindHierarchicalPath(pathData_->corridor_, startRef, endRef, localStart, localEnd, queryFilter))
+    {
+        polys = pathData_->corridor_.data();
+        numPolys = static_cast<int>(pathData_->corridor_.size());
+    }
+    else
+    {
+        navMeshQuery_->findPath(startRef, endRef, &localStart.x_, &localEnd.x_, queryFilter, pathData_->polys_, &numPolys,
+            MAX_POLYS);
+    }
     if (!numPolys)
         return;
 
     Vector3 actualLocalEnd = localEnd;
 
     // If full path was not found, clamp end point to the end polygon
-    if (pathData_->polys_[numPolys - 1] != endRef)
-        navMeshQuery_->closestPointOnPoly(pathData_->polys_[numPolys - 1], &localEnd.x_, &actualLocalEnd.x_, nullptr);
+    if (polys[numPolys - 1] != endRef)
+        navMeshQuery_->closestPointOnPoly(polys[numPolys - 1], &localEnd.x_, &actualLocalEnd.x_, nullptr);
 
-    navMeshQuery_->findStraightPath(&localStart.x_, &actualLocalEnd.x_, pathData_->polys_, numPolys,
+    navMeshQuery_->findStraightPath(&localStart.x_, &actualLocalEnd.x_, polys, numPolys,
         &pathData_->pathPoints_[0].x_, pathData_->pathFlags_, pathData_->pathPolys_, &numPathPoints, MAX_POLYS);
 
     // Transform path result back to world space
     for (int i = 0; i < numPathPoints; ++i)
+        dest.push_back(MakePathPoint(pathData_->pathPoints_[i], pathData_->pathFlags_[i], transform));
+}
+
+unsigned NavigationMesh::FindPathAsync(const Vector3& start, const Vector3& end, const NavigationPathCallback& callback,
+    const Vector3& extents, const dtQueryFilter* filter)
+{
+    // Navigation data is in local space. Transform path points from world to local
+    const Matrix3x4 inverse = node_ ? node_->GetWorldTransform().Inverse() : Matrix3x4::IDENTITY;
+
+    SharedPtr<NavigationPathQuery> query(new NavigationPathQuery());
+    query->id_ = pathQueue_->nextId_++;
+    query->localStart_ = inverse * start;
+    query->localEnd_ = inverse * end;
+    query->extents_ = extents;
+    query->filter_ = filter ? filter : queryFilter_.get();
+    query->callback_ = callback;
+
+    pathQueue_->queued_.push_back(query);
+    UpdateBeginFrameSubscription();
+    return query->id_;
+}
+
+void NavigationMesh::CancelPathQuery(unsigned queryId)
+{
+    const auto isCancelled = [queryId](NavigationPathQuery* query) { return query->id_ == queryId; };
+
+    ea::vector<SharedPtr<NavigationPathQuery> >& queued = pathQueue_->queued_;
+    queued.erase(ea::remove_if(queued.begin(), queued.end(), isCancelled), queued.end());
+
+    // Searches in progress are finished but not reported
+    for (const auto& lane : pathQueue_->lanes_)
+    {
+        if (lane->active_ && isCancelled(lane->active_))
+            lane->active_->cancelled_ = true;
+    }
+}
+
+void NavigationMesh::SetTileStreamingPath(const ea::string& path)
+{
+    const ea::string newPath = path.empty() ? EMPTY_STRING : AddTrailingSlash(path);
+    if (newPath != tileStreamingPath_)
+        emptyStreamedTiles_.clear();
+
+    tileStreamingPath_ = newPath;
+    MarkNetworkUpdate();
+}
+
+ea::string NavigationMesh::GetStreamingTileName(const IntVector2& tile) const
+{
+    return tileStreamingPath_ + "Tile_" + ea::to_string(tile.x_) + "_" + ea::to_string(tile.y_) + ".bin";
+}
+
+bool NavigationMesh::SaveStreamingTiles(const ea::string& directory) const
+{
+    if (!navMesh_)
+        return false;
+
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    const ea::string path = AddTrailingSlash(directory);
+    if (!fileSystem->CreateDirsRecursive(path))
+    {
+        URHO3D_LOGERROR("Could not create directory " + path);
+        return false;
+    }
+
+    for (int z = 0; z < numTilesZ_; ++z)
     {
-        NavigationPathPoint pt;
-        pt.position_ = transform * pathData_->pathPoints_[i];
-        pt.flag_ = (NavigationPathPointFlag)pathData_->pathFlags_[i];
+        for (int x = 0; x < numTilesX_; ++x)
+        {
+            const IntVector2 tile(x, z);
+            const ea::vector<unsigned char> tileData = GetTileData(tile);
+            if (tileData.empty())
+                continue;
 
-        // Walk through all NavAreas and find nearest
-        unsigned nearestNavAreaID = 0;       // 0 is the default nav area ID
-        float nearestDistance = M_LARGE_VALUE;
-        for (unsigned j = 0; j < areas_.size(); j++)
+            File file(context_, path + GetFileNameAndExtension(GetStreamingTileName(tile)), FILE_WRITE);
+            if (!file.IsOpen() || file.Write(tileData.data(), tileData.size()) != tileData.size())
+            {
+                URHO3D_LOGERROR("Could not write navigation mesh tile to " + file.GetName());
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void NavigationMesh::LoadTilesAsync(const IntVector2& from, const IntVector2& to)
+{
+    if (!navMesh_ || tileStreamingPath_.empty())
+        return;
+
+    auto* queue = GetSubsystem<WorkQueue>();
+    auto* cache = GetSubsystem<ResourceCache>();
+
+    for (int z = Max(from.y_, 0); z <= Min(to.y_, numTilesZ_ - 1); ++z)
+    {
+        for (int x = Max(from.x_, 0); x <= Min(to.x_, numTilesX_ - 1); ++x)
         {
-            NavArea* area = areas_[j];
-            if (area && area->IsEnabledEffective())
+            const IntVector2 tile(x, z);
+            if (HasTile(tile) || streamingTiles_.contains(tile) || emptyStreamedTiles_.contains(tile))
+                continue;
+
+            SharedPtr<NavigationStreamedTile> streamedTile(new NavigationStreamedTile());
+            streamedTile->tile_ = tile;
+            streamedTile->resourceName_ = GetStreamingTileName(tile);
+            streamingTiles_[tile] = streamedTile;
+
+            // Only read the data in the worker thread, the tile is added to the navigation mesh at the beginning of a frame
+            queue->AddWorkItem([streamedTile, cache]()
             {
-                BoundingBox bb = area->GetWorldBoundingBox();
-                if (bb.IsInside(pt.position_) == INSIDE)
+                if (!streamedTile->cancelled_)
                 {
-                    Vector3 areaWorldCenter = area->GetNode()->GetWorldPosition();
-                    float distance = (areaWorldCenter - pt.position_).LengthSquared();
-                    if (distance < nearestDistance)
+                    // Missing resource means that there is no navigation mesh in the tile
+                    SharedPtr<File> file = cache->GetFile(streamedTile->resourceName_, false);
+                    if (file)
                     {
-                        nearestDistance = distance;
-                        nearestNavAreaID = area->GetAreaID();
+                        streamedTile->data_.resize(file->GetSize());
+                        if (file->Read(streamedTile->data_.data(), streamedTile->data_.size()) != streamedTile->data_.size())
+                            streamedTile->data_.clear();
                     }
                 }
+                streamedTile->completed_ = true;
+            }, 0);
+        }
+    }
+
+    UpdateBeginFrameSubscription();
+}
+
+void NavigationMesh::UnloadTiles(const IntVector2& from, const IntVector2& to)
+{
+    if (!navMesh_)
+        return;
+
+    for (int z = Max(from.y_, 0); z <= Min(to.y_, numTilesZ_ - 1); ++z)
+    {
+        for (int x = Max(from.x_, 0); x <= Min(to.x_, numTilesX_ - 1); ++x)
+        {
+            const IntVector2 tile(x, z);
+            auto iter = streamingTiles_.find(tile);
+            if (iter != streamingTiles_.end())
+            {
+                iter->second->cancelled_ = true;
+                streamingTiles_.erase(iter);
+            }
+
+            if (HasTile(tile))
+                RemoveTile(tile);
+            streamedTiles_.erase(tile);
+            emptyStreamedTiles_.erase(tile);
+        }
+    }
+
+    UpdateBeginFrameSubscription();
+}
+
+void NavigationMesh::UpdateTileStreaming(const ea::vector<Vector3>& positions, float loadDistance, float unloadDistance)
+{
+    if (!navMesh_ || !node_ || tileStreamingPath_.empty())
+        return;
+
+    URHO3D_PROFILE("UpdateNavigationTileStreaming");
+
+    unloadDistance = Max(unloadDistance, loadDistance);
+
+    // Distances are measured in the horizontal plane of the navigation mesh
+    const Matrix3x4 inverse = node_->GetWorldTransform().Inverse();
+    ea::vector<Vector2> localPositions;
+    for (const Vector3& position : positions)
+    {
+        const Vector3 localPosition = inverse * position;
+        localPositions.emplace_back(localPosition.x_, localPosition.z_);
+    }
+
+    const auto isTileInRange = [&](const IntVector2& tile, float distance)
+    {
+        const BoundingBox tileBoundingBox = GetTileBoundingBox(tile);
+        const Rect tileRect(tileBoundingBox.min_.x_, tileBoundingBox.min_.z_, tileBoundingBox.max_.x_, tileBoundingBox.max_.z_);
+        for (const Vector2& localPosition : localPositions)
+        {
+            const Vector2 closestPoint = VectorMin(VectorMax(localPosition, tileRect.min_), tileRect.max_);
+            if ((closestPoint - localPosition).LengthSquared() <= distance * distance)
+                return true;
+        }
+        return false;
+    };
+
+    // Unload distant tiles first to keep memory bounded
+    ea::vector<IntVector2> tilesToUnload;
+    for (const IntVector2& tile : streamedTiles_)
+    {
+        if (!isTileInRange(tile, unloadDistance))
+            tilesToUnload.push_back(tile);
+    }
+    for (const auto& item : streamingTiles_)
+    {
+        if (!isTileInRange(item.first, unloadDistance))
+            tilesToUnload.push_back(item.first);
+    }
+    for (const IntVector2& tile : emptyStreamedTiles_)
+    {
+        if (!isTileInRange(tile, unloadDistance))
+            tilesToUnload.push_back(tile);
+    }
+    for (const IntVector2& tile : tilesToUnload)
+        UnloadTiles(tile, tile);
+
+    // Load nearby tiles
+    const float tileEdgeLength = (float)tileSize_ * cellSize_;
+    for (const Vector2& localPosition : localPositions)
+    {
+        const IntVector2 from = VectorFloorToInt((localPosition - Vector2(loadDistance, loadDistance) -
+            Vector2(boundingBox_.min_.x_, boundingBox_.min_.z_)) / tileEdgeLength);
+        const IntVector2 to = VectorFloorToInt((localPosition + Vector2(loadDistance, loadDistance) -
+            Vector2(boundingBox_.min_.x_, boundingBox_.min_.z_)) / tileEdgeLength);
+
+        for (int z = Max(from.y_, 0); z <= Min(to.y_, numTilesZ_ - 1); ++z)
+        {
+            for (int x = Max(from.x_, 0); x <= Min(to.x_, numTilesX_ - 1); ++x)
+            {
+                const IntVector2 tile(x, z);
+                if (isTileInRange(tile, loadDistance))
+                    LoadTilesAsync(tile, tile);
             }
         }
-        pt.areaID_ = (unsigned char)nearestNavAreaID;
+    }
+}
+
+void NavigationMesh::UpdateStreamedTiles()
+{
+    for (auto iter = streamingTiles_.begin(); iter != streamingTiles_.end();)
+    {
+        NavigationStreamedTile* streamedTile = iter->second;
+        if (!streamedTile->completed_)
+        {
+            ++iter;
+            continue;
+        }
+
+        // Tile may have been built in the meantime. Remember the tiles that have nothing to add, so that they are not read again
+        // on every update while in range
+        if (!HasTile(streamedTile->tile_))
+        {
+            if (!streamedTile->data_.empty() && AddTile(streamedTile->data_))
+                streamedTiles_.insert(streamedTile->tile_);
+            else
+                emptyStreamedTiles_.insert(streamedTile->tile_);
+        }
+        iter = streamingTiles_.erase(iter);
+    }
+}
+
+void NavigationMesh::SetHierarchicalPathfinding(bool enable)
+{
+    hierarchicalPathfinding_ = enable;
+    if (!enable)
+        tileGraph_->Reset();
+}
+
+void NavigationMesh::SetHierarchicalPathMinTiles(int numTiles)
+{
+    hierarchicalPathMinTiles_ = Max(numTiles, 1);
+}
 
-        dest.push_back(pt);
+void NavigationMesh::SetMaxPathQueryIterations(unsigned iterations)
+{
+    pathQueue_->maxIterations_ = Max(iterations, 1u);
+}
+
+void NavigationMesh::SetPathCacheSize(unsigned size)
+{
+    pathQueue_->cacheSize_ = size;
+    pathQueue_->cache_.clear();
+}
+
+unsigned NavigationMesh::GetMaxPathQueryIterations() const
+{
+    return pathQueue_->maxIterations_;
+}
+
+unsigned NavigationMesh::GetPathCacheSize() const
+{
+    return pathQueue_->cacheSize_;
+}
+
+unsigned NavigationMesh::GetNumPendingPathQueries() const
+{
+    unsigned numPending = pathQueue_->queued_.size();
+    for (const auto& lane : pathQueue_->lanes_)
+    {
+        if (lane->active_)
+            ++numPending;
     }
+    return numPending;
 }
 
 Vector3 NavigationMesh::GetRandomPoint(const dtQueryFilter* filter, dtPolyRef* randomRef)
@@ -942,9 +1967,13 @@ ea::vector<unsigned char> NavigationMesh::GetNavigationDataAttr() const
 
         const dtNavMesh* navMesh = navMesh_;
 
-        for (int z = 0; z < numTilesZ_; ++z)
-            for (int x = 0; x < numTilesX_; ++x)
-                WriteTile(ret, x, z);
+        // Streamed tiles are stored as separate resources
+        if (tileStreamingPath_.empty())
+        {
+            for (int z = 0; z < numTilesZ_; ++z)
+                for (int x = 0; x < numTilesX_; ++x)
+                    WriteTile(ret, x, z);
+        }
     }
 
     return ret.GetBuffer();
@@ -1286,6 +2315,10 @@ bool NavigationMesh::ReadTile(Deserializer& source, bool silent)
         return false;
     }
 
+    // New tile may provide shorter paths
+    pathQueue_->cache_.clear();
+    MarkTileGraphDirty(IntVector2(x, z), IntVector2(x, z));
+
     // Send event
     if (!silent)
     {
@@ -1299,18 +2332,17 @@ bool NavigationMesh::ReadTile(Deserializer& source, bool silent)
     return true;
 }
 
-bool NavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometryList, int x, int z)
+SharedPtr<NavigationTileBuildTask> NavigationMesh::PrepareTileBuild(ea::vector<NavigationGeometryInfo>& geometryList, int x, int z)
 {
-    URHO3D_PROFILE("BuildNavigationMeshTile");
-
-    // Remove previous tile (if any)
-    navMesh_->removeTile(navMesh_->getTileRefAt(x, z, 0), nullptr, nullptr);
-
-    const BoundingBox tileBoundingBox = GetTileBoundingBox(IntVector2(x, z));
-
-    SimpleNavBuildData build;
-
-    rcConfig cfg;       // NOLINT(hicpp-member-init)
+    SharedPtr<NavigationTileBuildTask> task(new NavigationTileBuildTask());
+    task->tile_ = IntVector2(x, z);
+    task->tileBoundingBox_ = GetTileBoundingBox(task->tile_);
+    task->agentHeight_ = agentHeight_;
+    task->agentRadius_ = agentRadius_;
+    task->agentMaxClimb_ = agentMaxClimb_;
+    task->partitionType_ = partitionType_;
+
+    rcConfig& cfg = task->config_;
     memset(&cfg, 0, sizeof cfg);
     cfg.cs = cellSize_;
     cfg.ch = cellHeight_;
@@ -1330,216 +2362,561 @@ bool NavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometryList,
     cfg.detailSampleDist = detailSampleDistance_ < 0.9f ? 0.0f : cellSize_ * detailSampleDistance_;
     cfg.detailSampleMaxError = cellHeight_ * detailSampleMaxError_;
 
-    rcVcopy(cfg.bmin, &tileBoundingBox.min_.x_);
-    rcVcopy(cfg.bmax, &tileBoundingBox.max_.x_);
+    rcVcopy(cfg.bmin, &task->tileBoundingBox_.min_.x_);
+    rcVcopy(cfg.bmax, &task->tileBoundingBox_.max_.x_);
     cfg.bmin[0] -= cfg.borderSize * cfg.cs;
     cfg.bmin[2] -= cfg.borderSize * cfg.cs;
     cfg.bmax[0] += cfg.borderSize * cfg.cs;
     cfg.bmax[2] += cfg.borderSize * cfg.cs;
 
-    BoundingBox expandedBox(*reinterpret_cast<Vector3*>(cfg.bmin), *reinterpret_cast<Vector3*>(cfg.bmax));
-    GetTileGeometry(&build, geometryList, expandedBox);
+    // Geometry is copied into the build data, so the tile may be built later without touching the scene
+    BoundingBox expandedBox(*reinterpret_cast<Vector3*>(cfg.bmin), *reinterpret_cast<Vector3*>(cfg.bmax));
+    GetTileGeometry(&task->build_, geometryList, expandedBox);
+
+    return task;
+}
+
+bool NavigationMesh::CommitTileBuild(NavigationTileBuildTask* task)
+{
+    const int x = task->tile_.x_;
+    const int z = task->tile_.y_;
+
+    // Remove previous tile (if any)
+    navMesh_->removeTile(navMesh_->getTileRefAt(x, z, 0), nullptr, nullptr);
+    MarkTileGraphDirty(task->tile_, task->tile_);
+
+    if (!task->success_)
+        return false;
+
+    if (!task->navData_)
+        return true; // Nothing to do
+
+    if (dtStatusFailed(navMesh_->addTile(task->navData_, task->navDataSize_, DT_TILE_FREE_DATA, 0, nullptr)))
+    {
+        URHO3D_LOGERROR("Failed to add navigation mesh tile");
+        return false;
+    }
+
+    // Navigation mesh owns the data now
+    task->navData_ = nullptr;
+    task->navDataSize_ = 0;
+
+    // New tile may provide shorter paths
+    pathQueue_->cache_.clear();
+
+    // Send a notification of the rebuild of this tile to anyone interested
+    {
+        using namespace NavigationAreaRebuilt;
+        VariantMap& eventData = GetContext()->GetEventDataMap();
+        eventData[P_NODE] = GetNode();
+        eventData[P_MESH] = this;
+        eventData[P_BOUNDSMIN] = Variant(task->tileBoundingBox_.min_);
+        eventData[P_BOUNDSMAX] = Variant(task->tileBoundingBox_.max_);
+        SendEvent(E_NAVIGATION_AREA_REBUILT, eventData);
+    }
+    return true;
+}
+
+bool NavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometryList, int x, int z)
+{
+    URHO3D_PROFILE("BuildNavigationMeshTile");
+
+    SharedPtr<NavigationTileBuildTask> task = PrepareTileBuild(geometryList, x, z);
+    BuildTileNavData(*task);
+    return CommitTileBuild(task);
+}
+
+unsigned NavigationMesh::BuildTiles(ea::vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to)
+{
+    unsigned numTiles = 0;
+
+    for (int z = from.y_; z <= to.y_; ++z)
+    {
+        for (int x = from.x_; x <= to.x_; ++x)
+        {
+            if (BuildTile(geometryList, x, z))
+                ++numTiles;
+        }
+    }
+    return numTiles;
+}
+
+void NavigationMesh::GetTileRange(const BoundingBox& boundingBox, IntVector2& from, IntVector2& to) const
+{
+    BoundingBox localSpaceBox = boundingBox.Transformed(node_->GetWorldTransform().Inverse());
+
+    float tileEdgeLength = (float)tileSize_ * cellSize_;
+
+    from.x_ = Clamp((int)((localSpaceBox.min_.x_ - boundingBox_.min_.x_) / tileEdgeLength), 0, numTilesX_ - 1);
+    from.y_ = Clamp((int)((localSpaceBox.min_.z_ - boundingBox_.min_.z_) / tileEdgeLength), 0, numTilesZ_ - 1);
+    to.x_ = Clamp((int)((localSpaceBox.max_.x_ - boundingBox_.min_.x_) / tileEdgeLength), 0, numTilesX_ - 1);
+    to.y_ = Clamp((int)((localSpaceBox.max_.z_ - boundingBox_.min_.z_) / tileEdgeLength), 0, numTilesZ_ - 1);
+}
+
+void NavigationMesh::SendAsyncBuildFinishedEvent(const IntVector2& from, const IntVector2& to, unsigned numTiles)
+{
+    using namespace NavigationAsyncBuildFinished;
+    VariantMap& eventData = GetContext()->GetEventDataMap();
+    eventData[P_NODE] = GetNode();
+    eventData[P_MESH] = this;
+    eventData[P_FROM] = from;
+    eventData[P_TO] = to;
+    eventData[P_NUMTILES] = numTiles;
+    SendEvent(E_NAVIGATION_ASYNC_BUILD_FINISHED, eventData);
+}
+
+void NavigationMesh::UpdateAsyncBuilds()
+{
+    // Builds are swapped in the order of submission, each one as a whole
+    while (!asyncBuilds_.empty())
+    {
+        SharedPtr<NavigationAsyncBuild> asyncBuild = asyncBuilds_.front();
+        for (NavigationTileBuildTask* task : asyncBuild->tasks_)
+        {
+            if (!task->completed_)
+                return;
+        }
+
+        URHO3D_PROFILE("CommitNavigationMeshTiles");
+
+        asyncBuilds_.erase(asyncBuilds_.begin());
 
-    if (build.vertices_.empty() || build.indices_.empty())
-        return true; // Nothing to do
+        unsigned numTiles = 0;
+        for (NavigationTileBuildTask* task : asyncBuild->tasks_)
+        {
+            if (!task->superseded_ && CommitTileBuild(task))
+                ++numTiles;
+        }
 
-    build.heightField_ = rcAllocHeightfield();
-    if (!build.heightField_)
-    {
-        URHO3D_LOGERROR("Could not allocate heightfield");
-        return false;
+        URHO3D_LOGDEBUG("Rebuilt " + ea::to_string(numTiles) + " tiles of the navigation mesh asynchronously");
+        SendAsyncBuildFinishedEvent(asyncBuild->from_, asyncBuild->to_, numTiles);
     }
+}
 
-    if (!rcCreateHeightfield(build.ctx_, *build.heightField_, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs,
-        cfg.ch))
-    {
-        URHO3D_LOGERROR("Could not create heightfield");
-        return false;
-    }
+void NavigationMesh::UpdatePathQueries()
+{
+    NavigationPathQueue& pathQueue = *pathQueue_;
+    if (GetNumPendingPathQueries() == 0)
+        return;
 
-    unsigned numTriangles = build.indices_.size() / 3;
-    ea::shared_array<unsigned char> triAreas(new unsigned char[numTriangles]);
-    memset(triAreas.get(), 0, numTriangles);
+    URHO3D_PROFILE("UpdatePathQueries");
 
-    rcMarkWalkableTriangles(build.ctx_, cfg.walkableSlopeAngle, &build.vertices_[0].x_, build.vertices_.size(),
-        &build.indices_[0], numTriangles, triAreas.get());
-    rcRasterizeTriangles(build.ctx_, &build.vertices_[0].x_, build.vertices_.size(), &build.indices_[0],
-        triAreas.get(), numTriangles, *build.heightField_, cfg.walkableClimb);
-    rcFilterLowHangingWalkableObstacles(build.ctx_, cfg.walkableClimb, *build.heightField_);
+    auto* queue = GetSubsystem<WorkQueue>();
 
-    rcFilterWalkableLowHeightSpans(build.ctx_, cfg.walkableHeight, *build.heightField_);
-    rcFilterLedgeSpans(build.ctx_, cfg.walkableHeight, cfg.walkableClimb, *build.heightField_);
+    // Worker threads and main thread process the queries, each one with its own Detour query
+    const unsigned numLanes = queue->GetNumThreads() + 1;
+    while (pathQueue.lanes_.size() < numLanes)
+        pathQueue.lanes_.push_back(ea::make_unique<NavigationPathQueryLane>());
 
-    build.compactHeightField_ = rcAllocCompactHeightfield();
-    if (!build.compactHeightField_)
+    bool canSearch = navMesh_ && node_;
+    for (const auto& lane : pathQueue.lanes_)
     {
-        URHO3D_LOGERROR("Could not allocate create compact heightfield");
-        return false;
-    }
-    if (!rcBuildCompactHeightfield(build.ctx_, cfg.walkableHeight, cfg.walkableClimb, *build.heightField_,
-        *build.compactHeightField_))
-    {
-        URHO3D_LOGERROR("Could not build compact heightfield");
-        return false;
-    }
-    if (!rcErodeWalkableArea(build.ctx_, cfg.walkableRadius, *build.compactHeightField_))
-    {
-        URHO3D_LOGERROR("Could not erode compact heightfield");
-        return false;
-    }
+        if (!canSearch || lane->navMesh_ == navMesh_)
+            continue;
 
-    // Mark area volumes
-    for (unsigned i = 0; i < build.navAreas_.size(); ++i)
-        rcMarkBoxArea(build.ctx_, &build.navAreas_[i].bounds_.min_.x_, &build.navAreas_[i].bounds_.max_.x_,
-            build.navAreas_[i].areaID_, *build.compactHeightField_);
+        if (!lane->query_)
+            lane->query_ = dtAllocNavMeshQuery();
+        if (!lane->query_ || dtStatusFailed(lane->query_->init(navMesh_, MAX_POLYS)))
+        {
+            URHO3D_LOGERROR("Could not init navigation mesh query");
+            canSearch = false;
+            break;
+        }
+        lane->navMesh_ = navMesh_;
+    }
 
-    if (this->partitionType_ == NAVMESH_PARTITION_WATERSHED)
+    ea::vector<SharedPtr<NavigationPathQuery> > finishedQueries;
+    if (canSearch)
     {
-        if (!rcBuildDistanceField(build.ctx_, *build.compactHeightField_))
+        pathQueue.nextQueued_ = 0;
+        for (const auto& lane : pathQueue.lanes_)
         {
-            URHO3D_LOGERROR("Could not build distance field");
-            return false;
+            NavigationPathQueryLane* lanePtr = lane.get();
+            queue->AddWorkItem([&pathQueue, lanePtr]() { ProcessPathQueryLane(pathQueue, *lanePtr); }, M_MAX_UNSIGNED);
         }
-        if (!rcBuildRegions(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea,
-            cfg.mergeRegionArea))
+        queue->Complete(M_MAX_UNSIGNED);
+
+        const unsigned numTaken = Min(pathQueue.nextQueued_.load(), pathQueue.queued_.size());
+        pathQueue.queued_.erase(pathQueue.queued_.begin(), pathQueue.queued_.begin() + numTaken);
+
+        for (const auto& lane : pathQueue.lanes_)
         {
-            URHO3D_LOGERROR("Could not build regions");
-            return false;
+            finishedQueries.insert(finishedQueries.end(), lane->finished_.begin(), lane->finished_.end());
+            lane->finished_.clear();
         }
     }
     else
     {
-        if (!rcBuildRegionsMonotone(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+        // There is nothing to search in, fail all the queries
+        for (const auto& lane : pathQueue.lanes_)
         {
-            URHO3D_LOGERROR("Could not build monotone regions");
-            return false;
+            if (lane->active_)
+                finishedQueries.push_back(lane->active_);
+            lane->active_ = nullptr;
         }
+        finishedQueries.insert(finishedQueries.end(), pathQueue.queued_.begin(), pathQueue.queued_.end());
+        pathQueue.queued_.clear();
     }
 
-    build.contourSet_ = rcAllocContourSet();
-    if (!build.contourSet_)
+    // Callbacks may queue new queries, so the results are collected beforehand
+    const Matrix3x4& transform = node_ ? node_->GetWorldTransform() : Matrix3x4::IDENTITY;
+    ea::vector<NavigationPathPoint> path;
+    for (NavigationPathQuery* query : finishedQueries)
     {
-        URHO3D_LOGERROR("Could not allocate contour set");
-        return false;
+        if (query->cancelled_ || !query->callback_)
+            continue;
+
+        path.clear();
+        for (unsigned i = 0; i < query->pathPoints_.size(); ++i)
+            path.push_back(MakePathPoint(query->pathPoints_[i], query->pathFlags_[i], transform));
+        query->callback_(path);
     }
-    if (!rcBuildContours(build.ctx_, *build.compactHeightField_, cfg.maxSimplificationError, cfg.maxEdgeLen,
-        *build.contourSet_))
+}
+
+NavigationPathPoint NavigationMesh::MakePathPoint(const Vector3& localPosition, unsigned char flags, const Matrix3x4& transform) const
+{
+    NavigationPathPoint pt;
+    pt.position_ = transform * localPosition;
+    pt.flag_ = (NavigationPathPointFlag)flags;
+
+    // Walk through all NavAreas and find nearest
+    unsigned nearestNavAreaID = 0;       // 0 is the default nav area ID
+    float nearestDistance = M_LARGE_VALUE;
+    for (unsigned j = 0; j < areas_.size(); j++)
     {
-        URHO3D_LOGERROR("Could not create contours");
-        return false;
+        NavArea* area = areas_[j];
+        if (area && area->IsEnabledEffective())
+        {
+            BoundingBox bb = area->GetWorldBoundingBox();
+            if (bb.IsInside(pt.position_) == INSIDE)
+            {
+                Vector3 areaWorldCenter = area->GetNode()->GetWorldPosition();
+                float distance = (areaWorldCenter - pt.position_).LengthSquared();
+                if (distance < nearestDistance)
+                {
+                    nearestDistance = distance;
+                    nearestNavAreaID = area->GetAreaID();
+                }
+            }
+        }
     }
+    pt.areaID_ = (unsigned char)nearestNavAreaID;
+    return pt;
+}
 
-    build.polyMesh_ = rcAllocPolyMesh();
-    if (!build.polyMesh_)
+void NavigationMesh::UpdateBeginFrameSubscription()
+{
+    if (IsBuildingAsync() || GetNumPendingPathQueries() != 0 || !streamingTiles_.empty())
+        SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(NavigationMesh, HandleBeginFrame));
+    else
+        UnsubscribeFromEvent(E_BEGINFRAME);
+}
+
+void NavigationMesh::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+    // Swap in the new tiles first so that path queries see them
+    UpdateAsyncBuilds();
+    UpdateStreamedTiles();
+    UpdatePathQueries();
+    UpdateBeginFrameSubscription();
+}
+
+void NavigationMesh::MarkTileGraphDirty(const IntVector2& from, const IntVector2& to)
+{
+    NavigationTileGraph& graph = *tileGraph_;
+    if (!graph.built_)
+        return;
+
+    for (int z = from.y_; z <= to.y_; ++z)
     {
-        URHO3D_LOGERROR("Could not allocate poly mesh");
-        return false;
+        for (int x = from.x_; x <= to.x_; ++x)
+            graph.dirtyTiles_.insert(IntVector2(x, z));
     }
-    if (!rcBuildPolyMesh(build.ctx_, *build.contourSet_, cfg.maxVertsPerPoly, *build.polyMesh_))
+}
+
+void NavigationMesh::UpdateTileGraph()
+{
+    NavigationTileGraph& graph = *tileGraph_;
+    if (!graph.built_)
     {
-        URHO3D_LOGERROR("Could not triangulate contours");
-        return false;
+        graph.Reset();
+        graph.built_ = true;
+        MarkTileGraphDirty(IntVector2::ZERO, GetNumTiles() - IntVector2::ONE);
     }
 
-    build.polyMeshDetail_ = rcAllocPolyMeshDetail();
-    if (!build.polyMeshDetail_)
+    if (graph.dirtyTiles_.empty())
+        return;
+
+    URHO3D_PROFILE("UpdateNavigationTileGraph");
+
+    static const IntVector2 neighbourOffsets[] = { IntVector2(1, 0), IntVector2(-1, 0), IntVector2(0, 1), IntVector2(0, -1) };
+    const IntRect tileRect(IntVector2::ZERO, GetNumTiles());
+
+    // Remove portals of the changed tiles, costs of the neighbour tiles should be updated too
+    ea::hash_set<IntVector2> affectedTiles;
+    for (const IntVector2& tile : graph.dirtyTiles_)
     {
-        URHO3D_LOGERROR("Could not allocate detail mesh");
-        return false;
+        affectedTiles.insert(tile);
+        for (const IntVector2& offset : neighbourOffsets)
+        {
+            if (tileRect.IsInside(tile + offset) == INSIDE)
+                affectedTiles.insert(tile + offset);
+        }
+
+        auto iter = graph.clusters_.find(tile);
+        if (iter == graph.clusters_.end())
+            continue;
+
+        for (unsigned portalIndex : iter->second.portals_)
+        {
+            NavigationTilePortal& portal = graph.portals_[portalIndex];
+            const IntVector2& otherTile = portal.tiles_[0] == tile ? portal.tiles_[1] : portal.tiles_[0];
+            auto otherIter = graph.clusters_.find(otherTile);
+            if (otherIter != graph.clusters_.end())
+                otherIter->second.portals_.erase_first(portalIndex);
+
+            portal.polyRef_ = 0;
+            graph.freePortals_.push_back(portalIndex);
+        }
+        graph.clusters_.erase(iter);
     }
-    if (!rcBuildPolyMeshDetail(build.ctx_, *build.polyMesh_, *build.compactHeightField_, cfg.detailSampleDist,
-        cfg.detailSampleMaxError, *build.polyMeshDetail_))
+
+    // Find new portals. Portals between two changed tiles are collected once
+    ea::vector<NavigationTilePortal> newPortals;
+    const float mergeDistance = cellSize_ * 2.0f;
+    for (const IntVector2& tile : graph.dirtyTiles_)
     {
-        URHO3D_LOGERROR("Could not build detail mesh");
-        return false;
+        for (const IntVector2& offset : neighbourOffsets)
+        {
+            const IntVector2 neighbour = tile + offset;
+            if (tileRect.IsInside(neighbour) != INSIDE)
+                continue;
+            if (graph.dirtyTiles_.contains(neighbour) && (offset.x_ < 0 || offset.y_ < 0))
+                continue;
+
+            CollectTilePortals(navMesh_, tile, neighbour, mergeDistance, newPortals);
+        }
     }
 
-    // Set polygon flags
-    /// \todo Assignment of flags from navigation areas?
-    for (int i = 0; i < build.polyMesh_->npolys; ++i)
+    for (const NavigationTilePortal& portal : newPortals)
     {
-        if (build.polyMesh_->areas[i] != RC_NULL_AREA)
-            build.polyMesh_->flags[i] = 0x1;
+        unsigned portalIndex;
+        if (!graph.freePortals_.empty())
+        {
+            portalIndex = graph.freePortals_.back();
+            graph.freePortals_.pop_back();
+            graph.portals_[portalIndex] = portal;
+        }
+        else
+        {
+            portalIndex = graph.portals_.size();
+            graph.portals_.push_back(portal);
+        }
+
+        graph.clusters_[portal.tiles_[0]].portals_.push_back(portalIndex);
+        graph.clusters_[portal.tiles_[1]].portals_.push_back(portalIndex);
     }
 
-    unsigned char* navData = nullptr;
-    int navDataSize = 0;
+    // Precompute traversal costs between the portals of each tile
+    for (const IntVector2& tile : affectedTiles)
+    {
+        auto iter = graph.clusters_.find(tile);
+        if (iter == graph.clusters_.end())
+            continue;
 
-    dtNavMeshCreateParams params;       // NOLINT(hicpp-member-init)
-    memset(&params, 0, sizeof params);
-    params.verts = build.polyMesh_->verts;
-    params.vertCount = build.polyMesh_->nverts;
-    params.polys = build.polyMesh_->polys;
-    params.polyAreas = build.polyMesh_->areas;
-    params.polyFlags = build.polyMesh_->flags;
-    params.polyCount = build.polyMesh_->npolys;
-    params.nvp = build.polyMesh_->nvp;
-    params.detailMeshes = build.polyMeshDetail_->meshes;
-    params.detailVerts = build.polyMeshDetail_->verts;
-    params.detailVertsCount = build.polyMeshDetail_->nverts;
-    params.detailTris = build.polyMeshDetail_->tris;
-    params.detailTriCount = build.polyMeshDetail_->ntris;
-    params.walkableHeight = agentHeight_;
-    params.walkableRadius = agentRadius_;
-    params.walkableClimb = agentMaxClimb_;
-    params.tileX = x;
-    params.tileY = z;
-    rcVcopy(params.bmin, build.polyMesh_->bmin);
-    rcVcopy(params.bmax, build.polyMesh_->bmax);
-    params.cs = cfg.cs;
-    params.ch = cfg.ch;
-    params.buildBvTree = true;
+        NavigationTileCluster& cluster = iter->second;
+        const unsigned numPortals = cluster.portals_.size();
+        cluster.costs_.resize(numPortals * numPortals);
+        for (unsigned i = 0; i < numPortals; ++i)
+        {
+            const NavigationTilePortal& from = graph.portals_[cluster.portals_[i]];
+            cluster.costs_[i * numPortals + i] = 0.0f;
+            for (unsigned j = i + 1; j < numPortals; ++j)
+            {
+                const NavigationTilePortal& to = graph.portals_[cluster.portals_[j]];
+                const float cost = GetLocalPathCost(from.polyRef_, to.polyRef_, from.position_, to.position_, queryFilter_.get());
+                cluster.costs_[i * numPortals + j] = cost;
+                cluster.costs_[j * numPortals + i] = cost;
+            }
+        }
+    }
 
-    // Add off-mesh connections if have them
-    if (build.offMeshRadii_.size())
+    graph.dirtyTiles_.clear();
+}
+
+float NavigationMesh::GetLocalPathCost(dtPolyRef startRef, dtPolyRef endRef, const Vector3& start, const Vector3& end,
+    const dtQueryFilter* filter)
+{
+    if (startRef == endRef)
+        return (end - start).Length();
+
+    int numPolys = 0;
+    navMeshQuery_->findPath(startRef, endRef, &start.x_, &end.x_, filter, pathData_->polys_, &numPolys, MAX_POLYS);
+    if (!numPolys || pathData_->polys_[numPolys - 1] != endRef)
+        return -1.0f;
+
+    int numPathPoints = 0;
+    navMeshQuery_->findStraightPath(&start.x_, &end.x_, pathData_->polys_, numPolys, &pathData_->pathPoints_[0].x_,
+        pathData_->pathFlags_, pathData_->pathPolys_, &numPathPoints, MAX_POLYS);
+
+    float cost = 0.0f;
+    for (int i = 1; i < numPathPoints; ++i)
+        cost += (pathData_->pathPoints_[i] - pathData_->pathPoints_[i - 1]).Length();
+    return cost;
+}
+
+bool NavigationMesh::FindHierarchicalPath(ea::vector<dtPolyRef>& corridor, dtPolyRef startRef, dtPolyRef endRef,
+    const Vector3& localStart, const Vector3& localEnd, const dtQueryFilter* filter)
+{
+    const dtMeshTile* startMeshTile = nullptr;
+    const dtMeshTile* endMeshTile = nullptr;
+    const dtPoly* poly = nullptr;
+    navMesh_->getTileAndPolyByRefUnsafe(startRef, &startMeshTile, &poly);
+    navMesh_->getTileAndPolyByRefUnsafe(endRef, &endMeshTile, &poly);
+    const IntVector2 startTile(startMeshTile->header->x, startMeshTile->header->y);
+    const IntVector2 endTile(endMeshTile->header->x, endMeshTile->header->y);
+
+    // Short paths are cheap enough for the regular search
+    const IntVector2 tileDistance = VectorAbs(endTile - startTile);
+    if (Max(tileDistance.x_, tileDistance.y_) < hierarchicalPathMinTiles_)
+        return false;
+
+    UpdateTileGraph();
+
+    NavigationTileGraph& graph = *tileGraph_;
+    const auto startIter = graph.clusters_.find(startTile);
+    const auto endIter = graph.clusters_.find(endTile);
+    if (startIter == graph.clusters_.end() || endIter == graph.clusters_.end())
+        return false;
+
+    URHO3D_PROFILE("FindHierarchicalPath");
+
+    const NavigationTileCluster& startCluster = startIter->second;
+    const NavigationTileCluster& endCluster = endIter->second;
+
+    // Search over the portals, the start and the end are additional nodes
+    const unsigned numPortals = graph.portals_.size();
+    const unsigned startNode = numPortals;
+    const unsigned endNode = numPortals + 1;
+    graph.searchCosts_.assign(numPortals + 2, M_INFINITY);
+    graph.searchPrevious_.assign(numPortals + 2, M_MAX_UNSIGNED);
+    graph.searchClosed_.assign(numPortals + 2, false);
+
+    ea::vector<float> endCosts(endCluster.portals_.size());
+    for (unsigned i = 0; i < endCluster.portals_.size(); ++i)
     {
-        params.offMeshConCount = build.offMeshRadii_.size();
-        params.offMeshConVerts = &build.offMeshVertices_[0].x_;
-        params.offMeshConRad = &build.offMeshRadii_[0];
-        params.offMeshConFlags = &build.offMeshFlags_[0];
-        params.offMeshConAreas = &build.offMeshAreas_[0];
-        params.offMeshConDir = &build.offMeshDir_[0];
+        const NavigationTilePortal& portal = graph.portals_[endCluster.portals_[i]];
+        endCosts[i] = GetLocalPathCost(portal.polyRef_, endRef, portal.position_, localEnd, filter);
     }
 
-    if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+    const auto getNodePosition = [&](unsigned node)
     {
-        URHO3D_LOGERROR("Could not build navigation mesh tile data");
-        return false;
-    }
+        return node == startNode ? localStart : node == endNode ? localEnd : graph.portals_[node].position_;
+    };
 
-    if (dtStatusFailed(navMesh_->addTile(navData, navDataSize, DT_TILE_FREE_DATA, 0, nullptr)))
+    using OpenNode = ea::pair<float, unsigned>;
+    ea::vector<OpenNode> openNodes;
+    const auto relax = [&](unsigned node, unsigned nextNode, float cost)
     {
-        URHO3D_LOGERROR("Failed to add navigation mesh tile");
-        dtFree(navData);
-        return false;
-    }
+        if (cost < 0.0f || graph.searchClosed_[nextNode])
+            return;
 
-    // Send a notification of the rebuild of this tile to anyone interested
+        const float nextCost = graph.searchCosts_[node] + cost;
+        if (nextCost >= graph.searchCosts_[nextNode])
+            return;
+
+        graph.searchCosts_[nextNode] = nextCost;
+        graph.searchPrevious_[nextNode] = node;
+        openNodes.emplace_back(nextCost + (localEnd - getNodePosition(nextNode)).Length(), nextNode);
+        ea::push_heap(openNodes.begin(), openNodes.end(), ea::greater<OpenNode>());
+    };
+
+    graph.searchCosts_[startNode] = 0.0f;
+    openNodes.emplace_back((localEnd - localStart).Length(), startNode);
+    while (!openNodes.empty())
     {
-        using namespace NavigationAreaRebuilt;
-        VariantMap& eventData = GetContext()->GetEventDataMap();
-        eventData[P_NODE] = GetNode();
-        eventData[P_MESH] = this;
-        eventData[P_BOUNDSMIN] = Variant(tileBoundingBox.min_);
-        eventData[P_BOUNDSMAX] = Variant(tileBoundingBox.max_);
-        SendEvent(E_NAVIGATION_AREA_REBUILT, eventData);
+        ea::pop_heap(openNodes.begin(), openNodes.end(), ea::greater<OpenNode>());
+        const unsigned node = openNodes.back().second;
+        openNodes.pop_back();
+
+        if (graph.searchClosed_[node])
+            continue;
+        graph.searchClosed_[node] = true;
+        if (node == endNode)
+            break;
+
+        if (node == startNode)
+        {
+            for (unsigned portalIndex : startCluster.portals_)
+            {
+                const NavigationTilePortal& portal = graph.portals_[portalIndex];
+                relax(node, portalIndex, GetLocalPathCost(startRef, portal.polyRef_, localStart, portal.position_, filter));
+            }
+            continue;
+        }
+
+        // Portal belongs to two tiles, continue to the other portals of both
+        for (const IntVector2& tile : graph.portals_[node].tiles_)
+        {
+            const NavigationTileCluster& cluster = graph.clusters_.find(tile)->second;
+            const unsigned numClusterPortals = cluster.portals_.size();
+            const unsigned index = cluster.portals_.index_of(node);
+            for (unsigned i = 0; i < numClusterPortals; ++i)
+                relax(node, cluster.portals_[i], cluster.costs_[index * numClusterPortals + i]);
+
+            if (tile == endTile)
+                relax(node, endNode, endCosts[index]);
+        }
     }
-    return true;
-}
 
-unsigned NavigationMesh::BuildTiles(ea::vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to)
-{
-    unsigned numTiles = 0;
+    if (!graph.searchClosed_[endNode])
+        return false;
 
-    for (int z = from.y_; z <= to.y_; ++z)
+    // Collect the portals on the route
+    ea::vector<unsigned> route;
+    for (unsigned node = graph.searchPrevious_[endNode]; node != startNode; node = graph.searchPrevious_[node])
+        route.push_back(node);
+    ea::reverse(route.begin(), route.end());
+
+    // Refine the route with local searches between the consecutive portals, removing loops at the joints
+    corridor.clear();
+    ea::unordered_map<dtPolyRef, unsigned> corridorIndices;
+    dtPolyRef fromRef = startRef;
+    Vector3 fromPosition = localStart;
+    for (unsigned i = 0; i <= route.size(); ++i)
     {
-        for (int x = from.x_; x <= to.x_; ++x)
+        const dtPolyRef toRef = i < route.size() ? graph.portals_[route[i]].polyRef_ : endRef;
+        const Vector3 toPosition = i < route.size() ? graph.portals_[route[i]].position_ : localEnd;
+
+        int numPolys = 0;
+        navMeshQuery_->findPath(fromRef, toRef, &fromPosition.x_, &toPosition.x_, filter, pathData_->polys_, &numPolys,
+            MAX_POLYS);
+        if (!numPolys || pathData_->polys_[numPolys - 1] != toRef)
+            return false;
+
+        for (int j = 0; j < numPolys; ++j)
         {
-            if (BuildTile(geometryList, x, z))
-                ++numTiles;
+            const dtPolyRef polyRef = pathData_->polys_[j];
+            const auto iter = corridorIndices.find(polyRef);
+            if (iter != corridorIndices.end())
+            {
+                const unsigned newSize = iter->second + 1;
+                for (unsigned k = newSize; k < corridor.size(); ++k)
+                    corridorIndices.erase(corridor[k]);
+                corridor.resize(newSize);
+            }
+            else
+            {
+                corridorIndices[polyRef] = corridor.size();
+                corridor.push_back(polyRef);
+            }
         }
+
+        fromRef = toRef;
+        fromPosition = toPosition;
     }
-    return numTiles;
+
+    return true;
 }
 
 bool NavigationMesh::InitializeQuery()
@@ -1568,6 +2945,28 @@ bool NavigationMesh::InitializeQuery()
 
 void NavigationMesh::ReleaseNavigationMesh()
 {
+    CancelAsyncBuilds();
+
+    // Searches in progress refer to the old navigation mesh, restart them later
+    for (const auto& lane : pathQueue_->lanes_)
+    {
+        if (lane->active_)
+        {
+            lane->active_->restarted_ = false;
+            pathQueue_->queued_.insert(pathQueue_->queued_.begin(), lane->active_);
+            lane->active_ = nullptr;
+        }
+        lane->navMesh_ = nullptr;
+    }
+    pathQueue_->cache_.clear();
+    tileGraph_->Reset();
+
+    for (auto& item : streamingTiles_)
+        item.second->cancelled_ = true;
+    streamingTiles_.clear();
+    streamedTiles_.clear();
+    emptyStreamedTiles_.clear();
+
     dtFreeNavMesh(navMesh_);
     navMesh_ = nullptr;
 
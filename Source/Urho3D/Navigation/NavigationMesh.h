@@ -24,7 +24,9 @@
 
 #pragma once
 
+#include <EASTL/hash_set.h>
 #include <EASTL/unique_ptr.h>
+#include <EASTL/unordered_map.h>
 
 #include "../Math/BoundingBox.h"
 #include "../Math/Matrix3x4.h"
@@ -54,6 +56,11 @@ class NavArea;
 
 struct FindPathData;
 struct NavBuildData;
+struct NavigationAsyncBuild;
+struct NavigationPathQueue;
+struct NavigationTileBuildTask;
+struct NavigationTileGraph;
+struct NavigationStreamedTile;
 
 /// Description of a navigation mesh geometry component, with transform and bounds information.
 struct NavigationGeometryInfo
@@ -88,6 +95,9 @@ struct URHO3D_API NavigationPathPoint
     unsigned char areaID_;
 };
 
+/// Callback used to receive the result of an asynchronous path query. The path is empty if not found.
+using NavigationPathCallback = std::function<void(const ea::vector<NavigationPathPoint>& path)>;
+
 /// Navigation mesh component. Collects the navigation geometry from child nodes with the Navigable component and responds to path queries.
 class URHO3D_API NavigationMesh : public Component
 {
@@ -158,6 +168,34 @@ public:
     virtual bool Build(const BoundingBox& boundingBox);
     /// Rebuild part of the navigation mesh in the rectangular area. Return true if successful.
     virtual bool Build(const IntVector2& from, const IntVector2& to);
+    /// Rebuild part of the navigation mesh contained by the world-space bounding box on worker threads. Old tiles stay in use until the new ones are swapped in at the beginning of a frame. Return true if the build was queued.
+    virtual bool BuildAsync(const BoundingBox& boundingBox);
+    /// Rebuild part of the navigation mesh in the rectangular area on worker threads. Old tiles stay in use until the new ones are swapped in at the beginning of a frame. Return true if the build was queued.
+    virtual bool BuildAsync(const IntVector2& from, const IntVector2& to);
+    /// Cancel all pending asynchronous builds. Tiles that are already swapped in are kept.
+    virtual void CancelAsyncBuilds();
+    /// Return whether any asynchronous build is pending.
+    virtual bool IsBuildingAsync() const { return !asyncBuilds_.empty(); }
+    /// Set resource directory of the streamed tiles. When set, tiles are not stored in the navigation data attribute and should be loaded with LoadTilesAsync() or UpdateTileStreaming().
+    /// @property
+    void SetTileStreamingPath(const ea::string& path);
+    /// Return resource directory of the streamed tiles.
+    /// @property
+    const ea::string& GetTileStreamingPath() const { return tileStreamingPath_; }
+    /// Return resource name of the streamed tile.
+    ea::string GetStreamingTileName(const IntVector2& tile) const;
+    /// Save all tiles into separate files in the directory, to be used as streamed tile resources. Return true if successful.
+    bool SaveStreamingTiles(const ea::string& directory) const;
+    /// Read tiles in the rectangular area from the streamed tile resources on worker threads. Tiles are added at the beginning of a frame.
+    void LoadTilesAsync(const IntVector2& from, const IntVector2& to);
+    /// Remove tiles in the rectangular area and cancel their pending loads.
+    void UnloadTiles(const IntVector2& from, const IntVector2& to);
+    /// Load streamed tiles closer than load distance to any of the world space positions and unload streamed tiles farther than unload distance from all of them.
+    void UpdateTileStreaming(const ea::vector<Vector3>& positions, float loadDistance, float unloadDistance);
+    /// Return number of streamed tiles that are being loaded.
+    unsigned GetNumStreamingTiles() const { return streamingTiles_.size(); }
+    /// Return number of resident tiles loaded by streaming.
+    unsigned GetNumStreamedTiles() const { return streamedTiles_.size(); }
     /// Return tile data.
     virtual ea::vector<unsigned char> GetTileData(const IntVector2& tile) const;
     /// Add tile to navigation mesh.
@@ -185,6 +223,33 @@ public:
     void FindPath
         (ea::vector<NavigationPathPoint>& dest, const Vector3& start, const Vector3& end, const Vector3& extents = Vector3::ONE,
             const dtQueryFilter* filter = nullptr);
+    /// Queue a path query between world space points. Queued queries are processed in parallel at the beginning of a frame and the callback is invoked from the main thread when the path is found. Return query ID.
+    unsigned FindPathAsync(const Vector3& start, const Vector3& end, const NavigationPathCallback& callback,
+        const Vector3& extents = Vector3::ONE, const dtQueryFilter* filter = nullptr);
+    /// Cancel a path query. The callback will not be invoked.
+    void CancelPathQuery(unsigned queryId);
+    /// Set whether long paths are planned over the graph of tile portals first and then refined with local searches.
+    /// @property
+    void SetHierarchicalPathfinding(bool enable);
+    /// Set minimum distance in tiles between the start and the end of the path for hierarchical pathfinding to be used.
+    /// @property
+    void SetHierarchicalPathMinTiles(int numTiles);
+    /// Return whether hierarchical pathfinding is used for long paths.
+    /// @property
+    bool GetHierarchicalPathfinding() const { return hierarchicalPathfinding_; }
+    /// Return minimum distance in tiles for hierarchical pathfinding to be used.
+    /// @property
+    int GetHierarchicalPathMinTiles() const { return hierarchicalPathMinTiles_; }
+    /// Set maximum number of path search iterations per frame for each thread processing path queries. Unfinished queries continue in the next frame.
+    void SetMaxPathQueryIterations(unsigned iterations);
+    /// Set maximum number of polygon corridors cached for path queries with the same start and end polygons. Zero disables the cache.
+    void SetPathCacheSize(unsigned size);
+    /// Return maximum number of path search iterations per frame for each thread processing path queries.
+    unsigned GetMaxPathQueryIterations() const;
+    /// Return maximum number of cached polygon corridors.
+    unsigned GetPathCacheSize() const;
+    /// Return number of path queries that are not finished yet.
+    unsigned GetNumPendingPathQueries() const;
     /// Return a random point on the navigation mesh.
     Vector3 GetRandomPoint(const dtQueryFilter* filter = nullptr, dtPolyRef* randomRef = nullptr);
     /// Return a random point on the navigation mesh within a circle. The circle radius is only a guideline and in practice the returned point may be further away.
@@ -331,6 +396,35 @@ protected:
     virtual bool BuildTile(ea::vector<NavigationGeometryInfo>& geometryList, int x, int z);
     /// Build tiles in the rectangular area. Return number of built tiles.
     unsigned BuildTiles(ea::vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to);
+    /// Snapshot tile geometry and build settings so that the tile can be built outside of the main thread.
+    SharedPtr<NavigationTileBuildTask> PrepareTileBuild(ea::vector<NavigationGeometryInfo>& geometryList, int x, int z);
+    /// Replace the tile with the result of the build task. Return true if successful.
+    bool CommitTileBuild(NavigationTileBuildTask* task);
+    /// Convert world-space bounding box to the range of affected tiles.
+    void GetTileRange(const BoundingBox& boundingBox, IntVector2& from, IntVector2& to) const;
+    /// Send the event about finished asynchronous build.
+    void SendAsyncBuildFinishedEvent(const IntVector2& from, const IntVector2& to, unsigned numTiles);
+    /// Swap in the tiles of the finished asynchronous builds.
+    virtual void UpdateAsyncBuilds();
+    /// Add the streamed tiles that finished loading.
+    void UpdateStreamedTiles();
+    /// Process queued path queries in worker threads and invoke the callbacks of the finished ones.
+    void UpdatePathQueries();
+    /// Make a path point from the point in the navigation mesh space.
+    NavigationPathPoint MakePathPoint(const Vector3& localPosition, unsigned char flags, const Matrix3x4& transform) const;
+    /// Subscribe to or unsubscribe from frame begin depending on pending asynchronous work.
+    void UpdateBeginFrameSubscription();
+    /// Handle frame begin. Finish asynchronous builds and path queries.
+    void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+    /// Mark tiles in the rectangular area as changed so that their portals are updated before the next hierarchical search.
+    void MarkTileGraphDirty(const IntVector2& from, const IntVector2& to);
+    /// Build the tile graph or update its changed tiles.
+    void UpdateTileGraph();
+    /// Return length of the path between two points in the navigation mesh space, or negative value if there is no path.
+    float GetLocalPathCost(dtPolyRef startRef, dtPolyRef endRef, const Vector3& start, const Vector3& end, const dtQueryFilter* filter);
+    /// Find polygon corridor by searching the tile graph and refining the route between the portals. Return false if the path is too short or not found.
+    bool FindHierarchicalPath(ea::vector<dtPolyRef>& corridor, dtPolyRef startRef, dtPolyRef endRef, const Vector3& localStart,
+        const Vector3& localEnd, const dtQueryFilter* filter);
     /// Ensure that the navigation mesh query is initialized. Return true if successful.
     bool InitializeQuery();
     /// Release the navigation mesh and the query.
@@ -346,6 +440,10 @@ protected:
     ea::unique_ptr<dtQueryFilter> queryFilter_;
     /// Temporary data for finding a path.
     ea::unique_ptr<FindPathData> pathData_;
+    /// Asynchronous path queries.
+    ea::unique_ptr<NavigationPathQueue> pathQueue_;
+    /// Tile graph for hierarchical pathfinding.
+    ea::unique_ptr<NavigationTileGraph> tileGraph_;
     /// Tile size.
     int tileSize_;
     /// Cell size.
@@ -388,8 +486,22 @@ protected:
     bool drawOffMeshConnections_;
     /// Debug draw NavArea components.
     bool drawNavAreas_;
+    /// Whether to use hierarchical pathfinding for long paths.
+    bool hierarchicalPathfinding_;
+    /// Minimum distance in tiles for hierarchical pathfinding.
+    int hierarchicalPathMinTiles_;
     /// NavAreas for this NavMesh.
     ea::vector<WeakPtr<NavArea> > areas_;
+    /// Pending asynchronous builds in the order of submission.
+    ea::vector<SharedPtr<NavigationAsyncBuild> > asyncBuilds_;
+    /// Resource directory of the streamed tiles.
+    ea::string tileStreamingPath_;
+    /// Streamed tiles being loaded.
+    ea::unordered_map<IntVector2, SharedPtr<NavigationStreamedTile> > streamingTiles_;
+    /// Resident tiles loaded by streaming.
+    ea::hash_set<IntVector2> streamedTiles_;
+    /// Tiles without streamed data, or with data that could not be added. Not loaded again until they leave the streamed region or the streaming path changes.
+    ea::hash_set<IntVector2> emptyStreamedTiles_;
 };
 
 /// Register Navigation library objects.
@@ -22,6 +22,8 @@
 
 #include "../Precompiled.h"
 
+#include <EASTL/sort.h>
+
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
 #include "../IO/File.h"
@@ -32,6 +34,7 @@
 #include "../Network/Connection.h"
 #include "../Network/Network.h"
 #include "../Network/NetworkEvents.h"
+#include "../Network/NetworkInterestGrid.h"
 #include "../Network/NetworkPriority.h"
 #include "../Network/Protocol.h"
 #include "../Resource/ResourceCache.h"
@@ -57,6 +60,10 @@ namespace Urho3D
 {
 
 static const int STATS_INTERVAL_MSEC = 2000;
+/// Scheduling priority of dirty nodes without NetworkPriority, equal to the default NetworkPriority base priority.
+static const float DEFAULT_SCHEDULE_PRIORITY = 100.0f;
+/// Smallest scheduling priority, so that every deferred node eventually gets written.
+static const float MIN_SCHEDULE_PRIORITY = 1.0f;
 
 PackageDownload::PackageDownload() :
     totalFragments_(0),
@@ -200,6 +207,9 @@ void Connection::SetScene(Scene* newScene)
 
     scene_ = newScene;
     sceneLoaded_ = false;
+    relevantNodes_.clear();
+    relevancyFiltered_ = false;
+    nodeWaitPriorities_.clear();
     UnsubscribeFromEvent(E_ASYNCLOADFINISHED);
 
     if (!scene_)
@@ -266,16 +276,38 @@ void Connection::SetLogStatistics(bool enable)
     logStatistics_ = enable;
 }
 
+void Connection::SetUpdateBudget(unsigned bytes)
+{
+    updateBudget_ = bytes;
+}
+
+void Connection::ResetReplicationStats()
+{
+    replicationBytes_.clear();
+    totalDeferredNodes_ = 0;
+}
+
 void Connection::Disconnect(int waitMSec)
 {
     peer_->CloseConnection(*address_, true);
 }
 
 void Connection::SendServerUpdate()
+{
+    WriteServerUpdate();
+    FinishServerUpdate();
+}
+
+void Connection::WriteServerUpdate()
 {
     if (!scene_ || !sceneLoaded_)
         return;
 
+    // Collect the nodes near the observer position if interest management limits the relevancy radius
+    interestGrid_ = scene_->GetComponent<NetworkInterestGrid>();
+    UpdateRelevantNodes();
+    updateBytes_ = 0;
+
     // Always check the root node (scene) first so that the scene-wide components get sent first,
     // and all other replicated nodes get added to the dirty set for sending the initial state
     unsigned sceneID = scene_->GetID();
@@ -283,14 +315,96 @@ void Connection::SendServerUpdate()
     ProcessNode(sceneID);
 
     // Then go through all dirtied nodes
-    nodesToProcess_.insert(sceneState_.dirtyNodes_.begin(), sceneState_.dirtyNodes_.end());
-    nodesToProcess_.erase(sceneID); // Do not process the root node twice
+    if (updateBudget_)
+        ProcessScheduledNodes();
+    else
+    {
+        nodesToProcess_.insert(sceneState_.dirtyNodes_.begin(), sceneState_.dirtyNodes_.end());
+        nodesToProcess_.erase(sceneID); // Do not process the root node twice
 
-    while (nodesToProcess_.size())
+        while (nodesToProcess_.size())
+        {
+            unsigned nodeID = *nodesToProcess_.begin();
+            ProcessNode(nodeID);
+        }
+    }
+
+    interestGrid_ = nullptr;
+}
+
+void Connection::ProcessScheduledNodes()
+{
+    const unsigned sceneID = scene_->GetID();
+
+    // Every update a node stays dirty it accumulates its current priority, so that a deferred node rises in the order
+    // until it gets written
+    scheduledNodes_.clear();
+    for (unsigned nodeID : sceneState_.dirtyNodes_)
     {
-        unsigned nodeID = *nodesToProcess_.begin();
+        if (nodeID == sceneID)
+            continue;
+
+        float priority = DEFAULT_SCHEDULE_PRIORITY;
+        if (const NetworkInterestEntry* interest = interestGrid_ ? interestGrid_->GetEntry(nodeID) : nullptr)
+            priority = interest->priority_->GetPriority((interest->position_ - position_).Length());
+
+        float& waitPriority = nodeWaitPriorities_[nodeID];
+        waitPriority += Max(priority, MIN_SCHEDULE_PRIORITY);
+        scheduledNodes_.emplace_back(waitPriority, nodeID);
+    }
+
+    ea::sort(scheduledNodes_.begin(), scheduledNodes_.end(),
+        [](const ea::pair<float, unsigned>& lhs, const ea::pair<float, unsigned>& rhs)
+    {
+        return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+    });
+
+    // All dirty nodes may be processed as dependencies of the nodes that fit the budget
+    for (const auto& scheduled : scheduledNodes_)
+        nodesToProcess_.insert(scheduled.second);
+
+    numDeferredNodes_ = 0;
+    for (unsigned i = 0; i < scheduledNodes_.size(); ++i)
+    {
+        const unsigned nodeID = scheduledNodes_[i].second;
+
+        // Always process at least one node, so that a node larger than the budget can not stall replication
+        if (i > 0 && updateBytes_ >= updateBudget_)
+        {
+            if (nodesToProcess_.contains(nodeID))
+                ++numDeferredNodes_;
+            continue;
+        }
+
         ProcessNode(nodeID);
     }
+
+    nodesToProcess_.clear();
+    totalDeferredNodes_ += numDeferredNodes_;
+
+    // Nodes that are no longer dirty were written, or parked outside the relevancy radius
+    for (const auto& scheduled : scheduledNodes_)
+    {
+        if (!sceneState_.dirtyNodes_.contains(scheduled.second))
+            nodeWaitPriorities_.erase(scheduled.second);
+    }
+}
+
+void Connection::FinishServerUpdate()
+{
+    for (NodeReplicationState* nodeState : newNodeStates_)
+    {
+        if (Node* node = nodeState->node_)
+            node->AddReplicationState(nodeState);
+    }
+    for (ComponentReplicationState* componentState : newComponentStates_)
+    {
+        if (Component* component = componentState->component_)
+            component->AddReplicationState(componentState);
+    }
+
+    newNodeStates_.clear();
+    newComponentStates_.clear();
 }
 
 void Connection::SendClientUpdate()
@@ -365,23 +479,60 @@ void Connection::SendRemoteEvents()
 
 void Connection::SendPackages()
 {
-    while (!uploads_.empty())
+    if (uploads_.empty())
+        return;
+
+    URHO3D_PROFILE("SendPackages");
+
+    // Limit the amount of package data waiting in the send and resend buffers, so that uploads do not flood
+    // the reliable queue and other messages still get through
+    unsigned inFlight = outgoingBuffer_[PT_RELIABLE_UNORDERED].GetSize();
+    if (peer_)
     {
-        unsigned char buffer[PACKAGE_FRAGMENT_SIZE];
+        SLNet::RakNetStatistics stats{};
+        if (peer_->GetStatistics(address_->systemAddress, &stats))
+        {
+            double bytesInSendBuffer = 0.0;
+            for (double bytes : stats.bytesInSendBuffer)
+                bytesInSendBuffer += bytes;
+            inFlight += (unsigned)bytesInSendBuffer + (unsigned)stats.bytesInResendBuffer;
+        }
+    }
+
+    const unsigned window = GetSubsystem<Network>()->GetPackageUploadWindow();
+
+    // Send one fragment of each upload in turn. Uploads whose data has not been read yet continue on the next update
+    bool sent = true;
+    while (sent && inFlight < window && !uploads_.empty())
+    {
+        sent = false;
 
-        for (auto i = uploads_.begin(); i != uploads_.end();)
+        for (auto i = uploads_.begin(); i != uploads_.end() && inFlight < window;)
         {
             auto current = i++;
             PackageUpload& upload = current->second;
-            auto fragmentSize =
-                (unsigned)Min((int)(upload.file_->GetSize() - upload.file_->GetPosition()), (int)PACKAGE_FRAGMENT_SIZE);
-            upload.file_->Read(buffer, fragmentSize);
+
+            if (upload.source_->HasFailed())
+            {
+                // Send the name hash only to indicate a failed download
+                URHO3D_LOGERROR("Failed to transmit package file to client " + ToString());
+                msg_.Clear();
+                msg_.WriteStringHash(current->first);
+                SendMessage(MSG_PACKAGEDATA, true, false, msg_);
+                uploads_.erase(current);
+                continue;
+            }
 
             msg_.Clear();
             msg_.WriteStringHash(current->first);
-            msg_.WriteUInt(upload.fragment_++);
-            msg_.Write(buffer, fragmentSize);
+            msg_.WriteUInt(upload.fragment_);
+            if (!upload.source_->ReadFragment(upload.fragment_, msg_))
+                continue;
+
+            ++upload.fragment_;
             SendMessage(MSG_PACKAGEDATA, true, false, msg_);
+            inFlight += msg_.GetSize();
+            sent = true;
 
             // Check if upload finished
             if (upload.fragment_ == upload.totalFragments_)
@@ -845,9 +996,9 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
                         return;
                     }
 
-                    // Try to open the file now
-                    SharedPtr<File> file(new File(context_, packageFullName));
-                    if (!file->IsOpen())
+                    // Uploads of the same package to different clients share the file reads
+                    SharedPtr<PackageUploadSource> source = GetSubsystem<Network>()->GetPackageUploadSource(packageFullName);
+                    if (!source)
                     {
                         URHO3D_LOGERROR("Failed to transmit package file " + name);
                         SendPackageError(name);
@@ -856,9 +1007,10 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
 
                     URHO3D_LOGINFO("Transmitting package file " + name + " to client " + ToString());
 
-                    uploads_[nameHash].file_ = file;
-                    uploads_[nameHash].fragment_ = 0;
-                    uploads_[nameHash].totalFragments_ = (file->GetSize() + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
+                    PackageUpload& upload = uploads_[nameHash];
+                    upload.source_ = source;
+                    upload.fragment_ = 0;
+                    upload.totalFragments_ = source->GetNumFragments();
                     return;
                 }
             }
@@ -1233,7 +1385,7 @@ void Connection::ProcessNode(unsigned nodeID)
             // Note: we will send MSG_REMOVENODE redundantly for each node in the hierarchy, even if removing the root node
             // would be enough. However, this may be better due to the client not possibly having updated parenting
             // information at the time of receiving this message
-            SendMessage(MSG_REMOVENODE, true, true, msg_);
+            SendReplicationMessage(MSG_REMOVENODE, true, Node::GetTypeStatic());
             sceneState_.nodeStates_.erase(nodeID);
         }
         else
@@ -1253,6 +1405,56 @@ void Connection::ProcessNode(unsigned nodeID)
     }
 }
 
+void Connection::UpdateRelevantNodes()
+{
+    const bool filterRelevancy = interestGrid_ && interestGrid_->GetRelevancyRadius() > 0.0f;
+    const unsigned version = interestGrid_ ? interestGrid_->GetVersion() : 0;
+
+    // When the filtering is toggled or its settings change, reconsider all nodes skipped so far
+    if (filterRelevancy != relevancyFiltered_ || version != relevancyVersion_)
+    {
+        for (auto i = sceneState_.nodeStates_.begin(); i != sceneState_.nodeStates_.end(); ++i)
+        {
+            if (i->second.markedDirty_)
+                sceneState_.dirtyNodes_.insert(i->first);
+        }
+
+        relevantNodes_.clear();
+        relevancyFiltered_ = filterRelevancy;
+        relevancyVersion_ = version;
+    }
+
+    if (!filterRelevancy)
+        return;
+
+    // Nodes entering the radius, or losing their NetworkPriority, may have been skipped before
+    interestGrid_->GetRelevantNodes(relevantNodesBuffer_, position_);
+    for (unsigned nodeID : relevantNodesBuffer_)
+    {
+        if (!relevantNodes_.contains(nodeID))
+            RestoreDirtyNode(nodeID);
+    }
+    for (unsigned nodeID : interestGrid_->GetRemovedNodes())
+        RestoreDirtyNode(nodeID);
+
+    relevantNodes_.clear();
+    relevantNodes_.insert(relevantNodesBuffer_.begin(), relevantNodesBuffer_.end());
+}
+
+void Connection::RestoreDirtyNode(unsigned nodeID)
+{
+    auto i = sceneState_.nodeStates_.find(nodeID);
+    if (i != sceneState_.nodeStates_.end() && i->second.markedDirty_)
+        sceneState_.dirtyNodes_.insert(nodeID);
+}
+
+void Connection::SendReplicationMessage(int msgID, bool inOrder, StringHash objectType, unsigned contentID)
+{
+    SendMessage(msgID, true, inOrder, msg_, contentID);
+    updateBytes_ += msg_.GetSize();
+    replicationBytes_[objectType] += msg_.GetSize();
+}
+
 void Connection::ProcessNewNode(Node* node)
 {
     // Process depended upon nodes first, if they are dirty
@@ -1271,7 +1473,7 @@ void Connection::ProcessNewNode(Node* node)
     nodeState.connection_ = this;
     nodeState.sceneState_ = &sceneState_;
     nodeState.node_ = node;
-    node->AddReplicationState(&nodeState);
+    newNodeStates_.push_back(&nodeState);
 
     // Write node's attributes
     node->WriteInitialDeltaUpdate(msg_, timeStamp_);
@@ -1299,14 +1501,14 @@ void Connection::ProcessNewNode(Node* node)
         componentState.connection_ = this;
         componentState.nodeState_ = &nodeState;
         componentState.component_ = component;
-        component->AddReplicationState(&componentState);
+        newComponentStates_.push_back(&componentState);
 
         msg_.WriteStringHash(component->GetType());
         msg_.WriteNetID(component->GetID());
         component->WriteInitialDeltaUpdate(msg_, timeStamp_);
     }
 
-    SendMessage(MSG_CREATENODE, true, true, msg_);
+    SendReplicationMessage(MSG_CREATENODE, true, node->GetType());
 
     nodeState.markedDirty_ = false;
     sceneState_.dirtyNodes_.erase(node->GetID());
@@ -1323,14 +1525,25 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             ProcessNode(nodeID);
     }
 
-    // Check from the interest management component, if exists, whether should update
-    /// \todo Searching for the component is a potential CPU hotspot. It should be cached
-    auto* priority = node->GetComponent<NetworkPriority>();
-    if (priority && (!priority->GetAlwaysUpdateOwner() || node->GetOwner() != this))
+    // Check from the interest management grid whether should update, if the node has a NetworkPriority component
+    const NetworkInterestEntry* interest = interestGrid_ ? interestGrid_->GetEntry(node->GetID()) : nullptr;
+    if (interest)
     {
-        float distance = (node->GetWorldPosition() - position_).Length();
-        if (!priority->CheckUpdate(distance, nodeState.priorityAcc_))
-            return;
+        NetworkPriority* priority = interest->priority_;
+        if (!priority->GetAlwaysUpdateOwner() || node->GetOwner() != this)
+        {
+            // Outside the relevancy radius remove from the dirty set, but keep marked dirty so that PrepareNetworkUpdate()
+            // does not add it back. It is restored once it enters the radius
+            if (relevancyFiltered_ && !relevantNodes_.contains(node->GetID()))
+            {
+                sceneState_.dirtyNodes_.erase(node->GetID());
+                return;
+            }
+
+            float distance = (interest->position_ - position_).Length();
+            if (!priority->CheckUpdate(distance, nodeState.priorityAcc_))
+                return;
+        }
     }
 
     // Check if attributes have changed
@@ -1356,7 +1569,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             msg_.WriteNetID(node->GetID());
             node->WriteLatestDataUpdate(msg_, timeStamp_);
 
-            SendMessage(MSG_NODELATESTDATA, true, false, msg_, node->GetID());
+            SendReplicationMessage(MSG_NODELATESTDATA, false, node->GetType(), node->GetID());
         }
 
         // Send deltaupdate if remaining dirty bits, or vars have changed
@@ -1386,7 +1599,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 }
             }
 
-            SendMessage(MSG_NODEDELTAUPDATE, true, true, msg_);
+            SendReplicationMessage(MSG_NODEDELTAUPDATE, true, node->GetType());
 
             nodeState.dirtyAttributes_.ClearAll();
             nodeState.dirtyVars_.clear();
@@ -1406,7 +1619,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             msg_.Clear();
             msg_.WriteNetID(current->first);
 
-            SendMessage(MSG_REMOVECOMPONENT, true, true, msg_);
+            SendReplicationMessage(MSG_REMOVECOMPONENT, true, Component::GetTypeStatic());
             nodeState.componentStates_.erase(current);
         }
         else
@@ -1434,7 +1647,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                     msg_.WriteNetID(component->GetID());
                     component->WriteLatestDataUpdate(msg_, timeStamp_);
 
-                    SendMessage(MSG_COMPONENTLATESTDATA, true, false, msg_, component->GetID());
+                    SendReplicationMessage(MSG_COMPONENTLATESTDATA, false, component->GetType(), component->GetID());
                 }
 
                 // Send deltaupdate if remaining dirty bits
@@ -1444,7 +1657,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                     msg_.WriteNetID(component->GetID());
                     component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_, timeStamp_);
 
-                    SendMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
+                    SendReplicationMessage(MSG_COMPONENTDELTAUPDATE, true, component->GetType());
 
                     componentState.dirtyAttributes_.ClearAll();
                 }
@@ -1472,7 +1685,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 componentState.connection_ = this;
                 componentState.nodeState_ = &nodeState;
                 componentState.component_ = component;
-                component->AddReplicationState(&componentState);
+                newComponentStates_.push_back(&componentState);
 
                 msg_.Clear();
                 msg_.WriteNetID(node->GetID());
@@ -1480,7 +1693,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 msg_.WriteNetID(component->GetID());
                 component->WriteInitialDeltaUpdate(msg_, timeStamp_);
 
-                SendMessage(MSG_CREATECOMPONENT, true, true, msg_);
+                SendReplicationMessage(MSG_CREATECOMPONENT, true, component->GetType());
             }
         }
     }
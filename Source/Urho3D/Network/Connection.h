@@ -30,6 +30,7 @@
 #include "../Core/Timer.h"
 #include "../Input/Controls.h"
 #include "../IO/VectorBuffer.h"
+#include "../Network/PackageUploadSource.h"
 #include "../Scene/ReplicationState.h"
 
 namespace SLNet
@@ -47,6 +48,7 @@ namespace Urho3D
 
 class File;
 class MemoryBuffer;
+class NetworkInterestGrid;
 class Node;
 class Scene;
 class Serializable;
@@ -91,9 +93,9 @@ struct PackageUpload
     /// Construct with defaults.
     PackageUpload();
 
-    /// Source file.
-    SharedPtr<File> file_;
-    /// Current fragment index.
+    /// Shared package data source.
+    SharedPtr<PackageUploadSource> source_;
+    /// Next fragment index to send.
     unsigned fragment_;
     /// Total number of fragments.
     unsigned totalFragments_;
@@ -159,10 +161,19 @@ public:
     /// Set whether to log data in/out statistics.
     /// @property
     void SetLogStatistics(bool enable);
+    /// Set the maximum bytes of replication messages written per server update. Dirty nodes are written in the order of their accumulated priority, and the ones over the budget are deferred to later updates. 0 (default) is unlimited.
+    /// @property
+    void SetUpdateBudget(unsigned bytes);
+    /// Reset the replication byte and deferred node statistics.
+    void ResetReplicationStats();
     /// Disconnect. If wait time is non-zero, will block while waiting for disconnect to finish.
     void Disconnect(int waitMSec = 0);
     /// Send scene update messages. Called by Network.
     void SendServerUpdate();
+    /// Write scene update messages without modifying the scene. Different connections may be written from worker threads concurrently. Called by Network.
+    void WriteServerUpdate();
+    /// Register the replication states created by WriteServerUpdate() to the replicated objects. Called by Network from the main thread.
+    void FinishServerUpdate();
     /// Send latest controls from the client. Called by Network.
     void SendClientUpdate();
     /// Send queued remote events. Called by Network.
@@ -224,6 +235,21 @@ public:
     /// @property
     bool GetLogStatistics() const { return logStatistics_; }
 
+    /// Return the maximum bytes of replication messages written per server update.
+    /// @property
+    unsigned GetUpdateBudget() const { return updateBudget_; }
+
+    /// Return replication message bytes written by node or component type since the statistics were reset.
+    const ea::unordered_map<StringHash, unsigned>& GetReplicationBytes() const { return replicationBytes_; }
+
+    /// Return number of dirty nodes deferred in the last server update due to the update budget.
+    /// @property
+    unsigned GetNumDeferredNodes() const { return numDeferredNodes_; }
+
+    /// Return total number of node deferrals due to the update budget since the statistics were reset.
+    /// @property
+    unsigned GetTotalDeferredNodes() const { return totalDeferredNodes_; }
+
     /// Return remote address.
     /// @property
     ea::string GetAddress() const;
@@ -301,12 +327,20 @@ private:
     void ProcessSceneLoaded(int msgID, MemoryBuffer& msg);
     /// Process a remote event message from the client or server. Called by Network.
     void ProcessRemoteEvent(int msgID, MemoryBuffer& msg);
+    /// Process the dirty nodes in the order of their accumulated priority until the update budget is used.
+    void ProcessScheduledNodes();
     /// Process a node for sending a network update. Recurses to process depended on node(s) first.
     void ProcessNode(unsigned nodeID);
     /// Process a node that the client has not yet received.
     void ProcessNewNode(Node* node);
     /// Process a node that the client has already received.
     void ProcessExistingNode(Node* node, NodeReplicationState& nodeState);
+    /// Update the set of nodes within the interest management relevancy radius.
+    void UpdateRelevantNodes();
+    /// Add a node skipped while outside the relevancy radius back to the dirty set.
+    void RestoreDirtyNode(unsigned nodeID);
+    /// Send a replication message from the message buffer and count its bytes to the update budget and statistics.
+    void SendReplicationMessage(int msgID, bool inOrder, StringHash objectType, unsigned contentID = 0);
     /// Process a SyncPackagesInfo message from server.
     void ProcessPackageInfo(int msgID, MemoryBuffer& msg);
     /// Process unknown message. All unknown messages are forwarded as an events
@@ -338,6 +372,34 @@ private:
     ea::unordered_map<unsigned, ea::vector<unsigned char> > componentLatestData_;
     /// Node ID's to process during a replication update.
     ea::hash_set<unsigned> nodesToProcess_;
+    /// Node replication states created during a replication update, registered to the nodes when it finishes.
+    ea::vector<NodeReplicationState*> newNodeStates_;
+    /// Component replication states created during a replication update, registered to the components when it finishes.
+    ea::vector<ComponentReplicationState*> newComponentStates_;
+    /// Interest management grid of the scene during a replication update.
+    NetworkInterestGrid* interestGrid_{};
+    /// Node IDs within the interest management relevancy radius.
+    ea::hash_set<unsigned> relevantNodes_;
+    /// Reusable buffer for querying the relevant nodes.
+    ea::vector<unsigned> relevantNodesBuffer_;
+    /// Interest management grid settings version the relevant nodes were collected with.
+    unsigned relevancyVersion_{};
+    /// Whether nodes outside the relevancy radius were skipped in the previous replication update.
+    bool relevancyFiltered_{};
+    /// Dirty nodes and their accumulated priorities, sorted for a budgeted replication update.
+    ea::vector<ea::pair<float, unsigned> > scheduledNodes_;
+    /// Priorities accumulated by dirty nodes while waiting to be written under the update budget.
+    ea::unordered_map<unsigned, float> nodeWaitPriorities_;
+    /// Replication message bytes by node or component type.
+    ea::unordered_map<StringHash, unsigned> replicationBytes_;
+    /// Maximum replication message bytes per server update, 0 for unlimited.
+    unsigned updateBudget_{};
+    /// Replication message bytes written during the current server update.
+    unsigned updateBytes_{};
+    /// Number of nodes deferred in the last server update.
+    unsigned numDeferredNodes_{};
+    /// Total number of node deferrals.
+    unsigned totalDeferredNodes_{};
     /// Reusable message buffer.
     VectorBuffer msg_;
     /// Queued remote events.
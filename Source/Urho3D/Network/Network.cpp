@@ -25,6 +25,7 @@
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Engine/EngineEvents.h"
 #include "../IO/FileSystem.h"
 #include "../Input/InputEvents.h"
@@ -34,6 +35,7 @@
 #include "../Network/HttpRequest.h"
 #include "../Network/Network.h"
 #include "../Network/NetworkEvents.h"
+#include "../Network/NetworkInterestGrid.h"
 #include "../Network/NetworkPriority.h"
 #include "../Network/Protocol.h"
 #include "../Scene/Scene.h"
@@ -192,6 +194,7 @@ static const char* RAKNET_MESSAGEID_STRINGS[] = {
 
 static const int DEFAULT_UPDATE_FPS = 30;
 static const int SERVER_TIMEOUT_TIME = 10000;
+static const unsigned DEFAULT_PACKAGE_UPLOAD_WINDOW = 256 * 1024;
 
 Network::Network(Context* context) :
     Object(context),
@@ -200,6 +203,8 @@ Network::Network(Context* context) :
     simulatedPacketLoss_(0.0f),
     updateInterval_(1.0f / (float)DEFAULT_UPDATE_FPS),
     updateAcc_(0.0f),
+    threadedServerUpdate_(false),
+    packageUploadWindow_(DEFAULT_PACKAGE_UPLOAD_WINDOW),
     isServer_(false),
     scene_(nullptr),
     natPunchServerAddress_(nullptr),
@@ -577,6 +582,16 @@ void Network::SetUpdateFps(int fps)
     updateAcc_ = 0.0f;
 }
 
+void Network::SetThreadedServerUpdate(bool enable)
+{
+    threadedServerUpdate_ = enable;
+}
+
+void Network::SetPackageUploadWindow(unsigned bytes)
+{
+    packageUploadWindow_ = Max(bytes, PACKAGE_FRAGMENT_SIZE);
+}
+
 void Network::SetSimulatedLatency(int ms)
 {
     simulatedLatency_ = Max(ms, 0);
@@ -690,6 +705,22 @@ bool Network::CheckRemoteEvent(StringHash eventType) const
     return allowedRemoteEvents_.contains(eventType);
 }
 
+SharedPtr<PackageUploadSource> Network::GetPackageUploadSource(const ea::string& fileName)
+{
+    SharedPtr<PackageUploadSource>& source = packageUploadSources_[fileName];
+    if (!source)
+    {
+        source = MakeShared<PackageUploadSource>(context_, fileName);
+        if (!source->IsOpen())
+        {
+            packageUploadSources_.erase(fileName);
+            return nullptr;
+        }
+    }
+
+    return source;
+}
+
 void Network::HandleIncomingPacket(SLNet::Packet* packet, bool isServer)
 {
     unsigned char packetID = packet->data[0];
@@ -937,21 +968,21 @@ void Network::PostUpdate(float timeStep)
                 }
 
                 for (auto i = networkScenes_.begin(); i != networkScenes_.end(); ++i)
+                {
                     (*i)->PrepareNetworkUpdate();
-            }
-
-            {
-                URHO3D_PROFILE("SendServerUpdate");
 
-                // Then send server updates for each client connection
-                for (auto i = clientConnections_.begin(); i != clientConnections_.end(); ++i)
-                {
-                    i->second->SendServerUpdate();
-                    i->second->SendRemoteEvents();
-                    i->second->SendPackages();
-                    i->second->SendAllBuffers();
+                    // Interest management is needed on the server only, so the grid is not replicated nor saved
+                    auto* interestGrid = (*i)->GetComponent<NetworkInterestGrid>();
+                    if (!interestGrid)
+                    {
+                        interestGrid = (*i)->CreateComponent<NetworkInterestGrid>(LOCAL);
+                        interestGrid->SetTemporary(true);
+                    }
+                    interestGrid->Update();
                 }
             }
+
+            SendServerUpdates();
         }
 
         if (serverConnection_)
@@ -967,6 +998,77 @@ void Network::PostUpdate(float timeStep)
     }
 }
 
+void Network::SendServerUpdates()
+{
+    URHO3D_PROFILE("SendServerUpdate");
+
+    auto* workQueue = GetSubsystem<WorkQueue>();
+    if (!threadedServerUpdate_ || !workQueue || workQueue->GetNumThreads() == 0 || clientConnections_.size() < 2)
+    {
+        // Send server updates for each client connection
+        for (auto i = clientConnections_.begin(); i != clientConnections_.end(); ++i)
+        {
+            i->second->SendServerUpdate();
+            i->second->SendRemoteEvents();
+            i->second->SendPackages();
+            i->second->SendAllBuffers();
+        }
+        UpdatePackageUploadSources();
+        return;
+    }
+
+    // Write and send the updates of the connections in parallel. The scene is only read during this phase,
+    // the replication states created by the connections are registered to the scene objects afterwards
+    serverUpdateConnections_.clear();
+    for (auto i = clientConnections_.begin(); i != clientConnections_.end(); ++i)
+        serverUpdateConnections_.push_back(i->second);
+
+    const unsigned numItems = Min(serverUpdateConnections_.size(), workQueue->GetNumThreads() + 1);
+    const unsigned connectionsPerItem = (serverUpdateConnections_.size() + numItems - 1) / numItems;
+    for (unsigned i = 0; i < numItems; ++i)
+    {
+        SharedPtr<WorkItem> item = workQueue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = [](const WorkItem* item, unsigned /*threadIndex*/)
+        {
+            auto** start = static_cast<Connection**>(item->start_);
+            auto** end = static_cast<Connection**>(item->end_);
+            for (Connection** connection = start; connection != end; ++connection)
+            {
+                (*connection)->WriteServerUpdate();
+                (*connection)->SendRemoteEvents();
+                (*connection)->SendPackages();
+                (*connection)->SendAllBuffers();
+            }
+        };
+        item->start_ = serverUpdateConnections_.data() + Min(i * connectionsPerItem, serverUpdateConnections_.size());
+        item->end_ = serverUpdateConnections_.data() + Min((i + 1) * connectionsPerItem, serverUpdateConnections_.size());
+        workQueue->AddWorkItem(item);
+    }
+    workQueue->Complete(M_MAX_UNSIGNED);
+
+    for (Connection* connection : serverUpdateConnections_)
+        connection->FinishServerUpdate();
+    serverUpdateConnections_.clear();
+
+    UpdatePackageUploadSources();
+}
+
+void Network::UpdatePackageUploadSources()
+{
+    for (auto i = packageUploadSources_.begin(); i != packageUploadSources_.end();)
+    {
+        // Close the packages no longer uploaded to any client
+        if (i->second->Refs() == 1)
+            i = packageUploadSources_.erase(i);
+        else
+        {
+            i->second->Update();
+            ++i;
+        }
+    }
+}
+
 void Network::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     using namespace BeginFrame;
@@ -1035,6 +1137,7 @@ unsigned long Network::GetEndpointHash(const SLNet::AddressOrGUID& endpoint)
 void RegisterNetworkLibrary(Context* context)
 {
     NetworkPriority::RegisterObject(context);
+    NetworkInterestGrid::RegisterObject(context);
     Connection::RegisterObject(context);
 }
 
@@ -89,6 +89,12 @@ public:
     /// Set network update FPS.
     /// @property
     void SetUpdateFps(int fps);
+    /// Set whether client connections are updated on WorkQueue threads in parallel. Disabled by default, has effect only when worker threads exist.
+    /// @property
+    void SetThreadedServerUpdate(bool enable);
+    /// Set maximum number of bytes per connection waiting to be sent or acknowledged before package uploads pause. Default 256 KB.
+    /// @property
+    void SetPackageUploadWindow(unsigned bytes);
     /// Set simulated latency in milliseconds. This adds a fixed delay before sending each packet.
     /// @property
     void SetSimulatedLatency(int ms);
@@ -114,6 +120,14 @@ public:
     /// @property
     int GetUpdateFps() const { return updateFps_; }
 
+    /// Return whether client connections are updated on WorkQueue threads in parallel.
+    /// @property
+    bool GetThreadedServerUpdate() const { return threadedServerUpdate_; }
+
+    /// Return maximum number of bytes per connection waiting to be sent or acknowledged before package uploads pause.
+    /// @property
+    unsigned GetPackageUploadWindow() const { return packageUploadWindow_; }
+
     /// Return simulated latency in milliseconds.
     /// @property
     int GetSimulatedLatency() const { return simulatedLatency_; }
@@ -139,6 +153,8 @@ public:
     /// Return the package download cache directory.
     /// @property
     const ea::string& GetPackageCacheDir() const { return packageCacheDir_; }
+    /// Return the shared upload source of a package file, opening it if not in use yet. Return null if the file can not be opened.
+    SharedPtr<PackageUploadSource> GetPackageUploadSource(const ea::string& fileName);
 
     /// Process incoming messages from connections. Called by HandleBeginFrame.
     void Update(float timeStep);
@@ -154,6 +170,10 @@ private:
     void OnServerConnected(const SLNet::AddressOrGUID& address);
     /// Handle server disconnection.
     void OnServerDisconnected(const SLNet::AddressOrGUID& address);
+    /// Send scene updates, remote events and packages to all client connections.
+    void SendServerUpdates();
+    /// Read the blocks requested by package uploads and close the packages no longer in use.
+    void UpdatePackageUploadSources();
     /// Reconfigure network simulator parameters on all existing connections.
     void ConfigureNetworkSimulator();
     /// All incoming packages are handled here.
@@ -185,8 +205,16 @@ private:
     float updateInterval_;
     /// Update time accumulator.
     float updateAcc_;
+    /// Whether client connections are updated in parallel.
+    bool threadedServerUpdate_;
+    /// Client connections being updated in parallel.
+    ea::vector<Connection*> serverUpdateConnections_;
     /// Package cache directory.
     ea::string packageCacheDir_;
+    /// Package upload sources in use by file name.
+    ea::unordered_map<ea::string, SharedPtr<PackageUploadSource> > packageUploadSources_;
+    /// Package upload window in bytes per connection.
+    unsigned packageUploadWindow_;
     /// Whether we started as server or not.
     bool isServer_;
     /// Server/Client password used for connecting.
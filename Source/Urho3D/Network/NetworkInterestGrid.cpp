@@ -0,0 +1,278 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Network/NetworkInterestGrid.h"
+#include "../Network/NetworkPriority.h"
+#include "../Scene/Scene.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+extern const char* NETWORK_CATEGORY;
+
+static const float DEFAULT_CELL_SIZE = 50.0f;
+static const float DEFAULT_RELEVANCY_RADIUS = 0.0f;
+static const float MIN_CELL_SIZE = 1.0f;
+
+NetworkInterestGrid::NetworkInterestGrid(Context* context) :
+    Component(context),
+    cellSize_(DEFAULT_CELL_SIZE),
+    relevancyRadius_(DEFAULT_RELEVANCY_RADIUS)
+{
+}
+
+NetworkInterestGrid::~NetworkInterestGrid()
+{
+    for (auto i = entries_.begin(); i != entries_.end(); ++i)
+        i->second.priority_->SetInterestGrid(nullptr);
+}
+
+void NetworkInterestGrid::RegisterObject(Context* context)
+{
+    context->RegisterFactory<NetworkInterestGrid>(NETWORK_CATEGORY);
+
+    URHO3D_ACCESSOR_ATTRIBUTE("Cell Size", GetCellSize, SetCellSize, float, DEFAULT_CELL_SIZE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Relevancy Radius", GetRelevancyRadius, SetRelevancyRadius, float, DEFAULT_RELEVANCY_RADIUS, AM_DEFAULT);
+}
+
+void NetworkInterestGrid::SetCellSize(float size)
+{
+    size = Max(size, MIN_CELL_SIZE);
+    if (size != cellSize_)
+    {
+        cellSize_ = size;
+        RebuildCells();
+        ++version_;
+    }
+}
+
+void NetworkInterestGrid::SetRelevancyRadius(float radius)
+{
+    radius = Max(radius, 0.0f);
+    if (radius != relevancyRadius_)
+    {
+        relevancyRadius_ = radius;
+        ++version_;
+    }
+}
+
+void NetworkInterestGrid::AddPriority(NetworkPriority* priority)
+{
+    Node* node = priority ? priority->GetNode() : nullptr;
+    if (!node)
+        return;
+
+    priority->SetInterestGrid(this);
+
+    const unsigned nodeID = node->GetID();
+    auto i = entries_.find(nodeID);
+    if (i != entries_.end())
+    {
+        i->second.priority_ = priority;
+        return;
+    }
+
+    NetworkInterestEntry& entry = entries_[nodeID];
+    entry.priority_ = priority;
+    entry.position_ = node->GetWorldPosition();
+    entry.cell_ = GetCell(entry.position_);
+    cells_[entry.cell_].push_back(nodeID);
+}
+
+void NetworkInterestGrid::RemovePriority(NetworkPriority* priority)
+{
+    Node* node = priority ? priority->GetNode() : nullptr;
+    if (!node)
+        return;
+
+    const unsigned nodeID = node->GetID();
+    auto i = entries_.find(nodeID);
+    if (i == entries_.end() || i->second.priority_ != priority)
+        return;
+
+    RemoveFromCell(i->second.cell_, nodeID);
+    entries_.erase(i);
+    pendingRemovedNodes_.push_back(nodeID);
+}
+
+void NetworkInterestGrid::MarkPriorityDirty(NetworkPriority* priority)
+{
+    Node* node = priority->GetNode();
+    if (!node)
+        return;
+
+    const unsigned nodeID = node->GetID();
+    auto i = entries_.find(nodeID);
+    if (i != entries_.end() && !i->second.dirty_)
+    {
+        i->second.dirty_ = true;
+        dirtyNodes_.push_back(nodeID);
+    }
+}
+
+void NetworkInterestGrid::Update()
+{
+    URHO3D_PROFILE("UpdateNetworkInterestGrid");
+
+    for (unsigned nodeID : dirtyNodes_)
+    {
+        auto i = entries_.find(nodeID);
+        if (i == entries_.end())
+            continue;
+
+        NetworkInterestEntry& entry = i->second;
+        entry.dirty_ = false;
+        entry.position_ = entry.priority_->GetNode()->GetWorldPosition();
+
+        const IntVector3 cell = GetCell(entry.position_);
+        if (cell != entry.cell_)
+        {
+            RemoveFromCell(entry.cell_, nodeID);
+            cells_[cell].push_back(nodeID);
+            entry.cell_ = cell;
+        }
+    }
+    dirtyNodes_.clear();
+
+    // Expose the removals since the previous update to the connections for this update
+    removedNodes_.clear();
+    removedNodes_.swap(pendingRemovedNodes_);
+}
+
+const NetworkInterestEntry* NetworkInterestGrid::GetEntry(unsigned nodeID) const
+{
+    auto i = entries_.find(nodeID);
+    return i != entries_.end() ? &i->second : nullptr;
+}
+
+void NetworkInterestGrid::GetRelevantNodes(ea::vector<unsigned>& result, const Vector3& position) const
+{
+    result.clear();
+
+    const Vector3 radius(relevancyRadius_, relevancyRadius_, relevancyRadius_);
+    const IntVector3 minCell = GetCell(position - radius);
+    const IntVector3 maxCell = GetCell(position + radius);
+    const float radiusSquared = relevancyRadius_ * relevancyRadius_;
+
+    const auto addCellNodes = [&](const ea::vector<unsigned>& nodeIDs)
+    {
+        for (unsigned nodeID : nodeIDs)
+        {
+            const NetworkInterestEntry& entry = entries_.find(nodeID)->second;
+            if ((entry.position_ - position).LengthSquared() <= radiusSquared)
+                result.push_back(nodeID);
+        }
+    };
+
+    // If the radius covers more cells than are occupied, check the occupied cells instead
+    const unsigned long long numCells = static_cast<unsigned long long>(maxCell.x_ - minCell.x_ + 1)
+        * static_cast<unsigned long long>(maxCell.y_ - minCell.y_ + 1) * static_cast<unsigned long long>(maxCell.z_ - minCell.z_ + 1);
+    if (numCells > cells_.size())
+    {
+        for (auto i = cells_.begin(); i != cells_.end(); ++i)
+        {
+            const IntVector3& cell = i->first;
+            if (cell.x_ >= minCell.x_ && cell.x_ <= maxCell.x_ && cell.y_ >= minCell.y_ && cell.y_ <= maxCell.y_
+                && cell.z_ >= minCell.z_ && cell.z_ <= maxCell.z_)
+                addCellNodes(i->second);
+        }
+        return;
+    }
+
+    for (int z = minCell.z_; z <= maxCell.z_; ++z)
+    {
+        for (int y = minCell.y_; y <= maxCell.y_; ++y)
+        {
+            for (int x = minCell.x_; x <= maxCell.x_; ++x)
+            {
+                auto i = cells_.find(IntVector3(x, y, z));
+                if (i != cells_.end())
+                    addCellNodes(i->second);
+            }
+        }
+    }
+}
+
+void NetworkInterestGrid::OnSceneSet(Scene* scene)
+{
+    if (scene)
+    {
+        ea::vector<NetworkPriority*> priorities;
+        scene->GetComponents<NetworkPriority>(priorities, true);
+        for (NetworkPriority* priority : priorities)
+            AddPriority(priority);
+    }
+    else
+    {
+        for (auto i = entries_.begin(); i != entries_.end(); ++i)
+        {
+            i->second.priority_->SetInterestGrid(nullptr);
+            pendingRemovedNodes_.push_back(i->first);
+        }
+        entries_.clear();
+        cells_.clear();
+        dirtyNodes_.clear();
+    }
+}
+
+IntVector3 NetworkInterestGrid::GetCell(const Vector3& position) const
+{
+    return VectorFloorToInt(position / cellSize_);
+}
+
+void NetworkInterestGrid::RemoveFromCell(const IntVector3& cell, unsigned nodeID)
+{
+    auto i = cells_.find(cell);
+    if (i == cells_.end())
+        return;
+
+    ea::vector<unsigned>& nodeIDs = i->second;
+    auto j = ea::find(nodeIDs.begin(), nodeIDs.end(), nodeID);
+    if (j != nodeIDs.end())
+    {
+        *j = nodeIDs.back();
+        nodeIDs.pop_back();
+    }
+
+    if (nodeIDs.empty())
+        cells_.erase(i);
+}
+
+void NetworkInterestGrid::RebuildCells()
+{
+    cells_.clear();
+    for (auto i = entries_.begin(); i != entries_.end(); ++i)
+    {
+        NetworkInterestEntry& entry = i->second;
+        entry.cell_ = GetCell(entry.position_);
+        cells_[entry.cell_].push_back(i->first);
+    }
+}
+
+}
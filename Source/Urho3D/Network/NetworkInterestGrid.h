@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Math/Vector3.h"
+#include "../Scene/Component.h"
+
+#include <EASTL/unordered_map.h>
+
+namespace Urho3D
+{
+
+class NetworkPriority;
+
+/// Interest management entry of a node with a NetworkPriority component.
+struct NetworkInterestEntry
+{
+    /// Network priority component.
+    NetworkPriority* priority_{};
+    /// World position at the last update.
+    Vector3 position_;
+    /// Grid cell.
+    IntVector3 cell_;
+    /// Whether the position needs to be updated.
+    bool dirty_{};
+};
+
+/// %Network interest management spatial grid. Created by Network as a temporary local component to the scene root when the scene is served.
+class URHO3D_API NetworkInterestGrid : public Component
+{
+    URHO3D_OBJECT(NetworkInterestGrid, Component);
+
+public:
+    /// Construct.
+    explicit NetworkInterestGrid(Context* context);
+    /// Destruct.
+    ~NetworkInterestGrid() override;
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Set grid cell size. Default 50.
+    /// @property
+    void SetCellSize(float size);
+    /// Set relevancy radius around the connection observer position. Nodes outside of it are not updated. Default 0 (no limit).
+    /// @property
+    void SetRelevancyRadius(float radius);
+
+    /// Return grid cell size.
+    /// @property
+    float GetCellSize() const { return cellSize_; }
+
+    /// Return relevancy radius.
+    /// @property
+    float GetRelevancyRadius() const { return relevancyRadius_; }
+
+    /// Add a network priority component. Called by NetworkPriority.
+    void AddPriority(NetworkPriority* priority);
+    /// Remove a network priority component. Called by NetworkPriority.
+    void RemovePriority(NetworkPriority* priority);
+    /// Mark the position of a network priority component's node changed. Called by NetworkPriority.
+    void MarkPriorityDirty(NetworkPriority* priority);
+    /// Update the positions of the moved nodes. Called by Network before sending the server update.
+    void Update();
+
+    /// Return the interest entry of a node, or null if it has no NetworkPriority. May be called from worker threads during the server update.
+    const NetworkInterestEntry* GetEntry(unsigned nodeID) const;
+    /// Return IDs of the nodes within the relevancy radius of a position. May be called from worker threads during the server update.
+    void GetRelevantNodes(ea::vector<unsigned>& result, const Vector3& position) const;
+    /// Return IDs of the nodes that were removed from the grid since the previous update.
+    const ea::vector<unsigned>& GetRemovedNodes() const { return removedNodes_; }
+    /// Return settings version, incremented whenever the cell size or relevancy radius changes.
+    unsigned GetVersion() const { return version_; }
+
+protected:
+    /// Handle scene being assigned. Registers the NetworkPriority components already in the scene.
+    void OnSceneSet(Scene* scene) override;
+
+private:
+    /// Return cell of a position.
+    IntVector3 GetCell(const Vector3& position) const;
+    /// Remove a node from a cell.
+    void RemoveFromCell(const IntVector3& cell, unsigned nodeID);
+    /// Rebuild all cells after the cell size changed.
+    void RebuildCells();
+
+    /// Entries by node ID.
+    ea::unordered_map<unsigned, NetworkInterestEntry> entries_;
+    /// Node IDs by cell.
+    ea::unordered_map<IntVector3, ea::vector<unsigned> > cells_;
+    /// Node IDs with changed positions.
+    ea::vector<unsigned> dirtyNodes_;
+    /// Node IDs removed since the previous update.
+    ea::vector<unsigned> pendingRemovedNodes_;
+    /// Node IDs removed before the current update.
+    ea::vector<unsigned> removedNodes_;
+    /// Grid cell size.
+    float cellSize_;
+    /// Relevancy radius.
+    float relevancyRadius_;
+    /// Settings version.
+    unsigned version_{};
+};
+
+}
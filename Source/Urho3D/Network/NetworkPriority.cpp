@@ -23,7 +23,9 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Network/NetworkInterestGrid.h"
 #include "../Network/NetworkPriority.h"
+#include "../Scene/Scene.h"
 
 #include "../DebugNew.h"
 
@@ -46,7 +48,11 @@ NetworkPriority::NetworkPriority(Context* context) :
 {
 }
 
-NetworkPriority::~NetworkPriority() = default;
+NetworkPriority::~NetworkPriority()
+{
+    if (interestGrid_)
+        interestGrid_->RemovePriority(this);
+}
 
 void NetworkPriority::RegisterObject(Context* context)
 {
@@ -82,10 +88,46 @@ void NetworkPriority::SetAlwaysUpdateOwner(bool enable)
     MarkNetworkUpdate();
 }
 
+void NetworkPriority::OnNodeSet(Node* node)
+{
+    if (node)
+        node->AddListener(this);
+}
+
+void NetworkPriority::OnSceneSet(Scene* scene)
+{
+    if (scene)
+    {
+        // The grid exists only on the server. If the scene is not served yet, the grid registers this when created
+        if (auto* interestGrid = scene->GetComponent<NetworkInterestGrid>())
+            interestGrid->AddPriority(this);
+    }
+    else if (interestGrid_)
+    {
+        interestGrid_->RemovePriority(this);
+        interestGrid_ = nullptr;
+    }
+}
+
+void NetworkPriority::OnMarkedDirty(Node* node)
+{
+    if (!interestGrid_)
+        return;
+
+    // The grid is not safe to modify from worker threads
+    Scene* scene = GetScene();
+    if (scene && scene->IsThreadedUpdate())
+    {
+        scene->DelayedMarkedDirty(this);
+        return;
+    }
+
+    interestGrid_->MarkPriorityDirty(this);
+}
+
 bool NetworkPriority::CheckUpdate(float distance, float& accumulator)
 {
-    float currentPriority = Max(basePriority_ - distanceFactor_ * distance, minPriority_);
-    accumulator += currentPriority;
+    accumulator += GetPriority(distance);
     if (accumulator >= UPDATE_THRESHOLD)
     {
         accumulator = fmodf(accumulator, UPDATE_THRESHOLD);
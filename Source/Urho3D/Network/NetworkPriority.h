@@ -27,6 +27,8 @@
 namespace Urho3D
 {
 
+class NetworkInterestGrid;
+
 /// %Network interest management settings component.
 class URHO3D_API NetworkPriority : public Component
 {
@@ -69,10 +71,24 @@ public:
     /// @property
     bool GetAlwaysUpdateOwner() const { return alwaysUpdateOwner_; }
 
+    /// Return the current priority at a distance from the observer.
+    float GetPriority(float distance) const { return Max(basePriority_ - distanceFactor_ * distance, minPriority_); }
     /// Increment and check priority accumulator. Return true if should update. Called by Connection.
     bool CheckUpdate(float distance, float& accumulator);
+    /// Set the interest management grid the node is registered to. Called by NetworkInterestGrid.
+    void SetInterestGrid(NetworkInterestGrid* interestGrid) { interestGrid_ = interestGrid; }
+
+protected:
+    /// Handle node being assigned.
+    void OnNodeSet(Node* node) override;
+    /// Handle scene being assigned.
+    void OnSceneSet(Scene* scene) override;
+    /// Handle node transform being dirtied.
+    void OnMarkedDirty(Node* node) override;
 
 private:
+    /// Interest management grid of the scene.
+    WeakPtr<NetworkInterestGrid> interestGrid_;
     /// Base priority.
     float basePriority_;
     /// Priority reduction distance factor.
@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include <EASTL/sort.h>
+
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Core/Timer.h"
+#include "../Core/WorkQueue.h"
+#include "../IO/Log.h"
+#include "../Network/PackageUploadSource.h"
+#include "../Network/Protocol.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Number of fragments in a block read at once.
+static const unsigned FRAGMENTS_PER_BLOCK = 64;
+/// Number of updates a block stays in memory after the last access.
+static const unsigned BLOCK_EXPIRE_UPDATES = 60;
+/// Maximum number of blocks in memory per package.
+static const unsigned MAX_BLOCKS = 64;
+
+PackageUploadSource::PackageUploadSource(Context* context, const ea::string& fileName) :
+    workQueue_(context->GetSubsystem<WorkQueue>()),
+    file_(MakeShared<File>(context, fileName))
+{
+    if (file_->IsOpen())
+    {
+        size_ = file_->GetSize();
+        numFragments_ = (size_ + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
+    }
+}
+
+PackageUploadSource::~PackageUploadSource()
+{
+    for (auto& pair : blocks_)
+    {
+        Block* block = pair.second.get();
+        if (!block->item_ || block->ready_)
+            continue;
+
+        // The read can not be cancelled once started, wait for it to finish before freeing the block
+        if (!workQueue_ || !workQueue_->RemoveWorkItem(block->item_))
+        {
+            while (!block->ready_)
+                Time::Sleep(0);
+        }
+    }
+}
+
+bool PackageUploadSource::ReadFragment(unsigned index, Serializer& dest)
+{
+    if (index >= numFragments_)
+        return false;
+
+    const unsigned blockIndex = index / FRAGMENTS_PER_BLOCK;
+
+    MutexLock lock(blocksMutex_);
+
+    Block* block = RequestBlock(blockIndex);
+    // Read ahead so that sequential uploads do not have to wait for every block
+    if ((blockIndex + 1) * FRAGMENTS_PER_BLOCK < numFragments_)
+        RequestBlock(blockIndex + 1);
+
+    if (!block->ready_)
+        return false;
+
+    const unsigned offset = (index % FRAGMENTS_PER_BLOCK) * PACKAGE_FRAGMENT_SIZE;
+    if (offset >= block->data_.size())
+        return false;
+
+    dest.Write(block->data_.data() + offset, Min(block->data_.size() - offset, PACKAGE_FRAGMENT_SIZE));
+    return true;
+}
+
+void PackageUploadSource::Update()
+{
+    URHO3D_PROFILE("UpdatePackageUploadSource");
+
+    MutexLock lock(blocksMutex_);
+
+    ++updateCount_;
+
+    ea::vector<ea::pair<unsigned, unsigned> > evictable;
+    for (auto& pair : blocks_)
+    {
+        const unsigned blockIndex = pair.first;
+        Block* block = pair.second.get();
+
+        if (block->ready_)
+        {
+            block->item_ = nullptr;
+            evictable.emplace_back(block->lastAccess_, blockIndex);
+        }
+        else if (!block->item_)
+        {
+            if (workQueue_)
+                block->item_ = workQueue_->AddWorkItem([this, blockIndex, block]() { ReadBlock(blockIndex, block); });
+            else
+                ReadBlock(blockIndex, block);
+        }
+    }
+
+    // Evict the least recently accessed blocks first. Blocks being read are never evicted
+    ea::sort(evictable.begin(), evictable.end());
+    unsigned numBlocks = blocks_.size();
+    for (const auto& entry : evictable)
+    {
+        if (numBlocks <= MAX_BLOCKS && updateCount_ - entry.first <= BLOCK_EXPIRE_UPDATES)
+            break;
+        blocks_.erase(entry.second);
+        --numBlocks;
+    }
+}
+
+unsigned PackageUploadSource::GetNumBlocks() const
+{
+    MutexLock lock(blocksMutex_);
+    return blocks_.size();
+}
+
+PackageUploadSource::Block* PackageUploadSource::RequestBlock(unsigned blockIndex)
+{
+    ea::unique_ptr<Block>& block = blocks_[blockIndex];
+    if (!block)
+        block = ea::make_unique<Block>();
+    block->lastAccess_ = updateCount_;
+    return block.get();
+}
+
+void PackageUploadSource::ReadBlock(unsigned blockIndex, Block* block)
+{
+    const unsigned offset = blockIndex * FRAGMENTS_PER_BLOCK * PACKAGE_FRAGMENT_SIZE;
+    const unsigned size = Min(size_ - offset, FRAGMENTS_PER_BLOCK * PACKAGE_FRAGMENT_SIZE);
+    block->data_.resize(size);
+
+    {
+        MutexLock lock(fileMutex_);
+        file_->Seek(offset);
+        if (file_->Read(block->data_.data(), size) != size)
+        {
+            URHO3D_LOGERROR("Failed to read package file " + file_->GetName() + " for upload");
+            block->data_.clear();
+            failed_ = true;
+        }
+    }
+
+    block->ready_ = true;
+}
+
+}
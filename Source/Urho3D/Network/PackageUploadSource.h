@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/RefCounted.h"
+#include "../Core/Mutex.h"
+#include "../IO/File.h"
+
+#include <EASTL/unique_ptr.h>
+#include <EASTL/unordered_map.h>
+
+#include <atomic>
+
+namespace Urho3D
+{
+
+class Serializer;
+class WorkQueue;
+struct WorkItem;
+
+/// Package file uploaded to clients in fragments. Fragments are read in blocks on WorkQueue threads and the blocks are shared between all connections uploading the same package.
+/// @nobind
+class URHO3D_API PackageUploadSource : public RefCounted
+{
+public:
+    /// Construct and open the package file.
+    PackageUploadSource(Context* context, const ea::string& fileName);
+    /// Destruct. Cancel or wait for the block reads in progress.
+    ~PackageUploadSource() override;
+
+    /// Copy a fragment to the destination if its block has been read. Otherwise request the block to be read and return false. Safe to call from multiple threads.
+    bool ReadFragment(unsigned index, Serializer& dest);
+    /// Start reading the requested blocks and evict blocks not accessed recently. Called on the main thread.
+    void Update();
+
+    /// Return whether the package file is open.
+    bool IsOpen() const { return file_->IsOpen(); }
+    /// Return whether reading the package file has failed.
+    bool HasFailed() const { return failed_; }
+    /// Return package file size.
+    unsigned GetSize() const { return size_; }
+    /// Return total number of fragments.
+    unsigned GetNumFragments() const { return numFragments_; }
+    /// Return number of blocks currently in memory.
+    unsigned GetNumBlocks() const;
+
+private:
+    /// Block of consecutive fragments.
+    struct Block
+    {
+        /// Fragment data.
+        ea::vector<unsigned char> data_;
+        /// Read work item while the read is queued or in progress.
+        SharedPtr<WorkItem> item_;
+        /// Update count of the last access.
+        unsigned lastAccess_{};
+        /// Whether the data has been read.
+        std::atomic<bool> ready_{};
+    };
+
+    /// Request a block to be read if not in memory yet and return it. Called with the mutex held.
+    Block* RequestBlock(unsigned blockIndex);
+    /// Read a block from the file. Called on a WorkQueue thread.
+    void ReadBlock(unsigned blockIndex, Block* block);
+
+    /// Work queue subsystem.
+    WeakPtr<WorkQueue> workQueue_;
+    /// Package file.
+    SharedPtr<File> file_;
+    /// Package file mutex.
+    Mutex fileMutex_;
+    /// Blocks in memory by block index.
+    ea::unordered_map<unsigned, ea::unique_ptr<Block> > blocks_;
+    /// Blocks mutex.
+    mutable Mutex blocksMutex_;
+    /// Package file size.
+    unsigned size_{};
+    /// Total number of fragments.
+    unsigned numFragments_{};
+    /// Number of updates so far.
+    unsigned updateCount_{};
+    /// Read failed flag.
+    std::atomic<bool> failed_{};
+};
+
+}
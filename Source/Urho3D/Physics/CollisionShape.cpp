@@ -32,6 +32,7 @@
 #include "../Graphics/Model.h"
 #include "../Graphics/Terrain.h"
 #include "../Graphics/VertexBuffer.h"
+#include "../IO/File.h"
 #include "../IO/Log.h"
 #include "../Physics/CollisionShape.h"
 #include "../Physics/PhysicsUtils.h"
@@ -62,6 +63,8 @@ namespace Urho3D
 
 static const float DEFAULT_COLLISION_MARGIN = 0.04f;
 static const unsigned QUANTIZE_MAX_TRIANGLES = 1000000;
+static const unsigned COOKED_BVH_ALIGNMENT = 16;
+static const unsigned COOKED_TRIANGLE_INFO_SIZE = 2 * sizeof(int) + 3 * sizeof(float);
 
 static const btVector3 WHITE(1.0f, 1.0f, 1.0f);
 static const btVector3 GREEN(0.0f, 1.0f, 0.0f);
@@ -83,6 +86,39 @@ static const char* typeNames[] =
 
 extern const char* PHYSICS_CATEGORY;
 
+/// Return checksum of the model positions and indices used for collision geometry.
+static unsigned GetGeometryChecksum(Model* model, unsigned lodLevel)
+{
+    unsigned checksum = 0;
+    const unsigned numGeometries = model->GetNumGeometries();
+
+    for (unsigned i = 0; i < numGeometries; ++i)
+    {
+        Geometry* geometry = model->GetGeometry(i, lodLevel);
+        if (!geometry)
+            continue;
+
+        const unsigned char* vertexData;
+        const unsigned char* indexData;
+        unsigned vertexSize;
+        unsigned indexSize;
+        const ea::vector<VertexElement>* elements;
+
+        geometry->GetRawData(vertexData, vertexSize, indexData, indexSize, elements);
+        if (!vertexData)
+            continue;
+
+        const unsigned vertexEnd = geometry->GetVertexStart() + geometry->GetVertexCount();
+        for (unsigned j = geometry->GetVertexStart(); j < vertexEnd; ++j)
+            checksum = StringHash::Calculate(&vertexData[j * vertexSize], sizeof(Vector3), checksum);
+        if (indexData)
+            checksum = StringHash::Calculate(&indexData[geometry->GetIndexStart() * indexSize], geometry->GetIndexCount() * indexSize, checksum);
+    }
+
+    // Zero is reserved for geometry without a source model
+    return checksum ? checksum : 1;
+}
+
 class TriangleMeshInterface : public btTriangleIndexVertexArray
 {
 public:
@@ -199,21 +235,119 @@ private:
 TriangleMeshData::TriangleMeshData(Model* model, unsigned lodLevel)
 {
     meshInterface_ = ea::make_unique<TriangleMeshInterface>(model, lodLevel);
-    shape_ = ea::make_unique<btBvhTriangleMeshShape>(meshInterface_.get(), meshInterface_->useQuantize_, true);
-
-    infoMap_ = ea::make_unique<btTriangleInfoMap>();
-    btGenerateInternalEdgeInfo(shape_.get(), infoMap_.get());
+    checksum_ = GetGeometryChecksum(model, lodLevel);
+    BuildShape();
 }
 
 TriangleMeshData::TriangleMeshData(CustomGeometry* custom)
 {
     meshInterface_ = ea::make_unique<TriangleMeshInterface>(custom);
+    BuildShape();
+}
+
+TriangleMeshData::TriangleMeshData(Model* model, unsigned lodLevel, Deserializer& cookedData)
+{
+    meshInterface_ = ea::make_unique<TriangleMeshInterface>(model, lodLevel);
+    checksum_ = GetGeometryChecksum(model, lodLevel);
+    if (!LoadCooked(cookedData))
+    {
+        URHO3D_LOGWARNING("Cooked triangle mesh data " + cookedData.GetName() + " is out of date or invalid, building it again");
+        BuildShape();
+    }
+}
+
+TriangleMeshData::~TriangleMeshData()
+{
+    // The shape does not own a cooked BVH, so destroy the shape before freeing the buffer it points to
+    shape_.reset();
+    if (bvhBuffer_)
+        btAlignedFree(bvhBuffer_);
+}
+
+void TriangleMeshData::BuildShape()
+{
     shape_ = ea::make_unique<btBvhTriangleMeshShape>(meshInterface_.get(), meshInterface_->useQuantize_, true);
 
     infoMap_ = ea::make_unique<btTriangleInfoMap>();
     btGenerateInternalEdgeInfo(shape_.get(), infoMap_.get());
 }
 
+bool TriangleMeshData::LoadCooked(Deserializer& source)
+{
+    if (source.ReadFileID() != "UCTM" || source.ReadUInt() != checksum_ || source.ReadUInt() != sizeof(btQuantizedBvh))
+        return false;
+
+    // Sizes come from the file, so check them against the remaining data before allocating
+    const unsigned bvhSize = source.ReadUInt();
+    if (bvhSize < sizeof(btQuantizedBvh) || bvhSize > source.GetSize() - source.GetPosition())
+        return false;
+
+    // The BVH is deserialized in place and must stay in the aligned buffer for the lifetime of the shape
+    void* buffer = btAlignedAlloc(bvhSize, COOKED_BVH_ALIGNMENT);
+    btQuantizedBvh* bvh = nullptr;
+    if (source.Read(buffer, bvhSize) == bvhSize && static_cast<btQuantizedBvh*>(buffer)->calculateSerializeBufferSize() <= bvhSize)
+        bvh = btQuantizedBvh::deSerializeInPlace(buffer, bvhSize, false);
+
+    const unsigned numTriangleInfos = source.ReadUInt();
+    if (!bvh || numTriangleInfos > (source.GetSize() - source.GetPosition()) / COOKED_TRIANGLE_INFO_SIZE)
+    {
+        btAlignedFree(buffer);
+        return false;
+    }
+
+    infoMap_ = ea::make_unique<btTriangleInfoMap>();
+    for (unsigned i = 0; i < numTriangleInfos; ++i)
+    {
+        const int key = source.ReadInt();
+        btTriangleInfo info;
+        info.m_flags = source.ReadInt();
+        info.m_edgeV0V1Angle = source.ReadFloat();
+        info.m_edgeV1V2Angle = source.ReadFloat();
+        info.m_edgeV2V0Angle = source.ReadFloat();
+        infoMap_->insert(btHashInt(key), info);
+    }
+
+    bvhBuffer_ = buffer;
+    shape_ = ea::make_unique<btBvhTriangleMeshShape>(meshInterface_.get(), meshInterface_->useQuantize_, false);
+    shape_->setOptimizedBvh(static_cast<btOptimizedBvh*>(bvh));
+    shape_->setTriangleInfoMap(infoMap_.get());
+
+    return true;
+}
+
+bool TriangleMeshData::SaveCooked(Serializer& dest) const
+{
+    const btOptimizedBvh* bvh = shape_ ? shape_->getOptimizedBvh() : nullptr;
+    if (!bvh || !checksum_)
+        return false;
+
+    const unsigned bvhSize = bvh->calculateSerializeBufferSize();
+    void* buffer = btAlignedAlloc(bvhSize, COOKED_BVH_ALIGNMENT);
+    const bool serialized = bvh->serializeInPlace(buffer, bvhSize, false);
+
+    bool success = serialized;
+    success &= dest.WriteFileID("UCTM");
+    success &= dest.WriteUInt(checksum_);
+    success &= dest.WriteUInt(sizeof(btQuantizedBvh));
+    success &= dest.WriteUInt(bvhSize);
+    success &= dest.Write(buffer, bvhSize) == bvhSize;
+    btAlignedFree(buffer);
+
+    const int numTriangleInfos = infoMap_ ? infoMap_->size() : 0;
+    success &= dest.WriteUInt(numTriangleInfos);
+    for (int i = 0; i < numTriangleInfos; ++i)
+    {
+        const btTriangleInfo* info = infoMap_->getAtIndex(i);
+        success &= dest.WriteInt(infoMap_->getKeyAtIndex(i).getUid1());
+        success &= dest.WriteInt(info->m_flags);
+        success &= dest.WriteFloat(info->m_edgeV0V1Angle);
+        success &= dest.WriteFloat(info->m_edgeV1V2Angle);
+        success &= dest.WriteFloat(info->m_edgeV2V0Angle);
+    }
+
+    return success;
+}
+
 GImpactMeshData::GImpactMeshData(Model* model, unsigned lodLevel)
 {
     meshInterface_ = ea::make_unique<TriangleMeshInterface>(model, lodLevel);
@@ -226,43 +360,18 @@ GImpactMeshData::GImpactMeshData(CustomGeometry* custom)
 
 ConvexData::ConvexData(Model* model, unsigned lodLevel)
 {
-    ea::vector<Vector3> vertices;
-    unsigned numGeometries = model->GetNumGeometries();
+    checksum_ = GetGeometryChecksum(model, lodLevel);
+    BuildHull(model, lodLevel);
+}
 
-    for (unsigned i = 0; i < numGeometries; ++i)
+ConvexData::ConvexData(Model* model, unsigned lodLevel, Deserializer& cookedData)
+{
+    checksum_ = GetGeometryChecksum(model, lodLevel);
+    if (!LoadCooked(cookedData))
     {
-        Geometry* geometry = model->GetGeometry(i, lodLevel);
-        if (!geometry)
-        {
-            URHO3D_LOGWARNING("Skipping null geometry for convex hull collision");
-            continue;
-        };
-
-        const unsigned char* vertexData;
-        const unsigned char* indexData;
-        unsigned vertexSize;
-        unsigned indexSize;
-        const ea::vector<VertexElement>* elements;
-
-        geometry->GetRawData(vertexData, vertexSize, indexData, indexSize, elements);
-        if (!vertexData || VertexBuffer::GetElementOffset(*elements, TYPE_VECTOR3, SEM_POSITION) != 0)
-        {
-            URHO3D_LOGWARNING("Skipping geometry with no or unsuitable CPU-side geometry data for convex hull collision");
-            continue;
-        }
-
-        unsigned vertexStart = geometry->GetVertexStart();
-        unsigned vertexCount = geometry->GetVertexCount();
-
-        // Copy vertex data
-        for (unsigned j = 0; j < vertexCount; ++j)
-        {
-            const Vector3& v = *((const Vector3*)(&vertexData[(vertexStart + j) * vertexSize]));
-            vertices.push_back(v);
-        }
+        URHO3D_LOGWARNING("Cooked convex hull data " + cookedData.GetName() + " is out of date or invalid, building it again");
+        BuildHull(model, lodLevel);
     }
-
-    BuildHull(vertices);
 }
 
 ConvexData::ConvexData(CustomGeometry* custom)
@@ -314,6 +423,94 @@ void ConvexData::BuildHull(const ea::vector<Vector3>& vertices)
     }
 }
 
+void ConvexData::BuildHull(Model* model, unsigned lodLevel)
+{
+    ea::vector<Vector3> vertices;
+    unsigned numGeometries = model->GetNumGeometries();
+
+    for (unsigned i = 0; i < numGeometries; ++i)
+    {
+        Geometry* geometry = model->GetGeometry(i, lodLevel);
+        if (!geometry)
+        {
+            URHO3D_LOGWARNING("Skipping null geometry for convex hull collision");
+            continue;
+        };
+
+        const unsigned char* vertexData;
+        const unsigned char* indexData;
+        unsigned vertexSize;
+        unsigned indexSize;
+        const ea::vector<VertexElement>* elements;
+
+        geometry->GetRawData(vertexData, vertexSize, indexData, indexSize, elements);
+        if (!vertexData || VertexBuffer::GetElementOffset(*elements, TYPE_VECTOR3, SEM_POSITION) != 0)
+        {
+            URHO3D_LOGWARNING("Skipping geometry with no or unsuitable CPU-side geometry data for convex hull collision");
+            continue;
+        }
+
+        unsigned vertexStart = geometry->GetVertexStart();
+        unsigned vertexCount = geometry->GetVertexCount();
+
+        // Copy vertex data
+        for (unsigned j = 0; j < vertexCount; ++j)
+        {
+            const Vector3& v = *((const Vector3*)(&vertexData[(vertexStart + j) * vertexSize]));
+            vertices.push_back(v);
+        }
+    }
+
+    BuildHull(vertices);
+}
+
+bool ConvexData::LoadCooked(Deserializer& source)
+{
+    if (source.ReadFileID() != "UCCH" || source.ReadUInt() != checksum_)
+        return false;
+
+    // Counts come from the file, so check them against the remaining data before allocating
+    const unsigned vertexCount = source.ReadUInt();
+    if (vertexCount > (source.GetSize() - source.GetPosition()) / sizeof(Vector3))
+        return false;
+    ea::shared_array<Vector3> vertexData(new Vector3[vertexCount]);
+    if (source.Read(vertexData.get(), vertexCount * sizeof(Vector3)) != vertexCount * sizeof(Vector3))
+        return false;
+
+    const unsigned indexCount = source.ReadUInt();
+    if (indexCount > (source.GetSize() - source.GetPosition()) / sizeof(unsigned))
+        return false;
+    ea::shared_array<unsigned> indexData(new unsigned[indexCount]);
+    if (source.Read(indexData.get(), indexCount * sizeof(unsigned)) != indexCount * sizeof(unsigned))
+        return false;
+    for (unsigned i = 0; i < indexCount; ++i)
+    {
+        if (indexData[i] >= vertexCount)
+            return false;
+    }
+
+    vertexData_ = vertexData;
+    vertexCount_ = vertexCount;
+    indexData_ = indexData;
+    indexCount_ = indexCount;
+    return true;
+}
+
+bool ConvexData::SaveCooked(Serializer& dest) const
+{
+    if (!checksum_)
+        return false;
+
+    bool success = true;
+    success &= dest.WriteFileID("UCCH");
+    success &= dest.WriteUInt(checksum_);
+    success &= dest.WriteUInt(vertexCount_);
+    success &= dest.Write(vertexData_.get(), vertexCount_ * sizeof(Vector3)) == vertexCount_ * sizeof(Vector3);
+    success &= dest.WriteUInt(indexCount_);
+    success &= dest.Write(indexData_.get(), indexCount_ * sizeof(unsigned)) == indexCount_ * sizeof(unsigned);
+    return success;
+}
+
 HeightfieldData::HeightfieldData(Terrain* terrain, unsigned lodLevel) :
     heightData_(terrain->GetHeightData()),
     spacing_(terrain->GetSpacing()),
@@ -779,6 +976,7 @@ void CollisionShape::SetTransform(const Vector3& position, const Quaternion& rot
 
 void CollisionShape::SetMargin(float margin)
 {
+    SyncPhysicsStep();
     margin = Max(margin, 0.0f);
 
     if (margin != margin_)
@@ -823,6 +1021,7 @@ void CollisionShape::SetLodLevel(unsigned lodLevel)
 
 BoundingBox CollisionShape::GetWorldBoundingBox() const
 {
+    SyncPhysicsStep();
     if (shape_ && node_)
     {
         // Use the rigid body's world transform if possible, as it may be different from the rendering transform
@@ -844,6 +1043,7 @@ BoundingBox CollisionShape::GetWorldBoundingBox() const
 
 void CollisionShape::NotifyRigidBody(bool updateMass)
 {
+    SyncPhysicsStep();
     btCompoundShape* compound = GetParentCompoundShape();
     if (node_ && shape_ && compound)
     {
@@ -888,6 +1088,7 @@ ResourceRef CollisionShape::GetModelAttr() const
 
 void CollisionShape::ReleaseShape()
 {
+    SyncPhysicsStep();
     btCompoundShape* compound = GetParentCompoundShape();
     if (shape_ && compound)
     {
@@ -957,6 +1158,8 @@ void CollisionShape::OnMarkedDirty(Node* node)
             return;
         }
 
+        SyncPhysicsStep();
+
         switch (shapeType_)
         {
         case SHAPE_BOX:
@@ -990,6 +1193,12 @@ void CollisionShape::OnMarkedDirty(Node* node)
     }
 }
 
+void CollisionShape::SyncPhysicsStep() const
+{
+    if (physicsWorld_)
+        physicsWorld_->SyncStep();
+}
+
 btCompoundShape* CollisionShape::GetParentCompoundShape()
 {
     if (!rigidBody_)
@@ -1000,6 +1209,7 @@ btCompoundShape* CollisionShape::GetParentCompoundShape()
 
 void CollisionShape::UpdateShape()
 {
+    SyncPhysicsStep();
     URHO3D_PROFILE("UpdateCollisionShape");
 
     ReleaseShape();
@@ -1097,6 +1307,7 @@ void CollisionShape::UpdateShape()
 
 void CollisionShape::UpdateCachedGeometryShape(CollisionGeometryDataCache& cache)
 {
+    SyncPhysicsStep();
     Scene* scene = GetScene();
     size_ = size_.Abs();
     if (customGeometryID_ && scene)
@@ -1122,7 +1333,9 @@ void CollisionShape::UpdateCachedGeometryShape(CollisionGeometryDataCache& cache
             geometry_ = cachedGeometry->second;
         else
         {
-            geometry_ = CreateCollisionGeometryData(shapeType_, model_, lodLevel_);
+            geometry_ = LoadCookedGeometry();
+            if (!geometry_)
+                geometry_ = CreateCollisionGeometryData(shapeType_, model_, lodLevel_);
             assert(geometry_);
             // Check if model has dynamic buffers, do not cache in that case
             if (!HasDynamicBuffers(model_, lodLevel_))
@@ -1136,6 +1349,27 @@ void CollisionShape::UpdateCachedGeometryShape(CollisionGeometryDataCache& cache
     }
 }
 
+CollisionGeometryData* CollisionShape::LoadCookedGeometry() const
+{
+    if (!physicsWorld_ || physicsWorld_->GetCookedGeometryPath().empty())
+        return nullptr;
+    if (shapeType_ != SHAPE_TRIANGLEMESH && shapeType_ != SHAPE_CONVEXHULL)
+        return nullptr;
+
+    // Missing cooked data is not an error, the geometry is built from the model instead
+    auto* cache = GetSubsystem<ResourceCache>();
+    SharedPtr<File> file = cache->GetFile(physicsWorld_->GetCookedGeometryName(model_, lodLevel_, shapeType_ == SHAPE_CONVEXHULL), false);
+    if (!file)
+        return nullptr;
+
+    URHO3D_PROFILE("LoadCookedCollisionGeometry");
+
+    if (shapeType_ == SHAPE_TRIANGLEMESH)
+        return new TriangleMeshData(model_, lodLevel_, *file);
+    else
+        return new ConvexData(model_, lodLevel_, *file);
+}
+
 void CollisionShape::SetModelShape(ShapeType shapeType, Model* model, unsigned lodLevel,
     const Vector3& scale, const Vector3& position, const Quaternion& rotation)
 {
@@ -42,10 +42,12 @@ namespace Urho3D
 {
 
 class CustomGeometry;
+class Deserializer;
 class Geometry;
 class Model;
 class PhysicsWorld;
 class RigidBody;
+class Serializer;
 class Terrain;
 class TriangleMeshInterface;
 
@@ -67,6 +69,11 @@ enum ShapeType
 /// Base class for collision shape geometry data.
 struct CollisionGeometryData : public RefCounted
 {
+    /// Write cooked geometry data that can be loaded instead of building it again. Return true if supported.
+    virtual bool SaveCooked(Serializer& dest) const { return false; }
+
+    /// Checksum of the source model geometry. Zero if built from custom geometry.
+    unsigned checksum_{};
 };
 
 /// Cache of collision geometry data.
@@ -80,6 +87,13 @@ struct TriangleMeshData : public CollisionGeometryData
     TriangleMeshData(Model* model, unsigned lodLevel);
     /// Construct from a custom geometry.
     explicit TriangleMeshData(CustomGeometry* custom);
+    /// Construct from a model using cooked BVH and edge data. Build them again if the cooked data is out of date.
+    TriangleMeshData(Model* model, unsigned lodLevel, Deserializer& cookedData);
+    /// Destruct.
+    ~TriangleMeshData() override;
+
+    /// Write cooked BVH and edge data.
+    bool SaveCooked(Serializer& dest) const override;
 
     /// Bullet triangle mesh interface.
     ea::unique_ptr<TriangleMeshInterface> meshInterface_;
@@ -87,6 +101,15 @@ struct TriangleMeshData : public CollisionGeometryData
     ea::unique_ptr<btBvhTriangleMeshShape> shape_;
     /// Bullet triangle info map.
     ea::unique_ptr<btTriangleInfoMap> infoMap_;
+
+private:
+    /// Build BVH and edge data.
+    void BuildShape();
+    /// Load cooked BVH and edge data. Return true if successful.
+    bool LoadCooked(Deserializer& source);
+
+    /// Aligned buffer holding the cooked BVH.
+    void* bvhBuffer_{};
 };
 
 /// Triangle mesh geometry data.
@@ -108,9 +131,15 @@ struct ConvexData : public CollisionGeometryData
     ConvexData(Model* model, unsigned lodLevel);
     /// Construct from a custom geometry.
     explicit ConvexData(CustomGeometry* custom);
+    /// Construct from a model using cooked hull data. Build the hull again if the cooked data is out of date.
+    ConvexData(Model* model, unsigned lodLevel, Deserializer& cookedData);
 
     /// Build the convex hull from vertices.
     void BuildHull(const ea::vector<Vector3>& vertices);
+    /// Build the convex hull from model vertices.
+    void BuildHull(Model* model, unsigned lodLevel);
+    /// Write cooked hull data.
+    bool SaveCooked(Serializer& dest) const override;
 
     /// Vertex data.
     ea::shared_array<Vector3> vertexData_;
@@ -120,6 +149,10 @@ struct ConvexData : public CollisionGeometryData
     ea::shared_array<unsigned> indexData_;
     /// Number of indices.
     unsigned indexCount_{};
+
+private:
+    /// Load cooked hull data. Return true if successful.
+    bool LoadCooked(Deserializer& source);
 };
 
 /// Heightfield geometry data.
@@ -283,12 +316,16 @@ protected:
     virtual btCollisionShape* UpdateDerivedShape(int shapeType, const Vector3& newWorldScale);
 
 private:
+    /// Wait for the pipelined physics step to finish before accessing Bullet state.
+    void SyncPhysicsStep() const;
     /// Find the parent rigid body component and return its compound collision shape.
     btCompoundShape* GetParentCompoundShape();
     /// Update the collision shape after attribute changes.
     void UpdateShape();
     /// Update cached geometry collision shape.
     void UpdateCachedGeometryShape(CollisionGeometryDataCache& cache);
+    /// Load cooked geometry data of the model if the physics world has a cooked geometry path. Return null if not available.
+    CollisionGeometryData* LoadCookedGeometry() const;
     /// Set as specified shape type using model and LOD.
     void SetModelShape(ShapeType shapeType, Model* model, unsigned lodLevel,
         const Vector3& scale, const Vector3& position, const Quaternion& rotation);
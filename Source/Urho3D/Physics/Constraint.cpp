@@ -125,6 +125,7 @@ void Constraint::ApplyAttributes()
 
 void Constraint::OnSetEnabled()
 {
+    SyncPhysicsStep();
     if (constraint_)
         constraint_->setEnabled(IsEnabledEffective());
 }
@@ -148,6 +149,7 @@ void Constraint::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
 
 void Constraint::SetConstraintType(ConstraintType type)
 {
+    SyncPhysicsStep();
     if (type != constraintType_ || !constraint_)
     {
         constraintType_ = type;
@@ -158,6 +160,7 @@ void Constraint::SetConstraintType(ConstraintType type)
 
 void Constraint::SetOtherBody(RigidBody* body)
 {
+    SyncPhysicsStep();
     if (otherBody_ != body)
     {
         if (otherBody_)
@@ -176,6 +179,7 @@ void Constraint::SetOtherBody(RigidBody* body)
 
 void Constraint::SetPosition(const Vector3& position)
 {
+    SyncPhysicsStep();
     if (position != position_)
     {
         position_ = position;
@@ -186,6 +190,7 @@ void Constraint::SetPosition(const Vector3& position)
 
 void Constraint::SetRotation(const Quaternion& rotation)
 {
+    SyncPhysicsStep();
     if (rotation != rotation_)
     {
         rotation_ = rotation;
@@ -196,6 +201,7 @@ void Constraint::SetRotation(const Quaternion& rotation)
 
 void Constraint::SetAxis(const Vector3& axis)
 {
+    SyncPhysicsStep();
     switch (constraintType_)
     {
     case CONSTRAINT_POINT:
@@ -218,6 +224,7 @@ void Constraint::SetAxis(const Vector3& axis)
 
 void Constraint::SetOtherPosition(const Vector3& position)
 {
+    SyncPhysicsStep();
     if (position != otherPosition_)
     {
         otherPosition_ = position;
@@ -228,6 +235,7 @@ void Constraint::SetOtherPosition(const Vector3& position)
 
 void Constraint::SetOtherRotation(const Quaternion& rotation)
 {
+    SyncPhysicsStep();
     if (rotation != otherRotation_)
     {
         otherRotation_ = rotation;
@@ -238,6 +246,7 @@ void Constraint::SetOtherRotation(const Quaternion& rotation)
 
 void Constraint::SetOtherAxis(const Vector3& axis)
 {
+    SyncPhysicsStep();
     switch (constraintType_)
     {
     case CONSTRAINT_POINT:
@@ -260,6 +269,7 @@ void Constraint::SetOtherAxis(const Vector3& axis)
 
 void Constraint::SetWorldPosition(const Vector3& position)
 {
+    SyncPhysicsStep();
     if (constraint_)
     {
         btTransform ownBodyInverse = constraint_->getRigidBodyA().getWorldTransform().inverse();
@@ -281,6 +291,7 @@ void Constraint::SetWorldPosition(const Vector3& position)
 
 void Constraint::SetHighLimit(const Vector2& limit)
 {
+    SyncPhysicsStep();
     if (limit != highLimit_)
     {
         highLimit_ = limit;
@@ -291,6 +302,7 @@ void Constraint::SetHighLimit(const Vector2& limit)
 
 void Constraint::SetLowLimit(const Vector2& limit)
 {
+    SyncPhysicsStep();
     if (limit != lowLimit_)
     {
         lowLimit_ = limit;
@@ -301,6 +313,7 @@ void Constraint::SetLowLimit(const Vector2& limit)
 
 void Constraint::SetERP(float erp)
 {
+    SyncPhysicsStep();
     erp = Max(erp, 0.0f);
 
     if (erp != erp_)
@@ -313,6 +326,7 @@ void Constraint::SetERP(float erp)
 
 void Constraint::SetCFM(float cfm)
 {
+    SyncPhysicsStep();
     cfm = Max(cfm, 0.0f);
 
     if (cfm != cfm_)
@@ -325,6 +339,7 @@ void Constraint::SetCFM(float cfm)
 
 void Constraint::SetDisableCollision(bool disable)
 {
+    SyncPhysicsStep();
     if (disable != disableCollision_)
     {
         disableCollision_ = disable;
@@ -335,6 +350,7 @@ void Constraint::SetDisableCollision(bool disable)
 
 Vector3 Constraint::GetWorldPosition() const
 {
+    SyncPhysicsStep();
     if (constraint_)
     {
         btTransform ownBody = constraint_->getRigidBodyA().getWorldTransform();
@@ -346,6 +362,7 @@ Vector3 Constraint::GetWorldPosition() const
 
 void Constraint::ReleaseConstraint()
 {
+    SyncPhysicsStep();
     if (constraint_)
     {
         if (ownBody_)
@@ -362,6 +379,7 @@ void Constraint::ReleaseConstraint()
 
 void Constraint::ApplyFrames()
 {
+    SyncPhysicsStep();
     if (!constraint_ || !node_ || (otherBody_ && !otherBody_->GetNode()))
         return;
 
@@ -452,11 +470,28 @@ void Constraint::OnMarkedDirty(Node* node)
 {
     /// \todo This does not catch the connected body node's scale changing
     if (HasWorldScaleChanged(cachedWorldScale_, node->GetWorldScale()))
+    {
+        // Physics operations are not safe from worker threads
+        Scene* scene = GetScene();
+        if (scene && scene->IsThreadedUpdate())
+        {
+            scene->DelayedMarkedDirty(this);
+            return;
+        }
+
         ApplyFrames();
+    }
+}
+
+void Constraint::SyncPhysicsStep() const
+{
+    if (physicsWorld_)
+        physicsWorld_->SyncStep();
 }
 
 void Constraint::CreateConstraint()
 {
+    SyncPhysicsStep();
     URHO3D_PROFILE("CreateConstraint");
 
     cachedWorldScale_ = node_->GetWorldScale();
@@ -538,6 +573,7 @@ void Constraint::CreateConstraint()
 
 void Constraint::ApplyLimits()
 {
+    SyncPhysicsStep();
     if (!constraint_)
         return;
 
@@ -579,6 +615,7 @@ void Constraint::ApplyLimits()
 
 void Constraint::AdjustOtherBodyPosition()
 {
+    SyncPhysicsStep();
     // Convenience for editing static constraints: if not connected to another body, adjust world position to match local
     // (when deserializing, the proper other body position will be read after own position, so this calculation is safely
     // overridden and does not accumulate constraint error
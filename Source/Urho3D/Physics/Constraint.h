@@ -183,6 +183,8 @@ protected:
     void OnMarkedDirty(Node* node) override;
 
 private:
+    /// Wait for the pipelined physics step to finish before accessing Bullet state.
+    void SyncPhysicsStep() const;
     /// Create the constraint.
     void CreateConstraint();
     /// Apply high and low constraint limits.
@@ -24,11 +24,19 @@
 
 #include <EASTL/sort.h>
 
+#include <condition_variable>
+#include <mutex>
+
 #include "../Core/Context.h"
+#include "../Core/CoreEvents.h"
 #include "../Core/Mutex.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/Model.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../Math/Ray.h"
 #include "../Physics/CollisionShape.h"
@@ -42,13 +50,17 @@
 #include "../Scene/SceneEvents.h"
 
 #include <Bullet/BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <Bullet/BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
 #include <Bullet/BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h>
 #include <Bullet/BulletCollision/CollisionDispatch/btInternalEdgeUtility.h>
 #include <Bullet/BulletCollision/CollisionShapes/btBoxShape.h>
 #include <Bullet/BulletCollision/CollisionShapes/btSphereShape.h>
 #include <Bullet/BulletCollision/Gimpact/btGImpactCollisionAlgorithm.h>
 #include <Bullet/BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h>
+#include <Bullet/BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
 #include <Bullet/BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h>
+#include <Bullet/BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <Bullet/LinearMath/btThreads.h>
 
 
 extern ContactAddedCallback gContactAddedCallback;
@@ -61,6 +73,7 @@ extern const char* SUBSYSTEM_CATEGORY;
 
 static const int MAX_SOLVER_ITERATIONS = 256;
 static const Vector3 DEFAULT_GRAVITY = Vector3(0.0f, -9.81f, 0.0f);
+static const unsigned MIN_QUERIES_PER_WORK_ITEM = 16;
 
 PhysicsWorldConfig PhysicsWorld::config;
 
@@ -71,12 +84,17 @@ static bool CompareRaycastResults(const PhysicsRaycastResult& lhs, const Physics
 
 void InternalPreTickCallback(btDynamicsWorld* world, btScalar timeStep)
 {
-    static_cast<PhysicsWorld*>(world->getWorldUserInfo())->PreStep(timeStep);
+    // Events can not be sent from the pipelined step thread, they are sent once per step from the main thread instead
+    auto* physicsWorld = static_cast<PhysicsWorld*>(world->getWorldUserInfo());
+    if (!physicsWorld->IsSteppingAsync())
+        physicsWorld->PreStep(timeStep);
 }
 
 void InternalTickCallback(btDynamicsWorld* world, btScalar timeStep)
 {
-    static_cast<PhysicsWorld*>(world->getWorldUserInfo())->PostStep(timeStep);
+    auto* physicsWorld = static_cast<PhysicsWorld*>(world->getWorldUserInfo());
+    if (!physicsWorld->IsSteppingAsync())
+        physicsWorld->PostStep(timeStep);
 }
 
 static bool CustomMaterialCombinerCallback(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int partId0,
@@ -118,6 +136,180 @@ void CleanupGeometryCacheImpl(CollisionGeometryDataCache& cache)
     }
 }
 
+/// Bullet task scheduler which runs parallel loops of the multithreaded world on WorkQueue threads.
+class PhysicsTaskScheduler : public btITaskScheduler
+{
+public:
+    /// Construct.
+    explicit PhysicsTaskScheduler(WorkQueue* workQueue) :
+        btITaskScheduler("WorkQueue"),
+        workQueue_(workQueue)
+    {
+    }
+
+    /// Return maximum number of threads.
+    int getMaxNumThreads() const override { return Min(static_cast<int>(workQueue_->GetNumThreads()) + 1, static_cast<int>(BT_MAX_THREAD_COUNT)); }
+    /// Return number of threads including the calling one.
+    int getNumThreads() const override { return getMaxNumThreads(); }
+    /// Set number of threads. Ignored, the number of WorkQueue threads is used.
+    void setNumThreads(int numThreads) override { }
+
+    /// Execute loop body over the range.
+    void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) override
+    {
+        RunRanges(iBegin, iEnd, grainSize, [&body](int begin, int end)
+        {
+            body.forLoop(begin, end);
+            return btScalar(0);
+        });
+    }
+
+    /// Execute loop body over the range and return sum of the results.
+    btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) override
+    {
+        return RunRanges(iBegin, iEnd, grainSize, [&body](int begin, int end) { return body.sumLoop(begin, end); });
+    }
+
+private:
+    /// Subrange of a loop.
+    struct LoopRange
+    {
+        /// Loop body.
+        const void* body_{};
+        /// Loop body invoker.
+        btScalar (*invoke_)(const void* body, int begin, int end){};
+        /// Range start.
+        int begin_{};
+        /// Range end.
+        int end_{};
+        /// Result of the loop body.
+        btScalar result_{};
+    };
+
+    /// Split the range between work items and wait for completion.
+    template <class T> btScalar RunRanges(int iBegin, int iEnd, int grainSize, const T& body)
+    {
+        // WorkQueue can only be completed from the main thread, otherwise execute the loop directly
+        const int count = iEnd - iBegin;
+        const int numThreads = getNumThreads();
+        if (count <= grainSize || numThreads <= 1 || !Thread::IsMainThread())
+            return body(iBegin, iEnd);
+
+        const int numItems = Min(numThreads, (count + grainSize - 1) / Max(grainSize, 1));
+        const int countPerItem = (count + numItems - 1) / numItems;
+
+        ranges_.resize(numItems);
+        int begin = iBegin;
+        for (int i = 0; i < numItems; ++i)
+        {
+            LoopRange& range = ranges_[i];
+            range.body_ = &body;
+            range.invoke_ = [](const void* body, int begin, int end) { return (*static_cast<const T*>(body))(begin, end); };
+            range.begin_ = begin;
+            range.end_ = Min(begin + countPerItem, iEnd);
+            range.result_ = 0;
+            begin = range.end_;
+
+            SharedPtr<WorkItem> item = workQueue_->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = RunLoopRange;
+            item->start_ = &range;
+            workQueue_->AddWorkItem(item);
+        }
+        workQueue_->Complete(M_MAX_UNSIGNED);
+
+        btScalar sum = 0;
+        for (const LoopRange& range : ranges_)
+            sum += range.result_;
+        return sum;
+    }
+
+    /// Work item function.
+    static void RunLoopRange(const WorkItem* item, unsigned threadIndex)
+    {
+        auto* range = reinterpret_cast<LoopRange*>(item->start_);
+        range->result_ = range->invoke_(range->body_, range->begin_, range->end_);
+    }
+
+    /// Work queue.
+    WorkQueue* workQueue_{};
+    /// Subranges of the current loop.
+    ea::vector<LoopRange> ranges_;
+};
+
+/// Dedicated thread which runs the simulation steps of a pipelined world.
+class PhysicsStepThread : public Thread
+{
+public:
+    /// Construct.
+    explicit PhysicsStepThread(PhysicsWorld* world) :
+        Thread("PhysicsStep"),
+        world_(world)
+    {
+    }
+
+    /// Destruct. Stop the thread.
+    ~PhysicsStepThread() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shouldRun_ = false;
+        }
+        condition_.notify_all();
+        Stop();
+    }
+
+    /// Start a simulation step.
+    void StartStep(float timeStep)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            timeStep_ = timeStep;
+            pending_ = true;
+        }
+        condition_.notify_all();
+    }
+
+    /// Wait for the current simulation step to finish.
+    void WaitStep()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this] { return !pending_; });
+    }
+
+    /// Run simulation steps until stopped.
+    void ThreadFunction() override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            condition_.wait(lock, [this] { return pending_ || !shouldRun_; });
+            if (!shouldRun_)
+                break;
+
+            const float timeStep = timeStep_;
+            lock.unlock();
+            world_->StepSimulation(timeStep);
+            lock.lock();
+
+            pending_ = false;
+            condition_.notify_all();
+        }
+    }
+
+private:
+    /// Physics world.
+    PhysicsWorld* world_{};
+    /// Mutex for the step state.
+    std::mutex mutex_;
+    /// Condition for step start and finish.
+    std::condition_variable condition_;
+    /// Time step of the pending step.
+    float timeStep_{};
+    /// Step pending or running flag.
+    bool pending_{};
+};
+
 /// Callback for physics world queries.
 struct PhysicsQueryCallback : public btCollisionWorld::ContactResultCallback
 {
@@ -147,6 +339,39 @@ struct PhysicsQueryCallback : public btCollisionWorld::ContactResultCallback
     unsigned collisionMask_;
 };
 
+/// Broadphase callback for overlap queries of physics query batch.
+struct PhysicsOverlapCallback : public btBroadphaseAabbCallback
+{
+    /// Construct.
+    PhysicsOverlapCallback(ea::vector<RigidBody*>& result, const PhysicsQuery& query) :
+        result_(result),
+        query_(query)
+    {
+    }
+
+    /// Process overlapping broadphase proxy.
+    bool process(const btBroadphaseProxy* proxy) override
+    {
+        auto* object = static_cast<btCollisionObject*>(proxy->m_clientObject);
+        auto* body = static_cast<RigidBody*>(object->getUserPointer());
+        if (!body || !(body->GetCollisionLayer() & query_.collisionMask_))
+            return true;
+
+        // Refine sphere queries against the body bounding box
+        if (query_.type_ == PQT_SPHERE_OVERLAP
+            && query_.sphere_.IsInside(BoundingBox(ToVector3(proxy->m_aabbMin), ToVector3(proxy->m_aabbMax))) == OUTSIDE)
+            return true;
+
+        result_.push_back(body);
+        return true;
+    }
+
+    /// Found rigid bodies.
+    ea::vector<RigidBody*>& result_;
+    /// Query.
+    const PhysicsQuery& query_;
+};
+
 PhysicsWorld::PhysicsWorld(Context* context) :
     Component(context),
     fps_(DEFAULT_FPS),
@@ -159,12 +384,37 @@ PhysicsWorld::PhysicsWorld(Context* context) :
     else
         collisionConfiguration_ = new btDefaultCollisionConfiguration();
 
-    collisionDispatcher_ = ea::make_unique<btCollisionDispatcher>(collisionConfiguration_);
-    btGImpactCollisionAlgorithm::registerAlgorithm(static_cast<btCollisionDispatcher*>(collisionDispatcher_.get()));
+#if BT_THREADSAFE
+    auto* workQueue = GetSubsystem<WorkQueue>();
+    if (PhysicsWorld::config.multiThreaded_ && workQueue && workQueue->GetNumThreads() > 0)
+    {
+        // Task scheduler must be set before creating the multithreaded objects as they allocate per-thread data
+        taskScheduler_ = ea::make_unique<PhysicsTaskScheduler>(workQueue);
+        btSetTaskScheduler(taskScheduler_.get());
+
+        collisionDispatcher_ = ea::make_unique<btCollisionDispatcherMt>(collisionConfiguration_);
+        btGImpactCollisionAlgorithm::registerAlgorithm(static_cast<btCollisionDispatcher*>(collisionDispatcher_.get()));
+
+        broadphase_ = ea::make_unique<btDbvtBroadphase>();
+        auto solverPool = ea::make_unique<btConstraintSolverPoolMt>(taskScheduler_->getNumThreads());
+        solverMt_ = ea::make_unique<btSequentialImpulseConstraintSolverMt>();
+        world_ = ea::make_unique<btDiscreteDynamicsWorldMt>(collisionDispatcher_.get(), broadphase_.get(), solverPool.get(),
+            solverMt_.get(), collisionConfiguration_);
+        solver_ = ea::move(solverPool);
+    }
+    else
+#endif
+    {
+        if (PhysicsWorld::config.multiThreaded_)
+            URHO3D_LOGWARNING("Multithreaded physics world requires worker threads and a thread-safe Bullet build, using single-threaded world");
+
+        collisionDispatcher_ = ea::make_unique<btCollisionDispatcher>(collisionConfiguration_);
+        btGImpactCollisionAlgorithm::registerAlgorithm(static_cast<btCollisionDispatcher*>(collisionDispatcher_.get()));
 
-    broadphase_ = ea::make_unique<btDbvtBroadphase>();
-    solver_ = ea::make_unique<btSequentialImpulseConstraintSolver>();
-    world_ = ea::make_unique<btDiscreteDynamicsWorld>(collisionDispatcher_.get(), broadphase_.get(), solver_.get(), collisionConfiguration_);
+        broadphase_ = ea::make_unique<btDbvtBroadphase>();
+        solver_ = ea::make_unique<btSequentialImpulseConstraintSolver>();
+        world_ = ea::make_unique<btDiscreteDynamicsWorld>(collisionDispatcher_.get(), broadphase_.get(), solver_.get(), collisionConfiguration_);
+    }
 
     world_->setGravity(ToBtVector3(DEFAULT_GRAVITY));
     world_->getDispatchInfo().m_useContinuous = true;
@@ -177,6 +427,16 @@ PhysicsWorld::PhysicsWorld(Context* context) :
 
 PhysicsWorld::~PhysicsWorld()
 {
+    // Finish the pipelined step without applying its results, the scene is being torn down
+    if (stepThread_)
+    {
+        stepThread_->WaitStep();
+        stepThread_.reset();
+        steppingAsync_ = false;
+        pipelinedWorldTransforms_.clear();
+        pipelinedNodeTransforms_.clear();
+    }
+
     if (scene_)
     {
         // Force all remaining constraints, rigid bodies and collision shapes to release themselves
@@ -191,10 +451,19 @@ PhysicsWorld::~PhysicsWorld()
     }
 
     world_.reset();
+    solverMt_.reset();
     solver_.reset();
     broadphase_.reset();
     collisionDispatcher_.reset();
 
+    // Bullet task scheduler is global, restore the default one if this world's scheduler is active
+    if (taskScheduler_)
+    {
+        if (btGetTaskScheduler() == taskScheduler_.get())
+            btSetTaskScheduler(btGetSequentialTaskScheduler());
+        taskScheduler_.reset();
+    }
+
     // Delete configuration only if it was the default created by PhysicsWorld
     if (!PhysicsWorld::config.collisionConfig_)
         delete collisionConfiguration_;
@@ -213,6 +482,8 @@ void PhysicsWorld::RegisterObject(Context* context)
     URHO3D_ATTRIBUTE("Interpolation", bool, interpolation_, true, AM_FILE);
     URHO3D_ATTRIBUTE("Internal Edge Utility", bool, internalEdge_, true, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Split Impulse", GetSplitImpulse, SetSplitImpulse, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Pipelined", IsPipelined, SetPipelined, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Cooked Geometry Path", GetCookedGeometryPath, SetCookedGeometryPath, ea::string, EMPTY_STRING, AM_DEFAULT);
 }
 
 bool PhysicsWorld::isVisible(const btVector3& aabbMin, const btVector3& aabbMax)
@@ -235,6 +506,7 @@ void PhysicsWorld::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
     {
         URHO3D_PROFILE("PhysicsDrawDebug");
 
+        SyncStep();
         debugRenderer_ = debug;
         debugDepthTest_ = depthTest;
         world_->debugDrawWorld();
@@ -260,6 +532,39 @@ void PhysicsWorld::Update(float timeStep)
 {
     URHO3D_PROFILE("UpdatePhysics");
 
+    if (stepThread_)
+    {
+        SyncStep();
+
+        // Cache kinematic body transforms, as the step thread must not read the scene
+        for (RigidBody* body : rigidBodies_)
+        {
+            if (body->IsKinematic() && body->GetBody())
+            {
+                btTransform transform;
+                body->getWorldTransform(transform);
+            }
+        }
+
+        // The pre-step event is sent once for the whole step in the pipelined mode
+        PreStep(timeStep);
+        delayedWorldTransforms_.clear();
+        asyncTimeStep_ = timeStep;
+        steppingAsync_ = true;
+        stepThread_->StartStep(timeStep);
+        return;
+    }
+
+    delayedWorldTransforms_.clear();
+    simulating_ = true;
+    StepSimulation(timeStep);
+    simulating_ = false;
+
+    ApplyDelayedWorldTransforms();
+}
+
+void PhysicsWorld::StepSimulation(float timeStep)
+{
     float internalTimeStep = 1.0f / fps_;
     int maxSubSteps = (int)(timeStep * fps_) + 1;
     if (maxSubSteps_ < 0)
@@ -270,8 +575,7 @@ void PhysicsWorld::Update(float timeStep)
     else if (maxSubSteps_ > 0)
         maxSubSteps = Min(maxSubSteps, maxSubSteps_);
 
-    delayedWorldTransforms_.clear();
-    simulating_ = true;
+    ActivateTaskScheduler();
 
     if (interpolation_)
         world_->stepSimulation(timeStep, maxSubSteps, internalTimeStep);
@@ -285,9 +589,10 @@ void PhysicsWorld::Update(float timeStep)
             --maxSubSteps;
         }
     }
+}
 
-    simulating_ = false;
-
+void PhysicsWorld::ApplyDelayedWorldTransforms()
+{
     // Apply delayed (parented) world transforms now
     while (!delayedWorldTransforms_.empty())
     {
@@ -308,11 +613,95 @@ void PhysicsWorld::Update(float timeStep)
     }
 }
 
+void PhysicsWorld::SyncStep()
+{
+    if (!steppingAsync_)
+        return;
+
+    // Components synchronize before touching Bullet state, which is only safe from the main thread
+    assert(Thread::IsMainThread());
+    URHO3D_PROFILE("SyncPhysicsStep");
+
+    stepThread_->WaitStep();
+    steppingAsync_ = false;
+
+    // Apply the buffered step results the same way as the motion states do in the synchronous update
+    simulating_ = true;
+    for (const PipelinedWorldTransform& transform : pipelinedWorldTransforms_)
+    {
+        transform.rigidBody_->setWorldTransform(btTransform(ToBtQuaternion(transform.worldRotation_),
+            ToBtVector3(transform.worldPosition_ + transform.worldRotation_ * transform.rigidBody_->GetCenterOfMass())));
+    }
+    pipelinedWorldTransforms_.clear();
+    simulating_ = false;
+    ApplyDelayedWorldTransforms();
+
+    // Node transforms set by the application during the step override the simulated ones
+    for (const PipelinedWorldTransform& transform : pipelinedNodeTransforms_)
+    {
+        if (Node* node = transform.rigidBody_->GetNode())
+            node->SetWorldTransform(transform.worldPosition_, transform.worldRotation_);
+    }
+    pipelinedNodeTransforms_.clear();
+
+    PostStep(asyncTimeStep_);
+}
+
+void PhysicsWorld::AddPipelinedWorldTransform(const PipelinedWorldTransform& transform)
+{
+    pipelinedWorldTransforms_.push_back(transform);
+}
+
+void PhysicsWorld::AddPipelinedNodeTransform(const PipelinedWorldTransform& transform)
+{
+    pipelinedNodeTransforms_.push_back(transform);
+}
+
+void PhysicsWorld::SetPipelined(bool enable)
+{
+    if (enable == IsPipelined())
+        return;
+
+    if (enable)
+    {
+        // Loops of the multithreaded world need the main thread to complete their work items
+        if (IsMultiThreaded())
+        {
+            URHO3D_LOGWARNING("Pipelined simulation is not supported with the multithreaded world");
+            return;
+        }
+
+        stepThread_ = ea::make_unique<PhysicsStepThread>(this);
+        if (!stepThread_->Run())
+        {
+            URHO3D_LOGERROR("Failed to start physics step thread");
+            stepThread_.reset();
+            return;
+        }
+        SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(PhysicsWorld, HandleBeginFrame));
+    }
+    else
+    {
+        SyncStep();
+        stepThread_.reset();
+        UnsubscribeFromEvent(E_BEGINFRAME);
+    }
+}
+
 void PhysicsWorld::UpdateCollisions()
 {
+    SyncStep();
+    ActivateTaskScheduler();
     world_->performDiscreteCollisionDetection();
 }
 
+void PhysicsWorld::ActivateTaskScheduler()
+{
+    // Several multithreaded worlds may exist, while Bullet has only one global task scheduler
+    if (taskScheduler_ && btGetTaskScheduler() != taskScheduler_.get())
+        btSetTaskScheduler(taskScheduler_.get());
+}
+
 void PhysicsWorld::SetFps(int fps)
 {
     fps_ = (unsigned)Clamp(fps, 1, 1000);
@@ -376,6 +765,8 @@ void PhysicsWorld::Raycast(ea::vector<PhysicsRaycastResult>& result, const Ray&
 {
     URHO3D_PROFILE("PhysicsRaycast");
 
+    SyncStep();
+
     if (maxDistance >= M_INFINITY)
         URHO3D_LOGWARNING("Infinite maxDistance in physics raycast is not supported");
 
@@ -404,6 +795,8 @@ void PhysicsWorld::RaycastSingle(PhysicsRaycastResult& result, const Ray& ray, f
 {
     URHO3D_PROFILE("PhysicsRaycastSingle");
 
+    SyncStep();
+
     if (maxDistance >= M_INFINITY)
         URHO3D_LOGWARNING("Infinite maxDistance in physics raycast is not supported");
 
@@ -436,6 +829,8 @@ void PhysicsWorld::RaycastSingleSegmented(PhysicsRaycastResult& result, const Ra
 {
     URHO3D_PROFILE("PhysicsRaycastSingleSegmented");
 
+    SyncStep();
+
     assert(overlapDistance < segmentDistance);
 
     if (maxDistance >= M_INFINITY)
@@ -488,6 +883,8 @@ void PhysicsWorld::SphereCast(PhysicsRaycastResult& result, const Ray& ray, floa
 {
     URHO3D_PROFILE("PhysicsSphereCast");
 
+    SyncStep();
+
     if (maxDistance >= M_INFINITY)
         URHO3D_LOGWARNING("Infinite maxDistance in physics sphere cast is not supported");
 
@@ -534,6 +931,8 @@ void PhysicsWorld::ConvexCast(PhysicsRaycastResult& result, CollisionShape* shap
         return;
     }
 
+    SyncStep();
+
     // If shape is attached in a rigidbody, set its collision group temporarily to 0 to make sure it is not returned in the sweep result
     auto* bodyComp = shape->GetComponent<RigidBody>();
     btRigidBody* body = bodyComp ? bodyComp->GetBody() : nullptr;
@@ -588,6 +987,8 @@ void PhysicsWorld::ConvexCast(PhysicsRaycastResult& result, btCollisionShape* sh
 
     URHO3D_PROFILE("PhysicsConvexCast");
 
+    SyncStep();
+
     btCollisionWorld::ClosestConvexResultCallback convexCallback(ToBtVector3(startPos), ToBtVector3(endPos));
     convexCallback.m_collisionFilterGroup = (short)0xffff;
     convexCallback.m_collisionFilterMask = (short)collisionMask;
@@ -621,10 +1022,49 @@ void PhysicsWorld::RemoveCachedGeometry(Model* model)
     RemoveCachedGeometryImpl(gimpactTrimeshCache_, model);
 }
 
+void PhysicsWorld::SetCookedGeometryPath(const ea::string& path)
+{
+    cookedGeometryPath_ = path.empty() ? EMPTY_STRING : AddTrailingSlash(path);
+}
+
+ea::string PhysicsWorld::GetCookedGeometryName(Model* model, unsigned lodLevel, bool convexHull) const
+{
+    return cookedGeometryPath_ + model->GetNameHash().ToString() + "_" + ea::to_string(lodLevel) + (convexHull ? ".hull" : ".trimesh");
+}
+
+bool PhysicsWorld::SaveCookedGeometry(const ea::string& directory) const
+{
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    const ea::string path = AddTrailingSlash(directory);
+    if (!fileSystem->CreateDirsRecursive(path))
+    {
+        URHO3D_LOGERROR("Could not create directory " + path);
+        return false;
+    }
+
+    for (const CollisionGeometryDataCache* cache : {&triMeshCache_, &convexCache_})
+    {
+        const bool convexHull = cache == &convexCache_;
+        for (const auto& item : *cache)
+        {
+            File file(context_, path + GetFileNameAndExtension(GetCookedGeometryName(item.first.first, item.first.second, convexHull)), FILE_WRITE);
+            if (!file.IsOpen() || !item.second->SaveCooked(file))
+            {
+                URHO3D_LOGERROR("Could not write cooked collision geometry to " + file.GetName());
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 void PhysicsWorld::GetRigidBodies(ea::vector<RigidBody*>& result, const Sphere& sphere, unsigned collisionMask)
 {
     URHO3D_PROFILE("PhysicsSphereQuery");
 
+    SyncStep();
+
     result.clear();
 
     btSphereShape sphereShape(sphere.radius_);
@@ -644,6 +1084,8 @@ void PhysicsWorld::GetRigidBodies(ea::vector<RigidBody*>& result, const Bounding
 {
     URHO3D_PROFILE("PhysicsBoxQuery");
 
+    SyncStep();
+
     result.clear();
 
     btBoxShape boxShape(ToBtVector3(box.HalfSize()));
@@ -662,6 +1104,8 @@ void PhysicsWorld::GetRigidBodies(ea::vector<RigidBody*>& result, const RigidBod
 {
     URHO3D_PROFILE("PhysicsBodyQuery");
 
+    SyncStep();
+
     result.clear();
 
     if (!body || !body->GetBody())
@@ -703,6 +1147,148 @@ void PhysicsWorld::GetCollidingBodies(ea::vector<RigidBody*>& result, const Rigi
     }
 }
 
+void PhysicsWorld::ExecuteQueryBatch(PhysicsQueryBatch& batch)
+{
+    URHO3D_PROFILE("PhysicsQueryBatch");
+
+    if (simulating_ || !Thread::IsMainThread())
+    {
+        URHO3D_LOGERROR("Physics query batch must be executed from the main thread outside of the simulation step");
+        return;
+    }
+
+    SyncStep();
+
+    const unsigned numQueries = batch.queries_.size();
+    batch.overlapBodies_.clear();
+    if (!numQueries)
+        return;
+
+    // Queries only read the world, but Bullet's broadphase traversal is reentrant only in the threadsafe build
+    auto* workQueue = GetSubsystem<WorkQueue>();
+    unsigned numRanges = 1;
+#if BT_THREADSAFE
+    if (workQueue && workQueue->GetNumThreads() > 0)
+        numRanges = Min(workQueue->GetNumThreads() + 1, (numQueries + MIN_QUERIES_PER_WORK_ITEM - 1) / MIN_QUERIES_PER_WORK_ITEM);
+#endif
+
+    if (numRanges <= 1)
+    {
+        ExecuteQueries(batch, 0, numQueries, batch.overlapBodies_);
+        return;
+    }
+
+    // Overlap results are collected per range and concatenated afterwards to keep them contiguous
+    queryRanges_.resize(numRanges);
+    const unsigned queriesPerRange = (numQueries + numRanges - 1) / numRanges;
+    for (unsigned i = 0; i < numRanges; ++i)
+    {
+        PhysicsQueryRange& range = queryRanges_[i];
+        range.begin_ = Min(i * queriesPerRange, numQueries);
+        range.end_ = Min(range.begin_ + queriesPerRange, numQueries);
+        range.overlapBodies_.clear();
+
+        SharedPtr<WorkItem> item = workQueue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = [](const WorkItem* item, unsigned threadIndex)
+        {
+            auto* world = reinterpret_cast<PhysicsWorld*>(item->aux_);
+            auto* batch = reinterpret_cast<PhysicsQueryBatch*>(item->end_);
+            auto* range = reinterpret_cast<PhysicsQueryRange*>(item->start_);
+            world->ExecuteQueries(*batch, range->begin_, range->end_, range->overlapBodies_);
+        };
+        item->start_ = &range;
+        item->end_ = &batch;
+        item->aux_ = this;
+        workQueue->AddWorkItem(item);
+    }
+    workQueue->Complete(M_MAX_UNSIGNED);
+
+    for (const PhysicsQueryRange& range : queryRanges_)
+    {
+        const unsigned offset = batch.overlapBodies_.size();
+        for (unsigned i = range.begin_; i < range.end_; ++i)
+            batch.queries_[i].overlapStart_ += offset;
+        batch.overlapBodies_.insert(batch.overlapBodies_.end(), range.overlapBodies_.begin(), range.overlapBodies_.end());
+    }
+}
+
+void PhysicsWorld::ExecuteQueries(PhysicsQueryBatch& batch, unsigned begin, unsigned end, ea::vector<RigidBody*>& overlapBodies) const
+{
+    for (unsigned i = begin; i < end; ++i)
+    {
+        PhysicsQuery& query = batch.queries_[i];
+        PhysicsRaycastResult& result = batch.results_[i];
+        result = PhysicsRaycastResult();
+        result.distance_ = M_INFINITY;
+
+        switch (query.type_)
+        {
+        case PQT_RAYCAST:
+        {
+            btCollisionWorld::ClosestRayResultCallback rayCallback(ToBtVector3(query.ray_.origin_),
+                ToBtVector3(query.ray_.origin_ + query.maxDistance_ * query.ray_.direction_));
+            rayCallback.m_collisionFilterGroup = (short)0xffff;
+            rayCallback.m_collisionFilterMask = (short)query.collisionMask_;
+
+            world_->rayTest(rayCallback.m_rayFromWorld, rayCallback.m_rayToWorld, rayCallback);
+
+            if (rayCallback.hasHit())
+            {
+                result.position_ = ToVector3(rayCallback.m_hitPointWorld);
+                result.normal_ = ToVector3(rayCallback.m_hitNormalWorld);
+                result.distance_ = (result.position_ - query.ray_.origin_).Length();
+                result.hitFraction_ = rayCallback.m_closestHitFraction;
+                result.body_ = static_cast<RigidBody*>(rayCallback.m_collisionObject->getUserPointer());
+            }
+            break;
+        }
+
+        case PQT_SPHERECAST:
+        {
+            btSphereShape shape(query.sphere_.radius_);
+            const Vector3 endPos = query.ray_.origin_ + query.maxDistance_ * query.ray_.direction_;
+
+            btCollisionWorld::ClosestConvexResultCallback convexCallback(ToBtVector3(query.ray_.origin_), ToBtVector3(endPos));
+            convexCallback.m_collisionFilterGroup = (short)0xffff;
+            convexCallback.m_collisionFilterMask = (short)query.collisionMask_;
+
+            world_->convexSweepTest(&shape, btTransform(btQuaternion::getIdentity(), convexCallback.m_convexFromWorld),
+                btTransform(btQuaternion::getIdentity(), convexCallback.m_convexToWorld), convexCallback);
+
+            if (convexCallback.hasHit())
+            {
+                result.body_ = static_cast<RigidBody*>(convexCallback.m_hitCollisionObject->getUserPointer());
+                result.position_ = ToVector3(convexCallback.m_hitPointWorld);
+                result.normal_ = ToVector3(convexCallback.m_hitNormalWorld);
+                result.distance_ = convexCallback.m_closestHitFraction * (endPos - query.ray_.origin_).Length();
+                result.hitFraction_ = convexCallback.m_closestHitFraction;
+            }
+            break;
+        }
+
+        case PQT_SPHERE_OVERLAP:
+        case PQT_BOX_OVERLAP:
+        {
+            const BoundingBox box = query.type_ == PQT_SPHERE_OVERLAP ? BoundingBox(query.sphere_) : query.box_;
+            query.overlapStart_ = overlapBodies.size();
+
+            PhysicsOverlapCallback callback(overlapBodies, query);
+            broadphase_->aabbTest(ToBtVector3(box.min_), ToBtVector3(box.max_), callback);
+
+            query.overlapCount_ = overlapBodies.size() - query.overlapStart_;
+            if (query.overlapCount_)
+            {
+                result.body_ = overlapBodies[query.overlapStart_];
+                result.position_ = result.body_->GetPosition();
+                result.distance_ = 0.0f;
+            }
+            break;
+        }
+        }
+    }
+}
+
 Vector3 PhysicsWorld::GetGravity() const
 {
     return ToVector3(world_->getGravity());
@@ -725,9 +1311,12 @@ void PhysicsWorld::AddRigidBody(RigidBody* body)
 
 void PhysicsWorld::RemoveRigidBody(RigidBody* body)
 {
+    SyncStep();
     rigidBodies_.erase_first(body);
     // Remove possible dangling pointer from the delayedWorldTransforms structure
     delayedWorldTransforms_.erase(body);
+    pipelinedNodeTransforms_.erase(ea::remove_if(pipelinedNodeTransforms_.begin(), pipelinedNodeTransforms_.end(),
+        [body](const PipelinedWorldTransform& transform) { return transform.rigidBody_ == body; }), pipelinedNodeTransforms_.end());
 }
 
 void PhysicsWorld::AddCollisionShape(CollisionShape* shape)
@@ -788,7 +1377,15 @@ void PhysicsWorld::OnSceneSet(Scene* scene)
         SubscribeToEvent(scene_, E_SCENESUBSYSTEMUPDATE, URHO3D_HANDLER(PhysicsWorld, HandleSceneSubsystemUpdate));
     }
     else
+    {
+        SyncStep();
         UnsubscribeFromEvent(E_SCENESUBSYSTEMUPDATE);
+    }
+}
+
+void PhysicsWorld::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+    SyncStep();
 }
 
 void PhysicsWorld::HandleSceneSubsystemUpdate(StringHash eventType, VariantMap& eventData)
@@ -1075,6 +1672,65 @@ void PhysicsWorld::SendCollisionEvents()
     previousCollisions_ = currentCollisions_;
 }
 
+unsigned PhysicsQueryBatch::AddRaycast(const Ray& ray, float maxDistance, unsigned collisionMask)
+{
+    PhysicsQuery query;
+    query.type_ = PQT_RAYCAST;
+    query.ray_ = ray;
+    query.maxDistance_ = maxDistance;
+    query.collisionMask_ = collisionMask;
+    return AddQuery(query);
+}
+
+unsigned PhysicsQueryBatch::AddSphereCast(const Ray& ray, float radius, float maxDistance, unsigned collisionMask)
+{
+    PhysicsQuery query;
+    query.type_ = PQT_SPHERECAST;
+    query.ray_ = ray;
+    query.sphere_ = Sphere(ray.origin_, radius);
+    query.maxDistance_ = maxDistance;
+    query.collisionMask_ = collisionMask;
+    return AddQuery(query);
+}
+
+unsigned PhysicsQueryBatch::AddOverlap(const Sphere& sphere, unsigned collisionMask)
+{
+    PhysicsQuery query;
+    query.type_ = PQT_SPHERE_OVERLAP;
+    query.sphere_ = sphere;
+    query.collisionMask_ = collisionMask;
+    return AddQuery(query);
+}
+
+unsigned PhysicsQueryBatch::AddOverlap(const BoundingBox& box, unsigned collisionMask)
+{
+    PhysicsQuery query;
+    query.type_ = PQT_BOX_OVERLAP;
+    query.box_ = box;
+    query.collisionMask_ = collisionMask;
+    return AddQuery(query);
+}
+
+void PhysicsQueryBatch::Clear()
+{
+    queries_.clear();
+    results_.clear();
+    overlapBodies_.clear();
+}
+
+unsigned PhysicsQueryBatch::AddQuery(const PhysicsQuery& query)
+{
+    if (query.type_ == PQT_RAYCAST || query.type_ == PQT_SPHERECAST)
+    {
+        if (query.maxDistance_ >= M_INFINITY)
+            URHO3D_LOGWARNING("Infinite maxDistance in physics query batch is not supported");
+    }
+
+    queries_.push_back(query);
+    results_.emplace_back();
+    return queries_.size() - 1;
+}
+
 void RegisterPhysicsLibrary(Context* context)
 {
     CollisionShape::RegisterObject(context);
@@ -22,10 +22,12 @@
 
 #pragma once
 
+#include <EASTL/span.h>
 #include <EASTL/unique_ptr.h>
 
 #include "../IO/VectorBuffer.h"
 #include "../Math/BoundingBox.h"
+#include "../Math/Ray.h"
 #include "../Math/Sphere.h"
 #include "../Math/Vector3.h"
 #include "../Scene/Component.h"
@@ -46,10 +48,11 @@ namespace Urho3D
 
 class CollisionShape;
 class Deserializer;
+class PhysicsStepThread;
+class PhysicsTaskScheduler;
 class Constraint;
 class Model;
 class Node;
-class Ray;
 class RigidBody;
 class Scene;
 class Serializer;
@@ -78,6 +81,92 @@ struct URHO3D_API PhysicsRaycastResult
     RigidBody* body_{};
 };
 
+/// Type of batched physics query.
+enum PhysicsQueryType
+{
+    PQT_RAYCAST = 0,
+    PQT_SPHERECAST,
+    PQT_SPHERE_OVERLAP,
+    PQT_BOX_OVERLAP
+};
+
+/// Single query of physics query batch.
+struct PhysicsQuery
+{
+    /// Query type.
+    PhysicsQueryType type_{};
+    /// Ray for casts.
+    Ray ray_;
+    /// Maximum distance for casts.
+    float maxDistance_{};
+    /// Sphere for sphere casts and overlaps.
+    Sphere sphere_;
+    /// Box for box overlaps.
+    BoundingBox box_;
+    /// Collision mask.
+    unsigned collisionMask_{};
+    /// Index of the first overlapping body in the batch.
+    unsigned overlapStart_{};
+    /// Number of overlapping bodies.
+    unsigned overlapCount_{};
+};
+
+/// Batch of physics world queries executed together after the simulation step, in parallel if possible.
+/// Results are stored in one contiguous array in the order the queries were added.
+class URHO3D_API PhysicsQueryBatch
+{
+    friend class PhysicsWorld;
+
+public:
+    /// Add closest hit raycast. Return query index.
+    unsigned AddRaycast(const Ray& ray, float maxDistance, unsigned collisionMask = M_MAX_UNSIGNED);
+    /// Add closest hit swept sphere test. Return query index.
+    unsigned AddSphereCast(const Ray& ray, float radius, float maxDistance, unsigned collisionMask = M_MAX_UNSIGNED);
+    /// Add sphere overlap test against rigid body bounding boxes. Return query index.
+    unsigned AddOverlap(const Sphere& sphere, unsigned collisionMask = M_MAX_UNSIGNED);
+    /// Add box overlap test against rigid body bounding boxes. Return query index.
+    unsigned AddOverlap(const BoundingBox& box, unsigned collisionMask = M_MAX_UNSIGNED);
+    /// Remove all queries and results.
+    void Clear();
+
+    /// Return number of queries.
+    unsigned GetNumQueries() const { return queries_.size(); }
+    /// Return queries.
+    const ea::vector<PhysicsQuery>& GetQueries() const { return queries_; }
+    /// Return results of all queries. Overlap queries report the first overlapping body.
+    const ea::vector<PhysicsRaycastResult>& GetResults() const { return results_; }
+    /// Return result of query.
+    const PhysicsRaycastResult& GetResult(unsigned index) const { return results_[index]; }
+    /// Return all bodies found by overlap query.
+    ea::span<RigidBody* const> GetOverlapBodies(unsigned index) const
+    {
+        const PhysicsQuery& query = queries_[index];
+        return { overlapBodies_.data() + query.overlapStart_, query.overlapCount_ };
+    }
+
+private:
+    /// Add query and its empty result.
+    unsigned AddQuery(const PhysicsQuery& query);
+
+    /// Queries.
+    ea::vector<PhysicsQuery> queries_;
+    /// Query results.
+    ea::vector<PhysicsRaycastResult> results_;
+    /// Bodies found by overlap queries.
+    ea::vector<RigidBody*> overlapBodies_;
+};
+
+/// Subrange of physics query batch executed by one work item.
+struct PhysicsQueryRange
+{
+    /// First query index.
+    unsigned begin_{};
+    /// Query index past the last one.
+    unsigned end_{};
+    /// Bodies found by overlap queries of this range.
+    ea::vector<RigidBody*> overlapBodies_;
+};
+
 /// Delayed world transform assignment for parented rigidbodies.
 struct DelayedWorldTransform
 {
@@ -91,6 +180,17 @@ struct DelayedWorldTransform
     Quaternion worldRotation_;
 };
 
+/// Rigid body transform buffered while the pipelined simulation step is running.
+struct PipelinedWorldTransform
+{
+    /// Rigid body.
+    RigidBody* rigidBody_;
+    /// New world position.
+    Vector3 worldPosition_;
+    /// New world rotation.
+    Quaternion worldRotation_;
+};
+
 /// Manifold pointers stored during collision processing.
 struct ManifoldPair
 {
@@ -111,12 +211,15 @@ struct ManifoldPair
 struct PhysicsWorldConfig
 {
     PhysicsWorldConfig() :
-        collisionConfig_(nullptr)
+        collisionConfig_(nullptr),
+        multiThreaded_(false)
     {
     }
 
     /// Override for the collision configuration (default btDefaultCollisionConfiguration).
     btCollisionConfiguration* collisionConfig_;
+    /// Use multithreaded Bullet world running on WorkQueue threads. Requires URHO3D_THREADING build and worker threads.
+    bool multiThreaded_;
 };
 
 static const int DEFAULT_FPS = 60;
@@ -132,6 +235,7 @@ class URHO3D_API PhysicsWorld : public Component, public btIDebugDraw
 
     friend void InternalPreTickCallback(btDynamicsWorld* world, btScalar timeStep);
     friend void InternalTickCallback(btDynamicsWorld* world, btScalar timeStep);
+    friend class PhysicsStepThread;
 
 public:
     /// Construct.
@@ -184,6 +288,9 @@ public:
     /// Set whether to interpolate between simulation steps.
     /// @property
     void SetInterpolation(bool enable);
+    /// Set whether to run the simulation step on a dedicated thread, overlapping it with the rest of the frame. Disabled by default.
+    /// @property
+    void SetPipelined(bool enable);
     /// Set whether to use Bullet's internal edge utility for trimesh collisions. Disabled by default.
     /// @property
     void SetInternalEdge(bool enable);
@@ -211,12 +318,19 @@ public:
         const Vector3& endPos, const Quaternion& endRot, unsigned collisionMask = M_MAX_UNSIGNED);
     /// Invalidate cached collision geometry for a model.
     void RemoveCachedGeometry(Model* model);
+    /// Set resource path of cooked collision geometry. Triangle meshes and convex hulls are loaded from it when available.
+    /// @property
+    void SetCookedGeometryPath(const ea::string& path);
+    /// Save cooked data of all cached triangle meshes and convex hulls to a directory.
+    bool SaveCookedGeometry(const ea::string& directory) const;
     /// Return rigid bodies by a sphere query.
     void GetRigidBodies(ea::vector<RigidBody*>& result, const Sphere& sphere, unsigned collisionMask = M_MAX_UNSIGNED);
     /// Return rigid bodies by a box query.
     void GetRigidBodies(ea::vector<RigidBody*>& result, const BoundingBox& box, unsigned collisionMask = M_MAX_UNSIGNED);
     /// Return rigid bodies by contact test with the specified body. It needs to be active to return all contacts reliably.
     void GetRigidBodies(ea::vector<RigidBody*>& result, const RigidBody* body);
+    /// Execute batched queries against the current world state. Must be called from the main thread outside of the simulation step.
+    void ExecuteQueryBatch(PhysicsQueryBatch& batch);
     /// Return rigid bodies that have been in collision with the specified body on the last simulation step. Only returns collisions that were sent as events (depends on collision event mode) and excludes e.g. static-static collisions.
     void GetCollidingBodies(ea::vector<RigidBody*>& result, const RigidBody* body);
 
@@ -240,6 +354,10 @@ public:
     /// @property
     bool GetInterpolation() const { return interpolation_; }
 
+    /// Return whether the simulation step runs on a dedicated thread.
+    /// @property
+    bool IsPipelined() const { return stepThread_ != nullptr; }
+
     /// Return whether Bullet's internal edge utility for trimesh collisions is enabled.
     /// @property
     bool GetInternalEdge() const { return internalEdge_; }
@@ -276,8 +394,21 @@ public:
     /// Set debug geometry depth test mode. Called both by PhysicsWorld itself and physics components.
     void SetDebugDepthTest(bool enable);
 
-    /// Return the Bullet physics world.
-    btDiscreteDynamicsWorld* GetWorld() { return world_.get(); }
+    /// Return the Bullet physics world. Waits for the pipelined simulation step to finish.
+    btDiscreteDynamicsWorld* GetWorld()
+    {
+        SyncStep();
+        return world_.get();
+    }
+
+    /// Wait for the pipelined simulation step to finish, then apply its transforms and send the collision and post-step events. Called by the physics components before they access Bullet state. Main thread only.
+    void SyncStep();
+    /// Return whether the pipelined simulation step is running.
+    bool IsSteppingAsync() const { return steppingAsync_; }
+    /// Buffer a rigid body transform from the pipelined simulation step. Called by RigidBody.
+    void AddPipelinedWorldTransform(const PipelinedWorldTransform& transform);
+    /// Buffer a node transform change of a rigid body during the pipelined simulation step. Called by RigidBody.
+    void AddPipelinedNodeTransform(const PipelinedWorldTransform& transform);
 
     /// Clean up the geometry cache.
     void CleanupGeometryCache();
@@ -300,6 +431,15 @@ public:
     /// Return whether is currently inside the Bullet substep loop.
     bool IsSimulating() const { return simulating_; }
 
+    /// Return resource path of cooked collision geometry.
+    /// @property
+    const ea::string& GetCookedGeometryPath() const { return cookedGeometryPath_; }
+    /// Return resource name of cooked collision geometry for a model.
+    ea::string GetCookedGeometryName(Model* model, unsigned lodLevel, bool convexHull) const;
+
+    /// Return whether the multithreaded Bullet world is used.
+    bool IsMultiThreaded() const { return taskScheduler_ != nullptr; }
+
     /// Overrides of the internal configuration.
     static struct PhysicsWorldConfig config;
 
@@ -310,12 +450,22 @@ protected:
 private:
     /// Handle the scene subsystem update event, step simulation here.
     void HandleSceneSubsystemUpdate(StringHash eventType, VariantMap& eventData);
+    /// Handle the frame begin event, wait for the pipelined simulation step here.
+    void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+    /// Step the Bullet world. Called from the main thread or from the pipelined step thread.
+    void StepSimulation(float timeStep);
+    /// Apply delayed (parented) world transforms.
+    void ApplyDelayedWorldTransforms();
     /// Trigger update before each physics simulation step.
     void PreStep(float timeStep);
     /// Trigger update after each physics simulation step.
     void PostStep(float timeStep);
     /// Send accumulated collision events.
     void SendCollisionEvents();
+    /// Make this world's task scheduler the active Bullet task scheduler.
+    void ActivateTaskScheduler();
+    /// Execute range of batched queries. Overlap query bodies are appended to the vector with range-relative indices.
+    void ExecuteQueries(PhysicsQueryBatch& batch, unsigned begin, unsigned end, ea::vector<RigidBody*>& overlapBodies) const;
 
     /// Bullet collision configuration.
     btCollisionConfiguration* collisionConfiguration_{};
@@ -323,8 +473,20 @@ private:
     ea::unique_ptr<btDispatcher> collisionDispatcher_;
     /// Bullet collision broadphase.
     ea::unique_ptr<btBroadphaseInterface> broadphase_;
-    /// Bullet constraint solver.
+    /// Bullet constraint solver. Solver pool for the multithreaded world.
     ea::unique_ptr<btConstraintSolver> solver_;
+    /// Bullet multithreaded constraint solver for large islands.
+    ea::unique_ptr<btConstraintSolver> solverMt_;
+    /// Task scheduler for the multithreaded world.
+    ea::unique_ptr<PhysicsTaskScheduler> taskScheduler_;
+    /// Work item ranges of the current query batch.
+    ea::vector<PhysicsQueryRange> queryRanges_;
+    /// Dedicated thread for the pipelined simulation step.
+    ea::unique_ptr<PhysicsStepThread> stepThread_;
+    /// Rigid body transforms from the pipelined simulation step, applied when the step is synchronized.
+    ea::vector<PipelinedWorldTransform> pipelinedWorldTransforms_;
+    /// Node transforms set during the pipelined simulation step, applied back to the rigid bodies when the step is synchronized.
+    ea::vector<PipelinedWorldTransform> pipelinedNodeTransforms_;
     /// Bullet physics world.
     ea::unique_ptr<btDiscreteDynamicsWorld> world_;
     /// Extra weak pointer to scene to allow for cleanup in case the world is destroyed before other components.
@@ -347,6 +509,8 @@ private:
     CollisionGeometryDataCache convexCache_;
     /// Cache for GImpact trimesh geometry data by model and LOD level.
     CollisionGeometryDataCache gimpactTrimeshCache_;
+    /// Resource path of cooked collision geometry.
+    ea::string cookedGeometryPath_;
     /// Preallocated event data map for physics collision events.
     VariantMap physicsCollisionData_;
     /// Preallocated event data map for node collision events.
@@ -371,6 +535,10 @@ private:
     bool applyingTransforms_{};
     /// Simulating flag.
     bool simulating_{};
+    /// Pipelined simulation step running flag.
+    bool steppingAsync_{};
+    /// Time step of the running pipelined simulation step.
+    float asyncTimeStep_{};
     /// Debug draw depth test mode.
     bool debugDepthTest_{};
     /// Debug renderer.
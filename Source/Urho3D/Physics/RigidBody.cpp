@@ -136,6 +136,7 @@ void RigidBody::ApplyAttributes()
 
 void RigidBody::OnSetEnabled()
 {
+    SyncPhysicsStep();
     bool enabled = IsEnabledEffective();
 
     if (enabled && !inWorld_)
@@ -146,6 +147,15 @@ void RigidBody::OnSetEnabled()
 
 void RigidBody::getWorldTransform(btTransform& worldTrans) const
 {
+    // The pipelined step must not read the scene, use the transform cached before the step instead
+    if (physicsWorld_ && physicsWorld_->IsSteppingAsync())
+    {
+        worldTrans.setOrigin(ToBtVector3(lastPosition_ + lastRotation_ * centerOfMass_));
+        worldTrans.setRotation(ToBtQuaternion(lastRotation_));
+        hasSimulated_ = true;
+        return;
+    }
+
     // We may be in a pathological state where a RigidBody exists without a scene node when this callback is fired,
     // so check to be sure
     if (node_)
@@ -168,6 +178,17 @@ void RigidBody::setWorldTransform(const btTransform& worldTrans)
     Vector3 newWorldPosition = ToVector3(worldTrans.getOrigin()) - newWorldRotation * centerOfMass_;
     RigidBody* parentRigidBody = nullptr;
 
+    // The pipelined step must not modify the scene, buffer the transform until the step is synchronized
+    if (physicsWorld_ && physicsWorld_->IsSteppingAsync())
+    {
+        PipelinedWorldTransform pipelined;
+        pipelined.rigidBody_ = this;
+        pipelined.worldPosition_ = newWorldPosition;
+        pipelined.worldRotation_ = newWorldRotation;
+        physicsWorld_->AddPipelinedWorldTransform(pipelined);
+        return;
+    }
+
     // It is possible that the RigidBody component has been kept alive via a shared pointer,
     // while its scene node has already been destroyed
     if (node_)
@@ -213,6 +234,7 @@ void RigidBody::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
 
 void RigidBody::SetMass(float mass)
 {
+    SyncPhysicsStep();
     mass = Max(mass, 0.0f);
 
     if (mass != mass_)
@@ -225,6 +247,7 @@ void RigidBody::SetMass(float mass)
 
 void RigidBody::SetPosition(const Vector3& position)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         btTransform& worldTrans = body_->getWorldTransform();
@@ -248,6 +271,7 @@ void RigidBody::SetPosition(const Vector3& position)
 
 void RigidBody::SetRotation(const Quaternion& rotation)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         Vector3 oldPosition = GetPosition();
@@ -274,6 +298,7 @@ void RigidBody::SetRotation(const Quaternion& rotation)
 
 void RigidBody::SetTransform(const Vector3& position, const Quaternion& rotation)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         btTransform& worldTrans = body_->getWorldTransform();
@@ -297,6 +322,7 @@ void RigidBody::SetTransform(const Vector3& position, const Quaternion& rotation
 
 void RigidBody::SetLinearVelocity(const Vector3& velocity)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setLinearVelocity(ToBtVector3(velocity));
@@ -308,6 +334,7 @@ void RigidBody::SetLinearVelocity(const Vector3& velocity)
 
 void RigidBody::SetLinearFactor(const Vector3& factor)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setLinearFactor(ToBtVector3(factor));
@@ -317,6 +344,7 @@ void RigidBody::SetLinearFactor(const Vector3& factor)
 
 void RigidBody::SetLinearRestThreshold(float threshold)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setSleepingThresholds(threshold, body_->getAngularSleepingThreshold());
@@ -326,6 +354,7 @@ void RigidBody::SetLinearRestThreshold(float threshold)
 
 void RigidBody::SetLinearDamping(float damping)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setDamping(damping, body_->getAngularDamping());
@@ -335,6 +364,7 @@ void RigidBody::SetLinearDamping(float damping)
 
 void RigidBody::SetAngularVelocity(const Vector3& velocity)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setAngularVelocity(ToBtVector3(velocity));
@@ -346,6 +376,7 @@ void RigidBody::SetAngularVelocity(const Vector3& velocity)
 
 void RigidBody::SetAngularFactor(const Vector3& factor)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setAngularFactor(ToBtVector3(factor));
@@ -355,6 +386,7 @@ void RigidBody::SetAngularFactor(const Vector3& factor)
 
 void RigidBody::SetAngularRestThreshold(float threshold)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setSleepingThresholds(body_->getLinearSleepingThreshold(), threshold);
@@ -364,6 +396,7 @@ void RigidBody::SetAngularRestThreshold(float threshold)
 
 void RigidBody::SetAngularDamping(float damping)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setDamping(body_->getLinearDamping(), damping);
@@ -373,6 +406,7 @@ void RigidBody::SetAngularDamping(float damping)
 
 void RigidBody::SetFriction(float friction)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setFriction(friction);
@@ -382,6 +416,7 @@ void RigidBody::SetFriction(float friction)
 
 void RigidBody::SetAnisotropicFriction(const Vector3& friction)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setAnisotropicFriction(ToBtVector3(friction));
@@ -391,6 +426,7 @@ void RigidBody::SetAnisotropicFriction(const Vector3& friction)
 
 void RigidBody::SetRollingFriction(float friction)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setRollingFriction(friction);
@@ -400,6 +436,7 @@ void RigidBody::SetRollingFriction(float friction)
 
 void RigidBody::SetRestitution(float restitution)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setRestitution(restitution);
@@ -409,6 +446,7 @@ void RigidBody::SetRestitution(float restitution)
 
 void RigidBody::SetContactProcessingThreshold(float threshold)
 {
+    SyncPhysicsStep();
     if (body_)
     {
         body_->setContactProcessingThreshold(threshold);
@@ -418,6 +456,7 @@ void RigidBody::SetContactProcessingThreshold(float threshold)
 
 void RigidBody::SetCcdRadius(float radius)
 {
+    SyncPhysicsStep();
     radius = Max(radius, 0.0f);
     if (body_)
     {
@@ -428,6 +467,7 @@ void RigidBody::SetCcdRadius(float radius)
 
 void RigidBody::SetCcdMotionThreshold(float threshold)
 {
+    SyncPhysicsStep();
     threshold = Max(threshold, 0.0f);
     if (body_)
     {
@@ -438,6 +478,7 @@ void RigidBody::SetCcdMotionThreshold(float threshold)
 
 void RigidBody::SetUseGravity(bool enable)
 {
+    SyncPhysicsStep();
     if (enable != useGravity_)
     {
         useGravity_ = enable;
@@ -448,6 +489,7 @@ void RigidBody::SetUseGravity(bool enable)
 
 void RigidBody::SetGravityOverride(const Vector3& gravity)
 {
+    SyncPhysicsStep();
     if (gravity != gravityOverride_)
     {
         gravityOverride_ = gravity;
@@ -458,6 +500,7 @@ void RigidBody::SetGravityOverride(const Vector3& gravity)
 
 void RigidBody::SetKinematic(bool enable)
 {
+    SyncPhysicsStep();
     if (enable != kinematic_)
     {
         kinematic_ = enable;
@@ -468,6 +511,7 @@ void RigidBody::SetKinematic(bool enable)
 
 void RigidBody::SetTrigger(bool enable)
 {
+    SyncPhysicsStep();
     if (enable != trigger_)
     {
         trigger_ = enable;
@@ -478,6 +522,7 @@ void RigidBody::SetTrigger(bool enable)
 
 void RigidBody::SetCollisionLayer(unsigned layer)
 {
+    SyncPhysicsStep();
     if (layer != collisionLayer_)
     {
         collisionLayer_ = layer;
@@ -488,6 +533,7 @@ void RigidBody::SetCollisionLayer(unsigned layer)
 
 void RigidBody::SetCollisionMask(unsigned mask)
 {
+    SyncPhysicsStep();
     if (mask != collisionMask_)
     {
         collisionMask_ = mask;
@@ -498,6 +544,7 @@ void RigidBody::SetCollisionMask(unsigned mask)
 
 void RigidBody::SetCollisionLayerAndMask(unsigned layer, unsigned mask)
 {
+    SyncPhysicsStep();
     if (layer != collisionLayer_ || mask != collisionMask_)
     {
         collisionLayer_ = layer;
@@ -515,6 +562,7 @@ void RigidBody::SetCollisionEventMode(CollisionEventMode mode)
 
 void RigidBody::ApplyForce(const Vector3& force)
 {
+    SyncPhysicsStep();
     if (body_ && force != Vector3::ZERO)
     {
         Activate();
@@ -524,6 +572,7 @@ void RigidBody::ApplyForce(const Vector3& force)
 
 void RigidBody::ApplyForce(const Vector3& force, const Vector3& position)
 {
+    SyncPhysicsStep();
     if (body_ && force != Vector3::ZERO)
     {
         Activate();
@@ -533,6 +582,7 @@ void RigidBody::ApplyForce(const Vector3& force, const Vector3& position)
 
 void RigidBody::ApplyTorque(const Vector3& torque)
 {
+    SyncPhysicsStep();
     if (body_ && torque != Vector3::ZERO)
     {
         Activate();
@@ -542,6 +592,7 @@ void RigidBody::ApplyTorque(const Vector3& torque)
 
 void RigidBody::ApplyImpulse(const Vector3& impulse)
 {
+    SyncPhysicsStep();
     if (body_ && impulse != Vector3::ZERO)
     {
         Activate();
@@ -551,6 +602,7 @@ void RigidBody::ApplyImpulse(const Vector3& impulse)
 
 void RigidBody::ApplyImpulse(const Vector3& impulse, const Vector3& position)
 {
+    SyncPhysicsStep();
     if (body_ && impulse != Vector3::ZERO)
     {
         Activate();
@@ -560,6 +612,7 @@ void RigidBody::ApplyImpulse(const Vector3& impulse, const Vector3& position)
 
 void RigidBody::ApplyTorqueImpulse(const Vector3& torque)
 {
+    SyncPhysicsStep();
     if (body_ && torque != Vector3::ZERO)
     {
         Activate();
@@ -569,18 +622,21 @@ void RigidBody::ApplyTorqueImpulse(const Vector3& torque)
 
 void RigidBody::ResetForces()
 {
+    SyncPhysicsStep();
     if (body_)
         body_->clearForces();
 }
 
 void RigidBody::Activate()
 {
+    SyncPhysicsStep();
     if (body_ && mass_ > 0.0f)
         body_->activate(true);
 }
 
 void RigidBody::ReAddBodyToWorld()
 {
+    SyncPhysicsStep();
     if (body_ && inWorld_)
         AddBodyToWorld();
 }
@@ -592,6 +648,7 @@ void RigidBody::DisableMassUpdate()
 
 void RigidBody::EnableMassUpdate()
 {
+    SyncPhysicsStep();
     if (!enableMassUpdate_)
     {
         enableMassUpdate_ = true;
@@ -601,6 +658,7 @@ void RigidBody::EnableMassUpdate()
 
 Vector3 RigidBody::GetPosition() const
 {
+    SyncPhysicsStep();
     if (body_)
     {
         const btTransform& transform = body_->getWorldTransform();
@@ -612,91 +670,109 @@ Vector3 RigidBody::GetPosition() const
 
 Quaternion RigidBody::GetRotation() const
 {
+    SyncPhysicsStep();
     return body_ ? ToQuaternion(body_->getWorldTransform().getRotation()) : Quaternion::IDENTITY;
 }
 
 Vector3 RigidBody::GetLinearVelocity() const
 {
+    SyncPhysicsStep();
     return body_ ? ToVector3(body_->getLinearVelocity()) : Vector3::ZERO;
 }
 
 Vector3 RigidBody::GetLinearFactor() const
 {
+    SyncPhysicsStep();
     return body_ ? ToVector3(body_->getLinearFactor()) : Vector3::ZERO;
 }
 
 Vector3 RigidBody::GetVelocityAtPoint(const Vector3& position) const
 {
+    SyncPhysicsStep();
     return body_ ? ToVector3(body_->getVelocityInLocalPoint(ToBtVector3(position - centerOfMass_))) : Vector3::ZERO;
 }
 
 float RigidBody::GetLinearRestThreshold() const
 {
+    SyncPhysicsStep();
     return body_ ? body_->getLinearSleepingThreshold() : 0.0f;
 }
 
 float RigidBody::GetLinearDamping() const
 {
+    SyncPhysicsStep();
     return body_ ? body_->getLinearDamping() : 0.0f;
 }
 
 Vector3 RigidBody::GetAngularVelocity() const
 {
+    SyncPhysicsStep();
     return body_ ? ToVector3(body_->getAngularVelocity()) : Vector3::ZERO;
 }
 
 Vector3 RigidBody::GetAngularFactor() const
 {
+    SyncPhysicsStep();
     return body_ ? ToVector3(body_->getAngularFactor()) : Vector3::ZERO;
 }
 
 float RigidBody::GetAngularRestThreshold() const
 {
+    SyncPhysicsStep();
     return body_ ? body_->getAngularSleepingThreshold() : 0.0f;
 }
 
 float RigidBody::GetAngularDamping() const
 {
+    SyncPhysicsStep();
     return body_ ? body_->getAngularDamping() : 0.0f;
 }
 
 float RigidBody::GetFriction() const
 {
+    SyncPhysicsStep();
     return body_ ? body_->getFriction() : 0.0f;
 }
 
 Vector3 RigidBody::GetAnisotropicFriction() const
 {
+    SyncPhysicsStep();
     return body_ ? ToVector3(body_->getAnisotropicFriction()) : Vector3::ZERO;
 }
 
 float RigidBody::GetRollingFriction() const
 {
+    SyncPhysicsStep();
     return body_ ? body_->getRollingFriction() : 0.0f;
 }
 
 float RigidBody::GetRestitution() const
 {
+    SyncPhysicsStep();
     return body_ ? body_->getRestitution() : 0.0f;
 }
 
 float RigidBody::GetContactProcessingThreshold() const
 {
+    SyncPhysicsStep();
     return body_ ? body_->getContactProcessingThreshold() : 0.0f;
 }
 
 float RigidBody::GetCcdRadius() const
 {
+    SyncPhysicsStep();
     return body_ ? body_->getCcdSweptSphereRadius() : 0.0f;
 }
 
 float RigidBody::GetCcdMotionThreshold() const
 {
+    SyncPhysicsStep();
     return body_ ? body_->getCcdMotionThreshold() : 0.0f;
 }
 
 bool RigidBody::IsActive() const
 {
+    SyncPhysicsStep();
     return body_ ? body_->isActive() : false;
 }
 
@@ -738,6 +814,7 @@ void RigidBody::ApplyWorldTransform(const Vector3& newWorldPosition, const Quate
 
 void RigidBody::UpdateMass()
 {
+    SyncPhysicsStep();
     if (!body_ || !enableMassUpdate_)
         return;
 
@@ -821,6 +898,7 @@ void RigidBody::UpdateMass()
 
 void RigidBody::UpdateGravity()
 {
+    SyncPhysicsStep();
     if (physicsWorld_ && body_)
     {
         btDiscreteDynamicsWorld* world = physicsWorld_->GetWorld();
@@ -874,6 +952,7 @@ void RigidBody::RemoveConstraint(Constraint* constraint)
 
 void RigidBody::ReleaseBody()
 {
+    SyncPhysicsStep();
     if (body_)
     {
         // Release all constraints which refer to this body
@@ -905,6 +984,17 @@ void RigidBody::OnMarkedDirty(Node* node)
             return;
         }
 
+        // The pipelined step may be using the body, apply the node transform after the step instead
+        if (physicsWorld_ && physicsWorld_->IsSteppingAsync())
+        {
+            PipelinedWorldTransform pipelined;
+            pipelined.rigidBody_ = this;
+            pipelined.worldPosition_ = node_->GetWorldPosition();
+            pipelined.worldRotation_ = node_->GetWorldRotation();
+            physicsWorld_->AddPipelinedNodeTransform(pipelined);
+            return;
+        }
+
         // Check if transform has changed from the last one set in ApplyWorldTransform()
         Vector3 newPosition = node_->GetWorldPosition();
         Quaternion newRotation = node_->GetWorldRotation();
@@ -949,8 +1039,15 @@ void RigidBody::OnSceneSet(Scene* scene)
     }
 }
 
+void RigidBody::SyncPhysicsStep() const
+{
+    if (physicsWorld_)
+        physicsWorld_->SyncStep();
+}
+
 void RigidBody::AddBodyToWorld()
 {
+    SyncPhysicsStep();
     if (!physicsWorld_)
         return;
 
@@ -1027,6 +1124,7 @@ void RigidBody::AddBodyToWorld()
 
 void RigidBody::RemoveBodyFromWorld()
 {
+    SyncPhysicsStep();
     if (physicsWorld_ && body_ && inWorld_)
     {
         btDiscreteDynamicsWorld* world = physicsWorld_->GetWorld();
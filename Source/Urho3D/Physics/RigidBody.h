@@ -308,6 +308,8 @@ protected:
     void OnMarkedDirty(Node* node) override;
 
 private:
+    /// Wait for the pipelined physics step to finish before accessing Bullet state.
+    void SyncPhysicsStep() const;
     /// Create the rigid body, or re-add to the physics world with changed flags. Calls UpdateMass().
     void AddBodyToWorld();
     /// Remove the rigid body from the physics world.
@@ -25,102 +25,201 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Core/ProcessUtils.h"
 #include "../Core/Profiler.h"
 #include "../IO/Log.h"
 #include "../Resource/BackgroundLoader.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/ResourceEvents.h"
 
+#include <EASTL/heap.h>
+#include <EASTL/sort.h>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
+/// Maximum default number of loader threads.
+static const unsigned MAX_DEFAULT_THREADS = 4;
+
+void BackgroundLoaderThread::ThreadFunction()
+{
+    while (shouldRun_)
+    {
+        // Sleep when no resources to load or tasks to run found
+        if (!owner_->LoadNextResource() && !owner_->RunNextTask())
+            Time::Sleep(5);
+    }
+}
+
 BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
-    owner_(owner)
+    owner_(owner),
+    numThreads_(Clamp(GetNumPhysicalCPUs() / 2, 1u, MAX_DEFAULT_THREADS)),
+    sequence_(0)
 {
 }
 
 BackgroundLoader::~BackgroundLoader()
 {
+    // Stop the threads without holding the mutex, as they may be waiting for it
+    ea::vector<ea::unique_ptr<BackgroundLoaderThread> > threads;
+    {
+        MutexLock lock(backgroundLoadMutex_);
+        threads.swap(threads_);
+    }
+    for (auto& thread : threads)
+        thread->Stop();
+
     MutexLock lock(backgroundLoadMutex_);
 
     backgroundLoadQueue_.clear();
+    loadOrder_.clear();
+    tasks_.clear();
 }
 
-void BackgroundLoader::ThreadFunction()
+void BackgroundLoader::SetNumThreads(unsigned numThreads)
 {
-    while (shouldRun_)
+    ea::vector<ea::unique_ptr<BackgroundLoaderThread> > removedThreads;
     {
-        backgroundLoadMutex_.Acquire();
+        MutexLock lock(backgroundLoadMutex_);
 
-        // Search for a queued resource that has not been loaded yet
-        auto i = backgroundLoadQueue_.begin();
-        while (i != backgroundLoadQueue_.end())
+        numThreads_ = Max(numThreads, 1u);
+        while (threads_.size() > numThreads_)
         {
-            if (i->second.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
+            removedThreads.push_back(ea::move(threads_.back()));
+            threads_.pop_back();
         }
+        // Start the additional threads now only if loading has already started
+        if (!threads_.empty())
+            StartThreads();
+    }
 
-        if (i == backgroundLoadQueue_.end())
-        {
-            // No resources to load found
-            backgroundLoadMutex_.Release();
-            Time::Sleep(5);
-        }
-        else
-        {
-            BackgroundLoadItem& item = i->second;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
+    for (auto& thread : removedThreads)
+        thread->Stop();
+}
 
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
-            {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
-            }
+bool BackgroundLoader::LoadNextResource()
+{
+    backgroundLoadMutex_.Acquire();
 
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            ea::pair<StringHash, StringHash> key = ea::make_pair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.size())
-            {
-                for (auto i = item.dependents_.begin(); i != item.dependents_.end(); ++i)
-                {
-                    auto j = backgroundLoadQueue_.find(*i);
-                    if (j != backgroundLoadQueue_.end())
-                        j->second.dependencies_.erase(key);
-                }
+    // Search for the queued resource with the highest priority. Skip the entries of resources already loaded,
+    // cancelled or reprioritized
+    while (!loadOrder_.empty())
+    {
+        ea::pop_heap(loadOrder_.begin(), loadOrder_.end());
+        const BackgroundLoadOrder order = loadOrder_.back();
+        loadOrder_.pop_back();
+
+        auto i = backgroundLoadQueue_.find(order.key_);
+        if (i == backgroundLoadQueue_.end() || i->second.priority_ != order.priority_ ||
+            i->second.resource_->GetAsyncLoadState() != ASYNC_QUEUED)
+            continue;
+
+        BackgroundLoadItem& item = i->second;
+        Resource* resource = item.resource_;
+        // We can be sure that the item is not removed from the queue as long as it is in the "loading" state
+        resource->SetAsyncLoadState(ASYNC_LOADING);
+        backgroundLoadMutex_.Release();
+
+        bool success = false;
+        SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+        if (file)
+            success = resource->BeginLoad(*file);
 
-                item.dependents_.clear();
+        // Process dependencies now
+        // Need to lock the queue again when manipulating other entries
+        backgroundLoadMutex_.Acquire();
+        if (item.dependents_.size())
+        {
+            for (auto j = item.dependents_.begin(); j != item.dependents_.end(); ++j)
+            {
+                auto k = backgroundLoadQueue_.find(*j);
+                if (k != backgroundLoadQueue_.end())
+                    k->second.dependencies_.erase(order.key_);
             }
 
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
+            item.dependents_.clear();
         }
+
+        resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+        backgroundLoadMutex_.Release();
+        return true;
     }
+
+    backgroundLoadMutex_.Release();
+    return false;
+}
+
+void BackgroundLoader::QueueTask(ea::function<void()> task)
+{
+    MutexLock lock(backgroundLoadMutex_);
+
+    tasks_.push_back(ea::move(task));
+    StartThreads();
+}
+
+bool BackgroundLoader::RunNextTask()
+{
+    ea::function<void()> task;
+    {
+        MutexLock lock(backgroundLoadMutex_);
+        if (tasks_.empty())
+            return false;
+
+        task = ea::move(tasks_.front());
+        tasks_.pop_front();
+    }
+
+    task();
+    return true;
 }
 
-bool BackgroundLoader::QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller)
+bool BackgroundLoader::QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller, int priority)
 {
     StringHash nameHash(name);
     ea::pair<StringHash, StringHash> key = ea::make_pair(type, nameHash);
 
     MutexLock lock(backgroundLoadMutex_);
 
-    // Check if already exists in the queue
-    if (backgroundLoadQueue_.find(key) != backgroundLoadQueue_.end())
+    // A resource queued by another resource is loaded at least with the priority of the caller
+    ea::pair<StringHash, StringHash> callerKey;
+    auto callerItem = backgroundLoadQueue_.end();
+    if (caller)
+    {
+        callerKey = ea::make_pair(caller->GetType(), caller->GetNameHash());
+        callerItem = backgroundLoadQueue_.find(callerKey);
+        if (callerItem != backgroundLoadQueue_.end())
+            priority = Max(priority, callerItem->second.priority_);
+        else
+        {
+            URHO3D_LOGWARNING("Resource " + caller->GetName() +
+                       " requested for a background loaded resource but was not in the background load queue");
+        }
+    }
+
+    // Check if already exists in the queue. If so, it may now be needed sooner or by another resource
+    auto existing = backgroundLoadQueue_.find(key);
+    if (existing != backgroundLoadQueue_.end())
+    {
+        BackgroundLoadItem& item = existing->second;
+        item.cancelled_ = false;
+
+        const AsyncLoadState state = item.resource_->GetAsyncLoadState();
+        if (callerItem != backgroundLoadQueue_.end() && callerKey != key && (state == ASYNC_QUEUED || state == ASYNC_LOADING))
+        {
+            item.dependents_.insert(callerKey);
+            callerItem->second.dependencies_.insert(key);
+        }
+
+        RaisePriority(key, priority);
         return false;
+    }
 
     BackgroundLoadItem& item = backgroundLoadQueue_[key];
     item.sendEventOnFailure_ = sendEventOnFailure;
+    item.priority_ = priority;
+    item.cancelled_ = false;
 
     // Make sure the pointer is non-null and is a Resource subclass
     item.resource_ = DynamicCast<Resource>(owner_->GetContext()->CreateObject(type));
@@ -146,51 +245,75 @@ bool BackgroundLoader::QueueResource(StringHash type, const ea::string& name, bo
     item.resource_->SetName(name);
     item.resource_->SetAsyncLoadState(ASYNC_QUEUED);
 
-    // If this is a resource calling for the background load of more resources, mark the dependency as necessary
+    // If this is a resource calling for the background load of more resources, mark the dependency as necessary.
+    // Look up the caller again, as inserting the item may have invalidated the iterator
     if (caller)
     {
-        ea::pair<StringHash, StringHash> callerKey = ea::make_pair(caller->GetType(), caller->GetNameHash());
-        auto j = backgroundLoadQueue_.find(
-            callerKey);
+        auto j = backgroundLoadQueue_.find(callerKey);
         if (j != backgroundLoadQueue_.end())
         {
             BackgroundLoadItem& callerItem = j->second;
             item.dependents_.insert(callerKey);
             callerItem.dependencies_.insert(key);
         }
-        else
-            URHO3D_LOGWARNING("Resource " + caller->GetName() +
-                       " requested for a background loaded resource but was not in the background load queue");
     }
 
-    // Start the background loader thread now
-    if (!IsStarted())
-        Run();
+    loadOrder_.push_back(BackgroundLoadOrder{priority, sequence_++, key});
+    ea::push_heap(loadOrder_.begin(), loadOrder_.end());
+
+    // Start the background loader threads now
+    StartThreads();
 
     return true;
 }
 
+bool BackgroundLoader::CancelResource(StringHash type, StringHash nameHash)
+{
+    ea::pair<StringHash, StringHash> key = ea::make_pair(type, nameHash);
+
+    MutexLock lock(backgroundLoadMutex_);
+
+    auto i = backgroundLoadQueue_.find(key);
+    if (i == backgroundLoadQueue_.end())
+        return false;
+
+    // Can not cancel if another queued resource needs this one
+    if (!i->second.dependents_.empty())
+        return false;
+
+    URHO3D_LOGDEBUG("Cancelled background loading resource " + i->second.resource_->GetName());
+    CancelQueuedResource(key);
+    return true;
+}
+
 void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 {
     backgroundLoadMutex_.Acquire();
 
     // Check if the resource in question is being background loaded
     ea::pair<StringHash, StringHash> key = ea::make_pair(type, nameHash);
-    auto i = backgroundLoadQueue_.find(
-        key);
+    auto i = backgroundLoadQueue_.find(key);
     if (i != backgroundLoadQueue_.end())
     {
+        BackgroundLoadItem& item = i->second;
+        Resource* resource = item.resource_;
+
+        // The resource is needed now, so load it and its dependencies before anything else
+        item.cancelled_ = false;
+        RaisePriority(key, M_MAX_INT);
         backgroundLoadMutex_.Release();
 
         {
-            Resource* resource = i->second.resource_;
             HiresTimer waitTimer;
             bool didWait = false;
 
             for (;;)
             {
-                unsigned numDeps = i->second.dependencies_.size();
+                backgroundLoadMutex_.Acquire();
+                unsigned numDeps = item.dependencies_.size();
                 AsyncLoadState state = resource->GetAsyncLoadState();
+                backgroundLoadMutex_.Release();
+
                 if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
                 {
                     didWait = true;
@@ -205,49 +328,76 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
                          resource->GetName());
         }
 
-        // This may take a long time and may potentially wait on other resources, so it is important we do not hold the mutex during this
-        FinishBackgroundLoading(i->second);
+        // This may take a long time and may potentially wait on other resources, so it is important we do not hold the mutex during this.
+        // The resource is needed now, so finish its possible partial upload without a budget
+        for (;;)
+        {
+            unsigned budget = M_MAX_UNSIGNED;
+            if (FinishBackgroundLoading(item, budget))
+                break;
+        }
 
         backgroundLoadMutex_.Acquire();
-        backgroundLoadQueue_.erase(i);
+        backgroundLoadQueue_.erase(key);
         backgroundLoadMutex_.Release();
     }
     else
         backgroundLoadMutex_.Release();
 }
 
-void BackgroundLoader::FinishResources(int maxMs)
+void BackgroundLoader::FinishResources(int maxMs, unsigned maxBytes)
 {
-    if (IsStarted())
-    {
-        HiresTimer timer;
+    HiresTimer timer;
+    unsigned budget = maxBytes;
 
-        backgroundLoadMutex_.Acquire();
+    // Collect the resources ready to finish, highest priority first. Drop the cancelled resources whose loading has ended
+    ea::vector<ea::pair<int, ea::pair<StringHash, StringHash> > > readyResources;
+    {
+        MutexLock lock(backgroundLoadMutex_);
 
-        for (auto i = backgroundLoadQueue_.begin();
-             i != backgroundLoadQueue_.end();)
+        for (auto i = backgroundLoadQueue_.begin(); i != backgroundLoadQueue_.end();)
         {
-            Resource* resource = i->second.resource_;
-            unsigned numDeps = i->second.dependencies_.size();
-            AsyncLoadState state = resource->GetAsyncLoadState();
+            BackgroundLoadItem& item = i->second;
+            unsigned numDeps = item.dependencies_.size();
+            AsyncLoadState state = item.resource_->GetAsyncLoadState();
             if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
                 ++i;
-            else
+            else if (item.cancelled_)
             {
-                // Finishing a resource may need it to wait for other resources to load, in which case we can not
-                // hold on to the mutex
-                backgroundLoadMutex_.Release();
-                FinishBackgroundLoading(i->second);
-                backgroundLoadMutex_.Acquire();
+                item.resource_->SetAsyncLoadState(ASYNC_DONE);
                 i = backgroundLoadQueue_.erase(i);
             }
-
-            // Break when the time limit passed so that we keep sufficient FPS
-            if (timer.GetUSec(false) >= maxMs * 1000LL)
-                break;
+            else
+            {
+                readyResources.emplace_back(-item.priority_, i->first);
+                ++i;
+            }
         }
+    }
+
+    ea::sort(readyResources.begin(), readyResources.end());
 
+    for (const auto& ready : readyResources)
+    {
+        // Finishing a resource may need it to wait for other resources to load, in which case we can not
+        // hold on to the mutex. It may also have finished some of the collected resources already
+        backgroundLoadMutex_.Acquire();
+        auto i = backgroundLoadQueue_.find(ready.second);
+        const bool found = i != backgroundLoadQueue_.end();
+        BackgroundLoadItem* item = found ? &i->second : nullptr;
         backgroundLoadMutex_.Release();
+
+        // A resource over the upload budget stays in the queue to continue on the next frame
+        if (item && FinishBackgroundLoading(*item, budget))
+        {
+            backgroundLoadMutex_.Acquire();
+            backgroundLoadQueue_.erase(ready.second);
+            backgroundLoadMutex_.Release();
+        }
+
+        // Break when the time limit passed or the upload budget is used up so that we keep sufficient FPS
+        if (timer.GetUSec(false) >= maxMs * 1000LL || !budget)
+            break;
     }
 }
 
@@ -257,18 +407,21 @@ unsigned BackgroundLoader::GetNumQueuedResources() const
     return backgroundLoadQueue_.size();
 }
 
-void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
+bool BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item, unsigned& budget)
 {
     Resource* resource = item.resource_;
 
     bool success = resource->GetAsyncLoadState() == ASYNC_SUCCESS;
-    // If BeginLoad() phase was successful, call EndLoad() and get the final success/failure result
+    // If BeginLoad() phase was successful, call EndLoadPartial() and get the final success/failure result once finished
     if (success)
     {
         URHO3D_PROFILE("FinishBackgroundLoading");
         URHO3D_PROFILE_ZONENAME(resource->GetTypeName().c_str(), resource->GetTypeName().length());
         URHO3D_LOGDEBUG("Finishing background loaded resource " + resource->GetName());
-        success = resource->EndLoad();
+        bool finished = true;
+        success = resource->EndLoadPartial(budget, finished);
+        if (success && !finished)
+            return false;
     }
     resource->SetAsyncLoadState(ASYNC_DONE);
 
@@ -295,6 +448,71 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
         eventData[P_RESOURCE] = resource;
         owner_->SendEvent(E_RESOURCEBACKGROUNDLOADED, eventData);
     }
+
+    return true;
+}
+
+void BackgroundLoader::RaisePriority(const ea::pair<StringHash, StringHash>& key, int priority)
+{
+    auto i = backgroundLoadQueue_.find(key);
+    if (i == backgroundLoadQueue_.end() || i->second.priority_ >= priority)
+        return;
+
+    BackgroundLoadItem& item = i->second;
+    item.priority_ = priority;
+    if (item.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+    {
+        loadOrder_.push_back(BackgroundLoadOrder{priority, sequence_++, key});
+        ea::push_heap(loadOrder_.begin(), loadOrder_.end());
+    }
+
+    for (const auto& dependency : item.dependencies_)
+        RaisePriority(dependency, priority);
+}
+
+void BackgroundLoader::CancelQueuedResource(const ea::pair<StringHash, StringHash>& key)
+{
+    auto i = backgroundLoadQueue_.find(key);
+    if (i == backgroundLoadQueue_.end())
+        return;
+
+    BackgroundLoadItem& item = i->second;
+    ea::vector<ea::pair<StringHash, StringHash> > dependencies(item.dependencies_.begin(), item.dependencies_.end());
+    item.dependencies_.clear();
+
+    for (const auto& dependency : dependencies)
+    {
+        auto j = backgroundLoadQueue_.find(dependency);
+        if (j != backgroundLoadQueue_.end())
+            j->second.dependents_.erase(key);
+    }
+
+    // A resource being loaded can not be removed until the loader thread is done with it
+    if (item.resource_->GetAsyncLoadState() == ASYNC_LOADING)
+        item.cancelled_ = true;
+    else
+    {
+        item.resource_->SetAsyncLoadState(ASYNC_DONE);
+        backgroundLoadQueue_.erase(i);
+    }
+
+    // Cancel the dependencies no other resource needs
+    for (const auto& dependency : dependencies)
+    {
+        auto j = backgroundLoadQueue_.find(dependency);
+        if (j != backgroundLoadQueue_.end() && j->second.dependents_.empty() && !j->second.cancelled_)
+            CancelQueuedResource(dependency);
+    }
+}
+
+void BackgroundLoader::StartThreads()
+{
+    while (threads_.size() < numThreads_)
+    {
+        auto thread = ea::make_unique<BackgroundLoaderThread>(this);
+        thread->Run();
+        threads_.push_back(ea::move(thread));
+    }
 }
 
 }
@@ -22,7 +22,10 @@
 
 #pragma once
 
+#include <EASTL/deque.h>
+#include <EASTL/functional.h>
 #include <EASTL/hash_set.h>
+#include <EASTL/unique_ptr.h>
 #include <EASTL/unordered_map.h>
 
 #include "../Core/Mutex.h"
@@ -33,6 +36,7 @@
 namespace Urho3D
 {
 
+class BackgroundLoader;
 class Resource;
 class ResourceCache;
 
@@ -45,44 +49,105 @@ struct URHO3D_API BackgroundLoadItem
     ea::hash_set<ea::pair<StringHash, StringHash> > dependencies_;
     /// Resources that depend on this resource's loading.
     ea::hash_set<ea::pair<StringHash, StringHash> > dependents_;
+    /// Load priority. Higher value = will be loaded first.
+    int priority_;
     /// Whether to send failure event.
     bool sendEventOnFailure_;
+    /// Whether the load has been cancelled while in progress.
+    bool cancelled_;
 };
 
-/// Background loader of resources. Owned by the ResourceCache.
+/// Entry of the background load order. May be stale if the item has been loaded, cancelled or reprioritized since.
+struct BackgroundLoadOrder
+{
+    /// Return whether this entry should be loaded after the other.
+    bool operator <(const BackgroundLoadOrder& rhs) const
+    {
+        return priority_ != rhs.priority_ ? priority_ < rhs.priority_ : sequence_ > rhs.sequence_;
+    }
+
+    /// Load priority.
+    int priority_;
+    /// Queueing sequence number to load the resources of equal priority in queueing order.
+    unsigned sequence_;
+    /// Resource type and name hash.
+    ea::pair<StringHash, StringHash> key_;
+};
+
+/// Background resource loader thread.
+class BackgroundLoaderThread : public Thread
+{
+public:
+    /// Construct.
+    explicit BackgroundLoaderThread(BackgroundLoader* owner) : Thread("BackgroundLoader"), owner_(owner) { }
+
+    /// Resource background loading loop.
+    void ThreadFunction() override;
+
+private:
+    /// Background loader.
+    BackgroundLoader* owner_;
+};
+
+/// Background loader of resources. Owned by the ResourceCache. Loads resources on a pool of threads in priority order.
 /// @nobind
-class URHO3D_API BackgroundLoader : public RefCounted, public Thread
+class URHO3D_API BackgroundLoader : public RefCounted
 {
 public:
     /// Construct.
     explicit BackgroundLoader(ResourceCache* owner);
 
-    /// Destruct. Forcibly clear the load queue.
+    /// Destruct. Stop the loader threads and forcibly clear the load queue.
     ~BackgroundLoader() override;
 
-    /// Resource background loading loop.
-    void ThreadFunction() override;
-
-    /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
-    bool QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller);
+    /// Set number of loader threads. Existing threads are stopped after finishing their current resource.
+    void SetNumThreads(unsigned numThreads);
+    /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type). If already queued, the priority is raised if higher.
+    bool QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller, int priority = 0);
+    /// Cancel loading of a resource and the dependencies no other resource needs. Return true if cancelled. Resources other queued resources depend on can not be cancelled.
+    bool CancelResource(StringHash type, StringHash nameHash);
     /// Wait and finish possible loading of a resource when being requested from the cache.
     void WaitForResource(StringHash type, StringHash nameHash);
-    /// Process resources that are ready to finish.
-    void FinishResources(int maxMs);
+    /// Process resources that are ready to finish, within a time limit and a GPU upload byte budget. Resources over the budget continue on the next call.
+    void FinishResources(int maxMs, unsigned maxBytes = M_MAX_UNSIGNED);
+    /// Load the queued resource with the highest priority. Return false if none is waiting to be loaded. Called by the loader threads.
+    bool LoadNextResource();
+    /// Queue a task to run on a loader thread when no resource is waiting to be loaded.
+    void QueueTask(ea::function<void()> task);
+    /// Run the oldest queued task. Return false if none is queued. Called by the loader threads.
+    bool RunNextTask();
 
+    /// Return number of loader threads.
+    unsigned GetNumThreads() const { return numThreads_; }
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
 
 private:
-    /// Finish one background loaded resource.
-    void FinishBackgroundLoading(BackgroundLoadItem& item);
+    /// Finish one background loaded resource or a part of it within the upload byte budget. Return true when the resource is done.
+    bool FinishBackgroundLoading(BackgroundLoadItem& item, unsigned& budget);
+    /// Raise the priority of a queued resource and its dependencies. Called with the mutex held.
+    void RaisePriority(const ea::pair<StringHash, StringHash>& key, int priority);
+    /// Remove a resource from the load queue and detach it from its dependencies, cancelling those no longer needed. Called with the mutex held.
+    void CancelQueuedResource(const ea::pair<StringHash, StringHash>& key);
+    /// Start the loader threads if not started yet. Called with the mutex held.
+    void StartThreads();
 
     /// Resource cache.
     ResourceCache* owner_;
+    /// Loader threads.
+    ea::vector<ea::unique_ptr<BackgroundLoaderThread> > threads_;
+    /// Number of loader threads.
+    unsigned numThreads_;
     /// Mutex for thread-safe access to the background load queue.
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
     ea::unordered_map<ea::pair<StringHash, StringHash>, BackgroundLoadItem> backgroundLoadQueue_;
+    /// Load order of the queued resources as a heap.
+    ea::vector<BackgroundLoadOrder> loadOrder_;
+    /// Next queueing sequence number.
+    unsigned sequence_;
+    /// Tasks queued to run on the loader threads.
+    ea::deque<ea::function<void()> > tasks_;
 };
 
 }
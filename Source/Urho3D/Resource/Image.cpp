@@ -24,11 +24,16 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../Resource/Decompress.h"
 
+#include <atomic>
+#include <thread>
+
 #include <SDL/SDL_surface.h>
 #include <STB/stb_image.h>
 #include <STB/stb_image_write.h>
@@ -38,6 +43,10 @@
 #include <webp/mux.h>
 #endif
 
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 #ifndef MAKEFOURCC
@@ -85,6 +94,13 @@ static const unsigned DDS_DXGI_FORMAT_BC2_UNORM_SRGB = 75;
 static const unsigned DDS_DXGI_FORMAT_BC3_UNORM = 77;
 static const unsigned DDS_DXGI_FORMAT_BC3_UNORM_SRGB = 78;
 
+/// Smallest mip level in pixels that is generated in parallel on the worker threads.
+static const int PARALLEL_MIP_MIN_PIXELS = 256 * 256;
+/// Number of output rows taken at a time when generating a mip level in parallel.
+static const int PARALLEL_MIP_ROWS = 16;
+/// Number of quantized linear values in the sRGB conversion table.
+static const unsigned SRGB_TABLE_SIZE = 16384;
+
 namespace Urho3D
 {
 
@@ -1187,6 +1203,27 @@ bool Image::Resize(int width, int height)
     if (!data_ || width <= 0 || height <= 0)
         return false;
 
+    // Reducing both dimensions by the same power of two uses the box filtered mip levels, which sample all pixels
+    unsigned levels = 1;
+    while ((width_ >> levels) > width && (height_ >> levels) > height)
+        ++levels;
+    if (width < width_ && height < height_ && (width_ >> levels) == width && (height_ >> levels) == height)
+    {
+        SharedPtr<Image> level = GetNextLevel();
+        for (unsigned i = 1; i < levels && level; ++i)
+            level = level->GetNextLevel();
+
+        if (level)
+        {
+            width_ = width;
+            height_ = height;
+            data_ = level->data_;
+            nextLevel_ = level->nextLevel_;
+            SetMemoryUse(width * height * depth_ * components_);
+            return true;
+        }
+    }
+
     /// \todo Reducing image size does not sample all needed pixels
     ea::shared_array<unsigned char> newData(new unsigned char[width * height * components_]);
     for (int y = 0; y < height; ++y)
@@ -1221,10 +1258,20 @@ bool Image::Resize(int width, int height)
     width_ = width;
     height_ = height;
     data_ = newData;
+    nextLevel_.Reset();
     SetMemoryUse(width * height * depth_ * components_);
     return true;
 }
 
+void Image::SetSRGB(bool enable)
+{
+    if (enable != sRGB_)
+    {
+        sRGB_ = enable;
+        nextLevel_.Reset();
+    }
+}
+
 void Image::Clear(const Color& color)
 {
     ClearInt(color.ToUInt());
@@ -1601,6 +1648,85 @@ Color Image::GetPixelTrilinear(float x, float y, float z) const
     return colorNear.Lerp(colorFar, zF);
 }
 
+/// Lookup tables for averaging sRGB pixels in linear space.
+struct SRGBTables
+{
+    /// Linear value of each sRGB byte value.
+    float toLinear_[256];
+    /// sRGB byte value of each quantized linear value.
+    unsigned char toSRGB_[SRGB_TABLE_SIZE];
+};
+
+/// Return the sRGB lookup tables, initialized on first use.
+static const SRGBTables& GetSRGBTables()
+{
+    static const SRGBTables tables = []()
+    {
+        SRGBTables ret;
+        for (unsigned i = 0; i < 256; ++i)
+            ret.toLinear_[i] = Color::ConvertGammaToLinear(i / 255.0f);
+        for (unsigned i = 0; i < SRGB_TABLE_SIZE; ++i)
+            ret.toSRGB_[i] = (unsigned char)Clamp(Color::ConvertLinearToGamma(i / (float)(SRGB_TABLE_SIZE - 1)) * 255.0f + 0.5f, 0.0f, 255.0f);
+        return ret;
+    }();
+    return tables;
+}
+
+/// Average the 2x2 pixel blocks of two image rows into one row of the next mip level. With sRGB tables, the color channels are averaged in linear space.
+static void DownsampleRow(const unsigned char* upper, const unsigned char* lower, unsigned char* out, int widthOut,
+    unsigned components, const SRGBTables* srgb)
+{
+    if (srgb)
+    {
+        // Alpha is always linear
+        const unsigned colorComponents = components == 2 ? 1 : Min(components, 3U);
+        for (int x = 0; x < widthOut; ++x)
+        {
+            const unsigned char* u = &upper[x * 2 * components];
+            const unsigned char* l = &lower[x * 2 * components];
+            unsigned char* o = &out[x * components];
+            for (unsigned i = 0; i < colorComponents; ++i)
+            {
+                const float value = (srgb->toLinear_[u[i]] + srgb->toLinear_[u[i + components]] +
+                    srgb->toLinear_[l[i]] + srgb->toLinear_[l[i + components]]) * 0.25f;
+                o[i] = srgb->toSRGB_[(unsigned)(value * (SRGB_TABLE_SIZE - 1) + 0.5f)];
+            }
+            for (unsigned i = colorComponents; i < components; ++i)
+                o[i] = (unsigned char)(((unsigned)u[i] + u[i + components] + l[i] + l[i + components]) >> 2);
+        }
+        return;
+    }
+
+    int x = 0;
+#ifdef URHO3D_SSE
+    // Two output pixels at a time from four input pixels of each row
+    if (components == 4)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 2 <= widthOut; x += 2)
+        {
+            const __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&upper[x * 8]));
+            const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&lower[x * 8]));
+            const __m128i sumLeft = _mm_add_epi16(_mm_unpacklo_epi8(u, zero), _mm_unpacklo_epi8(l, zero));
+            const __m128i sumRight = _mm_add_epi16(_mm_unpackhi_epi8(u, zero), _mm_unpackhi_epi8(l, zero));
+            const __m128i pairLeft = _mm_add_epi16(sumLeft, _mm_srli_si128(sumLeft, 8));
+            const __m128i pairRight = _mm_add_epi16(sumRight, _mm_srli_si128(sumRight, 8));
+            const __m128i result = _mm_srli_epi16(_mm_unpacklo_epi64(pairLeft, pairRight), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(&out[x * 4]), _mm_packus_epi16(result, result));
+        }
+    }
+#endif
+
+    for (; x < widthOut; ++x)
+    {
+        const unsigned char* u = &upper[x * 2 * components];
+        const unsigned char* l = &lower[x * 2 * components];
+        unsigned char* o = &out[x * components];
+        for (unsigned i = 0; i < components; ++i)
+            o[i] = (unsigned char)(((unsigned)u[i] + u[i + components] + l[i] + l[i + components]) >> 2);
+    }
+}
+
 SharedPtr<Image> Image::GetNextLevel() const
 {
     if (IsCompressed())
@@ -1636,137 +1762,70 @@ SharedPtr<Image> Image::GetNextLevel() const
         mipImage->SetSize(widthOut, heightOut, depthOut, components_);
     else
         mipImage->SetSize(widthOut, heightOut, components_);
+    mipImage->sRGB_ = sRGB_;
 
     const unsigned char* pixelDataIn = data_.get();
     unsigned char* pixelDataOut = mipImage->data_.get();
 
+    const SRGBTables* srgbTables = sRGB_ ? &GetSRGBTables() : nullptr;
+
     // 1D case
     if (depth_ == 1 && (height_ == 1 || width_ == 1))
     {
-        // Loop using the larger dimension
+        // Loop using the larger dimension. Passing the same row as both rows averages the pixel pairs
         if (widthOut < heightOut)
             widthOut = heightOut;
 
-        switch (components_)
-        {
-        case 1:
-            for (int x = 0; x < widthOut; ++x)
-                pixelDataOut[x] = (unsigned char)(((unsigned)pixelDataIn[x * 2] + pixelDataIn[x * 2 + 1]) >> 1);
-            break;
-
-        case 2:
-            for (int x = 0; x < widthOut * 2; x += 2)
-            {
-                pixelDataOut[x] = (unsigned char)(((unsigned)pixelDataIn[x * 2] + pixelDataIn[x * 2 + 2]) >> 1);
-                pixelDataOut[x + 1] = (unsigned char)(((unsigned)pixelDataIn[x * 2 + 1] + pixelDataIn[x * 2 + 3]) >> 1);
-            }
-            break;
-
-        case 3:
-            for (int x = 0; x < widthOut * 3; x += 3)
-            {
-                pixelDataOut[x] = (unsigned char)(((unsigned)pixelDataIn[x * 2] + pixelDataIn[x * 2 + 3]) >> 1);
-                pixelDataOut[x + 1] = (unsigned char)(((unsigned)pixelDataIn[x * 2 + 1] + pixelDataIn[x * 2 + 4]) >> 1);
-                pixelDataOut[x + 2] = (unsigned char)(((unsigned)pixelDataIn[x * 2 + 2] + pixelDataIn[x * 2 + 5]) >> 1);
-            }
-            break;
-
-        case 4:
-            for (int x = 0; x < widthOut * 4; x += 4)
-            {
-                pixelDataOut[x] = (unsigned char)(((unsigned)pixelDataIn[x * 2] + pixelDataIn[x * 2 + 4]) >> 1);
-                pixelDataOut[x + 1] = (unsigned char)(((unsigned)pixelDataIn[x * 2 + 1] + pixelDataIn[x * 2 + 5]) >> 1);
-                pixelDataOut[x + 2] = (unsigned char)(((unsigned)pixelDataIn[x * 2 + 2] + pixelDataIn[x * 2 + 6]) >> 1);
-                pixelDataOut[x + 3] = (unsigned char)(((unsigned)pixelDataIn[x * 2 + 3] + pixelDataIn[x * 2 + 7]) >> 1);
-            }
-            break;
-
-        default:
-            assert(false);  // Should never reach here
-            break;
-        }
+        DownsampleRow(pixelDataIn, pixelDataIn, pixelDataOut, widthOut, components_, srgbTables);
     }
     // 2D case
     else if (depth_ == 1)
     {
-        switch (components_)
+        const unsigned components = components_;
+        const unsigned rowSizeIn = width_ * components;
+        const unsigned rowSizeOut = widthOut * components;
+        auto downsampleRows = [=](int yBegin, int yEnd)
         {
-        case 1:
-            for (int y = 0; y < heightOut; ++y)
+            for (int y = yBegin; y < yEnd; ++y)
             {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_];
-                unsigned char* out = &pixelDataOut[y * widthOut];
-
-                for (int x = 0; x < widthOut; ++x)
-                {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 1] +
-                                              inLower[x * 2] + inLower[x * 2 + 1]) >> 2);
-                }
+                DownsampleRow(&pixelDataIn[(y * 2) * rowSizeIn], &pixelDataIn[(y * 2 + 1) * rowSizeIn],
+                    &pixelDataOut[y * rowSizeOut], widthOut, components, srgbTables);
             }
-            break;
+        };
 
-        case 2:
-            for (int y = 0; y < heightOut; ++y)
+        // Split large levels into row ranges for the worker threads. Work items can only be added from the main thread
+        auto* queue = GetSubsystem<WorkQueue>();
+        const unsigned numThreads = queue ? queue->GetNumThreads() : 0;
+        if (numThreads && widthOut * heightOut >= PARALLEL_MIP_MIN_PIXELS && Thread::IsMainThread() && !queue->IsCompleting())
+        {
+            // The main thread takes part, so that the work also gets done if the worker threads are busy
+            std::atomic<int> nextRow{0};
+            auto work = [&]()
             {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_ * 2];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_ * 2];
-                unsigned char* out = &pixelDataOut[y * widthOut * 2];
+                for (int y = nextRow.fetch_add(PARALLEL_MIP_ROWS); y < heightOut; y = nextRow.fetch_add(PARALLEL_MIP_ROWS))
+                    downsampleRows(y, Min(y + PARALLEL_MIP_ROWS, heightOut));
+            };
 
-                for (int x = 0; x < widthOut * 2; x += 2)
-                {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 2] +
-                                              inLower[x * 2] + inLower[x * 2 + 2]) >> 2);
-                    out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 3] +
-                                                  inLower[x * 2 + 1] + inLower[x * 2 + 3]) >> 2);
-                }
-            }
-            break;
+            ea::vector<SharedPtr<WorkItem> > items;
+            const unsigned numRanges = (unsigned)((heightOut + PARALLEL_MIP_ROWS - 1) / PARALLEL_MIP_ROWS);
+            const unsigned numItems = Min(numThreads, numRanges - 1);
+            for (unsigned i = 0; i < numItems; ++i)
+                items.push_back(queue->AddWorkItem(work, M_MAX_UNSIGNED));
 
-        case 3:
-            for (int y = 0; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_ * 3];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_ * 3];
-                unsigned char* out = &pixelDataOut[y * widthOut * 3];
+            work();
 
-                for (int x = 0; x < widthOut * 3; x += 3)
-                {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 3] +
-                                              inLower[x * 2] + inLower[x * 2 + 3]) >> 2);
-                    out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 4] +
-                                                  inLower[x * 2 + 1] + inLower[x * 2 + 4]) >> 2);
-                    out[x + 2] = (unsigned char)(((unsigned)inUpper[x * 2 + 2] + inUpper[x * 2 + 5] +
-                                                  inLower[x * 2 + 2] + inLower[x * 2 + 5]) >> 2);
-                }
-            }
-            break;
-
-        case 4:
-            for (int y = 0; y < heightOut; ++y)
+            // Items not started yet have nothing left to do, wait only for the ones in progress
+            for (SharedPtr<WorkItem>& item : items)
             {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_ * 4];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_ * 4];
-                unsigned char* out = &pixelDataOut[y * widthOut * 4];
-
-                for (int x = 0; x < widthOut * 4; x += 4)
+                if (!queue->RemoveWorkItem(item))
                 {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 4] +
-                                              inLower[x * 2] + inLower[x * 2 + 4]) >> 2);
-                    out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 5] +
-                                                  inLower[x * 2 + 1] + inLower[x * 2 + 5]) >> 2);
-                    out[x + 2] = (unsigned char)(((unsigned)inUpper[x * 2 + 2] + inUpper[x * 2 + 6] +
-                                                  inLower[x * 2 + 2] + inLower[x * 2 + 6]) >> 2);
-                    out[x + 3] = (unsigned char)(((unsigned)inUpper[x * 2 + 3] + inUpper[x * 2 + 7] +
-                                                  inLower[x * 2 + 3] + inLower[x * 2 + 7]) >> 2);
+                    while (!item->completed_)
+                        std::this_thread::yield();
                 }
             }
-            break;
-
-        default:
-            assert(false);  // Should never reach here
-            break;
         }
+        else
+            downsampleRows(0, heightOut);
     }
     // 3D case
     else
@@ -1930,6 +1989,7 @@ SharedPtr<Image> Image::ConvertToRGBA() const
 
     SharedPtr<Image> ret(context_->CreateObject<Image>());
     ret->SetSize(width_, height_, depth_, 4);
+    ret->sRGB_ = sRGB_;
 
     const unsigned char* src = data_.get();
     unsigned char* dest = ret->GetData();
@@ -2353,6 +2413,10 @@ unsigned char* Image::GetImageData(Deserializer& source, int& width, int& height
 {
     unsigned dataSize = source.GetSize();
 
+    // Decode memory-mapped data in place
+    if (const unsigned char* inMemoryData = source.GetInMemoryData())
+        return stbi_load_from_memory(inMemoryData, dataSize, &width, &height, (int*)&components, 0);
+
     ea::shared_array<unsigned char> buffer(new unsigned char[dataSize]);
     source.Read(buffer.get(), dataSize);
     return stbi_load_from_memory(buffer.get(), dataSize, &width, &height, (int*)&components, 0);
@@ -118,8 +118,11 @@ public:
     bool FlipHorizontal();
     /// Flip image vertically. Return true if successful.
     bool FlipVertical();
-    /// Resize image by bilinear resampling. Return true if successful.
+    /// Resize image by bilinear resampling, or by box filtered mip levels when reducing both dimensions by the same power of two. Return true if successful.
     bool Resize(int width, int height);
+    /// Set whether the image data is in sRGB color space. Mip levels are then averaged in linear space. Clears precalculated mip levels when changed.
+    /// @property
+    void SetSRGB(bool enable);
     /// Clear the image with a color.
     void Clear(const Color& color);
     /// Clear the image with an integer color. R component is in the 8 lowest bits.
@@ -142,7 +145,7 @@ public:
     /// Whether this texture has been detected as a volume, only relevant for DDS.
     /// @property
     bool IsArray() const { return array_; }
-    /// Whether this texture is in sRGB, only relevant for DDS.
+    /// Whether this texture is in sRGB. Detected for DDS, set with SetSRGB() for other formats.
     /// @property
     bool IsSRGB() const { return sRGB_; }
 
@@ -204,7 +207,7 @@ public:
     SharedPtr<Image> GetSubimage(const IntRect& rect) const;
     /// Return an SDL surface from the image, or null if failed. Only RGB images are supported. Specify rect to only return partial image. You must free the surface yourself.
     SDL_Surface* GetSDLSurface(const IntRect& rect = IntRect::ZERO) const;
-    /// Precalculate the mip levels. Used by asynchronous texture loading.
+    /// Precalculate the mip levels. Used by asynchronous texture loading. Large levels are split across the worker threads when called from the main thread.
     void PrecalculateLevels();
     /// Whether this texture has an alpha channel.
     /// @property
@@ -70,6 +70,13 @@ bool Resource::EndLoad()
     return true;
 }
 
+bool Resource::EndLoadPartial(unsigned& budget, bool& finished)
+{
+    // Resources that do not split their GPU upload finish at once
+    finished = true;
+    return EndLoad();
+}
+
 bool Resource::Save(Serializer& dest) const
 {
     URHO3D_LOGERROR("Save not supported for " + GetTypeName());
@@ -102,6 +109,7 @@ void Resource::SetMemoryUse(unsigned size)
 void Resource::ResetUseTimer()
 {
     useTimer_.Reset();
+    lastUseTimer_.Reset();
 }
 
 void Resource::SetAsyncLoadState(AsyncLoadState newState)
@@ -66,6 +66,8 @@ public:
     virtual bool BeginLoad(Deserializer& source);
     /// Finish resource loading. Always called from the main thread. Return true if successful.
     virtual bool EndLoad();
+    /// Finish background loaded resource loading in parts to spread GPU uploads over several frames. Always called from the main thread. Subtract the bytes uploaded from the budget and set finished when done. Return false on failure. Default calls EndLoad().
+    virtual bool EndLoadPartial(unsigned& budget, bool& finished);
     /// Save resource. Return true if successful.
     virtual bool Save(Serializer& dest) const;
 
@@ -83,6 +85,14 @@ public:
     void SetMemoryUse(unsigned size);
     /// Reset last used timer.
     void ResetUseTimer();
+    /// Mark the resource used, also while it is referred to elsewhere than in the resource cache. Called by the renderer for the textures it draws with.
+    void MarkUsed() { lastUseTimer_.Reset(); }
+    /// Reduce memory use while staying usable, for example by dropping texture mip levels. Called by ResourceCache when over memory budget. Return true if memory use was reduced or the reduction was started.
+    virtual bool ReduceMemoryUse() { return false; }
+    /// Undo one step of ReduceMemoryUse(). Called by ResourceCache when the resource is used again and fits in the memory budget. Return true if successful or started.
+    virtual bool RestoreMemoryUse() { return false; }
+    /// Continue a reduction or restoration started by ReduceMemoryUse() or RestoreMemoryUse() within the GPU upload byte budget, subtracting the uploaded bytes. Return true when finished. Called by ResourceCache.
+    virtual bool UpdateMemoryUseChange(unsigned& budget) { return true; }
     /// Set the asynchronous loading state. Called by ResourceCache. Resources in the middle of asynchronous loading are not normally returned to user.
     void SetAsyncLoadState(AsyncLoadState newState);
     /// Set absolute file name.
@@ -103,6 +113,12 @@ public:
     /// @property
     unsigned GetUseTimer();
 
+    /// Return time since last use in milliseconds, also when referred to elsewhere. The resource is used when requested from the resource cache or marked used.
+    unsigned GetLastUseTimer() { return lastUseTimer_.GetMSec(false); }
+
+    /// Return whether memory use has been reduced by ReduceMemoryUse().
+    virtual bool IsMemoryUseReduced() const { return false; }
+
     /// Return the asynchronous loading state.
     AsyncLoadState GetAsyncLoadState() const { return asyncLoadState_; }
 
@@ -118,6 +134,8 @@ private:
     ea::string absoluteFileName_;
     /// Last used timer.
     Timer useTimer_;
+    /// Last used timer that is not reset by references elsewhere.
+    Timer lastUseTimer_;
     /// Memory use in bytes.
     unsigned memoryUse_;
     /// Asynchronous loading state.
@@ -44,6 +44,8 @@
 
 #include <cstdio>
 
+#include <EASTL/sort.h>
+
 namespace Urho3D
 {
 
@@ -68,14 +70,25 @@ static const char* checkDirs[] =
 };
 
 static const SharedPtr<Resource> noResource;
+/// Interval in milliseconds between enforcing the memory budgets on resources in use.
+static const unsigned RESIDENCY_UPDATE_INTERVAL_MS = 250;
+/// Time in milliseconds since last use within which a reduced resource counts as used again and is restored.
+static const unsigned RESTORE_USE_TIME_MS = 500;
+/// Maximum number of resources reduced or restored at the same time. Each one reloads its file in the background.
+static const unsigned MAX_RESIDENCY_RELOADS = 4;
 
 ResourceCache::ResourceCache(Context* context) :
     Object(context),
     autoReloadResources_(false),
     returnFailedResources_(false),
     searchPackagesFirst_(true),
+    memoryMapPackages_(false),
     isRouting_(false),
-    finishBackgroundResourcesMs_(5)
+    dirFileIndexDirty_(false),
+    packageFileIndexDirty_(false),
+    finishBackgroundResourcesMs_(5),
+    finishBackgroundResourcesBytes_(4 * 1024 * 1024),
+    totalMemoryBudget_(0)
 {
     // Register Resource library object factories
     RegisterResourceLibrary(context_);
@@ -122,6 +135,7 @@ bool ResourceCache::AddResourceDir(const ea::string& pathName, unsigned priority
         resourceDirs_.insert_at(priority, fixedPath);
     else
         resourceDirs_.push_back(fixedPath);
+    dirFileIndexDirty_ = true;
 
     // If resource auto-reloading active, create a file watcher for the directory
     if (autoReloadResources_)
@@ -150,6 +164,7 @@ bool ResourceCache::AddPackageFile(PackageFile* package, unsigned priority)
         packages_.insert_at(priority, SharedPtr<PackageFile>(package));
     else
         packages_.push_back(SharedPtr<PackageFile>(package));
+    packageFileIndexDirty_ = true;
 
     URHO3D_LOGINFO("Added resource package " + package->GetName());
     return true;
@@ -158,7 +173,7 @@ bool ResourceCache::AddPackageFile(PackageFile* package, unsigned priority)
 bool ResourceCache::AddPackageFile(const ea::string& fileName, unsigned priority)
 {
     SharedPtr<PackageFile> package(new PackageFile(context_));
-    return package->Open(fileName) && AddPackageFile(package, priority);
+    return package->Open(fileName, 0, memoryMapPackages_) && AddPackageFile(package, priority);
 }
 
 bool ResourceCache::AddManualResource(Resource* resource)
@@ -193,6 +208,7 @@ void ResourceCache::RemoveResourceDir(const ea::string& pathName)
         if (!resourceDirs_[i].comparei(fixedPath))
         {
             resourceDirs_.erase_at(i);
+            dirFileIndexDirty_ = true;
             // Remove the filewatcher with the matching path
             for (unsigned j = 0; j < fileWatchers_.size(); ++j)
             {
@@ -220,6 +236,7 @@ void ResourceCache::RemovePackageFile(PackageFile* package, bool releaseResource
                 ReleasePackageResources(i->Get(), forceRelease);
             URHO3D_LOGINFO("Removed resource package " + (*i)->GetName());
             packages_.erase(i);
+            packageFileIndexDirty_ = true;
             return;
         }
     }
@@ -240,6 +257,7 @@ void ResourceCache::RemovePackageFile(const ea::string& fileName, bool releaseRe
                 ReleasePackageResources(i->Get(), forceRelease);
             URHO3D_LOGINFO("Removed resource package " + (*i)->GetName());
             packages_.erase(i);
+            packageFileIndexDirty_ = true;
             return;
         }
     }
@@ -674,7 +692,7 @@ Resource* ResourceCache::GetResource(StringHash type, const ea::string& name, bo
     return resource;
 }
 
-bool ResourceCache::BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller)
+bool ResourceCache::BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller, int priority)
 {
 #ifdef URHO3D_THREADING
     // If empty name, fail immediately
@@ -687,13 +705,35 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const ea::string& na
     if (FindResource(type, nameHash) != noResource)
         return false;
 
-    return backgroundLoader_->QueueResource(type, sanitatedName, sendEventOnFailure, caller);
+    return backgroundLoader_->QueueResource(type, sanitatedName, sendEventOnFailure, caller, priority);
 #else
     // When threading not supported, fall back to synchronous loading
     return GetResource(type, name, sendEventOnFailure);
 #endif
 }
 
+bool ResourceCache::CancelBackgroundLoadResource(StringHash type, const ea::string& name)
+{
+#ifdef URHO3D_THREADING
+    ea::string sanitatedName = SanitateResourceName(name);
+    if (sanitatedName.empty())
+        return false;
+
+    return backgroundLoader_->CancelResource(type, StringHash(sanitatedName));
+#else
+    return false;
+#endif
+}
+
+void ResourceCache::QueueBackgroundTask(ea::function<void()> task)
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->QueueTask(ea::move(task));
+#else
+    task();
+#endif
+}
+
 SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const ea::string& name, bool sendEventOnFailure)
 {
     ea::string sanitatedName = SanitateResourceName(name);
@@ -748,6 +788,22 @@ SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const ea::st
     return resource;
 }
 
+void ResourceCache::SetNumBackgroundLoadThreads(unsigned numThreads)
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->SetNumThreads(numThreads);
+#endif
+}
+
+unsigned ResourceCache::GetNumBackgroundLoadThreads() const
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->GetNumThreads();
+#else
+    return 0;
+#endif
+}
+
 unsigned ResourceCache::GetNumBackgroundLoadResources() const
 {
 #ifdef URHO3D_THREADING
@@ -779,21 +835,15 @@ bool ResourceCache::Exists(const ea::string& name) const
     if (sanitatedName.empty())
         return false;
 
-    for (unsigned i = 0; i < packages_.size(); ++i)
-    {
-        if (packages_[i]->Exists(sanitatedName))
-            return true;
-    }
+    UpdateFileIndex();
+    if (FindPackage(sanitatedName) != M_MAX_UNSIGNED)
+        return true;
 
-    auto* fileSystem = GetSubsystem<FileSystem>();
-    for (unsigned i = 0; i < resourceDirs_.size(); ++i)
-    {
-        if (fileSystem->FileExists(resourceDirs_[i] + sanitatedName))
-            return true;
-    }
+    if (FindResourceDir(sanitatedName) != M_MAX_UNSIGNED)
+        return true;
 
     // Fallback using absolute path
-    return fileSystem->FileExists(sanitatedName);
+    return GetSubsystem<FileSystem>()->FileExists(sanitatedName);
 }
 
 unsigned long long ResourceCache::GetMemoryBudget(StringHash type) const
@@ -817,17 +867,26 @@ unsigned long long ResourceCache::GetTotalMemoryUse() const
     return total;
 }
 
+bool ResourceCache::IsWithinMemoryBudget(StringHash type, unsigned long long extraMemoryUse) const
+{
+    auto i = resourceGroups_.find(type);
+    if (i != resourceGroups_.end() && i->second.memoryBudget_ &&
+        i->second.memoryUse_ + extraMemoryUse > i->second.memoryBudget_)
+        return false;
+
+    return !totalMemoryBudget_ || GetTotalMemoryUse() + extraMemoryUse <= totalMemoryBudget_;
+}
+
 ea::string ResourceCache::GetResourceFileName(const ea::string& name) const
 {
     MutexLock lock(resourceMutex_);
 
-    auto* fileSystem = GetSubsystem<FileSystem>();
-    for (unsigned i = 0; i < resourceDirs_.size(); ++i)
-    {
-        if (fileSystem->FileExists(resourceDirs_[i] + name))
-            return resourceDirs_[i] + name;
-    }
+    UpdateFileIndex();
+    const unsigned dirIndex = FindResourceDir(name);
+    if (dirIndex != M_MAX_UNSIGNED)
+        return resourceDirs_[dirIndex] + name;
 
+    auto* fileSystem = GetSubsystem<FileSystem>();
     if (IsAbsolutePath(name) && fileSystem->FileExists(name))
         return name;
     else
@@ -1079,37 +1138,194 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
     if (i == resourceGroups_.end())
         return;
 
-    for (;;)
+    // Resources in use always return a zero timer and can not be released
+    unsigned long long totalSize = 0;
+    ea::vector<ea::pair<unsigned, StringHash> > unusedResources;
+    for (auto j = i->second.resources_.begin(); j != i->second.resources_.end(); ++j)
     {
-        unsigned totalSize = 0;
-        unsigned oldestTimer = 0;
-        auto oldestResource = i->second.resources_.end();
+        totalSize += j->second->GetMemoryUse();
+        unsigned useTimer = j->second->GetUseTimer();
+        if (useTimer)
+            unusedResources.emplace_back(useTimer, j->first);
+    }
 
-        for (auto j = i->second.resources_.begin();
-             j != i->second.resources_.end(); ++j)
+    i->second.memoryUse_ = totalSize;
+    if (!i->second.memoryBudget_ || i->second.memoryUse_ <= i->second.memoryBudget_)
+        return;
+
+    // If memory budget is exceeded, release the least recently used resources until within it
+    ea::sort(unusedResources.begin(), unusedResources.end(), [](const ea::pair<unsigned, StringHash>& lhs,
+        const ea::pair<unsigned, StringHash>& rhs) { return lhs.first > rhs.first; });
+
+    for (auto j = unusedResources.begin(); j != unusedResources.end() && i->second.memoryUse_ > i->second.memoryBudget_; ++j)
+    {
+        auto k = i->second.resources_.find(j->second);
+        URHO3D_LOGDEBUG("Resource group " + k->second->GetTypeName() + " over memory budget, releasing resource " +
+            k->second->GetName());
+        i->second.memoryUse_ -= k->second->GetMemoryUse();
+        i->second.resources_.erase(k);
+    }
+}
+
+void ResourceCache::UpdateResidency()
+{
+    URHO3D_PROFILE("UpdateResidency");
+
+    // Memory use is counted stale while reductions or restorations are in progress, so wait for them to finish
+    if (!changingResources_.empty())
+        return;
+
+    // Recount memory use, as resources such as streamed textures change their size without going through the cache.
+    // Then enforce the budgets of each type first, then the total budget
+    ea::vector<ea::pair<StringHash, unsigned long long> > overBudgetTypes;
+    bool hasBudgets = totalMemoryBudget_ != 0;
+    for (auto i = resourceGroups_.begin(); i != resourceGroups_.end(); ++i)
+    {
+        unsigned long long memoryUse = 0;
+        for (auto j = i->second.resources_.begin(); j != i->second.resources_.end(); ++j)
+            memoryUse += j->second->GetMemoryUse();
+        i->second.memoryUse_ = memoryUse;
+
+        if (i->second.memoryBudget_)
+        {
+            hasBudgets = true;
+            if (i->second.memoryUse_ > i->second.memoryBudget_)
+                overBudgetTypes.emplace_back(i->first, i->second.memoryBudget_);
+        }
+    }
+
+    for (auto i = overBudgetTypes.begin(); i != overBudgetTypes.end(); ++i)
+        EnforceMemoryBudget(i->first, i->second);
+
+    if (totalMemoryBudget_ && GetTotalMemoryUse() > totalMemoryBudget_)
+        EnforceMemoryBudget(StringHash::ZERO, totalMemoryBudget_);
+
+    // Resources can only have been reduced to fit a budget
+    if (hasBudgets)
+        RestoreReducedResources();
+}
+
+void ResourceCache::EnforceMemoryBudget(StringHash type, unsigned long long budget)
+{
+    // Gather the candidates first, as reducing a resource may release other resources from the cache
+    unsigned long long memoryUse = 0;
+    ea::vector<ea::pair<unsigned, WeakPtr<Resource> > > candidates;
+    for (auto i = resourceGroups_.begin(); i != resourceGroups_.end(); ++i)
+    {
+        if (type != StringHash::ZERO && i->first != type)
+            continue;
+
+        memoryUse += i->second.memoryUse_;
+        for (auto j = i->second.resources_.begin(); j != i->second.resources_.end(); ++j)
+            candidates.emplace_back(j->second->GetLastUseTimer(), WeakPtr<Resource>(j->second));
+    }
+
+    ea::sort(candidates.begin(), candidates.end(), [](const ea::pair<unsigned, WeakPtr<Resource> >& lhs,
+        const ea::pair<unsigned, WeakPtr<Resource> >& rhs) { return lhs.first > rhs.first; });
+
+    ea::hash_set<StringHash> affectedTypes;
+    for (auto i = candidates.begin(); i != candidates.end() && memoryUse > budget; ++i)
+    {
+        SharedPtr<Resource> resource = i->second.Lock();
+        if (!resource)
+            continue;
+
+        ResourceGroup& group = resourceGroups_[resource->GetType()];
+        auto j = group.resources_.find(resource->GetNameHash());
+        if (j == group.resources_.end() || j->second != resource)
+            continue;
+
+        // Release resources only held by the cache (and the reference above), reduce the ones in use if they support it
+        const unsigned oldMemoryUse = resource->GetMemoryUse();
+        if (resource->Refs() == 2)
+        {
+            URHO3D_LOGDEBUG("Over memory budget, releasing resource " + resource->GetName());
+            group.resources_.erase(j);
+            memoryUse -= Min((unsigned long long)oldMemoryUse, memoryUse);
+            affectedTypes.insert(resource->GetType());
+        }
+        else if (CanReloadForResidency() && resource->ReduceMemoryUse())
+        {
+            // The reduction may finish later. Dropping a texture mip level saves about three quarters of its memory.
+            // The rest of the resources are reduced on the following updates if the limit is reached
+            changingResources_.emplace_back(resource);
+            URHO3D_LOGDEBUG("Over memory budget, reducing resource " + resource->GetName());
+            memoryUse -= Min((unsigned long long)oldMemoryUse * 3 / 4, memoryUse);
+        }
+    }
+
+    for (auto i = affectedTypes.begin(); i != affectedTypes.end(); ++i)
+        UpdateResourceGroup(*i);
+}
+
+void ResourceCache::RestoreReducedResources()
+{
+    ea::vector<ea::pair<unsigned, WeakPtr<Resource> > > candidates;
+    for (auto i = resourceGroups_.begin(); i != resourceGroups_.end(); ++i)
+    {
+        for (auto j = i->second.resources_.begin(); j != i->second.resources_.end(); ++j)
         {
-            totalSize += j->second->GetMemoryUse();
-            unsigned useTimer = j->second->GetUseTimer();
-            if (useTimer > oldestTimer)
+            if (j->second->IsMemoryUseReduced())
             {
-                oldestTimer = useTimer;
-                oldestResource = j;
+                unsigned lastUse = j->second->GetLastUseTimer();
+                if (lastUse < RESTORE_USE_TIME_MS)
+                    candidates.emplace_back(lastUse, WeakPtr<Resource>(j->second));
             }
         }
+    }
+
+    if (candidates.empty())
+        return;
+
+    ea::sort(candidates.begin(), candidates.end(), [](const ea::pair<unsigned, WeakPtr<Resource> >& lhs,
+        const ea::pair<unsigned, WeakPtr<Resource> >& rhs) { return lhs.first < rhs.first; });
+
+    // Spread the reloads over several updates with the same byte budget as finishing background loaded resources
+    unsigned restoredBytes = 0;
+    for (auto i = candidates.begin(); i != candidates.end() && restoredBytes < finishBackgroundResourcesBytes_ &&
+        CanReloadForResidency(); ++i)
+    {
+        SharedPtr<Resource> resource = i->second.Lock();
+        if (!resource)
+            continue;
+
+        // Restoring a texture mip level roughly quadruples its memory use. Leave the resource reduced if the result would not fit
+        if (!IsWithinMemoryBudget(resource->GetType(), 3ull * resource->GetMemoryUse()))
+            continue;
+
+        if (resource->RestoreMemoryUse())
+        {
+            changingResources_.emplace_back(resource);
+            restoredBytes += 3 * resource->GetMemoryUse();
+        }
+    }
+}
+
+bool ResourceCache::CanReloadForResidency() const
+{
+    return changingResources_.size() < MAX_RESIDENCY_RELOADS;
+}
+
+void ResourceCache::UpdateMemoryUseChanges()
+{
+    if (changingResources_.empty())
+        return;
 
-        i->second.memoryUse_ = totalSize;
+    URHO3D_PROFILE("UpdateMemoryUseChanges");
 
-        // If memory budget defined and is exceeded, remove the oldest resource and loop again
-        // (resources in use always return a zero timer and can not be removed)
-        if (i->second.memoryBudget_ && i->second.memoryUse_ > i->second.memoryBudget_ &&
-            oldestResource != i->second.resources_.end())
+    // Share the upload byte budget of finishing background loaded resources
+    unsigned budget = finishBackgroundResourcesBytes_;
+    for (unsigned i = 0; i < changingResources_.size() && budget;)
+    {
+        SharedPtr<Resource> resource = changingResources_[i].Lock();
+        if (!resource || resource->UpdateMemoryUseChange(budget))
         {
-            URHO3D_LOGDEBUG("Resource group " + oldestResource->second->GetTypeName() + " over memory budget, releasing resource " +
-                     oldestResource->second->GetName());
-            i->second.resources_.erase(oldestResource);
+            if (resource)
+                UpdateResourceGroup(resource->GetType());
+            changingResources_.erase(changingResources_.begin() + i);
         }
         else
-            break;
+            ++i;
     }
 }
 
@@ -1120,6 +1336,14 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
         FileChange change;
         while (fileWatchers_[i]->GetNextChange(change))
         {
+            // Keep the file index current for files added, removed or renamed on disk, also when the reload is ignored
+            if (change.kind_ != FILECHANGE_MODIFIED)
+            {
+                RefreshFileIndex(change.fileName_);
+                if (!change.oldFileName_.empty())
+                    RefreshFileIndex(change.oldFileName_);
+            }
+
             auto it = ignoreResourceAutoReload_.find(change.fileName_);
             if (it != ignoreResourceAutoReload_.end())
             {
@@ -1143,28 +1367,34 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
 #ifdef URHO3D_THREADING
     {
         URHO3D_PROFILE("FinishBackgroundResources");
-        backgroundLoader_->FinishResources(finishBackgroundResourcesMs_);
+        backgroundLoader_->FinishResources(finishBackgroundResourcesMs_, finishBackgroundResourcesBytes_);
     }
 #endif
+
+    UpdateMemoryUseChanges();
+
+    if (residencyTimer_.GetMSec(false) >= RESIDENCY_UPDATE_INTERVAL_MS)
+    {
+        residencyTimer_.Reset();
+        UpdateResidency();
+    }
 }
 
 File* ResourceCache::SearchResourceDirs(const ea::string& name)
 {
-    auto* fileSystem = GetSubsystem<FileSystem>();
-    for (unsigned i = 0; i < resourceDirs_.size(); ++i)
+    UpdateFileIndex();
+    const unsigned dirIndex = FindResourceDir(name);
+    if (dirIndex != M_MAX_UNSIGNED)
     {
-        if (fileSystem->FileExists(resourceDirs_[i] + name))
-        {
-            // Construct the file first with full path, then rename it to not contain the resource path,
-            // so that the file's sanitatedName can be used in further GetFile() calls (for example over the network)
-            File* file(new File(context_, resourceDirs_[i] + name));
-            file->SetName(name);
-            return file;
-        }
+        // Construct the file first with full path, then rename it to not contain the resource path,
+        // so that the file's sanitatedName can be used in further GetFile() calls (for example over the network)
+        File* file(new File(context_, resourceDirs_[dirIndex] + name));
+        file->SetName(name);
+        return file;
     }
 
     // Fallback using absolute path
-    if (fileSystem->FileExists(name))
+    if (GetSubsystem<FileSystem>()->FileExists(name))
         return new File(context_, name);
 
     return nullptr;
@@ -1172,13 +1402,119 @@ File* ResourceCache::SearchResourceDirs(const ea::string& name)
 
 File* ResourceCache::SearchPackages(const ea::string& name)
 {
-    for (unsigned i = 0; i < packages_.size(); ++i)
+    UpdateFileIndex();
+    const unsigned index = FindPackage(name);
+    if (index != M_MAX_UNSIGNED)
+        return new File(context_, packages_[index], name);
+
+    return nullptr;
+}
+
+unsigned ResourceCache::FindResourceDir(const ea::string& name) const
+{
+    // Both found and missing files are remembered, so that each name is checked on disk at most once
+    auto i = dirFileIndex_.find(name);
+    if (i != dirFileIndex_.end())
+        return i->second;
+
+    // Not indexed under this exact name, e.g. requested in a different case or created after indexing
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    unsigned dirIndex = M_MAX_UNSIGNED;
+    for (unsigned j = 0; j < resourceDirs_.size(); ++j)
     {
-        if (packages_[i]->Exists(name))
-            return new File(context_, packages_[i], name);
+        if (fileSystem->FileExists(resourceDirs_[j] + name))
+        {
+            dirIndex = j;
+            break;
+        }
     }
 
-    return nullptr;
+    dirFileIndex_[name] = dirIndex;
+    return dirIndex;
+}
+
+unsigned ResourceCache::FindPackage(const ea::string& name) const
+{
+    // Package contents do not change, so a file missing from the index is in no package
+    auto i = packageFileIndex_.find(name.to_lower());
+    if (i == packageFileIndex_.end())
+        return M_MAX_UNSIGNED;
+
+    if (packages_[i->second]->Exists(name))
+        return i->second;
+
+    // The indexed package has the file in a different case, another package may have it in the requested case
+    for (unsigned j = 0; j < packages_.size(); ++j)
+    {
+        if (packages_[j]->Exists(name))
+            return j;
+    }
+
+    return M_MAX_UNSIGNED;
+}
+
+void ResourceCache::UpdateFileIndex() const
+{
+    if (dirFileIndexDirty_)
+    {
+        URHO3D_PROFILE("UpdateResourceDirFileIndex");
+
+        dirFileIndex_.clear();
+
+        // Index from the lowest priority up, so that higher priority directories overwrite
+        auto* fileSystem = GetSubsystem<FileSystem>();
+        ea::vector<ea::string> fileNames;
+        for (unsigned i = resourceDirs_.size(); i-- > 0;)
+        {
+            fileSystem->ScanDir(fileNames, resourceDirs_[i], "*", SCAN_FILES, true);
+            for (const ea::string& fileName : fileNames)
+                dirFileIndex_[fileName] = i;
+        }
+
+        dirFileIndexDirty_ = false;
+    }
+
+    if (packageFileIndexDirty_)
+    {
+        URHO3D_PROFILE("UpdateResourcePackageFileIndex");
+
+        packageFileIndex_.clear();
+
+        for (unsigned i = packages_.size(); i-- > 0;)
+        {
+            for (const auto& entry : packages_[i]->GetEntries())
+                packageFileIndex_[entry.first.to_lower()] = i;
+        }
+
+        packageFileIndexDirty_ = false;
+    }
+}
+
+void ResourceCache::RefreshFileIndex(const ea::string& name)
+{
+    MutexLock lock(resourceMutex_);
+
+    if (dirFileIndexDirty_)
+        return;
+
+    // Forget the file under any case, including remembered misses, so that it is checked on disk again
+    for (auto i = dirFileIndex_.begin(); i != dirFileIndex_.end();)
+    {
+        if (!i->first.comparei(name))
+            i = dirFileIndex_.erase(i);
+        else
+            ++i;
+    }
+
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    for (unsigned i = 0; i < resourceDirs_.size(); ++i)
+    {
+        if (fileSystem->FileExists(resourceDirs_[i] + name))
+        {
+            dirFileIndex_[name] = i;
+            return;
+        }
+    }
 }
 
 void RegisterResourceLibrary(Context* context)
@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include <EASTL/functional.h>
 #include <EASTL/unique_ptr.h>
 #include <EASTL/hash_set.h>
 
@@ -97,7 +98,7 @@ public:
     bool AddResourceDir(const ea::string& pathName, unsigned priority = PRIORITY_LAST);
     /// Add a package file for loading resources from. Optional priority parameter which will control search order.
     bool AddPackageFile(PackageFile* package, unsigned priority = PRIORITY_LAST);
-    /// Add a package file for loading resources from by name. Optional priority parameter which will control search order.
+    /// Add a package file for loading resources from by name. Optional priority parameter which will control search order. The package is memory-mapped if enabled with SetMemoryMapPackages().
     bool AddPackageFile(const ea::string& fileName, unsigned priority = PRIORITY_LAST);
     /// Add a manually created resource. Must be uniquely named within its type.
     bool AddManualResource(Resource* resource);
@@ -128,6 +129,9 @@ public:
     /// Set memory budget for a specific resource type, default 0 is unlimited.
     /// @property
     void SetMemoryBudget(StringHash type, unsigned long long budget);
+    /// Set memory budget for all resources together, default 0 is unlimited. When exceeded, the least recently used resources of any type are released or reduced.
+    /// @property
+    void SetTotalMemoryBudget(unsigned long long budget) { totalMemoryBudget_ = budget; }
     /// Enable or disable automatic reloading of resources as files are modified. Default false.
     /// @property
     void SetAutoReloadResources(bool enable);
@@ -138,10 +142,19 @@ public:
     /// Define whether when getting resources should check package files or directories first. True for packages, false for directories.
     /// @property
     void SetSearchPackagesFirst(bool value) { searchPackagesFirst_ = value; }
+    /// Set whether package files added by name are memory-mapped. Default false.
+    /// @property
+    void SetMemoryMapPackages(bool enable) { memoryMapPackages_ = enable; }
 
     /// Set how many milliseconds maximum per frame to spend on finishing background loaded resources.
     /// @property
     void SetFinishBackgroundResourcesMs(int ms) { finishBackgroundResourcesMs_ = Max(ms, 1); }
+    /// Set how many bytes maximum per frame to upload to the GPU when finishing background loaded resources. Large textures and models are finished over several frames.
+    /// @property
+    void SetFinishBackgroundResourcesBytes(unsigned bytes) { finishBackgroundResourcesBytes_ = Max(bytes, 1U); }
+    /// Set number of threads loading resources in the background. Default is half the number of physical CPU cores, at most 4.
+    /// @property
+    void SetNumBackgroundLoadThreads(unsigned numThreads);
 
     /// Add a resource router object. By default there is none, so the routing process is skipped.
     void AddResourceRouter(ResourceRouter* router, bool addAsFirst = false);
@@ -154,8 +167,12 @@ public:
     Resource* GetResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true);
     /// Load a resource without storing it in the resource cache. Return null if not found or if fails. Can be called from outside the main thread if the resource itself is safe to load completely (it does not possess for example GPU data).
     SharedPtr<Resource> GetTempResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true);
-    /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
-    bool BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr);
+    /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Resources with higher priority are loaded first; queueing an already queued resource again with a higher priority raises its priority. Can be called from outside the main thread.
+    bool BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr, int priority = 0);
+    /// Cancel a background load request that is no longer needed. The resources queued by it are cancelled as well unless needed by others. Return true if cancelled.
+    bool CancelBackgroundLoadResource(StringHash type, const ea::string& name);
+    /// Run a task on the background loader threads when no resource is waiting to be loaded, or immediately if threading is not supported. The task must not access main thread state.
+    void QueueBackgroundTask(ea::function<void()> task);
     /// Return number of pending background-loaded resources.
     /// @property
     unsigned GetNumBackgroundLoadResources() const;
@@ -184,7 +201,9 @@ public:
     /// Template version of releasing a resource by name.
     template <class T> void ReleaseResource(const ea::string& resourceName, bool force = false);
     /// Template version of queueing a resource background load.
-    template <class T> bool BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr);
+    template <class T> bool BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr, int priority = 0);
+    /// Template version of cancelling a resource background load.
+    template <class T> bool CancelBackgroundLoadResource(const ea::string& name);
     /// Template version of returning loaded resources of a specific type.
     template <class T> void GetResources(ea::vector<T*>& result) const;
     /// Return whether a file exists in the resource directories or package files. Does not check manually added in-memory resources.
@@ -198,6 +217,11 @@ public:
     /// Return total memory use for all resources.
     /// @property
     unsigned long long GetTotalMemoryUse() const;
+    /// Return memory budget for all resources together.
+    /// @property
+    unsigned long long GetTotalMemoryBudget() const { return totalMemoryBudget_; }
+    /// Return whether the memory use of a resource type can grow by the given amount and still fit both its own budget and the total budget.
+    bool IsWithinMemoryBudget(StringHash type, unsigned long long extraMemoryUse) const;
     /// Return full absolute file name of resource if possible, or empty if not found.
     ea::string GetResourceFileName(const ea::string& name) const;
 
@@ -212,10 +236,20 @@ public:
     /// Return whether when getting resources should check package files or directories first.
     /// @property
     bool GetSearchPackagesFirst() const { return searchPackagesFirst_; }
+    /// Return whether package files added by name are memory-mapped.
+    /// @property
+    bool GetMemoryMapPackages() const { return memoryMapPackages_; }
 
     /// Return how many milliseconds maximum to spend on finishing background loaded resources.
     /// @property
     int GetFinishBackgroundResourcesMs() const { return finishBackgroundResourcesMs_; }
+    /// Return how many bytes maximum per frame to upload to the GPU when finishing background loaded resources.
+    /// @property
+    unsigned GetFinishBackgroundResourcesBytes() const { return finishBackgroundResourcesBytes_; }
+
+    /// Return number of threads loading resources in the background.
+    /// @property
+    unsigned GetNumBackgroundLoadThreads() const;
 
     /// Return a resource router by index.
     ResourceRouter* GetResourceRouter(unsigned index) const;
@@ -263,12 +297,30 @@ private:
     void ReleasePackageResources(PackageFile* package, bool force = false);
     /// Update a resource group. Recalculate memory use and release resources if over memory budget.
     void UpdateResourceGroup(StringHash type);
+    /// Enforce the memory budgets on resources in use and bring back reduced resources used again. Called periodically on begin frame.
+    void UpdateResidency();
+    /// Release unused and reduce used resources of a type, or of all types if zero, least recently used first until within the budget.
+    void EnforceMemoryBudget(StringHash type, unsigned long long budget);
+    /// Restore reduced resources that have been used recently, most recently used first, as long as they fit in the memory budgets.
+    void RestoreReducedResources();
+    /// Return whether another resource may be reduced or restored during the current residency update.
+    bool CanReloadForResidency() const;
+    /// Continue the reductions and restorations in progress within the GPU upload byte budget.
+    void UpdateMemoryUseChanges();
     /// Handle begin frame event. Automatic resource reloads and the finalization of background loaded resources are processed here.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
     /// Search FileSystem for file.
     File* SearchResourceDirs(const ea::string& name);
     /// Search resource packages for file.
     File* SearchPackages(const ea::string& name);
+    /// Return the resource directory index of a file, or M_MAX_UNSIGNED if not found. Probes the directories only for names not yet indexed, and remembers the result.
+    unsigned FindResourceDir(const ea::string& name) const;
+    /// Return the package index of a file, or M_MAX_UNSIGNED if not found. Scans the packages only if the indexed one does not match the case.
+    unsigned FindPackage(const ea::string& name) const;
+    /// Rebuild the file index of the resource directories or of the packages, whichever have changed since.
+    void UpdateFileIndex() const;
+    /// Update the file index of the resource directories for a file changed on disk.
+    void RefreshFileIndex(const ea::string& name);
 
     /// Mutex for thread-safe access to the resource directories, resource packages and resource dependencies.
     mutable Mutex resourceMutex_;
@@ -280,6 +332,14 @@ private:
     ea::vector<SharedPtr<FileWatcher> > fileWatchers_;
     /// Package files.
     ea::vector<SharedPtr<PackageFile> > packages_;
+    /// Index of the highest priority resource directory containing each file, by file name. M_MAX_UNSIGNED for names known to be missing.
+    mutable ea::unordered_map<ea::string, unsigned> dirFileIndex_;
+    /// Index of the highest priority package containing each file, by lowercase file name.
+    mutable ea::unordered_map<ea::string, unsigned> packageFileIndex_;
+    /// Whether the file index of the resource directories needs to be rebuilt.
+    mutable bool dirFileIndexDirty_;
+    /// Whether the file index of the packages needs to be rebuilt.
+    mutable bool packageFileIndexDirty_;
     /// Dependent resources. Only used with automatic reload to eg. trigger reload of a cube texture when any of its faces change.
     ea::unordered_map<StringHash, ea::hash_set<StringHash> > dependentResources_;
     /// Resource background loader.
@@ -292,10 +352,20 @@ private:
     bool returnFailedResources_;
     /// Search priority flag.
     bool searchPackagesFirst_;
+    /// Memory-map packages added by name flag.
+    bool memoryMapPackages_;
     /// Resource routing flag to prevent endless recursion.
     mutable bool isRouting_;
     /// How many milliseconds maximum per frame to spend on finishing background loaded resources.
     int finishBackgroundResourcesMs_;
+    /// How many bytes maximum per frame to upload to the GPU when finishing background loaded resources.
+    unsigned finishBackgroundResourcesBytes_;
+    /// Memory budget for all resources together.
+    unsigned long long totalMemoryBudget_;
+    /// Timer for updating the resource residency.
+    Timer residencyTimer_;
+    /// Resources with a reduction or restoration in progress.
+    ea::vector<WeakPtr<Resource> > changingResources_;
     /// List of resources that will not be auto-reloaded if reloading event triggers.
     ea::vector<ea::string> ignoreResourceAutoReload_;
 };
@@ -324,10 +394,16 @@ template <class T> SharedPtr<T> ResourceCache::GetTempResource(const ea::string&
     return StaticCast<T>(GetTempResource(type, name, sendEventOnFailure));
 }
 
-template <class T> bool ResourceCache::BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure, Resource* caller)
+template <class T> bool ResourceCache::BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure, Resource* caller, int priority)
+{
+    StringHash type = T::GetTypeStatic();
+    return BackgroundLoadResource(type, name, sendEventOnFailure, caller, priority);
+}
+
+template <class T> bool ResourceCache::CancelBackgroundLoadResource(const ea::string& name)
 {
     StringHash type = T::GetTypeStatic();
-    return BackgroundLoadResource(type, name, sendEventOnFailure, caller);
+    return CancelBackgroundLoadResource(type, name);
 }
 
 template <class T> void ResourceCache::GetResources(ea::vector<T*>& result) const
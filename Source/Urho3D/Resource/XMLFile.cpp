@@ -84,11 +84,18 @@ bool XMLFile::BeginLoad(Deserializer& source)
         return false;
     }
 
-    ea::shared_array<char> buffer(new char[dataSize]);
-    if (source.Read(buffer.get(), dataSize) != dataSize)
-        return false;
+    // Parse memory-mapped data in place, as the parser makes its own copy anyway
+    const void* data = source.GetInMemoryData();
+    ea::shared_array<char> buffer;
+    if (!data)
+    {
+        buffer = new char[dataSize];
+        if (source.Read(buffer.get(), dataSize) != dataSize)
+            return false;
+        data = buffer.get();
+    }
 
-    if (!document_->load_buffer(buffer.get(), dataSize))
+    if (!document_->load_buffer(data, dataSize))
     {
         URHO3D_LOGERROR("Could not parse XML data from " + source.GetName());
         document_->reset();
@@ -189,6 +189,7 @@ void Component::PrepareNetworkUpdate()
         if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
         {
             networkState_->previousValues_[i] = networkState_->currentValues_[i];
+            networkState_->InvalidateCache();
 
             // Mark the attribute dirty in all replication states that are tracking this component
             for (auto j = networkState_->replicationStates_.begin();
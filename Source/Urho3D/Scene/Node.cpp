@@ -47,6 +47,11 @@
 namespace Urho3D
 {
 
+/// Quantization step of the replicated node position.
+static const float NETWORK_POSITION_PRECISION = 0.001f;
+/// Bits per component of the replicated node rotation.
+static const int NETWORK_ROTATION_BITS = 15;
+
 Node::Node(Context* context) :
     Animatable(context),
     worldTransform_(Matrix3x4::IDENTITY),
@@ -88,9 +93,11 @@ void Node::RegisterObject(Context* context)
     URHO3D_ACCESSOR_ATTRIBUTE("Scale", GetScale, SetScale, Vector3, Vector3::ONE, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Variables", VariantMap, vars_, Variant::emptyVariantMap, AM_FILE); // Network replication of vars uses custom data
     URHO3D_ACCESSOR_ATTRIBUTE("Network Position", GetNetPositionAttr, SetNetPositionAttr, Vector3, Vector3::ZERO,
-        AM_NET | AM_LATESTDATA | AM_NOEDIT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Network Rotation", GetNetRotationAttr, SetNetRotationAttr, ea::vector<unsigned char>, Variant::emptyBuffer,
-        AM_NET | AM_LATESTDATA | AM_NOEDIT);
+        AM_NET | AM_LATESTDATA | AM_NOEDIT)
+        .SetMetadata(AttributeMetadata::P_NET_PRECISION, NETWORK_POSITION_PRECISION);
+    URHO3D_ACCESSOR_ATTRIBUTE("Network Rotation", GetNetRotationAttr, SetNetRotationAttr, Quaternion, Quaternion::IDENTITY,
+        AM_NET | AM_LATESTDATA | AM_NOEDIT)
+        .SetMetadata(AttributeMetadata::P_NET_QUATERNION_BITS, NETWORK_ROTATION_BITS);
     URHO3D_ACCESSOR_ATTRIBUTE("Network Parent Node", GetNetParentAttr, SetNetParentAttr, ea::vector<unsigned char>, Variant::emptyBuffer,
         AM_NET | AM_NOEDIT);
 }
@@ -1608,14 +1615,13 @@ void Node::SetNetPositionAttr(const Vector3& value)
         SetPosition(value);
 }
 
-void Node::SetNetRotationAttr(const ea::vector<unsigned char>& value)
+void Node::SetNetRotationAttr(const Quaternion& value)
 {
-    MemoryBuffer buf(value);
     auto* transform = GetComponent<SmoothedTransform>();
     if (transform)
-        transform->SetTargetRotation(buf.ReadPackedQuaternion());
+        transform->SetTargetRotation(value);
     else
-        SetRotation(buf.ReadPackedQuaternion());
+        SetRotation(value);
 }
 
 void Node::SetNetParentAttr(const ea::vector<unsigned char>& value)
@@ -1660,11 +1666,9 @@ const Vector3& Node::GetNetPositionAttr() const
     return position_;
 }
 
-const ea::vector<unsigned char>& Node::GetNetRotationAttr() const
+const Quaternion& Node::GetNetRotationAttr() const
 {
-    impl_->attrBuffer_.Clear();
-    impl_->attrBuffer_.WritePackedQuaternion(rotation_);
-    return impl_->attrBuffer_.GetBuffer();
+    return rotation_;
 }
 
 const ea::vector<unsigned char>& Node::GetNetParentAttr() const
@@ -1871,6 +1875,7 @@ void Node::PrepareNetworkUpdate()
         if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
         {
             networkState_->previousValues_[i] = networkState_->currentValues_[i];
+            networkState_->InvalidateCache();
 
             // Mark the attribute dirty in all replication states that are tracking this node
             for (auto j = networkState_->replicationStates_.begin();
@@ -26,6 +26,8 @@
 #include <EASTL/unordered_map.h>
 
 #include "../Core/Attribute.h"
+#include "../Core/Mutex.h"
+#include "../IO/VectorBuffer.h"
 #include "../Math/StringHash.h"
 
 #include <cstring>
@@ -132,6 +134,31 @@ struct URHO3D_API NetworkState
     VariantMap previousVars_;
     /// Bitmask for intercepting network messages. Used on the client only.
     unsigned long long interceptMask_{};
+
+    /// Serialized initial delta update without time stamp, shared by all connections.
+    VectorBuffer initialDeltaCache_;
+    /// Serialized delta update without time stamp, shared by connections with the same dirty bits.
+    VectorBuffer deltaCache_;
+    /// Serialized latest data update without time stamp, shared by all connections.
+    VectorBuffer latestDataCache_;
+    /// Dirty attribute bits the delta update was serialized with.
+    DirtyBits deltaCacheBits_;
+    /// Initial delta update cache valid flag.
+    bool initialDeltaCacheValid_{};
+    /// Delta update cache valid flag.
+    bool deltaCacheValid_{};
+    /// Latest data update cache valid flag.
+    bool latestDataCacheValid_{};
+    /// Serialized update cache mutex. Connections may be updated from several threads.
+    SpinLockMutex cacheMutex_;
+
+    /// Invalidate serialized updates after the network attribute values have changed.
+    void InvalidateCache()
+    {
+        initialDeltaCacheValid_ = false;
+        deltaCacheValid_ = false;
+        latestDataCacheValid_ = false;
+    }
 };
 
 /// Base class for per-user network replication states.
@@ -25,6 +25,7 @@
 #include "../Core/Context.h"
 #include "../IO/Archive.h"
 #include "../IO/ArchiveSerialization.h"
+#include "../IO/BitStream.h"
 #include "../IO/Deserializer.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
@@ -63,6 +64,262 @@ static unsigned RemapAttributeIndex(const ea::vector<AttributeInfo>* attributes,
     return netAttrIndex; // Could not remap
 }
 
+/// Largest quantized component value of a network attribute before it is sent with variable length coding.
+/// Zigzag encoded, the values up to this magnitude take at most 31 bits, which fits the length prefix.
+static const int MAX_QUANTIZED_COMPONENT = (1 << 30) - 1;
+/// Number of bits in the length prefix of a variable length quantized component.
+static const unsigned QUANTIZED_LENGTH_BITS = 5;
+/// Largest absolute value of the three smallest components of a unit quaternion.
+static const float QUATERNION_COMPONENT_LIMIT = 0.70710678f;
+
+/// Quantization settings of a network attribute, read from the attribute metadata.
+struct NetworkQuantization
+{
+    /// Number of quantized components.
+    unsigned numComponents_{};
+    /// Whether is a quaternion with smallest-three encoding.
+    bool quaternion_{};
+    /// Component step.
+    float precision_{};
+    /// Minimum component value.
+    float minValue_{};
+    /// Maximum component value.
+    float maxValue_{};
+    /// Largest quantized component value when bounded.
+    int maxSteps_{};
+    /// Bits per component when bounded. Zero for variable length components.
+    unsigned bits_{};
+};
+
+/// Quantized network attribute value.
+struct QuantizedValue
+{
+    /// Integer components. For smallest-three quaternions the first is the index of the omitted component.
+    int data_[4]{};
+};
+
+/// Return quantization settings of a network attribute. Return false if the attribute is sent as Variant data.
+static bool GetNetworkQuantization(const AttributeInfo& attr, NetworkQuantization& dest)
+{
+    if (attr.metadata_.empty())
+        return false;
+
+    if (attr.type_ == VAR_QUATERNION)
+    {
+        const int bits = attr.GetMetadata(AttributeMetadata::P_NET_QUATERNION_BITS).GetInt();
+        if (bits <= 0)
+            return false;
+
+        dest.numComponents_ = 3;
+        dest.quaternion_ = true;
+        dest.bits_ = (unsigned)Min(bits, 30);
+        dest.maxSteps_ = (1 << dest.bits_) - 1;
+        return true;
+    }
+
+    switch (attr.type_)
+    {
+    case VAR_FLOAT: dest.numComponents_ = 1; break;
+    case VAR_VECTOR2: dest.numComponents_ = 2; break;
+    case VAR_VECTOR3: dest.numComponents_ = 3; break;
+    case VAR_VECTOR4: dest.numComponents_ = 4; break;
+    default: return false;
+    }
+
+    dest.precision_ = attr.GetMetadata(AttributeMetadata::P_NET_PRECISION).GetFloat();
+    if (dest.precision_ <= 0.0f)
+        return false;
+
+    // Use a fixed number of bits if the range is known and the steps fit
+    const Variant& minValue = attr.GetMetadata(AttributeMetadata::P_NET_MIN_VALUE);
+    const Variant& maxValue = attr.GetMetadata(AttributeMetadata::P_NET_MAX_VALUE);
+    if (!minValue.IsEmpty() && !maxValue.IsEmpty() && maxValue.GetFloat() > minValue.GetFloat())
+    {
+        const float steps = Ceil((maxValue.GetFloat() - minValue.GetFloat()) / dest.precision_);
+        if (steps < (float)MAX_QUANTIZED_COMPONENT)
+        {
+            dest.minValue_ = minValue.GetFloat();
+            dest.maxValue_ = maxValue.GetFloat();
+            dest.maxSteps_ = (int)steps;
+            dest.bits_ = LogBaseTwo((unsigned)dest.maxSteps_) + 1;
+        }
+    }
+
+    return true;
+}
+
+/// Quantize a network attribute value.
+static void Quantize(const NetworkQuantization& quantization, const Variant& value, QuantizedValue& dest)
+{
+    if (quantization.quaternion_)
+    {
+        // Smallest-three: omit the largest component and reconstruct it from the unit length
+        const Quaternion rotation = value.GetQuaternion().Normalized();
+        const float* data = rotation.Data();
+        unsigned largest = 0;
+        for (unsigned i = 1; i < 4; ++i)
+        {
+            if (Abs(data[i]) > Abs(data[largest]))
+                largest = i;
+        }
+
+        const float sign = data[largest] < 0.0f ? -1.0f : 1.0f;
+        const float scale = quantization.maxSteps_ / (2.0f * QUATERNION_COMPONENT_LIMIT);
+        dest.data_[0] = largest;
+        for (unsigned i = 0, j = 1; i < 4; ++i)
+        {
+            if (i != largest)
+            {
+                const float component = Clamp(data[i] * sign, -QUATERNION_COMPONENT_LIMIT, QUATERNION_COMPONENT_LIMIT);
+                dest.data_[j++] = Clamp(RoundToInt((component + QUATERNION_COMPONENT_LIMIT) * scale), 0, quantization.maxSteps_);
+            }
+        }
+        return;
+    }
+
+    float components[4]{};
+    switch (value.GetType())
+    {
+    case VAR_FLOAT: components[0] = value.GetFloat(); break;
+    case VAR_VECTOR2: memcpy(components, value.GetVector2().Data(), sizeof(Vector2)); break;
+    case VAR_VECTOR3: memcpy(components, value.GetVector3().Data(), sizeof(Vector3)); break;
+    case VAR_VECTOR4: memcpy(components, value.GetVector4().Data(), sizeof(Vector4)); break;
+    default: break;
+    }
+
+    for (unsigned i = 0; i < quantization.numComponents_; ++i)
+    {
+        if (quantization.bits_)
+        {
+            const float component = Clamp(components[i], quantization.minValue_, quantization.maxValue_);
+            dest.data_[i] = Clamp(RoundToInt((component - quantization.minValue_) / quantization.precision_), 0,
+                quantization.maxSteps_);
+        }
+        else
+        {
+            const float steps = Clamp(components[i] / quantization.precision_, (float)-MAX_QUANTIZED_COMPONENT,
+                (float)MAX_QUANTIZED_COMPONENT);
+            dest.data_[i] = RoundToInt(steps);
+        }
+    }
+}
+
+/// Return a network attribute value from a quantized value.
+static Variant Dequantize(const NetworkQuantization& quantization, VariantType type, const QuantizedValue& value)
+{
+    if (quantization.quaternion_)
+    {
+        const float scale = (2.0f * QUATERNION_COMPONENT_LIMIT) / quantization.maxSteps_;
+        const unsigned largest = (unsigned)value.data_[0] & 3u;
+        float data[4];
+        float sumSquares = 0.0f;
+        for (unsigned i = 0, j = 1; i < 4; ++i)
+        {
+            if (i != largest)
+            {
+                data[i] = value.data_[j++] * scale - QUATERNION_COMPONENT_LIMIT;
+                sumSquares += data[i] * data[i];
+            }
+        }
+        data[largest] = sqrtf(Max(1.0f - sumSquares, 0.0f));
+        return Quaternion(data[0], data[1], data[2], data[3]).Normalized();
+    }
+
+    float components[4]{};
+    for (unsigned i = 0; i < quantization.numComponents_; ++i)
+    {
+        if (quantization.bits_)
+            components[i] = Min(quantization.minValue_ + value.data_[i] * quantization.precision_, quantization.maxValue_);
+        else
+            components[i] = value.data_[i] * quantization.precision_;
+    }
+
+    switch (type)
+    {
+    case VAR_VECTOR2: return Vector2(components);
+    case VAR_VECTOR3: return Vector3(components);
+    case VAR_VECTOR4: return Vector4(components);
+    default: return components[0];
+    }
+}
+
+/// Write an absolute quantized value.
+static void WriteAbsolute(BitWriter& dest, const NetworkQuantization& quantization, const QuantizedValue& value)
+{
+    if (quantization.quaternion_)
+    {
+        dest.WriteBits((unsigned)value.data_[0], 2);
+        for (unsigned i = 1; i < 4; ++i)
+            dest.WriteBits((unsigned)value.data_[i], quantization.bits_);
+    }
+    else if (quantization.bits_)
+    {
+        for (unsigned i = 0; i < quantization.numComponents_; ++i)
+            dest.WriteBits((unsigned)value.data_[i], quantization.bits_);
+    }
+    else
+    {
+        for (unsigned i = 0; i < quantization.numComponents_; ++i)
+        {
+            const unsigned encoded = BitWriter::ZigZagEncode(value.data_[i]);
+            const unsigned length = encoded ? LogBaseTwo(encoded) + 1 : 0;
+            dest.WriteBits(length, QUANTIZED_LENGTH_BITS);
+            dest.WriteBits(encoded, length);
+        }
+    }
+}
+
+/// Read an absolute quantized value.
+static void ReadAbsolute(BitReader& source, const NetworkQuantization& quantization, QuantizedValue& value)
+{
+    if (quantization.quaternion_)
+    {
+        value.data_[0] = (int)source.ReadBits(2);
+        for (unsigned i = 1; i < 4; ++i)
+            value.data_[i] = (int)source.ReadBits(quantization.bits_);
+    }
+    else if (quantization.bits_)
+    {
+        for (unsigned i = 0; i < quantization.numComponents_; ++i)
+            value.data_[i] = Min((int)source.ReadBits(quantization.bits_), quantization.maxSteps_);
+    }
+    else
+    {
+        for (unsigned i = 0; i < quantization.numComponents_; ++i)
+        {
+            const unsigned length = source.ReadBits(QUANTIZED_LENGTH_BITS);
+            value.data_[i] = BitReader::ZigZagDecode(source.ReadBits(length));
+        }
+    }
+}
+
+/// Write a network attribute value, quantized if the attribute has quantization metadata.
+static void WriteNetworkValue(BitWriter& dest, const AttributeInfo& attr, const Variant& value)
+{
+    NetworkQuantization quantization;
+    if (!GetNetworkQuantization(attr, quantization))
+    {
+        dest.WriteVariantData(value);
+        return;
+    }
+
+    QuantizedValue quantized;
+    Quantize(quantization, value, quantized);
+    WriteAbsolute(dest, quantization, quantized);
+}
+
+/// Read a network attribute value written with WriteNetworkValue().
+static Variant ReadNetworkValue(BitReader& source, const AttributeInfo& attr)
+{
+    NetworkQuantization quantization;
+    if (!GetNetworkQuantization(attr, quantization))
+        return source.ReadVariant(attr.type_);
+
+    QuantizedValue quantized;
+    ReadAbsolute(source, quantization, quantized);
+    return Dequantize(quantization, attr.type_, quantized);
+}
+
 static bool SaveAttributeWithName(Archive& archive, const AttributeInfo& attr, const Variant& value)
 {
     assert(!archive.IsInput());
@@ -998,6 +1255,8 @@ void Serializable::AllocateNetworkState()
         // Copy the default attribute values to the previous state as a starting point
         for (unsigned i = 0; i < numAttributes; ++i)
             networkState_->previousValues_[i] = networkAttributes->at(i).defaultValue_;
+
+        networkState_->InvalidateCache();
     }
 }
 
@@ -1013,26 +1272,39 @@ void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeS
     if (!attributes)
         return;
 
-    unsigned numAttributes = attributes->size();
-    DirtyBits attributeBits;
-
-    // Compare against defaults
-    for (unsigned i = 0; i < numAttributes; ++i)
+    // Serialize once after the values have changed and share the data between all connections
+    MutexLock<SpinLockMutex> lock(networkState_->cacheMutex_);
+    VectorBuffer& cache = networkState_->initialDeltaCache_;
+    if (!networkState_->initialDeltaCacheValid_)
     {
-        const AttributeInfo& attr = attributes->at(i);
-        if (networkState_->currentValues_[i] != attr.defaultValue_)
-            attributeBits.Set(i);
-    }
+        unsigned numAttributes = attributes->size();
+        DirtyBits attributeBits;
 
-    // First write the change bitfield, then attribute data for non-default attributes
-    dest.WriteUByte(timeStamp);
-    dest.Write(attributeBits.data_, (numAttributes + 7) >> 3u);
+        // Compare against defaults
+        for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            const AttributeInfo& attr = attributes->at(i);
+            if (networkState_->currentValues_[i] != attr.defaultValue_)
+                attributeBits.Set(i);
+        }
 
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+        // First write the change bitfield, then attribute data for non-default attributes
+        cache.Clear();
+        cache.Write(attributeBits.data_, (numAttributes + 7) >> 3u);
+
+        BitWriter writer(cache);
+        for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            if (attributeBits.IsSet(i))
+                WriteNetworkValue(writer, attributes->at(i), networkState_->currentValues_[i]);
+        }
+        writer.Flush();
+
+        networkState_->initialDeltaCacheValid_ = true;
     }
+
+    dest.WriteUByte(timeStamp);
+    dest.Write(cache.GetData(), cache.GetSize());
 }
 
 void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp)
@@ -1047,18 +1319,34 @@ void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attribute
     if (!attributes)
         return;
 
-    unsigned numAttributes = attributes->size();
+    // Connections usually share the same dirty bits, serialize once for them. Connections that skipped updates
+    // (for example due to NetworkPriority) have accumulated different bits and replace the cached data
+    MutexLock<SpinLockMutex> lock(networkState_->cacheMutex_);
+    VectorBuffer& cache = networkState_->deltaCache_;
+    DirtyBits& cacheBits = networkState_->deltaCacheBits_;
+    if (!networkState_->deltaCacheValid_ || memcmp(cacheBits.data_, attributeBits.data_, sizeof attributeBits.data_) != 0)
+    {
+        unsigned numAttributes = attributes->size();
 
-    // First write the change bitfield, then attribute data for changed attributes
-    // Note: the attribute bits should not contain LATESTDATA attributes
-    dest.WriteUByte(timeStamp);
-    dest.Write(attributeBits.data_, (numAttributes + 7) >> 3u);
+        // First write the change bitfield, then attribute data for changed attributes
+        // Note: the attribute bits should not contain LATESTDATA attributes
+        cache.Clear();
+        cache.Write(attributeBits.data_, (numAttributes + 7) >> 3u);
 
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+        BitWriter writer(cache);
+        for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            if (attributeBits.IsSet(i))
+                WriteNetworkValue(writer, attributes->at(i), networkState_->currentValues_[i]);
+        }
+        writer.Flush();
+
+        cacheBits = attributeBits;
+        networkState_->deltaCacheValid_ = true;
     }
+
+    dest.WriteUByte(timeStamp);
+    dest.Write(cache.GetData(), cache.GetSize());
 }
 
 void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp)
@@ -1073,15 +1361,26 @@ void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeSta
     if (!attributes)
         return;
 
-    unsigned numAttributes = attributes->size();
+    MutexLock<SpinLockMutex> lock(networkState_->cacheMutex_);
+    VectorBuffer& cache = networkState_->latestDataCache_;
+    if (!networkState_->latestDataCacheValid_)
+    {
+        unsigned numAttributes = attributes->size();
 
-    dest.WriteUByte(timeStamp);
+        cache.Clear();
+        BitWriter writer(cache);
+        for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            if (attributes->at(i).mode_ & AM_LATESTDATA)
+                WriteNetworkValue(writer, attributes->at(i), networkState_->currentValues_[i]);
+        }
+        writer.Flush();
 
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributes->at(i).mode_ & AM_LATESTDATA)
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+        networkState_->latestDataCacheValid_ = true;
     }
+
+    dest.WriteUByte(timeStamp);
+    dest.Write(cache.GetData(), cache.GetSize());
 }
 
 bool Serializable::ReadDeltaUpdate(Deserializer& source)
@@ -1098,14 +1397,16 @@ bool Serializable::ReadDeltaUpdate(Deserializer& source)
     unsigned char timeStamp = source.ReadUByte();
     source.Read(attributeBits.data_, (numAttributes + 7) >> 3u);
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    BitReader reader(source);
+    for (unsigned i = 0; i < numAttributes && !reader.IsEof(); ++i)
     {
         if (attributeBits.IsSet(i))
         {
             const AttributeInfo& attr = attributes->at(i);
+            const Variant value = ReadNetworkValue(reader, attributes->at(i));
             if (!(interceptMask & (1ULL << i)))
             {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+                OnSetAttribute(attr, value);
                 changed = true;
             }
             else
@@ -1117,7 +1418,7 @@ bool Serializable::ReadDeltaUpdate(Deserializer& source)
                 eventData[P_TIMESTAMP] = (unsigned)timeStamp;
                 eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
                 eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
+                eventData[P_VALUE] = value;
                 SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
             }
         }
@@ -1138,14 +1439,16 @@ bool Serializable::ReadLatestDataUpdate(Deserializer& source)
     unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
     unsigned char timeStamp = source.ReadUByte();
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    BitReader reader(source);
+    for (unsigned i = 0; i < numAttributes && !reader.IsEof(); ++i)
     {
         const AttributeInfo& attr = attributes->at(i);
         if (attr.mode_ & AM_LATESTDATA)
         {
+            const Variant value = ReadNetworkValue(reader, attributes->at(i));
             if (!(interceptMask & (1ULL << i)))
             {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+                OnSetAttribute(attr, value);
                 changed = true;
             }
             else
@@ -1157,7 +1460,7 @@ bool Serializable::ReadLatestDataUpdate(Deserializer& source)
                 eventData[P_TIMESTAMP] = (unsigned)timeStamp;
                 eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
                 eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
+                eventData[P_VALUE] = value;
                 SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
             }
         }
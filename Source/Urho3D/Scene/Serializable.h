@@ -249,6 +249,14 @@ namespace AttributeMetadata
 {
     /// Names of vector struct elements. StringVector.
     static const StringHash P_VECTOR_STRUCT_ELEMENTS = "VectorStructElements";
+    /// Quantization step of float and vector components in network replication. Float.
+    static const StringHash P_NET_PRECISION = "NetPrecision";
+    /// Minimum component value of a quantized network attribute. Sent with a fixed number of bits when both limits are set. Float.
+    static const StringHash P_NET_MIN_VALUE = "NetMinValue";
+    /// Maximum component value of a quantized network attribute. Float.
+    static const StringHash P_NET_MAX_VALUE = "NetMaxValue";
+    /// Bits per component of a quaternion network attribute sent with smallest-three encoding. Int.
+    static const StringHash P_NET_QUATERNION_BITS = "NetQuaternionBits";
 }
 
 // The following macros need to be used within a class member function such as ClassName::RegisterObject().
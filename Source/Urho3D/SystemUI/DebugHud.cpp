@@ -31,6 +31,7 @@
 #include "../Graphics/Renderer.h"
 #include "../Graphics/GraphicsEvents.h"
 #include "../IO/Log.h"
+#include "../Resource/ResourceCache.h"
 #include "../UI/UI.h"
 #include "../SystemUI/SystemUI.h"
 #include "../SystemUI/DebugHud.h"
@@ -182,6 +183,52 @@ void DebugHud::RenderUI(DebugHudModeFlags mode)
         }
     }
 
+    if (mode & DEBUGHUD_SHOW_MEMORY)
+    {
+        auto* cache = GetSubsystem<ResourceCache>();
+        float left_offset = ui::GetCursorPos().x;
+
+        // Show the live memory use of each resource type against its budget, and how many resources have been reduced to fit
+        ea::vector<ea::pair<ea::string, const ResourceGroup*> > groups;
+        for (auto i = cache->GetAllResources().begin(); i != cache->GetAllResources().end(); ++i)
+        {
+            if (!i->second.resources_.empty())
+                groups.emplace_back(context_->GetTypeName(i->first), &i->second);
+        }
+        ea::quick_sort(groups.begin(), groups.end());
+
+        for (auto i = groups.begin(); i != groups.end(); ++i)
+        {
+            const ResourceGroup& group = *i->second;
+            unsigned numReduced = 0;
+            for (auto j = group.resources_.begin(); j != group.resources_.end(); ++j)
+            {
+                if (j->second->IsMemoryUseReduced())
+                    ++numReduced;
+            }
+
+            ea::string line = i->first + " " + GetFileSizeString(group.memoryUse_);
+            if (group.memoryBudget_)
+                line += " / " + GetFileSizeString(group.memoryBudget_);
+            if (numReduced)
+                line.append_sprintf(" (%u reduced)", numReduced);
+            ui::Text("%s", line.c_str());
+            ui::SetCursorPosX(left_offset);
+        }
+
+        ea::string total = "Total " + GetFileSizeString(cache->GetTotalMemoryUse());
+        if (cache->GetTotalMemoryBudget())
+            total += " / " + GetFileSizeString(cache->GetTotalMemoryBudget());
+        ui::Text("%s", total.c_str());
+        ui::SetCursorPosX(left_offset);
+
+        if (renderer && renderer->GetNumStreamedTextures())
+        {
+            ui::Text("Streamed textures %u", renderer->GetNumStreamedTextures());
+            ui::SetCursorPosX(left_offset);
+        }
+    }
+
     if (mode & DEBUGHUD_SHOW_MODE)
     {
         const ImGuiStyle& style = ui::GetStyle();
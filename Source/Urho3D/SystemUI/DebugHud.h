@@ -38,6 +38,7 @@ enum DebugHudMode : unsigned
     DEBUGHUD_SHOW_NONE = 0x0,
     DEBUGHUD_SHOW_STATS = 0x1,
     DEBUGHUD_SHOW_MODE = 0x2,
+    DEBUGHUD_SHOW_MEMORY = 0x4,
     DEBUGHUD_SHOW_ALL = 0x7,
 };
 URHO3D_FLAGSET(DebugHudMode, DebugHudModeFlags);
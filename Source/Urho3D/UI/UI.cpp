@@ -452,6 +452,17 @@ void UI::RenderUpdate()
         GetBatches(batches_, vertexData_, cursor_, currentScissor);
     }
 
+    // Keep the textures drawn with resident when the resource cache enforces memory budgets
+    Texture* lastTexture = nullptr;
+    for (const UIBatch& batch : batches_)
+    {
+        if (batch.texture_ && batch.texture_ != lastTexture)
+        {
+            batch.texture_->MarkUsed();
+            lastTexture = batch.texture_;
+        }
+    }
+
     // UIElement does not have anything to show. Insert dummy batch that will clear the texture.
     if (batches_.empty() && texture_)
     {
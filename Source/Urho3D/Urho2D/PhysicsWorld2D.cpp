@@ -24,6 +24,8 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/Renderer.h"
@@ -45,6 +47,77 @@ extern const char* SUBSYSTEM_CATEGORY;
 static const Vector2 DEFAULT_GRAVITY(0.0f, -9.81f);
 static const int DEFAULT_VELOCITY_ITERATIONS = 8;
 static const int DEFAULT_POSITION_ITERATIONS = 3;
+/// Minimum number of rigid bodies to convert transforms on WorkQueue threads.
+static const unsigned MIN_THREADED_TRANSFORM_BODIES = 256;
+
+/// Box2D task scheduler which splits the island solving between WorkQueue threads.
+class PhysicsTaskScheduler2D : public b2TaskScheduler
+{
+public:
+    /// Construct.
+    explicit PhysicsTaskScheduler2D(WorkQueue* workQueue) :
+        workQueue_(workQueue)
+    {
+    }
+
+    /// Return number of threads including the calling one.
+    int32 GetNumThreads() const override { return static_cast<int32>(workQueue_->GetNumThreads()) + 1; }
+
+    /// Execute task over the range [0, count) and wait for completion.
+    void ParallelFor(int32 count, b2Task task, void* context) override
+    {
+        // WorkQueue can only be completed from the main thread
+        const int32 numItems = Thread::IsMainThread() ? Min(count, GetNumThreads()) : 1;
+        if (numItems <= 1)
+        {
+            task(context, 0, count);
+            return;
+        }
+
+        const int32 countPerItem = (count + numItems - 1) / numItems;
+
+        ranges_.resize(numItems);
+        int32 begin = 0;
+        for (int32 i = 0; i < numItems; ++i)
+        {
+            TaskRange& range = ranges_[i];
+            range.task_ = task;
+            range.context_ = context;
+            range.begin_ = begin;
+            range.end_ = Min(begin + countPerItem, count);
+            begin = range.end_;
+
+            SharedPtr<WorkItem> item = workQueue_->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = RunTaskRange;
+            item->start_ = &range;
+            workQueue_->AddWorkItem(item);
+        }
+        workQueue_->Complete(M_MAX_UNSIGNED);
+    }
+
+private:
+    /// Subrange of a task.
+    struct TaskRange
+    {
+        b2Task task_{};
+        void* context_{};
+        int32 begin_{};
+        int32 end_{};
+    };
+
+    /// Execute task subrange.
+    static void RunTaskRange(const WorkItem* item, unsigned /*threadIndex*/)
+    {
+        const auto* range = static_cast<const TaskRange*>(item->start_);
+        range->task_(range->context_, range->begin_, range->end_);
+    }
+
+    /// Work queue.
+    WorkQueue* workQueue_;
+    /// Task subranges.
+    ea::vector<TaskRange> ranges_;
+};
 
 PhysicsWorld2D::PhysicsWorld2D(Context* context) :
     Component(context),
@@ -61,6 +134,10 @@ PhysicsWorld2D::PhysicsWorld2D(Context* context) :
     world_->SetContactListener(this);
     // Set debug draw
     world_->SetDebugDraw(this);
+
+    // Create the task scheduler for solving islands in parallel. It is used once threading is enabled
+    if (auto* workQueue = GetSubsystem<WorkQueue>())
+        taskScheduler_ = ea::make_unique<PhysicsTaskScheduler2D>(workQueue);
 }
 
 PhysicsWorld2D::~PhysicsWorld2D()
@@ -89,6 +166,7 @@ void PhysicsWorld2D::RegisterObject(Context* context)
         AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Position Iterations", GetPositionIterations, SetPositionIterations, int, DEFAULT_POSITION_ITERATIONS,
         AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Threaded", IsThreaded, SetThreaded, bool, false, AM_DEFAULT);
 }
 
 void PhysicsWorld2D::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
@@ -292,19 +370,7 @@ void PhysicsWorld2D::Update(float timeStep)
     physicsStepping_ = false;
 
     // Apply world transforms. Unparented transforms first
-    for (unsigned i = 0; i < rigidBodies_.size();)
-    {
-        if (rigidBodies_[i])
-        {
-            rigidBodies_[i]->ApplyWorldTransform();
-            ++i;
-        }
-        else
-        {
-            // Erase possible stale weak pointer
-            rigidBodies_.erase_at(i);
-        }
-    }
+    ApplyWorldTransforms();
 
     // Apply delayed (parented) world transforms now, if any
     while (!delayedWorldTransforms_.empty())
@@ -332,6 +398,72 @@ void PhysicsWorld2D::Update(float timeStep)
     SendEvent(E_PHYSICSPOSTSTEP, eventData);
 }
 
+void PhysicsWorld2D::ApplyWorldTransforms()
+{
+    auto* workQueue = GetSubsystem<WorkQueue>();
+    const bool threaded = threaded_ && workQueue && workQueue->GetNumThreads() > 0
+        && rigidBodies_.size() >= MIN_THREADED_TRANSFORM_BODIES;
+
+    if (!threaded)
+    {
+        for (unsigned i = 0; i < rigidBodies_.size();)
+        {
+            if (rigidBodies_[i])
+            {
+                rigidBodies_[i]->ApplyWorldTransform();
+                ++i;
+            }
+            else
+            {
+                // Erase possible stale weak pointer
+                rigidBodies_.erase_at(i);
+            }
+        }
+        return;
+    }
+
+    // Erase possible stale weak pointers
+    rigidBodies_.erase(ea::remove_if(rigidBodies_.begin(), rigidBodies_.end(),
+        [](const WeakPtr<RigidBody2D>& rigidBody) { return !rigidBody; }), rigidBodies_.end());
+
+    // Convert Box2D transforms on worker threads, then assign them to the nodes serially.
+    // Take a snapshot of the rigid bodies, as they may be removed while applying the transforms
+    bodyTransforms_.resize(rigidBodies_.size());
+    for (unsigned i = 0; i < rigidBodies_.size(); ++i)
+        bodyTransforms_[i].rigidBody_ = rigidBodies_[i];
+
+    const unsigned numItems = Min(bodyTransforms_.size(), workQueue->GetNumThreads() + 1);
+    const unsigned bodiesPerItem = (bodyTransforms_.size() + numItems - 1) / numItems;
+    for (unsigned i = 0; i < numItems; ++i)
+    {
+        SharedPtr<WorkItem> item = workQueue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = [](const WorkItem* item, unsigned /*threadIndex*/)
+        {
+            auto* world = static_cast<PhysicsWorld2D*>(item->aux_);
+            const unsigned begin = static_cast<unsigned>(reinterpret_cast<size_t>(item->start_));
+            const unsigned end = static_cast<unsigned>(reinterpret_cast<size_t>(item->end_));
+            for (unsigned j = begin; j < end; ++j)
+            {
+                BodyTransform& transform = world->bodyTransforms_[j];
+                transform.rigidBody_->CalculateBodyTransform(transform.position_, transform.rotation_);
+            }
+        };
+        item->start_ = reinterpret_cast<void*>(static_cast<size_t>(i * bodiesPerItem));
+        item->end_ = reinterpret_cast<void*>(static_cast<size_t>(Min((i + 1) * bodiesPerItem, bodyTransforms_.size())));
+        item->aux_ = this;
+        workQueue->AddWorkItem(item);
+    }
+    workQueue->Complete(M_MAX_UNSIGNED);
+
+    for (const BodyTransform& transform : bodyTransforms_)
+    {
+        if (transform.rigidBody_)
+            transform.rigidBody_->ApplyWorldTransform(transform.position_, transform.rotation_);
+    }
+    bodyTransforms_.clear();
+}
+
 void PhysicsWorld2D::DrawDebugGeometry()
 {
     auto* debug = GetComponent<DebugRenderer>();
@@ -344,6 +476,12 @@ void PhysicsWorld2D::SetUpdateEnabled(bool enable)
     updateEnabled_ = enable;
 }
 
+void PhysicsWorld2D::SetThreaded(bool enable)
+{
+    threaded_ = enable;
+    world_->SetTaskScheduler(threaded_ ? taskScheduler_.get() : nullptr);
+}
+
 void PhysicsWorld2D::SetDrawShape(bool drawShape)
 {
     if (drawShape)
@@ -152,6 +152,9 @@ public:
     /// Set position iterations.
     /// @property
     void SetPositionIterations(int positionIterations);
+    /// Set whether to solve islands and convert body transforms on WorkQueue threads. Disabled by default, has effect only when worker threads exist.
+    /// @property
+    void SetThreaded(bool enable);
     /// Add rigid body.
     void AddRigidBody(RigidBody2D* rigidBody);
     /// Remove rigid body.
@@ -224,6 +227,10 @@ public:
     /// @property
     int GetPositionIterations() const { return positionIterations_; }
 
+    /// Return whether islands are solved and body transforms converted on WorkQueue threads.
+    /// @property
+    bool IsThreaded() const { return threaded_; }
+
     /// Return the Box2D physics world.
     b2World* GetWorld() { return world_.get(); }
 
@@ -243,6 +250,8 @@ protected:
     void SendBeginContactEvents();
     /// Send end contact events.
     void SendEndContactEvents();
+    /// Apply world transforms of the rigid bodies to the scene nodes.
+    void ApplyWorldTransforms();
 
     /// Box2D physics world.
     ea::unique_ptr<b2World> world_;
@@ -270,6 +279,23 @@ protected:
     ea::vector<WeakPtr<RigidBody2D> > rigidBodies_;
     /// Delayed (parented) world transform assignments.
     ea::unordered_map<RigidBody2D*, DelayedWorldTransform2D> delayedWorldTransforms_;
+    /// Threaded island solving and transform conversion flag.
+    bool threaded_{false};
+    /// Box2D task scheduler executing on WorkQueue threads.
+    ea::unique_ptr<b2TaskScheduler> taskScheduler_;
+
+    /// Box2D body transform calculated on a WorkQueue thread.
+    struct BodyTransform
+    {
+        /// Rigid body.
+        WeakPtr<RigidBody2D> rigidBody_;
+        /// Body world position.
+        Vector2 position_;
+        /// Body world rotation.
+        Quaternion rotation_;
+    };
+    /// Body transforms calculated on WorkQueue threads.
+    ea::vector<BodyTransform> bodyTransforms_;
 
     /// Contact info.
     struct ContactInfo
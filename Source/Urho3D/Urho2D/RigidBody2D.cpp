@@ -419,6 +419,17 @@ void RigidBody2D::ReleaseBody()
 }
 
 void RigidBody2D::ApplyWorldTransform()
+{
+    if (!body_ || !node_)
+        return;
+
+    Vector2 bodyPosition;
+    Quaternion bodyRotation;
+    CalculateBodyTransform(bodyPosition, bodyRotation);
+    ApplyWorldTransform(bodyPosition, bodyRotation);
+}
+
+void RigidBody2D::ApplyWorldTransform(const Vector2& bodyPosition, const Quaternion& bodyRotation)
 {
     if (!body_ || !node_)
         return;
@@ -434,11 +445,10 @@ void RigidBody2D::ApplyWorldTransform()
     if (!parentRigidBody && (!body_->IsActive() || body_->GetType() == b2_staticBody || !body_->IsAwake()))
         return;
 
-    const b2Transform& transform = body_->GetTransform();
     Vector3 newWorldPosition = node_->GetWorldPosition();
-    newWorldPosition.x_ = transform.p.x;
-    newWorldPosition.y_ = transform.p.y;
-    Quaternion newWorldRotation(transform.q.GetAngle() * M_RADTODEG, Vector3::FORWARD);
+    newWorldPosition.x_ = bodyPosition.x_;
+    newWorldPosition.y_ = bodyPosition.y_;
+    const Quaternion& newWorldRotation = bodyRotation;
 
     if (parentRigidBody)
     {
@@ -465,6 +475,16 @@ void RigidBody2D::ApplyWorldTransform(const Vector3& newWorldPosition, const Qua
     }
 }
 
+void RigidBody2D::CalculateBodyTransform(Vector2& bodyPosition, Quaternion& bodyRotation) const
+{
+    if (!body_)
+        return;
+
+    const b2Transform& transform = body_->GetTransform();
+    bodyPosition = ToVector2(transform.p);
+    bodyRotation = Quaternion(transform.q.GetAngle() * M_RADTODEG, Vector3::FORWARD);
+}
+
 void RigidBody2D::AddCollisionShape2D(CollisionShape2D* collisionShape)
 {
     if (!collisionShape)
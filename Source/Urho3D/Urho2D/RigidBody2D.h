@@ -124,6 +124,10 @@ public:
 
     /// Apply world transform from the Box2D body. Called by PhysicsWorld2D.
     void ApplyWorldTransform();
+    /// Apply world transform from the precalculated Box2D body position & rotation. Called by PhysicsWorld2D.
+    void ApplyWorldTransform(const Vector2& bodyPosition, const Quaternion& bodyRotation);
+    /// Calculate world position & rotation of the Box2D body. Does not access the scene, may be called from worker threads.
+    void CalculateBodyTransform(Vector2& bodyPosition, Quaternion& bodyRotation) const;
     /// Apply specified world position & rotation. Called by PhysicsWorld2D.
     void ApplyWorldTransform(const Vector3& newWorldPosition, const Quaternion& newWorldRotation);
     /// Add collision shape.